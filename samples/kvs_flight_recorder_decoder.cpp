@@ -0,0 +1,70 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+#include <vector>
+
+#include "FlightRecorder.h"
+
+using namespace std;
+using namespace com::amazonaws::kinesis::video;
+
+#define APP_NAME "kvs_flight_recorder_decoder"
+#define LOG_ERROR(fmt, ...) \
+  do { fprintf(stderr, "[ERROR] " APP_NAME ": " fmt "\n", ##__VA_ARGS__); } while(0)
+
+#define NANOS_IN_A_SECOND 1000000000ULL
+
+static void print_usage(char* program_path) {
+    printf("USAGE\n"
+           "    %s <flight_recorder_dump_file> [stream_handle]\n\n"
+           "Prints the flight recorder entries from the oldest to the newest, optionally only the ones of the given stream handle.\n",
+           program_path);
+}
+
+static void print_timestamp(uint64_t timestamp) {
+    char time_string[32];
+    time_t seconds = (time_t) (timestamp / NANOS_IN_A_SECOND);
+    strftime(time_string, sizeof(time_string), "%Y-%m-%dT%H:%M:%S", gmtime(&seconds));
+    printf("%s.%09" PRIu64 "Z", time_string, timestamp % NANOS_IN_A_SECOND);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2 || argc > 3 || strcmp(argv[1], "--help") == 0 || strcmp(argv[1], "-h") == 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    bool filter_stream = argc == 3;
+    uint64_t stream_handle = filter_stream ? strtoull(argv[2], NULL, 0) : 0;
+
+    FlightRecorderFileHeader header;
+    vector<FlightRecorderEntry> entries;
+    if (!FlightRecorder::readDumpFile(argv[1], header, entries)) {
+        LOG_ERROR("%s is not a valid flight recorder dump file", argv[1]);
+        return 1;
+    }
+
+    if (FLIGHT_RECORDER_DUMP_REASON_ON_DEMAND == header.reason) {
+        printf("# dumped on demand");
+    } else {
+        printf("# dumped on signal %u", header.reason);
+    }
+
+    printf(", %" PRIu64 " entries, %" PRIu64 " earlier entries overwritten\n", header.entry_count, header.overwritten_count);
+    printf("# timestamp stream_handle event status value aux\n");
+
+    for (const auto& entry : entries) {
+        if (filter_stream && entry.stream_handle != stream_handle) {
+            continue;
+        }
+
+        print_timestamp(entry.timestamp);
+        printf(" 0x%" PRIx64 " %s 0x%08x %" PRIu64 " %u\n", entry.stream_handle,
+               FlightRecorder::getEventName(entry.event), entry.status, entry.value, entry.aux);
+    }
+
+    return 0;
+}
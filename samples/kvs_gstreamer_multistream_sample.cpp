@@ -50,7 +50,6 @@ LOGGER_TAG("com.amazonaws.kinesis.video.gstreamer");
 #define DEFAULT_CODEC_ID "V_MPEG4/ISO/AVC"
 #define DEFAULT_TRACKNAME "kinesis_video"
 #define APP_SINK_BASE_NAME "appsink"
-#define DEFAULT_BUFFER_SIZE (1 * 1024 * 1024)
 #define DEFAULT_STORAGE_SIZE (128 * 1024 * 1024)
 #define DEFAULT_ROTATION_TIME_SECONDS 3600
 
@@ -175,8 +174,6 @@ typedef struct _CustomData {
     map<string, shared_ptr<KinesisVideoStream>> kinesis_video_stream_handles;
     vector<GstElement *> pipelines;
     map<string, bool> stream_started;
-    map<string, uint8_t*> frame_data_map;
-    map<string, UINT32> frame_data_size_map;
     // Pts of first frame
     map<string, uint64_t> first_pts_map;
     map<string, uint64_t> producer_start_time_map;
@@ -194,11 +191,31 @@ void create_kinesis_video_frame(Frame *frame, const nanoseconds &pts, const nano
     frame->trackId = DEFAULT_TRACK_ID;
 }
 
-bool put_frame(shared_ptr<KinesisVideoStream> kinesis_video_stream, void *data, size_t len, const nanoseconds &pts,
+bool put_frame(const shared_ptr<KinesisVideoStream> &kinesis_video_stream, FrameBuffer frame_buffer, const nanoseconds &pts,
                const nanoseconds &dts, FRAME_FLAGS flags) {
     Frame frame;
-    create_kinesis_video_frame(&frame, pts, dts, flags, data, len);
-    return kinesis_video_stream->putFrame(frame);
+    create_kinesis_video_frame(&frame, pts, dts, flags, frame_buffer.data(), frame_buffer.size());
+    return kinesis_video_stream->putFrame(frame, move(frame_buffer));
+}
+
+/* Hands the mapped buffer over to the SDK instead of copying the payload out of it */
+bool map_frame_buffer(GstBuffer *buffer, FrameBuffer &frame_buffer) {
+    GstMapInfo *info = g_new0(GstMapInfo, 1);
+
+    gst_buffer_ref(buffer);
+    if (!gst_buffer_map(buffer, info, GST_MAP_READ)) {
+        g_free(info);
+        gst_buffer_unref(buffer);
+        return false;
+    }
+
+    frame_buffer = FrameBuffer(info->data, info->size, [buffer, info](uint8_t *, size_t) {
+        gst_buffer_unmap(buffer, info);
+        g_free(info);
+        gst_buffer_unref(buffer);
+    });
+
+    return true;
 }
 
 static GstFlowReturn on_new_sample(GstElement *sink, CustomData *data) {
@@ -222,7 +239,6 @@ static GstFlowReturn on_new_sample(GstElement *sink, CustomData *data) {
     }
 
     GstBuffer *buffer = gst_sample_get_buffer(sample);
-    size_t buffer_size = gst_buffer_get_size(buffer);
 
     isHeader = GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_HEADER);
     isDroppable = GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_CORRUPTED) ||
@@ -233,16 +249,6 @@ static GstFlowReturn on_new_sample(GstElement *sink, CustomData *data) {
                   (isHeader && (!GST_BUFFER_PTS_IS_VALID(buffer) || !GST_BUFFER_DTS_IS_VALID(buffer)));
 
     if (!isDroppable) {
-        UINT32 frame_data_size = data->frame_data_size_map[stream_handle_key];
-        if (frame_data_size < buffer_size) {
-            frame_data_size = frame_data_size * 2;
-            delete [] data->frame_data_map[stream_handle_key];
-            data->frame_data_size_map[stream_handle_key] = frame_data_size;
-            data->frame_data_map[stream_handle_key] = new uint8_t[frame_data_size];
-        }
-
-        gst_buffer_extract(buffer, 0, data->frame_data_map[stream_handle_key], buffer_size);
-
         bool delta = GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT);
         FRAME_FLAGS kinesis_video_flags;
 
@@ -259,7 +265,9 @@ static GstFlowReturn on_new_sample(GstElement *sink, CustomData *data) {
 
         buffer->pts += data->producer_start_time_map[stream_handle_key] - data->first_pts_map[stream_handle_key];
 
-        if (false == put_frame(data->kinesis_video_stream_handles[stream_handle_key], data->frame_data_map[stream_handle_key], buffer_size, std::chrono::nanoseconds(buffer->pts),
+        FrameBuffer frame_buffer;
+        if (!map_frame_buffer(buffer, frame_buffer) ||
+            false == put_frame(data->kinesis_video_stream_handles[stream_handle_key], move(frame_buffer), std::chrono::nanoseconds(buffer->pts),
                                std::chrono::nanoseconds(buffer->dts), kinesis_video_flags)) {
             GST_WARNING("Dropped frame");
         }
@@ -361,8 +369,6 @@ void kinesis_stream_init(string stream_name, CustomData *data, string stream_han
         0));
     auto kvs_stream = data->kinesis_video_producer->createStreamSync(move(stream_definition));
     data->kinesis_video_stream_handles[stream_handle_key] = kvs_stream;
-    data->frame_data_size_map[stream_handle_key] = DEFAULT_BUFFER_SIZE;
-    data->frame_data_map[stream_handle_key] = new uint8_t[DEFAULT_BUFFER_SIZE];
     LOG_DEBUG("Stream is ready: " << stream_name);
 }
 
@@ -400,8 +406,6 @@ int gstreamer_init(int argc, char *argv[]) {
     data.kinesis_video_stream_handles = map<string, shared_ptr<KinesisVideoStream>>();
     data.stream_started = map<string, bool>();
     data.pipelines = vector<GstElement *>();
-    data.frame_data_map = map<string, uint8_t*>();
-    data.frame_data_size_map = map<string, UINT32>();
     data.first_pts_map = map<string, uint64_t>();
     data.producer_start_time_map = map<string, uint64_t>();;
 
@@ -507,10 +511,6 @@ CleanUp:
         gst_object_unref(pipeline);
     }
 
-    for (auto frame_data : data.frame_data_map) {
-        delete [] frame_data.second;
-    }
-
     return 0;
 }
 
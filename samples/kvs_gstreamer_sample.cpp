@@ -49,6 +49,7 @@ LOGGER_TAG("com.amazonaws.kinesis.video.gstreamer");
 #define DEFAULT_FRAME_DURATION_MS 1
 #define DEFAULT_CREDENTIAL_ROTATION_SECONDS 3600
 #define DEFAULT_CREDENTIAL_EXPIRATION_SECONDS 180
+#define ASYNC_INGEST_QUEUE_CAPACITY_ENV_VAR "ASYNC_INGEST_QUEUE_CAPACITY"
 
 typedef enum _StreamSource {
     FILE_SOURCE,
@@ -323,7 +324,7 @@ void create_kinesis_video_frame(Frame *frame, const nanoseconds &pts, const nano
     frame->trackId = DEFAULT_TRACK_ID;
 }
 
-bool put_frame(shared_ptr<KinesisVideoStream> kinesis_video_stream, void *data, size_t len, const nanoseconds &pts, const nanoseconds &dts, FRAME_FLAGS flags) {
+bool put_frame(const shared_ptr<KinesisVideoStream> &kinesis_video_stream, void *data, size_t len, const nanoseconds &pts, const nanoseconds &dts, FRAME_FLAGS flags) {
     Frame frame;
     create_kinesis_video_frame(&frame, pts, dts, flags, data, len);
     return kinesis_video_stream->putFrame(frame);
@@ -582,6 +583,13 @@ void kinesis_video_stream_init(CustomData *data) {
         DEFAULT_TRACKNAME,
         nullptr,
         0));
+
+    // Decouple the appsink thread from the content store contention when requested
+    char const *async_ingest_queue_capacity;
+    if (nullptr != (async_ingest_queue_capacity = getenv(ASYNC_INGEST_QUEUE_CAPACITY_ENV_VAR))) {
+        stream_definition->setAsyncIngestQueueCapacity((uint32_t) std::stoul(async_ingest_queue_capacity));
+    }
+
     data->kinesis_video_stream = data->kinesis_video_producer->createStreamSync(move(stream_definition));
 
     // reset state
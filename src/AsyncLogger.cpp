@@ -0,0 +1,671 @@
+#include "Logger.h"
+#include "AsyncLogger.h"
+#include "SdkThread.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+LOGGER_TAG("com.amazonaws.kinesis.video");
+
+using std::string;
+using std::vector;
+using std::shared_ptr;
+
+/**
+ * How often the background thread looks for the new records when idle
+ */
+#define ASYNC_LOG_WRITER_POLL_PERIOD_MILLIS 5
+
+/**
+ * Length marker of a null string argument
+ */
+#define ASYNC_LOG_NULL_STRING_LENGTH 0xFFFF
+
+/**
+ * Largest formatted conversion spec with the '*' width and precision substituted
+ */
+#define ASYNC_LOG_MAX_SPEC_SIZE 64
+
+namespace {
+
+enum ArgKind : uint8_t {
+    ARG_KIND_INT,
+    ARG_KIND_LONG,
+    ARG_KIND_LLONG,
+    ARG_KIND_INTMAX,
+    ARG_KIND_SIZE,
+    ARG_KIND_PTRDIFF,
+    ARG_KIND_DOUBLE,
+    ARG_KIND_LDOUBLE,
+    ARG_KIND_POINTER,
+    ARG_KIND_STRING,
+};
+
+/**
+ * Single printf conversion spec
+ */
+struct FormatSpec {
+    const char* start;
+    const char* end;
+    bool width_star;
+    bool precision_star;
+    ArgKind kind;
+};
+
+/**
+ * Parses the conversion spec starting at the '%'. Returns false for the unsupported conversions.
+ */
+bool parseSpec(const char* start, FormatSpec& spec) {
+    const char* p = start + 1;
+    spec.start = start;
+    spec.width_star = false;
+    spec.precision_star = false;
+
+    while (*p != '\0' && strchr("-+ #0'", *p) != nullptr) {
+        p++;
+    }
+
+    if (*p == '*') {
+        spec.width_star = true;
+        p++;
+    } else {
+        while (*p >= '0' && *p <= '9') {
+            p++;
+        }
+    }
+
+    if (*p == '.') {
+        p++;
+        if (*p == '*') {
+            spec.precision_star = true;
+            p++;
+        } else {
+            while (*p >= '0' && *p <= '9') {
+                p++;
+            }
+        }
+    }
+
+    ArgKind int_kind = ARG_KIND_INT;
+    bool long_double = false;
+    bool wide = false;
+    switch (*p) {
+        case 'h':
+            p += (p[1] == 'h') ? 2 : 1;
+            break;
+        case 'l':
+            if (p[1] == 'l') {
+                int_kind = ARG_KIND_LLONG;
+                p += 2;
+            } else {
+                int_kind = ARG_KIND_LONG;
+                wide = true;
+                p++;
+            }
+            break;
+        case 'q':
+            int_kind = ARG_KIND_LLONG;
+            p++;
+            break;
+        case 'j':
+            int_kind = ARG_KIND_INTMAX;
+            p++;
+            break;
+        case 'z':
+            int_kind = ARG_KIND_SIZE;
+            p++;
+            break;
+        case 't':
+            int_kind = ARG_KIND_PTRDIFF;
+            p++;
+            break;
+        case 'L':
+            long_double = true;
+            p++;
+            break;
+        default:
+            break;
+    }
+
+    switch (*p) {
+        case 'd': case 'i': case 'u': case 'o': case 'x': case 'X':
+            spec.kind = int_kind;
+            break;
+        case 'c':
+            if (wide) {
+                return false;
+            }
+
+            spec.kind = ARG_KIND_INT;
+            break;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+            spec.kind = long_double ? ARG_KIND_LDOUBLE : ARG_KIND_DOUBLE;
+            break;
+        case 's':
+            if (wide) {
+                return false;
+            }
+
+            spec.kind = ARG_KIND_STRING;
+            break;
+        case 'p':
+            spec.kind = ARG_KIND_POINTER;
+            break;
+        default:
+            // %n and the unknown conversions are not deferred
+            return false;
+    }
+
+    spec.end = p + 1;
+    return true;
+}
+
+bool appendPayload(AsyncLogRecord& record, const void* data, size_t size) {
+    if (record.payload_size + size > ASYNC_LOG_RECORD_PAYLOAD_SIZE) {
+        return false;
+    }
+
+    memcpy(record.payload + record.payload_size, data, size);
+    record.payload_size += (uint16_t) size;
+    return true;
+}
+
+template <typename T> bool captureValue(AsyncLogRecord& record, ArgKind kind, T value) {
+    if (record.arg_count == ASYNC_LOG_RECORD_MAX_ARGS) {
+        return false;
+    }
+
+    record.arg_kinds[record.arg_count++] = kind;
+    return appendPayload(record, &value, sizeof(T));
+}
+
+bool captureArgument(AsyncLogRecord& record, ArgKind kind, va_list& args) {
+    switch (kind) {
+        case ARG_KIND_INT:
+            return captureValue(record, kind, va_arg(args, int));
+        case ARG_KIND_LONG:
+            return captureValue(record, kind, va_arg(args, long));
+        case ARG_KIND_LLONG:
+            return captureValue(record, kind, va_arg(args, long long));
+        case ARG_KIND_INTMAX:
+            return captureValue(record, kind, va_arg(args, intmax_t));
+        case ARG_KIND_SIZE:
+            return captureValue(record, kind, va_arg(args, size_t));
+        case ARG_KIND_PTRDIFF:
+            return captureValue(record, kind, va_arg(args, ptrdiff_t));
+        case ARG_KIND_DOUBLE:
+            return captureValue(record, kind, va_arg(args, double));
+        case ARG_KIND_LDOUBLE:
+            return captureValue(record, kind, va_arg(args, long double));
+        case ARG_KIND_POINTER:
+            return captureValue(record, kind, va_arg(args, void*));
+        case ARG_KIND_STRING: {
+            const char* value = va_arg(args, const char*);
+            uint16_t length = ASYNC_LOG_NULL_STRING_LENGTH;
+            if (nullptr != value) {
+                size_t string_length = strlen(value);
+                if (string_length >= ASYNC_LOG_RECORD_PAYLOAD_SIZE) {
+                    return false;
+                }
+
+                length = (uint16_t) string_length;
+            }
+
+            return captureValue(record, kind, length) &&
+                   (ASYNC_LOG_NULL_STRING_LENGTH == length || appendPayload(record, value, length));
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Reads the captured arguments back in the capture order
+ */
+class ArgumentReader {
+public:
+    explicit ArgumentReader(const AsyncLogRecord& record) : record_(record), offset_(0) {
+    }
+
+    template <typename T> T read() {
+        T value;
+        memcpy(&value, record_.payload + offset_, sizeof(T));
+        offset_ += sizeof(T);
+        return value;
+    }
+
+    const char* readString(uint16_t length) {
+        const char* value = reinterpret_cast<const char*>(record_.payload + offset_);
+        offset_ += length;
+        return value;
+    }
+
+private:
+    const AsyncLogRecord& record_;
+    size_t offset_;
+};
+
+/**
+ * Formats a single conversion with the '*' width and precision substituted into the spec
+ */
+void formatConversion(const FormatSpec& spec, ArgumentReader& reader, string& message) {
+    char spec_format[ASYNC_LOG_MAX_SPEC_SIZE];
+    char buffer[ASYNC_LOG_MAX_MESSAGE_SIZE];
+    size_t spec_size = 0;
+
+    for (const char* p = spec.start; p < spec.end && spec_size < ASYNC_LOG_MAX_SPEC_SIZE - 16; p++) {
+        if (*p == '*') {
+            spec_size += snprintf(spec_format + spec_size, ASYNC_LOG_MAX_SPEC_SIZE - spec_size, "%d", reader.read<int>());
+        } else {
+            spec_format[spec_size++] = *p;
+        }
+    }
+
+    spec_format[spec_size] = '\0';
+
+    int size = 0;
+    switch (spec.kind) {
+        case ARG_KIND_INT:
+            size = snprintf(buffer, sizeof(buffer), spec_format, reader.read<int>());
+            break;
+        case ARG_KIND_LONG:
+            size = snprintf(buffer, sizeof(buffer), spec_format, reader.read<long>());
+            break;
+        case ARG_KIND_LLONG:
+            size = snprintf(buffer, sizeof(buffer), spec_format, reader.read<long long>());
+            break;
+        case ARG_KIND_INTMAX:
+            size = snprintf(buffer, sizeof(buffer), spec_format, reader.read<intmax_t>());
+            break;
+        case ARG_KIND_SIZE:
+            size = snprintf(buffer, sizeof(buffer), spec_format, reader.read<size_t>());
+            break;
+        case ARG_KIND_PTRDIFF:
+            size = snprintf(buffer, sizeof(buffer), spec_format, reader.read<ptrdiff_t>());
+            break;
+        case ARG_KIND_DOUBLE:
+            size = snprintf(buffer, sizeof(buffer), spec_format, reader.read<double>());
+            break;
+        case ARG_KIND_LDOUBLE:
+            size = snprintf(buffer, sizeof(buffer), spec_format, reader.read<long double>());
+            break;
+        case ARG_KIND_POINTER:
+            size = snprintf(buffer, sizeof(buffer), spec_format, reader.read<void*>());
+            break;
+        case ARG_KIND_STRING: {
+            uint16_t length = reader.read<uint16_t>();
+            if (ASYNC_LOG_NULL_STRING_LENGTH == length) {
+                size = snprintf(buffer, sizeof(buffer), spec_format, "(null)");
+            } else {
+                string value(reader.readString(length), length);
+                size = snprintf(buffer, sizeof(buffer), spec_format, value.c_str());
+            }
+            break;
+        }
+    }
+
+    if (size > 0) {
+        message.append(buffer, std::min((size_t) size, sizeof(buffer) - 1));
+    }
+}
+
+uint64_t nowNanos() {
+    return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+std::atomic<bool> AsyncLogger::active_(false);
+
+AsyncLogger& AsyncLogger::getInstance() {
+    // Intentionally leaked so the threads logging during the static destruction never observe a destroyed instance
+    static AsyncLogger* instance = new AsyncLogger();
+    return *instance;
+}
+
+AsyncLogger::AsyncLogger()
+        : ring_capacity_(DEFAULT_ASYNC_LOG_RING_CAPACITY),
+          epoch_(0),
+          rings_generation_(0),
+          writer_exit_(false),
+          writer_wakeup_(false),
+          flush_requests_(0),
+          flush_completions_(0),
+          dropped_records_(0) {
+}
+
+AsyncLogger::ThreadRingHolder::~ThreadRingHolder() {
+    if (nullptr != thread_ring) {
+        thread_ring->closed = true;
+    }
+}
+
+bool AsyncLogger::start(uint32_t ring_capacity) {
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    if (writer_thread_.joinable()) {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> rings_lock(rings_mutex_);
+        ring_capacity_ = 0 == ring_capacity ? DEFAULT_ASYNC_LOG_RING_CAPACITY : ring_capacity;
+        epoch_++;
+    }
+
+    writer_exit_ = false;
+    writer_thread_ = SdkThread::start("log", [this]() { writerRoutine(); });
+    active_ = true;
+
+    return true;
+}
+
+void AsyncLogger::stop() {
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    if (!writer_thread_.joinable()) {
+        return;
+    }
+
+    // The new records are logged synchronously from now on
+    active_ = false;
+
+    {
+        std::lock_guard<std::mutex> writer_lock(writer_mutex_);
+        writer_exit_ = true;
+        writer_cv_.notify_all();
+    }
+
+    writer_thread_.join();
+
+    // Write out the records which raced with the mode being turned off
+    vector<shared_ptr<ThreadRing>> thread_rings;
+    {
+        std::lock_guard<std::mutex> rings_lock(rings_mutex_);
+        thread_rings.swap(rings_);
+        rings_generation_++;
+    }
+
+    string message;
+    drainRings(thread_rings, message);
+}
+
+void AsyncLogger::flush() {
+    std::unique_lock<std::mutex> lock(writer_mutex_);
+    if (!isActive()) {
+        return;
+    }
+
+    uint64_t flush_request = ++flush_requests_;
+    writer_cv_.notify_all();
+    writer_cv_.wait(lock, [this, flush_request]() { return writer_exit_ || flush_completions_ >= flush_request; });
+}
+
+AsyncLogger::ThreadRing* AsyncLogger::getThreadRing() {
+    static thread_local ThreadRingHolder holder;
+
+    uint64_t epoch = epoch_.load(std::memory_order_relaxed);
+    if (nullptr == holder.thread_ring || holder.epoch != epoch) {
+        std::lock_guard<std::mutex> lock(rings_mutex_);
+        holder.thread_ring = std::make_shared<ThreadRing>(ring_capacity_);
+        holder.epoch = epoch;
+        rings_.push_back(holder.thread_ring);
+        rings_generation_++;
+    }
+
+    return holder.thread_ring.get();
+}
+
+AsyncLogRecord* AsyncLogger::claimRecord(ThreadRing*& thread_ring, const log4cplus::Logger& logger, log4cplus::LogLevel level,
+                                         const char* file, int line) {
+    thread_ring = getThreadRing();
+    AsyncLogRecord* record = thread_ring->ring.claim();
+    if (nullptr == record) {
+        dropped_records_++;
+        return nullptr;
+    }
+
+    record->logger = &logger;
+    record->level = level;
+    record->file = file;
+    record->line = line;
+    record->timestamp = nowNanos();
+    record->format = nullptr;
+    record->payload_size = 0;
+    record->arg_count = 0;
+
+    return record;
+}
+
+void AsyncLogger::publishRecord(ThreadRing* thread_ring) {
+    thread_ring->ring.publish();
+
+    // Wake up the writer early rather than waiting for the poll period once the ring fills up
+    if (thread_ring->ring.size() * 2 >= thread_ring->ring.capacity() && !writer_wakeup_.exchange(true)) {
+        writer_cv_.notify_one();
+    }
+}
+
+void AsyncLogger::logf(const log4cplus::Logger& logger, log4cplus::LogLevel level, const char* file, int line,
+                       const char* format, va_list args) {
+    ThreadRing* thread_ring = nullptr;
+    AsyncLogRecord* record = claimRecord(thread_ring, logger, level, file, line);
+    if (nullptr == record) {
+        return;
+    }
+
+    va_list capture_args;
+    va_copy(capture_args, args);
+    bool captured = captureArguments(*record, format, capture_args);
+    va_end(capture_args);
+
+    if (captured) {
+        record->format = format;
+        publishRecord(thread_ring);
+        return;
+    }
+
+    // Fall back to formatting on the calling thread
+    char buffer[ASYNC_LOG_MAX_MESSAGE_SIZE];
+    int size = vsnprintf(buffer, sizeof(buffer), format, args);
+    if (size < 0) {
+        return;
+    }
+
+    if (size < ASYNC_LOG_RECORD_PAYLOAD_SIZE) {
+        record->arg_count = 0;
+        record->payload_size = 0;
+        appendPayload(*record, buffer, (size_t) size);
+        publishRecord(thread_ring);
+        return;
+    }
+
+    logger.forcedLog(level, buffer, file, line);
+}
+
+void AsyncLogger::log(const log4cplus::Logger& logger, log4cplus::LogLevel level, const char* file, int line,
+                      const string& message) {
+    if (message.size() > ASYNC_LOG_RECORD_PAYLOAD_SIZE) {
+        logger.forcedLog(level, message, file, line);
+        return;
+    }
+
+    ThreadRing* thread_ring = nullptr;
+    AsyncLogRecord* record = claimRecord(thread_ring, logger, level, file, line);
+    if (nullptr == record) {
+        return;
+    }
+
+    appendPayload(*record, message.data(), message.size());
+    publishRecord(thread_ring);
+}
+
+bool AsyncLogger::captureArguments(AsyncLogRecord& record, const char* format, va_list args) {
+    record.payload_size = 0;
+    record.arg_count = 0;
+
+    va_list capture_args;
+    va_copy(capture_args, args);
+
+    bool captured = true;
+    for (const char* p = format; captured && *p != '\0'; p++) {
+        if (*p != '%') {
+            continue;
+        }
+
+        if (p[1] == '%') {
+            p++;
+            continue;
+        }
+
+        FormatSpec spec;
+        captured = parseSpec(p, spec);
+        if (captured && spec.width_star) {
+            captured = captureArgument(record, ARG_KIND_INT, capture_args);
+        }
+
+        if (captured && spec.precision_star) {
+            captured = captureArgument(record, ARG_KIND_INT, capture_args);
+        }
+
+        if (captured) {
+            captured = captureArgument(record, spec.kind, capture_args);
+            p = spec.end - 1;
+        }
+    }
+
+    va_end(capture_args);
+    return captured;
+}
+
+void AsyncLogger::formatRecord(const AsyncLogRecord& record, string& message) {
+    message.clear();
+    if (nullptr == record.format) {
+        message.assign(reinterpret_cast<const char*>(record.payload), record.payload_size);
+        return;
+    }
+
+    ArgumentReader reader(record);
+    const char* p = record.format;
+    while (*p != '\0' && message.size() < ASYNC_LOG_MAX_MESSAGE_SIZE) {
+        const char* next = strchr(p, '%');
+        if (nullptr == next) {
+            message.append(p);
+            break;
+        }
+
+        message.append(p, next - p);
+        if (next[1] == '%') {
+            message.push_back('%');
+            p = next + 2;
+            continue;
+        }
+
+        // The format has been validated during the capture
+        FormatSpec spec;
+        parseSpec(next, spec);
+        formatConversion(spec, reader, message);
+        p = spec.end;
+    }
+}
+
+void AsyncLogger::writerRoutine() {
+    vector<shared_ptr<ThreadRing>> thread_rings;
+    uint64_t rings_generation = (uint64_t) -1;
+    uint64_t reported_dropped_records = dropped_records_;
+    string message;
+    message.reserve(ASYNC_LOG_MAX_MESSAGE_SIZE);
+
+    std::unique_lock<std::mutex> lock(writer_mutex_);
+    while (true) {
+        uint64_t flush_request = flush_requests_;
+        bool exit = writer_exit_;
+        writer_wakeup_ = false;
+        lock.unlock();
+
+        if (rings_generation != rings_generation_.load()) {
+            std::lock_guard<std::mutex> rings_lock(rings_mutex_);
+            thread_rings = rings_;
+            rings_generation = rings_generation_;
+        }
+
+        drainRings(thread_rings, message);
+
+        uint64_t dropped_records = dropped_records_;
+        if (dropped_records != reported_dropped_records) {
+            LOG4CPLUS_WARN(KinesisVideoLogger::getInstance(), "Dropped " << dropped_records - reported_dropped_records
+                                                              << " log records due to the asynchronous log ring overflow");
+            reported_dropped_records = dropped_records;
+        }
+
+        lock.lock();
+        flush_completions_ = flush_request;
+        writer_cv_.notify_all();
+        if (exit) {
+            break;
+        }
+
+        writer_cv_.wait_for(lock, std::chrono::milliseconds(ASYNC_LOG_WRITER_POLL_PERIOD_MILLIS),
+                            [this, flush_request]() { return writer_exit_ || writer_wakeup_ || flush_requests_ != flush_request; });
+    }
+}
+
+uint64_t AsyncLogger::drainRings(vector<shared_ptr<ThreadRing>>& thread_rings, string& message) {
+    uint64_t written = 0;
+
+    while (true) {
+        // Merge the heads of the rings in the capture order
+        ThreadRing* oldest_ring = nullptr;
+        AsyncLogRecord* oldest_record = nullptr;
+        for (auto& thread_ring : thread_rings) {
+            AsyncLogRecord* record = thread_ring->ring.front();
+            if (nullptr != record && (nullptr == oldest_record || record->timestamp < oldest_record->timestamp)) {
+                oldest_ring = thread_ring.get();
+                oldest_record = record;
+            }
+        }
+
+        if (nullptr == oldest_record) {
+            break;
+        }
+
+        formatRecord(*oldest_record, message);
+        oldest_record->logger->forcedLog(oldest_record->level, message, oldest_record->file, oldest_record->line);
+        oldest_ring->ring.pop();
+        written++;
+    }
+
+    // Release the drained rings of the exited threads
+    bool released = false;
+    for (auto it = thread_rings.begin(); it != thread_rings.end();) {
+        if ((*it)->closed && (*it)->ring.empty()) {
+            it = thread_rings.erase(it);
+            released = true;
+        } else {
+            it++;
+        }
+    }
+
+    if (released) {
+        std::lock_guard<std::mutex> lock(rings_mutex_);
+        for (auto it = rings_.begin(); it != rings_.end();) {
+            if ((*it)->closed && (*it)->ring.empty()) {
+                it = rings_.erase(it);
+            } else {
+                it++;
+            }
+        }
+    }
+
+    return written;
+}
+
+} // namespace video
+} // namespace kinesis
+} // namespace amazonaws
+} // namespace com
@@ -0,0 +1,227 @@
+/** Copyright 2017 Amazon.com. All rights reserved. */
+
+#pragma once
+
+#include <log4cplus/logger.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SpscRingBuffer.h"
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+/**
+ * Default number of the records in each of the per-thread rings
+ */
+#define DEFAULT_ASYNC_LOG_RING_CAPACITY 512
+
+/**
+ * Size of the inline payload holding either the raw printf arguments or the formatted message
+ */
+#define ASYNC_LOG_RECORD_PAYLOAD_SIZE 256
+
+/**
+ * Maximum number of the printf arguments captured in a record
+ */
+#define ASYNC_LOG_RECORD_MAX_ARGS 16
+
+/**
+ * Maximum size of the message formatted by the background thread
+ */
+#define ASYNC_LOG_MAX_MESSAGE_SIZE 4096
+
+/**
+ * Fixed size binary log record.
+ *
+ * The printf style records keep the format pointer and the raw arguments - the strings are copied
+ * into the payload. The formatting is deferred to the background thread. The stream style records
+ * produced by the LOG_* macros carry the already formatted message in the payload.
+ */
+struct AsyncLogRecord {
+    const log4cplus::Logger* logger;
+    log4cplus::LogLevel level;
+    const char* file;
+    int line;
+
+    /**
+     * Capture time in nanoseconds on the steady clock. Used to merge the per-thread rings in order.
+     */
+    uint64_t timestamp;
+
+    /**
+     * printf format or nullptr if the payload holds the formatted message
+     */
+    const char* format;
+
+    uint16_t payload_size;
+    uint8_t arg_count;
+    uint8_t arg_kinds[ASYNC_LOG_RECORD_MAX_ARGS];
+    uint8_t payload[ASYNC_LOG_RECORD_PAYLOAD_SIZE];
+};
+
+/**
+ * Asynchronous log backend.
+ *
+ * The logging threads write the records into their own lock-free single-producer rings and a single
+ * background thread merges the rings in the capture order, formats the records and hands them over
+ * to log4cplus. When a ring is full the record is dropped and counted rather than blocking the caller.
+ *
+ * NOTE: Records which don't fit into the record payload are logged synchronously. The log4cplus
+ * timestamp and thread of the asynchronous records are those of the background thread.
+ */
+class AsyncLogger {
+public:
+    static AsyncLogger& getInstance();
+
+    /**
+     * @return Whether the asynchronous mode is on. Cheap enough to be checked on every log call.
+     */
+    static bool isActive() {
+        return active_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Turns on the asynchronous mode.
+     *
+     * @param ring_capacity Number of the records in each of the per-thread rings.
+     * @return true if the mode was turned on and false if it's already on.
+     */
+    bool start(uint32_t ring_capacity = DEFAULT_ASYNC_LOG_RING_CAPACITY);
+
+    /**
+     * Turns off the asynchronous mode and writes out the pending records.
+     */
+    void stop();
+
+    /**
+     * Awaits until the records logged before the call are written out
+     */
+    void flush();
+
+    /**
+     * Logs a printf style message. The caller is expected to have checked the logger level.
+     */
+    void logf(const log4cplus::Logger& logger, log4cplus::LogLevel level, const char* file, int line,
+              const char* format, va_list args);
+
+    /**
+     * Logs an already formatted message. The caller is expected to have checked the logger level.
+     */
+    void log(const log4cplus::Logger& logger, log4cplus::LogLevel level, const char* file, int line,
+             const std::string& message);
+
+    /**
+     * @return The number of the records dropped due to the ring overflow
+     */
+    uint64_t getDroppedRecords() const {
+        return dropped_records_.load();
+    }
+
+    /**
+     * Captures the printf arguments into the record.
+     *
+     * @return false if the format has unsupported conversions or the arguments don't fit into the payload.
+     */
+    static bool captureArguments(AsyncLogRecord& record, const char* format, va_list args);
+
+    /**
+     * Formats the record into the message
+     */
+    static void formatRecord(const AsyncLogRecord& record, std::string& message);
+
+private:
+    struct ThreadRing {
+        explicit ThreadRing(uint32_t capacity) : ring(capacity), closed(false) {
+        }
+
+        SpscRingBuffer<AsyncLogRecord> ring;
+
+        /**
+         * Set once the owning thread exits. The ring is released after being drained.
+         */
+        std::atomic<bool> closed;
+    };
+
+    struct ThreadRingHolder {
+        ~ThreadRingHolder();
+
+        std::shared_ptr<ThreadRing> thread_ring;
+        uint64_t epoch = 0;
+    };
+
+    AsyncLogger();
+
+    /**
+     * Returns the calling thread ring registering a new one on the first use
+     */
+    ThreadRing* getThreadRing();
+
+    /**
+     * Claims a record in the calling thread ring. nullptr if the ring is full.
+     */
+    AsyncLogRecord* claimRecord(ThreadRing*& thread_ring, const log4cplus::Logger& logger, log4cplus::LogLevel level,
+                                const char* file, int line);
+
+    /**
+     * Publishes the record claimed in the calling thread ring
+     */
+    void publishRecord(ThreadRing* thread_ring);
+
+    void writerRoutine();
+
+    /**
+     * Writes out the pending records in order
+     *
+     * @return Number of the records written
+     */
+    uint64_t drainRings(std::vector<std::shared_ptr<ThreadRing>>& thread_rings, std::string& message);
+
+    static std::atomic<bool> active_;
+
+    /**
+     * Serializes start and stop
+     */
+    std::mutex control_mutex_;
+
+    uint32_t ring_capacity_;
+
+    /**
+     * Incremented on every start so the threads re-register their rings
+     */
+    std::atomic<uint64_t> epoch_;
+
+    std::mutex rings_mutex_;
+    std::vector<std::shared_ptr<ThreadRing>> rings_;
+    std::atomic<uint64_t> rings_generation_;
+
+    std::thread writer_thread_;
+    std::mutex writer_mutex_;
+    std::condition_variable writer_cv_;
+    bool writer_exit_;
+
+    /**
+     * Set by the logging threads to wake up the writer ahead of the poll period
+     */
+    std::atomic<bool> writer_wakeup_;
+
+    /**
+     * Flush handshake
+     */
+    uint64_t flush_requests_;
+    uint64_t flush_completions_;
+
+    std::atomic<uint64_t> dropped_records_;
+};
+
+} // namespace video
+} // namespace kinesis
+} // namespace amazonaws
+} // namespace com
@@ -1,49 +1,135 @@
 #include "Auth.h"
 #include "Logger.h"
+#include "SdkThread.h"
 
 LOGGER_TAG("com.amazonaws.kinesis.video");
 
 namespace com { namespace amazonaws { namespace kinesis { namespace video {
 
 using std::mutex;
+using std::shared_ptr;
 
 CredentialProvider::CredentialProvider()
     :   next_rotation_time_(0),
+        refresh_exit_(false),
+        refresh_running_(false),
         security_token_(NULL) {
 }
 
 void CredentialProvider::getCredentials(Credentials& credentials) {
-
-    // synchronize credential access since multiple clients may call simultaneously
-    std::lock_guard<mutex> guard(credential_mutex_);
-    refreshCredentials();
-    credentials = credentials_;
+    credentials = *getCredentialsSnapshot();
 }
 
 void CredentialProvider::getUpdatedCredentials(Credentials& credentials) {
+    credentials = *getCredentialsSnapshot(true);
+}
+
+shared_ptr<const Credentials> CredentialProvider::getCredentialsSnapshot(bool force_update) {
+    // The background refresh keeps the credentials fresh so there is no need to force the update
+    bool update = force_update && !refresh_running_;
+    auto credentials = std::atomic_load(&credentials_);
+    if (!update && isFresh(credentials)) {
+        return credentials;
+    }
 
     // synchronize credential access since multiple clients may call simultaneously
     std::lock_guard<mutex> guard(credential_mutex_);
-    refreshCredentials(true);
-    credentials = credentials_;
+    refreshCredentials(update);
+    return std::atomic_load(&credentials_);
+}
+
+bool CredentialProvider::isFresh(const shared_ptr<const Credentials>& credentials) const {
+    // Compared in seconds as the expiration of the non-expiring credentials overflows the finer durations
+    auto now_time = std::chrono::duration_cast<std::chrono::seconds>(systemCurrentTime().time_since_epoch());
+    return nullptr != credentials && now_time + CredentialProviderGracePeriod <= credentials->getExpiration();
 }
 
 void CredentialProvider::refreshCredentials(bool forceUpdate) {
-    auto now_time = systemCurrentTime().time_since_epoch();
+    auto credentials = std::atomic_load(&credentials_);
+
     // update if we've exceeded the refresh interval with grace period
-    if (forceUpdate || now_time + CredentialProviderGracePeriod > next_rotation_time_) {
+    if (forceUpdate || !isFresh(credentials)) {
         LOG_DEBUG("Refreshing credentials. Force refreshing: " << forceUpdate
-                         << " Now time is: " << now_time.count()
+                         << " Now time is: " << systemCurrentTime().time_since_epoch().count()
                          << " Expiration: " << next_rotation_time_.count());
-        updateCredentials(credentials_);
-        next_rotation_time_ = credentials_.getExpiration();
+
+        // The published credentials are never modified so the update works on a copy
+        auto updated_credentials = nullptr == credentials ? std::make_shared<Credentials>()
+                                                          : std::make_shared<Credentials>(*credentials);
+        updateCredentials(*updated_credentials);
+        next_rotation_time_ = updated_credentials->getExpiration();
+        std::atomic_store(&credentials_, shared_ptr<const Credentials>(updated_credentials));
     }
 }
 
 void CredentialProvider::updateCredentials(Credentials &credentials) {
     // no-op
 }
+
+void CredentialProvider::startCredentialRefresh() {
+    std::lock_guard<mutex> lock(refresh_mutex_);
+    if (refresh_running_ || !isCredentialRefreshNeeded()) {
+        return;
+    }
+
+    refresh_exit_ = false;
+    refresh_running_ = true;
+    refresh_thread_ = SdkThread::start("creds", [this]() { refreshRoutine(); });
+}
+
+void CredentialProvider::stopCredentialRefresh() {
+    {
+        std::lock_guard<mutex> lock(refresh_mutex_);
+        if (!refresh_running_) {
+            return;
+        }
+
+        refresh_exit_ = true;
+        refresh_cv_.notify_all();
+    }
+
+    refresh_thread_.join();
+    refresh_running_ = false;
+}
+
+void CredentialProvider::refreshRoutine() {
+    using std::chrono::seconds;
+
+    std::unique_lock<mutex> lock(refresh_mutex_);
+    while (!refresh_exit_) {
+        auto wait_time = seconds(CREDENTIAL_REFRESH_RETRY_SECONDS);
+        lock.unlock();
+        try {
+            std::lock_guard<mutex> guard(credential_mutex_);
+            auto now_time = std::chrono::duration_cast<seconds>(systemCurrentTime().time_since_epoch());
+            auto refresh_ahead = CredentialProviderGracePeriod + seconds(CREDENTIAL_REFRESH_AHEAD_SECONDS);
+            auto credentials = std::atomic_load(&credentials_);
+            if (nullptr == credentials || now_time + refresh_ahead > credentials->getExpiration()) {
+                refreshCredentials(true);
+                credentials = std::atomic_load(&credentials_);
+            }
+
+            // Sleep until the refresh is due, re-checking periodically in case the clock moves
+            if (now_time + refresh_ahead + seconds(CREDENTIAL_REFRESH_MAX_WAIT_SECONDS) <= credentials->getExpiration()) {
+                wait_time = seconds(CREDENTIAL_REFRESH_MAX_WAIT_SECONDS);
+            } else if (now_time + refresh_ahead + wait_time < credentials->getExpiration()) {
+                wait_time = seconds((credentials->getExpiration() - refresh_ahead - now_time).count());
+            }
+        } catch (std::exception& err) {
+            LOG_ERROR("Failed to refresh credentials in the background: " << err.what());
+        } catch (...) {
+            // Escaping the thread would terminate the process. Retried the same as any other failure.
+            LOG_ERROR("Failed to refresh credentials in the background with an unknown exception");
+        }
+
+        lock.lock();
+        refresh_cv_.wait_for(lock, wait_time, [this]() { return refresh_exit_; });
+    }
+}
+
 CredentialProvider::~CredentialProvider() {
+    // The derived provider is gone by now, the owner is expected to have stopped the refresh already
+    stopCredentialRefresh();
     freeAwsCredentials(&security_token_);
 }
 
@@ -94,17 +180,16 @@ STATUS CredentialProvider::getStreamingTokenHandler(UINT64 custom_data, PCHAR st
 
     auto this_obj = reinterpret_cast<CredentialProvider*>(custom_data);
 
-    Credentials credentials;
-    this_obj->getUpdatedCredentials(credentials);
+    auto credentials = this_obj->getCredentialsSnapshot(true);
 
-    auto access_key = credentials.getAccessKey();
+    const auto& access_key = credentials->getAccessKey();
     auto access_key_len = access_key.length();
-    auto secret_key = credentials.getSecretKey();
+    const auto& secret_key = credentials->getSecretKey();
     auto secret_key_len = secret_key.length();
-    auto session_token = credentials.getSessionToken();
+    const auto& session_token = credentials->getSessionToken();
     auto session_token_len = session_token.length();
     // Credentials expiration count is in seconds. Need to set the expiration in Kinesis Video time
-    auto expiration = credentials.getExpiration().count() * HUNDREDS_OF_NANOS_IN_A_SECOND;
+    auto expiration = credentials->getExpiration().count() * HUNDREDS_OF_NANOS_IN_A_SECOND;
 
     // free current aws credential first
     freeAwsCredentials(&this_obj->security_token_);
@@ -127,21 +212,20 @@ STATUS CredentialProvider::getSecurityTokenHandler(UINT64 custom_data, PBYTE* pp
 
     auto this_obj = reinterpret_cast<CredentialProvider*>(custom_data);
 
-    Credentials credentials;
-    this_obj->getCredentials(credentials);
+    auto credentials = this_obj->getCredentialsSnapshot();
 
-    auto access_key = credentials.getAccessKey();
+    const auto& access_key = credentials->getAccessKey();
     auto access_key_len = access_key.length();
-    auto secret_key = credentials.getSecretKey();
+    const auto& secret_key = credentials->getSecretKey();
     auto secret_key_len = secret_key.length();
-    auto session_token = credentials.getSessionToken();
+    const auto& session_token = credentials->getSessionToken();
     auto session_token_len = session_token.length();
 
     // free current aws credential first
     freeAwsCredentials(&this_obj->security_token_);
 
     // Credentials expiration count is in seconds. Need to set the expiration in Kinesis Video time
-    *p_expiration = credentials.getExpiration().count() * HUNDREDS_OF_NANOS_IN_A_SECOND;
+    *p_expiration = credentials->getExpiration().count() * HUNDREDS_OF_NANOS_IN_A_SECOND;
 
     // Store the buffer so we can release it at the end
     createAwsCredentials((PCHAR) access_key.c_str(), access_key_len, (PCHAR) secret_key.c_str(), secret_key_len,
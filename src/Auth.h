@@ -1,7 +1,11 @@
 #pragma once
 
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <memory>
 #include <mutex>
+#include <thread>
 
 #include <cstdlib>
 #include <cstring>
@@ -16,6 +20,21 @@ namespace com { namespace amazonaws { namespace kinesis { namespace video {
 
 #define STRING_TO_PCHAR(s) ((PCHAR) ((s).c_str()))
 
+/**
+ * How long before the refresh grace period the background refresh updates the credentials
+ */
+#define CREDENTIAL_REFRESH_AHEAD_SECONDS 30
+
+/**
+ * Minimal time between the background refreshes. Also the retry period after a failed refresh.
+ */
+#define CREDENTIAL_REFRESH_RETRY_SECONDS 5
+
+/**
+ * Longest time the background refresh sleeps before re-checking the expiration
+ */
+#define CREDENTIAL_REFRESH_MAX_WAIT_SECONDS 3600
+
 /**
 * Simple data object around aws credentials
 */
@@ -136,6 +155,30 @@ public:
     virtual void getUpdatedCredentials(Credentials& credentials);
     virtual ~CredentialProvider();
 
+    /**
+     * Gets the current credentials. The credentials are immutable so the callers hold on to them
+     * without copying. Updates them on the calling thread only if they are about to expire or if
+     * an update is forced while the background refresh isn't running.
+     *
+     * @param force_update Whether to update the credentials unless the background refresh keeps them fresh
+     */
+    std::shared_ptr<const Credentials> getCredentialsSnapshot(bool force_update = false);
+
+    /**
+     * Starts updating the credentials on a background thread ahead of their expiration so the token
+     * requests from the producer threads don't wait on a slow updateCredentials. No-op for the providers
+     * which don't need the refresh.
+     *
+     * NOTE: The thread calls into the derived provider so the owner of the provider starts it once the
+     * provider is fully constructed and stops it before the provider is destroyed.
+     */
+    void startCredentialRefresh();
+
+    /**
+     * Stops the background refresh. Waits for the update in progress.
+     */
+    void stopCredentialRefresh();
+
     /**
      * Gets the callbacks
      *
@@ -172,16 +215,43 @@ public:
 protected:
     CredentialProvider();
 
+    /**
+     * @return Whether the credentials expire and need the background refresh
+     */
+    virtual bool isCredentialRefreshNeeded() const {
+        return true;
+    }
+
     const std::chrono::duration<uint64_t> CredentialProviderGracePeriod = std::chrono::seconds(5 + (MIN_STREAMING_TOKEN_EXPIRATION_DURATION + STREAMING_TOKEN_EXPIRATION_GRACE_PERIOD) / HUNDREDS_OF_NANOS_IN_A_SECOND);
 
 private:
+    /**
+     * Updates the credentials if needed and publishes them. Must be called with the credential mutex held.
+     */
     void refreshCredentials(bool forceUpdate = false);
 
+    /**
+     * Whether the credentials are out of the refresh grace period
+     */
+    bool isFresh(const std::shared_ptr<const Credentials>& credentials) const;
+
+    void refreshRoutine();
+
     virtual void updateCredentials(Credentials& credentials) = 0;
 
     std::mutex credential_mutex_;
     std::chrono::duration<uint64_t> next_rotation_time_;
-    Credentials credentials_;
+
+    /**
+     * Current credentials. Replaced as a whole with std::atomic_store and read with std::atomic_load.
+     */
+    std::shared_ptr<const Credentials> credentials_;
+
+    std::mutex refresh_mutex_;
+    std::condition_variable refresh_cv_;
+    bool refresh_exit_;
+    std::atomic<bool> refresh_running_;
+    std::thread refresh_thread_;
     /**
      * Storage for the serialized security token
      */
@@ -194,6 +264,11 @@ private:
 };
 
 class EmptyCredentialProvider : public CredentialProvider {
+protected:
+    bool isCredentialRefreshNeeded() const override {
+        return false;
+    }
+
 private:
     void updateCredentials(Credentials& credentials) override {
         credentials.setAccessKey("");
@@ -210,6 +285,10 @@ public:
 
 protected:
 
+    bool isCredentialRefreshNeeded() const override {
+        return false;
+    }
+
     void updateCredentials(Credentials& credentials) override {
         // Copy the stored creds forward
         credentials = credentials_;
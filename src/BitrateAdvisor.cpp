@@ -0,0 +1,81 @@
+#include "Logger.h"
+#include "BitrateAdvisor.h"
+
+#include <algorithm>
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+LOGGER_TAG("com.amazonaws.kinesis.video");
+
+BitrateAdvisor::BitrateAdvisor(uint64_t max_bitrate_bps)
+        : max_bitrate_(max_bitrate_bps),
+          min_bitrate_(max_bitrate_bps * BITRATE_ADVISOR_MIN_BITRATE_PERCENT / 100),
+          latency_pressure_(false),
+          recommended_bitrate_(max_bitrate_bps),
+          last_buffer_duration_(0),
+          buffer_growth_samples_(0),
+          decrease_hold_samples_(0),
+          reported_bitrate_(max_bitrate_bps) {}
+
+void BitrateAdvisor::onLatencyPressure(uint64_t buffer_duration) {
+    UNUSED_PARAM(buffer_duration);
+    latency_pressure_ = true;
+}
+
+bool BitrateAdvisor::update(uint64_t transfer_rate_bps,
+                            std::chrono::milliseconds buffer_duration,
+                            uint32_t storage_percent,
+                            uint64_t& recommended_bitrate_bps) {
+    if (0 == max_bitrate_) {
+        return false;
+    }
+
+    // The buffer duration saw-tooths with the fragment acks, hence only the sustained growth is the congestion
+    buffer_growth_samples_ = buffer_duration > last_buffer_duration_ ? buffer_growth_samples_ + 1 : 0;
+    last_buffer_duration_ = buffer_duration;
+    bool buffer_growing = buffer_growth_samples_ >= BITRATE_ADVISOR_BUFFER_GROWTH_SAMPLES;
+    bool latency_pressure = latency_pressure_.exchange(false);
+    bool storage_pressure = storage_percent >= BITRATE_ADVISOR_STORAGE_PRESSURE_PERCENT;
+
+    if (0 != decrease_hold_samples_) {
+        decrease_hold_samples_--;
+    }
+
+    uint64_t bitrate = recommended_bitrate_;
+    if (latency_pressure || buffer_growing || storage_pressure) {
+        // The transfer rate is what the uplink sustains. Staying under it drains the backlog.
+        if (0 == decrease_hold_samples_) {
+            if (0 != transfer_rate_bps) {
+                bitrate = std::min(bitrate, transfer_rate_bps);
+            }
+
+            bitrate = bitrate * BITRATE_ADVISOR_DECREASE_PERCENT / 100;
+            decrease_hold_samples_ = BITRATE_ADVISOR_DECREASE_HOLD_SAMPLES;
+        }
+
+        buffer_growth_samples_ = 0;
+    } else {
+        bitrate += max_bitrate_ * BITRATE_ADVISOR_INCREASE_PERCENT / 100;
+    }
+
+    bitrate = std::max(min_bitrate_, std::min(max_bitrate_, bitrate));
+    recommended_bitrate_ = bitrate;
+
+    // Small steps are not worth reconfiguring the encoder for unless the recommendation settles at a bound
+    uint64_t change = bitrate > reported_bitrate_ ? bitrate - reported_bitrate_ : reported_bitrate_ - bitrate;
+    bool at_bound = bitrate == max_bitrate_ || bitrate == min_bitrate_;
+    if (0 == change || (change * 100 < reported_bitrate_ * BITRATE_ADVISOR_REPORT_THRESHOLD_PERCENT && !at_bound)) {
+        return false;
+    }
+
+    LOG_DEBUG("Recommended bitrate changed from " << reported_bitrate_ << " to " << bitrate << " bps. Latency pressure: "
+              << latency_pressure << ", buffer growing: " << buffer_growing << ", storage pressure: " << storage_pressure);
+    reported_bitrate_ = bitrate;
+    recommended_bitrate_bps = bitrate;
+    return true;
+}
+
+} // namespace video
+} // namespace kinesis
+} // namespace amazonaws
+} // namespace com
@@ -0,0 +1,110 @@
+/** Copyright 2017 Amazon.com. All rights reserved. */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+
+#include "com/amazonaws/kinesis/video/client/Include.h"
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+/**
+ * Lowest recommended bitrate as the percentage of the stream average bandwidth
+ */
+#define BITRATE_ADVISOR_MIN_BITRATE_PERCENT 10
+
+/**
+ * Percentage of the achieved transfer rate recommended under the pressure so that the backlog drains
+ */
+#define BITRATE_ADVISOR_DECREASE_PERCENT 85
+
+/**
+ * Additive increase per sample without the pressure as the percentage of the stream average bandwidth
+ */
+#define BITRATE_ADVISOR_INCREASE_PERCENT 3
+
+/**
+ * Smallest change of the recommendation in percent which is reported
+ */
+#define BITRATE_ADVISOR_REPORT_THRESHOLD_PERCENT 5
+
+/**
+ * Content store utilization in percent considered as the storage pressure. Under the frame shedding
+ * thresholds so that the encoder backs off before the frames are shed.
+ */
+#define BITRATE_ADVISOR_STORAGE_PRESSURE_PERCENT 40
+
+/**
+ * Number of the consecutive samples of the growing buffer duration considered as the uplink congestion
+ */
+#define BITRATE_ADVISOR_BUFFER_GROWTH_SAMPLES 3
+
+/**
+ * Number of the samples a decrease holds off the next one for so that the encoder catches up with it
+ * rather than the recommendation collapsing under a pressure which is reported on every sample
+ */
+#define BITRATE_ADVISOR_DECREASE_HOLD_SAMPLES 3
+
+/**
+ * Per-stream encoder bitrate recommendation.
+ *
+ * Follows the additive increase, multiplicative decrease of the congestion control. The recommendation drops
+ * to a fraction of the achieved transfer rate whenever the stream reports the latency pressure, its buffer
+ * duration keeps growing or the content store utilization is over the threshold, at most once per the hold samples, and
+ * otherwise climbs back towards the stream average bandwidth.
+ *
+ * Updated by the producer metrics sampler. The latency pressure is recorded from the client callback thread.
+ */
+class BitrateAdvisor {
+public:
+    /**
+     * @param max_bitrate_bps The stream average bandwidth. 0 disables the recommendations.
+     */
+    explicit BitrateAdvisor(uint64_t max_bitrate_bps);
+
+    /**
+     * Records the latency pressure reported by the stream
+     *
+     * @param buffer_duration The current buffer duration in 100ns.
+     */
+    void onLatencyPressure(uint64_t buffer_duration);
+
+    /**
+     * Updates the recommendation with the sampled stream metrics
+     *
+     * @param transfer_rate_bps The current transfer rate of the stream.
+     * @param buffer_duration The current view duration of the stream.
+     * @param storage_percent The content store utilization in percent.
+     * @param recommended_bitrate_bps Set to the new recommendation if any.
+     * @return Whether the recommendation changed enough to be reported.
+     */
+    bool update(uint64_t transfer_rate_bps,
+                std::chrono::milliseconds buffer_duration,
+                uint32_t storage_percent,
+                uint64_t& recommended_bitrate_bps);
+
+    /**
+     * @return The current recommendation in bits per second.
+     */
+    uint64_t getRecommendedBitrate() const {
+        return recommended_bitrate_;
+    }
+
+private:
+    const uint64_t max_bitrate_;
+    const uint64_t min_bitrate_;
+
+    std::atomic<bool> latency_pressure_;
+    std::atomic<uint64_t> recommended_bitrate_;
+
+    std::chrono::milliseconds last_buffer_duration_;
+    uint32_t buffer_growth_samples_;
+    uint32_t decrease_hold_samples_;
+    uint64_t reported_bitrate_;
+};
+
+} // namespace video
+} // namespace kinesis
+} // namespace amazonaws
+} // namespace com
@@ -0,0 +1,172 @@
+/** Copyright 2017 Amazon.com. All rights reserved. */
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+/**
+ * Default number of shards. Needs to be a power of two.
+ */
+#define DEFAULT_CONCURRENT_MAP_SHARD_COUNT 64
+
+/**
+ * Sharded read-copy-update hash map optimized for the read-mostly access patterns,
+ * such as the stream handle lookups from the callback threads.
+ *
+ * Each shard publishes an immutable table through an atomic shared pointer. The readers load the
+ * current table of a single shard and never hold the shard write lock, so they don't wait on the
+ * copy of the table. The writers serialize per shard, copy the shard table, modify the copy and
+ * publish it. As the keys are spread across the shards, the copy is bounded by the shard size rather
+ * than the total number of items.
+ *
+ * NOTE: The atomic shared pointer operations are not lock-free in the common standard libraries.
+ * libstdc++ guards them with a small pool of mutexes shared by the process, so a load briefly contends
+ * with the concurrent loads and stores hashing to the same mutex, and the reference count of the
+ * table is a shared cache line.
+ *
+ * @tparam K The key. Must be hashable.
+ * @tparam V The value. Must be copyable and default constructible - the default value is returned on a miss.
+ */
+template <typename K, typename V, size_t SHARD_COUNT = DEFAULT_CONCURRENT_MAP_SHARD_COUNT> class ConcurrentMap {
+    static_assert(SHARD_COUNT != 0 && (SHARD_COUNT & (SHARD_COUNT - 1)) == 0, "Shard count must be a power of two");
+
+    using table_t = std::unordered_map<K, V>;
+
+public:
+    ConcurrentMap() : size_(0) {
+        for (auto& shard : shards_) {
+            shard.table = std::make_shared<const table_t>();
+        }
+    }
+
+    /**
+     * Put an item into the map. Replaces the existing value.
+     * @param k key
+     * @param v value
+     */
+    void put(const K& k, const V& v) {
+        Shard& shard = getShard(k);
+        std::lock_guard<std::mutex> lock(shard.write_mutex);
+        std::shared_ptr<table_t> table = std::make_shared<table_t>(*std::atomic_load(&shard.table));
+        if (table->insert(std::make_pair(k, v)).second) {
+            size_++;
+        } else {
+            (*table)[k] = v;
+        }
+
+        std::atomic_store(&shard.table, std::shared_ptr<const table_t>(std::move(table)));
+    }
+
+    /**
+     * Retrieve an item from the map. Does not block on the writers.
+     * @param k Key to look up.
+     * @return The value at k or the default value (ex: nullptr).
+     */
+    V get(const K& k) const {
+        std::shared_ptr<const table_t> table = std::atomic_load(&getShard(k).table);
+        auto it = table->find(k);
+        return it == table->end() ? V() : it->second;
+    }
+
+    /**
+     * Remove the pair stored the map at k, if it exists.
+     * @param k Key to be removed.
+     * @return The removed value or the default value if the key was not found.
+     */
+    V remove(const K& k) {
+        Shard& shard = getShard(k);
+        std::lock_guard<std::mutex> lock(shard.write_mutex);
+        std::shared_ptr<const table_t> current = std::atomic_load(&shard.table);
+        auto it = current->find(k);
+        if (it == current->end()) {
+            return V();
+        }
+
+        V value = it->second;
+        std::shared_ptr<table_t> table = std::make_shared<table_t>(*current);
+        table->erase(k);
+        size_--;
+        std::atomic_store(&shard.table, std::shared_ptr<const table_t>(std::move(table)));
+
+        return value;
+    }
+
+    /**
+     * Check if a key exists in the map.
+     * @param k Key to be checked
+     * @return True if the key exists and false otherwise.
+     */
+    bool exists(const K& k) const {
+        std::shared_ptr<const table_t> table = std::atomic_load(&getShard(k).table);
+        return table->find(k) != table->end();
+    }
+
+    /**
+     * @return The number of items. Approximate while the map is being modified.
+     */
+    size_t size() const {
+        return size_.load();
+    }
+
+    /**
+     * Returns a consistent per-shard snapshot of the values which is safe to iterate
+     * while the map is being modified, ex: for bulk operations.
+     */
+    std::vector<V> snapshot() const {
+        std::vector<V> values;
+        values.reserve(size());
+        for (const auto& shard : shards_) {
+            std::shared_ptr<const table_t> table = std::atomic_load(&shard.table);
+            for (const auto& pair : *table) {
+                values.push_back(pair.second);
+            }
+        }
+
+        return values;
+    }
+
+private:
+    struct Shard {
+        /**
+         * Current immutable table of the shard
+         */
+        std::shared_ptr<const table_t> table;
+
+        /**
+         * Serializes the writers of the shard
+         */
+        std::mutex write_mutex;
+    };
+
+    Shard& getShard(const K& k) {
+        return shards_[shardIndex(k)];
+    }
+
+    const Shard& getShard(const K& k) const {
+        return shards_[shardIndex(k)];
+    }
+
+    static size_t shardIndex(const K& k) {
+        // Mix the hash as the stream handles are pointer values with the low bits being zero
+        uint64_t hash = (uint64_t) std::hash<K>()(k);
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 33;
+        return (size_t) (hash & (SHARD_COUNT - 1));
+    }
+
+    Shard shards_[SHARD_COUNT];
+    std::atomic<size_t> size_;
+};
+
+} // namespace video
+} // namespace kinesis
+} // namespace amazonaws
+} // namespace com
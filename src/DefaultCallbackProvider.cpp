@@ -2,6 +2,10 @@
 
 #include "DefaultCallbackProvider.h"
 #include "Logger.h"
+#include "FlightRecorder.h"
+#include "StreamLatencyTracker.h"
+#include "FrameLog.h"
+#include "BitrateAdvisor.h"
 
 namespace com { namespace amazonaws { namespace kinesis { namespace video {
 
@@ -81,6 +85,7 @@ STATUS DefaultCallbackProvider::streamClosedHandler(UINT64 custom_data,
                                                     STREAM_HANDLE stream_handle,
                                                     UPLOAD_HANDLE stream_upload_handle) {
     LOG_DEBUG("streamClosedHandler invoked for upload handle: " << stream_upload_handle);
+    FlightRecorder::getInstance().record(FLIGHT_RECORDER_EVENT_STREAM_CLOSED, stream_handle, STATUS_SUCCESS, stream_upload_handle);
 
     auto this_obj = reinterpret_cast<DefaultCallbackProvider *>(custom_data);
 
@@ -113,6 +118,7 @@ STATUS DefaultCallbackProvider::streamErrorHandler(UINT64 custom_data,
                                                    UINT64 fragment_timecode,
                                                    STATUS status) {
     LOG_DEBUG("streamErrorHandler invoked");
+    FlightRecorder::getInstance().record(FLIGHT_RECORDER_EVENT_STREAM_ERROR, stream_handle, status, fragment_timecode);
     auto this_obj = reinterpret_cast<DefaultCallbackProvider*>(custom_data);
 
     // Call the client callback if any specified
@@ -143,6 +149,7 @@ STATUS DefaultCallbackProvider::clientReadyHandler(UINT64 custom_data, CLIENT_HA
 
 STATUS DefaultCallbackProvider::storageOverflowPressureHandler(UINT64 custom_data, UINT64 bytes_remaining) {
     LOG_DEBUG("storageOverflowPressureHandler invoked");
+    FlightRecorder::getInstance().record(FLIGHT_RECORDER_EVENT_STORAGE_OVERFLOW_PRESSURE, INVALID_STREAM_HANDLE_VALUE, STATUS_SUCCESS, bytes_remaining);
     auto this_obj = reinterpret_cast<DefaultCallbackProvider*>(custom_data);
 
     // Call the client callback if any specified
@@ -156,6 +163,7 @@ STATUS DefaultCallbackProvider::storageOverflowPressureHandler(UINT64 custom_dat
 
 STATUS DefaultCallbackProvider::streamUnderflowReportHandler(UINT64 custom_data, STREAM_HANDLE stream_handle) {
     LOG_DEBUG("streamUnderflowReportHandler invoked");
+    FlightRecorder::getInstance().record(FLIGHT_RECORDER_EVENT_STREAM_UNDERFLOW, stream_handle);
     auto this_obj = reinterpret_cast<DefaultCallbackProvider*>(custom_data);
 
     // Call the client callback if any specified
@@ -171,8 +179,14 @@ STATUS DefaultCallbackProvider::streamLatencyPressureHandler(UINT64 custom_data,
                                                              STREAM_HANDLE stream_handle,
                                                              UINT64 buffer_duration) {
     LOG_DEBUG("streamLatencyPressureHandler invoked");
+    FlightRecorder::getInstance().record(FLIGHT_RECORDER_EVENT_STREAM_LATENCY_PRESSURE, stream_handle, STATUS_SUCCESS, buffer_duration);
     auto this_obj = reinterpret_cast<DefaultCallbackProvider*>(custom_data);
 
+    auto bitrate_advisor = this_obj->bitrate_advisors_.get(stream_handle);
+    if (nullptr != bitrate_advisor) {
+        bitrate_advisor->onLatencyPressure(buffer_duration);
+    }
+
     // Call the client callback if any specified
     auto stream_latency_callback = this_obj->stream_callback_provider_->getStreamLatencyPressureCallback();
     if (nullptr != stream_latency_callback) {
@@ -188,6 +202,7 @@ STATUS DefaultCallbackProvider::droppedFrameReportHandler(UINT64 custom_data,
                                                           STREAM_HANDLE stream_handle,
                                                           UINT64 timecode) {
     LOG_DEBUG("droppedFrameReportHandler invoked");
+    FlightRecorder::getInstance().record(FLIGHT_RECORDER_EVENT_DROPPED_FRAME, stream_handle, STATUS_SUCCESS, timecode);
     auto this_obj = reinterpret_cast<DefaultCallbackProvider*>(custom_data);
 
     // Call the client callback if any specified
@@ -205,6 +220,7 @@ STATUS DefaultCallbackProvider::droppedFragmentReportHandler(UINT64 custom_data,
                                                              STREAM_HANDLE stream_handle,
                                                              UINT64 timecode) {
     LOG_DEBUG("droppedFragmentReportHandler invoked");
+    FlightRecorder::getInstance().record(FLIGHT_RECORDER_EVENT_DROPPED_FRAGMENT, stream_handle, STATUS_SUCCESS, timecode);
     auto this_obj = reinterpret_cast<DefaultCallbackProvider*>(custom_data);
 
     // Call the client callback if any specified
@@ -222,6 +238,7 @@ STATUS DefaultCallbackProvider::bufferDurationOverflowPressureHandler(UINT64 cus
                                                                       STREAM_HANDLE stream_handle,
                                                                       UINT64 remaining_duration) {
     LOG_DEBUG("bufferDurationOverflowPressureHandler invoked");
+    FlightRecorder::getInstance().record(FLIGHT_RECORDER_EVENT_BUFFER_DURATION_OVERFLOW_PRESSURE, stream_handle, STATUS_SUCCESS, remaining_duration);
     auto this_obj = reinterpret_cast<DefaultCallbackProvider*>(custom_data);
 
     // Call the client callback if any specified
@@ -239,6 +256,7 @@ STATUS DefaultCallbackProvider::streamConnectionStaleHandler(UINT64 custom_data,
                                                              STREAM_HANDLE stream_handle,
                                                              UINT64 last_ack_duration) {
     LOG_DEBUG("streamConnectionStaleHandler invoked");
+    FlightRecorder::getInstance().record(FLIGHT_RECORDER_EVENT_CONNECTION_STALE, stream_handle, STATUS_SUCCESS, last_ack_duration);
     auto this_obj = reinterpret_cast<DefaultCallbackProvider*>(custom_data);
 
     // Call the client callback if any specified
@@ -254,6 +272,7 @@ STATUS DefaultCallbackProvider::streamConnectionStaleHandler(UINT64 custom_data,
 
 STATUS DefaultCallbackProvider::streamReadyHandler(UINT64 custom_data, STREAM_HANDLE stream_handle) {
     LOG_DEBUG("streamReadyHandler invoked");
+    FlightRecorder::getInstance().record(FLIGHT_RECORDER_EVENT_STREAM_READY, stream_handle);
     auto this_obj = reinterpret_cast<DefaultCallbackProvider*>(custom_data);
 
     // Call the client callback if any specified
@@ -272,6 +291,23 @@ STATUS DefaultCallbackProvider::fragmentAckReceivedHandler(UINT64 custom_data,
     LOG_DEBUG("fragmentAckReceivedHandler invoked");
     auto this_obj = reinterpret_cast<DefaultCallbackProvider*>(custom_data);
 
+    if (nullptr != fragment_ack) {
+        FlightRecorder::getInstance().record(FLIGHT_RECORDER_EVENT_FRAGMENT_ACK, stream_handle, fragment_ack->result,
+                                             fragment_ack->timestamp, (uint16_t) fragment_ack->ackType);
+    }
+
+    auto latency_tracker = this_obj->latency_trackers_.get(stream_handle);
+    if (nullptr != latency_tracker && nullptr != fragment_ack) {
+        latency_tracker->recordFragmentAck(*fragment_ack);
+    }
+
+    if (nullptr != fragment_ack && FRAGMENT_ACK_TYPE_PERSISTED == fragment_ack->ackType) {
+        auto frame_log = this_obj->frame_logs_.get(stream_handle);
+        if (nullptr != frame_log) {
+            frame_log->onFragmentPersisted(fragment_ack->timestamp);
+        }
+    }
+
     // Call the client callback if any specified
     auto fragment_ack_callback = this_obj->stream_callback_provider_->getFragmentAckReceivedCallback();
     if (nullptr != fragment_ack_callback) {
@@ -294,6 +330,14 @@ VOID DefaultCallbackProvider::logPrintHandler(UINT32 level, PCHAR tag, PCHAR fmt
             log4cplus::ERROR_LOG_LEVEL,
             log4cplus::FATAL_LOG_LEVEL};
     UNUSED_PARAM(tag);
+
+#if KVS_MIN_LOG_LEVEL > KVS_LOG_LEVEL_TRACE
+    // PIC levels start at verbose which maps onto the trace level
+    if (level < LOG_LEVEL_VERBOSE + KVS_MIN_LOG_LEVEL) {
+        return;
+    }
+#endif
+
     va_list valist;
     log4cplus::LogLevel logLevel = log4cplus::TRACE_LOG_LEVEL;
     if (level >= LOG_LEVEL_VERBOSE && level <= LOG_LEVEL_FATAL) {
@@ -301,7 +345,17 @@ VOID DefaultCallbackProvider::logPrintHandler(UINT32 level, PCHAR tag, PCHAR fmt
     }
 
     va_start(valist, fmt);
-    auto logger = KinesisVideoLogger::getInstance();
+    auto& logger = KinesisVideoLogger::getInstance();
+
+    // Defer the formatting and the appender I/O off the PIC and curl threads
+    if (AsyncLogger::isActive()) {
+        if (logger.isEnabledFor(logLevel)) {
+            AsyncLogger::getInstance().logf(logger, logLevel, __FILE__, __LINE__, fmt, valist);
+        }
+
+        va_end(valist);
+        return;
+    }
 
     // This implementation is pulled from LOG4CPLUS_MACRO_FMT_BODY
     // Modified _snpbuf.print_va_list(va_list) to accept va_list instead of _snpbuf.print(arg...)
@@ -449,12 +503,45 @@ DefaultCallbackProvider::DefaultCallbackProvider(
     addProducerCallbacks(client_callbacks_, &producer_callbacks_);
     setPlatformCallbacks(client_callbacks_, &platform_callbacks_);
     createContinuousRetryStreamCallbacks(client_callbacks_, &pContinuoutsRetryStreamCallbacks);
+
+    // The credentials are refreshed in C++ so keep them ahead of the token requests. Started last and
+    // stopped first as the refresh calls into the provider.
+    credentials_provider_->startCredentialRefresh();
 }
 
 DefaultCallbackProvider::~DefaultCallbackProvider() {
+    // The refresh calls into the provider implementation so it's stopped while the provider is intact
+    credentials_provider_->stopCredentialRefresh();
     freeCallbacksProvider(&client_callbacks_);
 }
 
+void DefaultCallbackProvider::shutdownStream(STREAM_HANDLE stream_handle) {
+    latency_trackers_.remove(stream_handle);
+    frame_logs_.remove(stream_handle);
+    bitrate_advisors_.remove(stream_handle);
+}
+
+void DefaultCallbackProvider::registerStreamLatencyTracker(STREAM_HANDLE stream_handle, shared_ptr<StreamLatencyTracker> latency_tracker) {
+    latency_trackers_.put(stream_handle, latency_tracker);
+}
+
+void DefaultCallbackProvider::registerStreamFrameLog(STREAM_HANDLE stream_handle, shared_ptr<FrameLog> frame_log) {
+    frame_logs_.put(stream_handle, frame_log);
+}
+
+void DefaultCallbackProvider::registerStreamBitrateAdvisor(STREAM_HANDLE stream_handle, shared_ptr<BitrateAdvisor> bitrate_advisor) {
+    bitrate_advisors_.put(stream_handle, bitrate_advisor);
+}
+
+void DefaultCallbackProvider::reportBitrateRecommendation(STREAM_HANDLE stream_handle, uint64_t recommended_bitrate_bps) {
+    auto bitrate_recommendation_callback = stream_callback_provider_->getBitrateRecommendationCallback();
+    if (nullptr != bitrate_recommendation_callback) {
+        bitrate_recommendation_callback(stream_callback_provider_->getCallbackCustomData(),
+                                        stream_handle,
+                                        recommended_bitrate_bps);
+    }
+}
+
 StreamCallbacks DefaultCallbackProvider::getStreamCallbacks() {
     MEMSET(&stream_callbacks_, 0, SIZEOF(stream_callbacks_));
     stream_callbacks_.customData = reinterpret_cast<uintptr_t>(this);
@@ -5,10 +5,10 @@
 #include "CallbackProvider.h"
 #include "ClientCallbackProvider.h"
 #include "StreamCallbackProvider.h"
-#include "ThreadSafeMap.h"
 #include "GetTime.h"
 
 #include "Auth.h"
+#include "ConcurrentMap.h"
 
 #include <algorithm>
 #include <memory>
@@ -21,6 +21,10 @@
 
 namespace com { namespace amazonaws { namespace kinesis { namespace video {
 
+class StreamLatencyTracker;
+class FrameLog;
+class BitrateAdvisor;
+
 class DefaultCallbackProvider : public CallbackProvider {
 public:
     using callback_t = ClientCallbacks;
@@ -76,6 +80,39 @@ public:
 
     callback_t getCallbacks() override;
 
+    /**
+     * @copydoc com::amazonaws::kinesis::video::CallbackProvider::shutdownStream()
+     */
+    void shutdownStream(STREAM_HANDLE stream_handle) override;
+
+    /**
+     * Stream has been created. The latency tracker is to be fed with the fragment acks of the stream.
+     *
+     * NOTE: SDK internal. Called by the producer for the streams it creates.
+     */
+    void registerStreamLatencyTracker(STREAM_HANDLE stream_handle, std::shared_ptr<StreamLatencyTracker> latency_tracker);
+
+    /**
+     * Stream has been created with the frame log. The frame log is to be fed with the persisted fragment acks of the stream.
+     *
+     * NOTE: SDK internal. Called by the producer for the streams it creates.
+     */
+    void registerStreamFrameLog(STREAM_HANDLE stream_handle, std::shared_ptr<FrameLog> frame_log);
+
+    /**
+     * Stream has been created. The bitrate advisor is to be fed with the latency pressure of the stream.
+     *
+     * NOTE: SDK internal. Called by the producer for the streams it creates.
+     */
+    void registerStreamBitrateAdvisor(STREAM_HANDLE stream_handle, std::shared_ptr<BitrateAdvisor> bitrate_advisor);
+
+    /**
+     * The bitrate recommended for the stream has changed. Forwarded to the stream callback provider.
+     *
+     * NOTE: SDK internal. Called by the producer metrics sampler.
+     */
+    void reportBitrateRecommendation(STREAM_HANDLE stream_handle, uint64_t recommended_bitrate_bps);
+
     /**
      * @copydoc com::amazonaws::kinesis::video::CallbackProvider::getCurrentTimeCallback()
      */
@@ -464,6 +501,21 @@ protected:
      * Stores all platform callbacks from C++
      */
     PlatformCallbacks platform_callbacks_;
+
+    /**
+     * Latency trackers of the active streams looked up by the fragment ack callback
+     */
+    ConcurrentMap<STREAM_HANDLE, std::shared_ptr<StreamLatencyTracker>> latency_trackers_;
+
+    /**
+     * Frame logs of the active streams released by the persisted fragment acks
+     */
+    ConcurrentMap<STREAM_HANDLE, std::shared_ptr<FrameLog>> frame_logs_;
+
+    /**
+     * Bitrate advisors of the active streams fed with the latency pressure
+     */
+    ConcurrentMap<STREAM_HANDLE, std::shared_ptr<BitrateAdvisor>> bitrate_advisors_;
 };
 
 } // namespace video
@@ -3,8 +3,16 @@
 #include "DefaultDeviceInfoProvider.h"
 #include "Logger.h"
 
+#include <algorithm>
+#include <fstream>
 #include <string>
 
+#if !defined(_WIN32)
+#include <cerrno>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace com { namespace amazonaws { namespace kinesis { namespace video {
 
 LOGGER_TAG("com.amazonaws.kinesis.video");
@@ -90,6 +98,98 @@ const string DefaultDeviceInfoProvider::getCertPath() {
     return cert_path_;
 }
 
+uint64_t DefaultDeviceInfoProvider::setAutoStorageSize(const std::vector<StreamStorageDemand> &stream_demands) {
+    uint64_t memory_limit = getCgroupMemoryLimit();
+    uint64_t storage_size = computeStorageSize(stream_demands, memory_limit);
+    device_info_.storageInfo.storageSize = storage_size;
+
+    LOG_INFO("Auto-sized storage to " << storage_size << " bytes for " << stream_demands.size() << " streams with memory limit "
+             << (0 == memory_limit ? string("unlimited") : std::to_string(memory_limit)));
+    return storage_size;
+}
+
+uint64_t DefaultDeviceInfoProvider::computeStorageSize(const std::vector<StreamStorageDemand> &stream_demands, uint64_t memory_limit) {
+    uint64_t storage_size = 0;
+    for (const auto &stream_demand : stream_demands) {
+        storage_size += stream_demand.avg_bandwidth_bps / 8 * stream_demand.buffer_duration.count();
+    }
+
+    storage_size = std::max<uint64_t>(storage_size * (100 + AUTO_STORAGE_HEADROOM_PERCENT) / 100, AUTO_STORAGE_MIN_SIZE);
+
+    uint64_t storage_limit = memory_limit * AUTO_STORAGE_MEMORY_LIMIT_PERCENT / 100;
+    if (0 != memory_limit && storage_size > storage_limit) {
+        // Falling short of the buffer duration beats getting the container killed
+        LOG_WARN("Storage size of " << storage_size << " bytes needed by the streams is capped to " << storage_limit
+                 << " bytes by the memory limit of " << memory_limit << " bytes");
+        storage_size = storage_limit;
+    }
+
+    return storage_size;
+}
+
+uint64_t DefaultDeviceInfoProvider::getCgroupMemoryLimit(const string &proc_cgroup_path, const string &cgroup_root) {
+    // The cgroup v2 membership is the single "0::<path>" line
+    std::ifstream proc_cgroup(proc_cgroup_path);
+    string line, cgroup_path;
+    while (std::getline(proc_cgroup, line)) {
+        if (0 == line.compare(0, 3, "0::")) {
+            cgroup_path = line.substr(3);
+            break;
+        }
+    }
+
+    if (cgroup_path.empty()) {
+        return 0;
+    }
+
+    // The effective limit is the lowest one up the hierarchy
+    uint64_t memory_limit = 0;
+    while (true) {
+        std::ifstream memory_max(cgroup_root + (cgroup_path == "/" ? "" : cgroup_path) + "/memory.max");
+        string value;
+        if (memory_max >> value && value != "max") {
+            uint64_t limit = strtoull(value.c_str(), nullptr, 10);
+            if (0 != limit && (0 == memory_limit || limit < memory_limit)) {
+                memory_limit = limit;
+            }
+        }
+
+        if (cgroup_path.empty() || cgroup_path == "/") {
+            break;
+        }
+
+        cgroup_path = cgroup_path.substr(0, cgroup_path.find_last_of('/'));
+    }
+
+    return memory_limit;
+}
+
+void DefaultDeviceInfoProvider::setHybridFileStorage(const string &root_directory, uint64_t memory_storage_size, uint64_t max_file_storage_size) {
+    LOG_AND_THROW_IF(0 == max_file_storage_size, "Hybrid storage max file storage size can't be 0");
+    LOG_AND_THROW_IF(max_file_storage_size > MAX_UINT64 / 100 || memory_storage_size > MAX_UINT64 / 100 - max_file_storage_size,
+                     "Hybrid storage size " + std::to_string(memory_storage_size) + " + " + std::to_string(max_file_storage_size) + " is too large");
+    LOG_AND_THROW_IF(root_directory.empty() || root_directory.size() > MAX_PATH_LEN, "Invalid hybrid storage directory " + root_directory);
+
+#if !defined(_WIN32)
+    if (0 != mkdir(root_directory.c_str(), 0700) && EEXIST != errno) {
+        LOG_AND_THROW("Unable to create hybrid storage directory " + root_directory + ". errno " + std::to_string(errno));
+    }
+
+    LOG_AND_THROW_IF(0 != access(root_directory.c_str(), W_OK | X_OK), "Hybrid storage directory " + root_directory + " isn't writable");
+#endif
+
+    // The spill ratio is the memory part of the storage in whole percents so it is less than 100 with a file part
+    uint64_t storage_size = memory_storage_size + max_file_storage_size;
+    uint32_t spill_ratio = (uint32_t) (memory_storage_size * 100 / storage_size);
+    device_info_.storageInfo.storageType = DEVICE_STORAGE_TYPE_HYBRID_FILE;
+    device_info_.storageInfo.storageSize = storage_size;
+    device_info_.storageInfo.spillRatio = spill_ratio;
+    strcpy(device_info_.storageInfo.rootDirectory, root_directory.c_str());
+
+    LOG_INFO("Using hybrid file storage of " << device_info_.storageInfo.storageSize << " bytes with " << spill_ratio
+             << "% in memory and the rest in " << root_directory);
+}
+
 
 } // namespace video
 } // namespace kinesis
@@ -3,16 +3,83 @@
 #pragma once
 
 #include "DeviceInfoProvider.h"
+#include <chrono>
 #include <string>
+#include <vector>
 
 namespace com { namespace amazonaws { namespace kinesis { namespace video {
 
+/**
+ * Headroom on top of the buffered stream content for the packaging and the allocator fragmentation
+ */
+#define AUTO_STORAGE_HEADROOM_PERCENT 25
+
+/**
+ * Minimum auto-sized storage
+ */
+#define AUTO_STORAGE_MIN_SIZE (16 * 1024 * 1024)
+
+/**
+ * Share of the container memory limit the auto-sized storage may take
+ */
+#define AUTO_STORAGE_MEMORY_LIMIT_PERCENT 50
+
+/**
+ * Content the stream needs to buffer
+ */
+struct StreamStorageDemand {
+    uint64_t avg_bandwidth_bps;
+    std::chrono::duration<uint64_t> buffer_duration;
+};
+
 class DefaultDeviceInfoProvider : public DeviceInfoProvider {
 public:
     DefaultDeviceInfoProvider(const std::string &custom_useragent = "", const std::string &cert_path = "");
     device_info_t getDeviceInfo() override;
     const std::string getCustomUserAgent() override;
     const std::string getCertPath() override;
+
+    /**
+     * Backs the content store by the files in a directory on top of the memory. The allocations are served from
+     * the memory part while it lasts and spill over to the files once it's full, so a long network outage is
+     * buffered on the local storage rather than in a large memory reservation.
+     *
+     * The content store is sized as the sum of the two parts. The memory part is rounded down to the whole
+     * percentage of the content store the Kinesis Video PIC spill ratio is expressed in.
+     *
+     * @param root_directory The directory of the spill files. Created if missing.
+     * @param memory_storage_size Size in bytes of the content kept in memory.
+     * @param max_file_storage_size Maximum size in bytes of the content spilled to the files.
+     * @throws std::runtime_error if a size is out of range or the directory can't be used.
+     */
+    void setHybridFileStorage(const std::string &root_directory, uint64_t memory_storage_size, uint64_t max_file_storage_size);
+
+    /**
+     * Sizes the content store for the streams to buffer their buffer duration at their average bandwidth
+     * rather than reserving the default size. The size is capped by the cgroup memory limit of the process.
+     *
+     * @param stream_demands The streams of the producer.
+     * @return The storage size in bytes.
+     */
+    uint64_t setAutoStorageSize(const std::vector<StreamStorageDemand> &stream_demands);
+
+    /**
+     * @param stream_demands The streams to buffer.
+     * @param memory_limit The memory limit in bytes. 0 if unlimited.
+     * @return The storage size in bytes.
+     */
+    static uint64_t computeStorageSize(const std::vector<StreamStorageDemand> &stream_demands, uint64_t memory_limit);
+
+    /**
+     * Reads the cgroup v2 memory.max of the cgroup of the process and its ancestors.
+     *
+     * @param proc_cgroup_path The cgroup membership file of the process.
+     * @param cgroup_root The mount point of the cgroup v2 hierarchy.
+     * @return The lowest memory limit in bytes. 0 if unlimited or not running under cgroup v2.
+     */
+    static uint64_t getCgroupMemoryLimit(const std::string &proc_cgroup_path = "/proc/self/cgroup",
+                                         const std::string &cgroup_root = "/sys/fs/cgroup");
+
 protected:
 
     DeviceInfo device_info_;
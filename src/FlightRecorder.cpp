@@ -0,0 +1,379 @@
+#include "Logger.h"
+#include "FlightRecorder.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#if !defined(_WIN32)
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+LOGGER_TAG("com.amazonaws.kinesis.video");
+
+using std::string;
+using std::vector;
+
+/**
+ * Number of the entries read from the ring at a time while dumping. Bounded as the signal handlers dump from the stack.
+ */
+#define FLIGHT_RECORDER_DUMP_CHUNK_ENTRIES 64
+
+static_assert(sizeof(FlightRecorderEntry) == 32, "Flight recorder entries are expected to be packed");
+static_assert(sizeof(FlightRecorderFileHeader) == 40, "Flight recorder header is expected to be packed");
+
+namespace {
+
+const char* const EVENT_NAMES[FLIGHT_RECORDER_EVENT_COUNT] = {
+        "NONE",
+        "STREAM_CREATE",
+        "STREAM_FREE",
+        "STREAM_START",
+        "STREAM_STOP",
+        "STREAM_STOP_SYNC",
+        "STREAM_RESET",
+        "STREAM_RESET_CONNECTION",
+        "PUT_FRAME",
+        "STREAM_READY",
+        "STREAM_CLOSED",
+        "STREAM_ERROR",
+        "STREAM_LATENCY_PRESSURE",
+        "STREAM_UNDERFLOW",
+        "CONNECTION_STALE",
+        "DROPPED_FRAME",
+        "DROPPED_FRAGMENT",
+        "BUFFER_DURATION_OVERFLOW_PRESSURE",
+        "STORAGE_OVERFLOW_PRESSURE",
+        "FRAGMENT_ACK"};
+
+#if !defined(_WIN32)
+
+const int HANDLED_SIGNALS[] = {SIGUSR1, SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT};
+
+#define HANDLED_SIGNAL_COUNT (sizeof(HANDLED_SIGNALS) / sizeof(HANDLED_SIGNALS[0]))
+
+/**
+ * The signal handlers can't allocate so the paths are prepared on install
+ */
+char g_dump_file_path[FLIGHT_RECORDER_MAX_DUMP_PATH_LEN];
+char g_temp_dump_file_path[FLIGHT_RECORDER_MAX_DUMP_PATH_LEN];
+struct sigaction g_previous_actions[HANDLED_SIGNAL_COUNT];
+bool g_signal_handlers_installed = false;
+
+bool writeFully(int fd, const void* data, size_t size) {
+    const char* current = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t written = ::write(fd, current, size);
+        if (written < 0) {
+            if (EINTR == errno) {
+                continue;
+            }
+
+            return false;
+        }
+
+        current += written;
+        size -= (size_t) written;
+    }
+
+    return true;
+}
+
+#endif
+
+} // namespace
+
+FlightRecorder::FlightRecorder(uint32_t capacity)
+        : capacity_(0 == capacity ? 1 : capacity),
+          slots_(new Slot[capacity_]),
+          next_index_(0),
+          enabled_(true) {
+    for (uint32_t i = 0; i < capacity_; i++) {
+        slots_[i].sequence.store(0, std::memory_order_relaxed);
+    }
+}
+
+FlightRecorder& FlightRecorder::getInstance() {
+    static FlightRecorder instance;
+    return instance;
+}
+
+void FlightRecorder::record(FlightRecorderEventType event, STREAM_HANDLE stream_handle, STATUS status,
+                            uint64_t value, uint16_t aux) {
+    if (!enabled_.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    uint64_t timestamp = (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    uint64_t index = next_index_.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = slots_[index % capacity_];
+
+    // Invalidate the slot for the readers while it's being written
+    slot.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.timestamp.store(timestamp, std::memory_order_relaxed);
+    slot.stream_handle.store((uint64_t) stream_handle, std::memory_order_relaxed);
+    slot.value.store(value, std::memory_order_relaxed);
+    slot.packed.store((uint64_t) status | ((uint64_t) event << 32) | ((uint64_t) aux << 48), std::memory_order_relaxed);
+
+    slot.sequence.store(index + 1, std::memory_order_release);
+}
+
+size_t FlightRecorder::readEntries(uint64_t& index, uint64_t end_index, FlightRecorderEntry* entries, size_t max_entries) const {
+    size_t count = 0;
+    for (; index < end_index && count < max_entries; index++) {
+        const Slot& slot = slots_[index % capacity_];
+        uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+        if (sequence != index + 1) {
+            // Being written or already overwritten
+            continue;
+        }
+
+        FlightRecorderEntry& entry = entries[count];
+        entry.timestamp = slot.timestamp.load(std::memory_order_relaxed);
+        entry.stream_handle = slot.stream_handle.load(std::memory_order_relaxed);
+        entry.value = slot.value.load(std::memory_order_relaxed);
+        uint64_t packed = slot.packed.load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != sequence) {
+            continue;
+        }
+
+        entry.status = (uint32_t) packed;
+        entry.event = (uint16_t) (packed >> 32);
+        entry.aux = (uint16_t) (packed >> 48);
+        count++;
+    }
+
+    return count;
+}
+
+vector<FlightRecorderEntry> FlightRecorder::getEntries() const {
+    vector<FlightRecorderEntry> entries;
+    uint64_t end_index = next_index_.load(std::memory_order_acquire);
+    uint64_t index = getFirstIndex(end_index);
+
+    entries.resize((size_t) (end_index - index));
+    entries.resize(readEntries(index, end_index, entries.data(), entries.size()));
+    return entries;
+}
+
+void FlightRecorder::fillHeader(FlightRecorderFileHeader& header, uint64_t entry_count, uint64_t first_index, uint32_t reason) const {
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, FLIGHT_RECORDER_FILE_MAGIC, FLIGHT_RECORDER_FILE_MAGIC_SIZE);
+    header.version = FLIGHT_RECORDER_FILE_VERSION;
+    header.entry_size = sizeof(FlightRecorderEntry);
+    header.entry_count = entry_count;
+    header.overwritten_count = first_index;
+    header.reason = reason;
+}
+
+bool FlightRecorder::dump(const string& file_path) const {
+    FlightRecorderEntry entries[FLIGHT_RECORDER_DUMP_CHUNK_ENTRIES];
+    FlightRecorderFileHeader header;
+    uint64_t end_index = next_index_.load(std::memory_order_acquire);
+    uint64_t first_index = getFirstIndex(end_index);
+    uint64_t index = first_index;
+    uint64_t entry_count = 0;
+
+    string temp_file_path = file_path + ".tmp";
+    {
+        std::ofstream out(temp_file_path, std::ios::out | std::ios::trunc | std::ios::binary);
+        if (!out) {
+            LOG_ERROR("Failed to open the flight recorder dump file " << temp_file_path);
+            return false;
+        }
+
+        // The entries being written are skipped so the header is finalized after the entries
+        fillHeader(header, 0, first_index, FLIGHT_RECORDER_DUMP_REASON_ON_DEMAND);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        while (index < end_index) {
+            size_t count = readEntries(index, end_index, entries, FLIGHT_RECORDER_DUMP_CHUNK_ENTRIES);
+            out.write(reinterpret_cast<const char*>(entries), count * sizeof(FlightRecorderEntry));
+            entry_count += count;
+        }
+
+        fillHeader(header, entry_count, first_index, FLIGHT_RECORDER_DUMP_REASON_ON_DEMAND);
+        out.seekp(0);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        if (!out.flush()) {
+            LOG_ERROR("Failed to write the flight recorder dump file " << temp_file_path);
+            return false;
+        }
+    }
+
+    if (0 != std::rename(temp_file_path.c_str(), file_path.c_str())) {
+        LOG_ERROR("Failed to rename the flight recorder dump file " << temp_file_path);
+        return false;
+    }
+
+    LOG_INFO("Dumped " << entry_count << " flight recorder entries into " << file_path);
+    return true;
+}
+
+bool FlightRecorder::readDumpFile(const string& file_path, FlightRecorderFileHeader& header,
+                                  vector<FlightRecorderEntry>& entries) {
+    std::ifstream in(file_path, std::ios::in | std::ios::binary);
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+        return false;
+    }
+
+    if (0 != memcmp(header.magic, FLIGHT_RECORDER_FILE_MAGIC, FLIGHT_RECORDER_FILE_MAGIC_SIZE) ||
+        FLIGHT_RECORDER_FILE_VERSION != header.version ||
+        sizeof(FlightRecorderEntry) != header.entry_size) {
+        return false;
+    }
+
+    // The entry count of a truncated or a corrupt file is bounded by the entries the file can hold
+    in.seekg(0, std::ios::end);
+    uint64_t file_size = (uint64_t) in.tellg();
+    in.seekg(sizeof(header), std::ios::beg);
+    if (!in || header.entry_count > (file_size - sizeof(header)) / sizeof(FlightRecorderEntry)) {
+        return false;
+    }
+
+    entries.resize((size_t) header.entry_count);
+    return (bool) in.read(reinterpret_cast<char*>(entries.data()), entries.size() * sizeof(FlightRecorderEntry));
+}
+
+const char* FlightRecorder::getEventName(uint16_t event) {
+    return event < FLIGHT_RECORDER_EVENT_COUNT ? EVENT_NAMES[event] : "UNKNOWN";
+}
+
+#if defined(_WIN32)
+
+bool FlightRecorder::installSignalHandlers(const string& file_path) {
+    UNUSED_PARAM(file_path);
+    LOG_ERROR("Flight recorder signal dumps are not supported on this platform. Use the on-demand dump instead");
+    return false;
+}
+
+void FlightRecorder::uninstallSignalHandlers() {
+}
+
+void FlightRecorder::signalHandler(int signal_number) {
+    UNUSED_PARAM(signal_number);
+}
+
+#else
+
+bool FlightRecorder::dumpToDescriptor(int fd, uint32_t reason) const {
+    FlightRecorderEntry entries[FLIGHT_RECORDER_DUMP_CHUNK_ENTRIES];
+    FlightRecorderFileHeader header;
+    uint64_t end_index = next_index_.load(std::memory_order_acquire);
+    uint64_t first_index = getFirstIndex(end_index);
+    uint64_t index = first_index;
+    uint64_t entry_count = 0;
+
+    fillHeader(header, 0, first_index, reason);
+    if (!writeFully(fd, &header, sizeof(header))) {
+        return false;
+    }
+
+    while (index < end_index) {
+        size_t count = readEntries(index, end_index, entries, FLIGHT_RECORDER_DUMP_CHUNK_ENTRIES);
+        if (!writeFully(fd, entries, count * sizeof(FlightRecorderEntry))) {
+            return false;
+        }
+
+        entry_count += count;
+    }
+
+    fillHeader(header, entry_count, first_index, reason);
+    return 0 == ::lseek(fd, 0, SEEK_SET) && writeFully(fd, &header, sizeof(header));
+}
+
+void FlightRecorder::signalHandler(int signal_number) {
+    // Only the async-signal-safe calls from here on
+    int saved_errno = errno;
+
+    int fd = ::open(g_temp_dump_file_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) {
+        bool dumped = getInstance().dumpToDescriptor(fd, (uint32_t) signal_number);
+        ::close(fd);
+        if (dumped) {
+            ::rename(g_temp_dump_file_path, g_dump_file_path);
+        }
+    }
+
+    if (SIGUSR1 != signal_number) {
+        // Hand the crash over to the previous handler. The signal is re-delivered once this handler returns.
+        for (size_t i = 0; i < HANDLED_SIGNAL_COUNT; i++) {
+            if (HANDLED_SIGNALS[i] == signal_number) {
+                ::sigaction(signal_number, &g_previous_actions[i], nullptr);
+                break;
+            }
+        }
+
+        ::raise(signal_number);
+    }
+
+    errno = saved_errno;
+}
+
+bool FlightRecorder::installSignalHandlers(const string& file_path) {
+    if (file_path.empty() || file_path.size() + sizeof(".tmp") > FLIGHT_RECORDER_MAX_DUMP_PATH_LEN) {
+        LOG_ERROR("Invalid flight recorder dump file path " << file_path);
+        return false;
+    }
+
+    if (g_signal_handlers_installed) {
+        LOG_ERROR("Flight recorder signal handlers are already installed");
+        return false;
+    }
+
+    // Make sure the recorder is constructed outside of the signal handler
+    getInstance();
+
+    snprintf(g_dump_file_path, SIZEOF(g_dump_file_path), "%s", file_path.c_str());
+    snprintf(g_temp_dump_file_path, SIZEOF(g_temp_dump_file_path), "%s.tmp", file_path.c_str());
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = &FlightRecorder::signalHandler;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+
+    for (size_t i = 0; i < HANDLED_SIGNAL_COUNT; i++) {
+        if (0 != ::sigaction(HANDLED_SIGNALS[i], &action, &g_previous_actions[i])) {
+            LOG_ERROR("Failed to install the flight recorder handler for signal " << HANDLED_SIGNALS[i]);
+            for (size_t j = 0; j < i; j++) {
+                ::sigaction(HANDLED_SIGNALS[j], &g_previous_actions[j], nullptr);
+            }
+
+            return false;
+        }
+    }
+
+    g_signal_handlers_installed = true;
+    LOG_INFO("Flight recorder dumps into " << file_path << " on SIGUSR1 and on crash");
+    return true;
+}
+
+void FlightRecorder::uninstallSignalHandlers() {
+    if (!g_signal_handlers_installed) {
+        return;
+    }
+
+    for (size_t i = 0; i < HANDLED_SIGNAL_COUNT; i++) {
+        ::sigaction(HANDLED_SIGNALS[i], &g_previous_actions[i], nullptr);
+    }
+
+    g_signal_handlers_installed = false;
+}
+
+#endif
+
+} // namespace video
+} // namespace kinesis
+} // namespace amazonaws
+} // namespace com
@@ -0,0 +1,236 @@
+/** Copyright 2017 Amazon.com. All rights reserved. */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "com/amazonaws/kinesis/video/client/Include.h"
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+/**
+ * Default number of the entries kept by the process-wide flight recorder
+ */
+#define DEFAULT_FLIGHT_RECORDER_CAPACITY 32768
+
+/**
+ * Dump file magic and format version
+ */
+#define FLIGHT_RECORDER_FILE_MAGIC "KVSFLTRC"
+#define FLIGHT_RECORDER_FILE_MAGIC_SIZE 8
+#define FLIGHT_RECORDER_FILE_VERSION 1
+
+/**
+ * Dump reason recorded for the on-demand dumps. The signal dumps record the signal number instead.
+ */
+#define FLIGHT_RECORDER_DUMP_REASON_ON_DEMAND 0
+
+/**
+ * Maximum length of the dump file path used by the signal handlers
+ */
+#define FLIGHT_RECORDER_MAX_DUMP_PATH_LEN 4096
+
+/**
+ * Recorded events. The meaning of the entry value and aux fields depends on the event.
+ */
+typedef enum _FlightRecorderEventType {
+    FLIGHT_RECORDER_EVENT_NONE = 0,
+    FLIGHT_RECORDER_EVENT_STREAM_CREATE,                        // status - create result
+    FLIGHT_RECORDER_EVENT_STREAM_FREE,
+    FLIGHT_RECORDER_EVENT_STREAM_START,                         // status - CPD set result if any
+    FLIGHT_RECORDER_EVENT_STREAM_STOP,                          // status - stop result
+    FLIGHT_RECORDER_EVENT_STREAM_STOP_SYNC,                     // status - stop result
+    FLIGHT_RECORDER_EVENT_STREAM_RESET,                         // status - reset result
+    FLIGHT_RECORDER_EVENT_STREAM_RESET_CONNECTION,              // status - reset result
+    FLIGHT_RECORDER_EVENT_PUT_FRAME,                            // status - put result, value - pts, aux - frame flags
+    FLIGHT_RECORDER_EVENT_STREAM_READY,
+    FLIGHT_RECORDER_EVENT_STREAM_CLOSED,                        // value - upload handle
+    FLIGHT_RECORDER_EVENT_STREAM_ERROR,                         // status - error, value - fragment timecode
+    FLIGHT_RECORDER_EVENT_STREAM_LATENCY_PRESSURE,              // value - buffer duration
+    FLIGHT_RECORDER_EVENT_STREAM_UNDERFLOW,
+    FLIGHT_RECORDER_EVENT_CONNECTION_STALE,                     // value - last ack duration
+    FLIGHT_RECORDER_EVENT_DROPPED_FRAME,                        // value - frame timecode
+    FLIGHT_RECORDER_EVENT_DROPPED_FRAGMENT,                     // value - fragment timecode
+    FLIGHT_RECORDER_EVENT_BUFFER_DURATION_OVERFLOW_PRESSURE,    // value - remaining duration
+    FLIGHT_RECORDER_EVENT_STORAGE_OVERFLOW_PRESSURE,            // value - remaining bytes
+    FLIGHT_RECORDER_EVENT_FRAGMENT_ACK,                         // status - ack result, value - fragment timecode, aux - ack type
+    FLIGHT_RECORDER_EVENT_COUNT
+} FlightRecorderEventType;
+
+/**
+ * Decoded flight recorder entry as laid out in the dump file
+ */
+struct FlightRecorderEntry {
+    /**
+     * Nanoseconds since the epoch
+     */
+    uint64_t timestamp;
+    uint64_t stream_handle;
+    uint64_t value;
+    uint32_t status;
+    uint16_t event;
+    uint16_t aux;
+};
+
+/**
+ * Dump file header. Followed by the entries from the oldest to the newest.
+ */
+struct FlightRecorderFileHeader {
+    char magic[FLIGHT_RECORDER_FILE_MAGIC_SIZE];
+    uint32_t version;
+    uint32_t entry_size;
+    uint64_t entry_count;
+
+    /**
+     * Number of the entries recorded before the dumped ones and overwritten since
+     */
+    uint64_t overwritten_count;
+
+    /**
+     * FLIGHT_RECORDER_DUMP_REASON_ON_DEMAND or the signal number
+     */
+    uint32_t reason;
+    uint32_t reserved;
+};
+
+/**
+ * Fixed size in-memory flight recorder.
+ *
+ * Keeps the most recent stream lifecycle events, callback invocations and putFrame results in a binary
+ * ring which can be dumped into a compact file on demand, on SIGUSR1 or on a crash. The recording is
+ * lock-free, allocation-free and costs a clock read and a handful of relaxed stores so it's always on.
+ *
+ * The dump files are decoded with the kvs_flight_recorder_decoder tool.
+ *
+ * NOTE: The entries being written while the ring is dumped are skipped.
+ */
+class FlightRecorder {
+public:
+    explicit FlightRecorder(uint32_t capacity = DEFAULT_FLIGHT_RECORDER_CAPACITY);
+
+    /**
+     * @return The process-wide recorder used by the SDK
+     */
+    static FlightRecorder& getInstance();
+
+    /**
+     * Records an event with the current time
+     */
+    void record(FlightRecorderEventType event, STREAM_HANDLE stream_handle, STATUS status = STATUS_SUCCESS,
+                uint64_t value = 0, uint16_t aux = 0);
+
+    /**
+     * Turns the recording on or off. On by default.
+     */
+    void setEnabled(bool enabled) {
+        enabled_.store(enabled, std::memory_order_relaxed);
+    }
+
+    bool isEnabled() const {
+        return enabled_.load(std::memory_order_relaxed);
+    }
+
+    uint32_t capacity() const {
+        return capacity_;
+    }
+
+    /**
+     * @return Total number of the entries recorded so far
+     */
+    uint64_t getRecordedCount() const {
+        return next_index_.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @return The entries currently in the ring from the oldest to the newest
+     */
+    std::vector<FlightRecorderEntry> getEntries() const;
+
+    /**
+     * Dumps the ring into a file. The file is replaced atomically.
+     *
+     * @return true if the dump has been written and false otherwise.
+     */
+    bool dump(const std::string& file_path) const;
+
+    /**
+     * Dumps the process-wide recorder into the given file on SIGUSR1 and on the crash signals.
+     * The previously installed crash handlers are invoked after the dump.
+     *
+     * @return true if the handlers have been installed and false otherwise.
+     */
+    static bool installSignalHandlers(const std::string& file_path);
+
+    /**
+     * Restores the signal handlers replaced by installSignalHandlers
+     */
+    static void uninstallSignalHandlers();
+
+    /**
+     * Reads a dump file
+     *
+     * @return true if the file has been read and false if it's not a valid dump.
+     */
+    static bool readDumpFile(const std::string& file_path, FlightRecorderFileHeader& header,
+                             std::vector<FlightRecorderEntry>& entries);
+
+    /**
+     * @return The event name or "UNKNOWN"
+     */
+    static const char* getEventName(uint16_t event);
+
+private:
+    /**
+     * Seqlock protected slot. The sequence is the entry index + 1 once the entry is complete and 0 while it's written.
+     */
+    struct Slot {
+        std::atomic<uint64_t> sequence;
+        std::atomic<uint64_t> timestamp;
+        std::atomic<uint64_t> stream_handle;
+        std::atomic<uint64_t> value;
+
+        /**
+         * status | event << 32 | aux << 48
+         */
+        std::atomic<uint64_t> packed;
+    };
+
+    /**
+     * Reads up to max_entries consistent entries starting at the index. Async-signal-safe.
+     *
+     * @param index The index to start at. Advanced past the last index read.
+     * @param end_index The index to stop at.
+     * @return Number of the entries read
+     */
+    size_t readEntries(uint64_t& index, uint64_t end_index, FlightRecorderEntry* entries, size_t max_entries) const;
+
+    /**
+     * @return The index of the oldest entry in the ring
+     */
+    uint64_t getFirstIndex(uint64_t end_index) const {
+        return end_index > capacity_ ? end_index - capacity_ : 0;
+    }
+
+    void fillHeader(FlightRecorderFileHeader& header, uint64_t entry_count, uint64_t first_index, uint32_t reason) const;
+
+    /**
+     * Writes the dump into an open file descriptor. Async-signal-safe.
+     */
+    bool dumpToDescriptor(int fd, uint32_t reason) const;
+
+    static void signalHandler(int signal_number);
+
+    const uint32_t capacity_;
+    std::unique_ptr<Slot[]> slots_;
+    std::atomic<uint64_t> next_index_;
+    std::atomic<bool> enabled_;
+};
+
+} // namespace video
+} // namespace kinesis
+} // namespace amazonaws
+} // namespace com
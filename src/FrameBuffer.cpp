@@ -0,0 +1,65 @@
+/** Copyright 2017 Amazon.com. All rights reserved. */
+
+#include "FrameBuffer.h"
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+using std::vector;
+
+FrameBuffer::FrameBuffer() : data_(nullptr), size_(0) {}
+
+FrameBuffer::FrameBuffer(uint8_t* data, size_t size, release_callback_t release_callback)
+        : data_(data),
+          size_(size),
+          release_callback_(std::move(release_callback)) {}
+
+FrameBuffer::FrameBuffer(vector<uint8_t>&& data)
+        : storage_(std::move(data)) {
+    data_ = storage_.data();
+    size_ = storage_.size();
+}
+
+FrameBuffer::FrameBuffer(FrameBuffer&& other) : data_(nullptr), size_(0) {
+    *this = std::move(other);
+}
+
+FrameBuffer& FrameBuffer::operator=(FrameBuffer&& other) {
+    if (this != &other) {
+        release();
+
+        // Moving the vector keeps the heap block so the adopted data pointer stays valid
+        storage_ = std::move(other.storage_);
+        release_callback_ = std::move(other.release_callback_);
+        data_ = other.data_;
+        size_ = other.size_;
+
+        other.data_ = nullptr;
+        other.size_ = 0;
+        other.release_callback_ = nullptr;
+        other.storage_.clear();
+    }
+
+    return *this;
+}
+
+FrameBuffer::~FrameBuffer() {
+    release();
+}
+
+void FrameBuffer::release() {
+    if (release_callback_) {
+        release_callback_t release_callback = std::move(release_callback_);
+        release_callback_ = nullptr;
+        release_callback(data_, size_);
+    }
+
+    storage_.clear();
+    storage_.shrink_to_fit();
+    data_ = nullptr;
+    size_ = 0;
+}
+
+} // namespace video
+} // namespace kinesis
+} // namespace amazonaws
+} // namespace com
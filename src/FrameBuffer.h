@@ -0,0 +1,91 @@
+/** Copyright 2017 Amazon.com. All rights reserved. */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+/**
+* Move-only owner of a frame payload handed over to the SDK.
+*
+* The payload is either adopted from a vector or is an external buffer (ex: a mapped GstBuffer)
+* accompanied by a release callback. The SDK keeps the buffer alive until the frame has been packaged
+* into the content store and then releases it, so the caller neither has to copy the payload nor keep it alive.
+*
+* NOTE: The release callback may be invoked on an SDK thread.
+*/
+class FrameBuffer {
+public:
+    using release_callback_t = std::function<void(uint8_t* data, size_t size)>;
+
+    /**
+     * Empty buffer
+     */
+    FrameBuffer();
+
+    /**
+     * Wraps an external payload which is released by invoking the release callback.
+     *
+     * @param data The payload
+     * @param size The payload size in bytes
+     * @param release_callback Invoked exactly once when the SDK no longer needs the payload. Can be empty.
+     */
+    FrameBuffer(uint8_t* data, size_t size, release_callback_t release_callback);
+
+    /**
+     * Adopts the payload stored in the vector without copying
+     */
+    explicit FrameBuffer(std::vector<uint8_t>&& data);
+
+    FrameBuffer(FrameBuffer&& other);
+
+    FrameBuffer& operator=(FrameBuffer&& other);
+
+    FrameBuffer(const FrameBuffer&) = delete;
+
+    FrameBuffer& operator=(const FrameBuffer&) = delete;
+
+    ~FrameBuffer();
+
+    /**
+     * @return The payload or nullptr if empty
+     */
+    uint8_t* data() const {
+        return data_;
+    }
+
+    /**
+     * @return The payload size in bytes
+     */
+    size_t size() const {
+        return size_;
+    }
+
+    bool empty() const {
+        return nullptr == data_;
+    }
+
+    /**
+     * Releases the payload. Idempotent.
+     */
+    void release();
+
+private:
+    uint8_t* data_;
+    size_t size_;
+    release_callback_t release_callback_;
+
+    /**
+     * Storage for the adopted vector payload
+     */
+    std::vector<uint8_t> storage_;
+};
+
+} // namespace video
+} // namespace kinesis
+} // namespace amazonaws
+} // namespace com
@@ -0,0 +1,620 @@
+#include "Logger.h"
+#include "FrameLog.h"
+#include "SdkThread.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#if !defined(_WIN32)
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+LOGGER_TAG("com.amazonaws.kinesis.video");
+
+using std::string;
+using std::vector;
+
+namespace {
+
+/**
+ * Marks the start of a frame record
+ */
+const uint32_t FRAME_RECORD_MAGIC = 0x4b565346;
+
+/**
+ * Name of the segment being preallocated until it's ready
+ */
+const char NEXT_SEGMENT_FILE_NAME[] = "next.tmp";
+
+/**
+ * Frame record header followed by the frame data. The segment index tells the records apart from
+ * the stale records of a recycled segment file and the checksum detects the torn writes.
+ */
+struct FrameRecordHeader {
+    uint32_t magic;
+    uint32_t crc;
+    uint64_t segment_index;
+    uint64_t presentation_ts;
+    uint64_t decoding_ts;
+    uint64_t duration;
+    uint64_t track_id;
+    uint32_t flags;
+    uint32_t size;
+};
+
+static_assert(sizeof(FrameRecordHeader) == 56, "Frame record header must not be padded");
+
+uint32_t updateCrc(uint32_t crc, const uint8_t* data, size_t size) {
+    static const vector<uint32_t> table = []() {
+        vector<uint32_t> crc_table(256);
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t value = i;
+            for (int bit = 0; bit < 8; bit++) {
+                value = (value & 1) ? (0xedb88320 ^ (value >> 1)) : (value >> 1);
+            }
+
+            crc_table[i] = value;
+        }
+
+        return crc_table;
+    }();
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+
+    return ~crc;
+}
+
+/**
+ * Checksum of the record past the checksum field
+ */
+uint32_t getRecordCrc(const FrameRecordHeader& header, const uint8_t* data) {
+    const uint8_t* header_bytes = reinterpret_cast<const uint8_t*>(&header.segment_index);
+    uint32_t crc = updateCrc(0, header_bytes, sizeof(FrameRecordHeader) - offsetof(FrameRecordHeader, segment_index));
+    return updateCrc(crc, data, header.size);
+}
+
+void makeDirectory(const string& path) {
+#if !defined(_WIN32)
+    if (0 != mkdir(path.c_str(), 0700) && EEXIST != errno) {
+        LOG_AND_THROW("Unable to create frame log directory " + path + ". errno " + std::to_string(errno));
+    }
+#endif
+}
+
+vector<uint64_t> listSegments(const string& directory) {
+    vector<uint64_t> segments;
+#if !defined(_WIN32)
+    DIR* dir = opendir(directory.c_str());
+    LOG_AND_THROW_IF(nullptr == dir, "Unable to open frame log directory " + directory + ". errno " + std::to_string(errno));
+
+    const size_t extension_len = strlen(FRAME_LOG_SEGMENT_EXTENSION);
+    struct dirent* entry;
+    while (nullptr != (entry = readdir(dir))) {
+        string name = entry->d_name;
+        if (name.size() > extension_len && 0 == name.compare(name.size() - extension_len, extension_len, FRAME_LOG_SEGMENT_EXTENSION)) {
+            segments.push_back(strtoull(name.c_str(), nullptr, 10));
+        }
+    }
+
+    closedir(dir);
+#endif
+    std::sort(segments.begin(), segments.end());
+    return segments;
+}
+
+bool readFile(const string& path, vector<uint8_t>& contents) {
+#if !defined(_WIN32)
+    int fd = open(path.c_str(), O_RDONLY);
+    if (-1 == fd) {
+        return false;
+    }
+
+    struct stat file_stat;
+    if (0 != fstat(fd, &file_stat)) {
+        close(fd);
+        return false;
+    }
+
+    contents.resize((size_t) file_stat.st_size);
+    size_t offset = 0;
+    while (offset < contents.size()) {
+        ssize_t result = read(fd, contents.data() + offset, contents.size() - offset);
+        if (result <= 0) {
+            if (result < 0 && EINTR == errno) {
+                continue;
+            }
+
+            break;
+        }
+
+        offset += (size_t) result;
+    }
+
+    contents.resize(offset);
+    close(fd);
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool writeRecord(int fd, uint64_t offset, const FrameRecordHeader& header, const uint8_t* data) {
+#if !defined(_WIN32)
+    struct iovec iov[2];
+    iov[0].iov_base = const_cast<FrameRecordHeader*>(&header);
+    iov[0].iov_len = sizeof(FrameRecordHeader);
+    iov[1].iov_base = const_cast<uint8_t*>(data);
+    iov[1].iov_len = header.size;
+
+    // A single system call for the header and the data in the common case
+    int iov_index = 0;
+    while (iov_index < 2) {
+        ssize_t result = pwritev(fd, iov + iov_index, 2 - iov_index, (off_t) offset);
+        if (result < 0) {
+            if (EINTR == errno) {
+                continue;
+            }
+
+            return false;
+        }
+
+        offset += (uint64_t) result;
+        while (iov_index < 2 && (size_t) result >= iov[iov_index].iov_len) {
+            result -= iov[iov_index].iov_len;
+            iov_index++;
+        }
+
+        if (iov_index < 2) {
+            iov[iov_index].iov_base = reinterpret_cast<uint8_t*>(iov[iov_index].iov_base) + result;
+            iov[iov_index].iov_len -= (size_t) result;
+        }
+    }
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+void syncFile(int fd) {
+#if defined(__linux__)
+    fdatasync(fd);
+#elif !defined(_WIN32)
+    fsync(fd);
+#endif
+}
+
+/**
+ * Persists the entries of the directory
+ */
+void syncDirectory(const string& path) {
+#if !defined(_WIN32)
+    int fd = open(path.c_str(), O_RDONLY | O_DIRECTORY);
+    if (-1 == fd) {
+        LOG_WARN("Unable to open frame log directory " << path << " to sync. errno " << errno);
+        return;
+    }
+
+    if (0 != fsync(fd)) {
+        LOG_WARN("Unable to sync frame log directory " << path << ". errno " << errno);
+    }
+
+    close(fd);
+#else
+    UNUSED_PARAM(path);
+#endif
+}
+
+void closeFile(int fd) {
+#if !defined(_WIN32)
+    close(fd);
+#endif
+}
+
+} // namespace
+
+FrameLog::FrameLog(const string& directory,
+                   const string& stream_name,
+                   uint64_t timecode_scale,
+                   uint64_t segment_size,
+                   std::chrono::milliseconds sync_interval)
+        : directory_(directory + "/" + stream_name),
+          timecode_scale_(0 == timecode_scale ? 1 : timecode_scale),
+          segment_size_(segment_size),
+          sync_interval_(sync_interval),
+          current_offset_(0),
+          current_fragment_timecode_(0),
+          next_fd_(-1),
+          append_sequence_(0),
+          synced_sequence_(0),
+          directory_changed_(false),
+          sync_requested_(false),
+          prepare_requested_(true),
+          sync_thread_exit_(false) {
+#if defined(_WIN32)
+    LOG_AND_THROW("Frame log is not supported on this platform");
+#endif
+    LOG_AND_THROW_IF(directory.empty() || stream_name.empty(), "Frame log directory and stream name can't be empty");
+    memset(&metrics_, 0x00, sizeof(metrics_));
+
+    makeDirectory(directory);
+    makeDirectory(directory_);
+
+    // Continue after the segments left over by the previous run
+    replay_segments_ = listSegments(directory_);
+    uint64_t index = replay_segments_.empty() ? 0 : replay_segments_.back() + 1;
+    int fd = prepareSegment(getSegmentPath(index), "");
+    LOG_AND_THROW_IF(-1 == fd, "Unable to create frame log segment in " + directory_ + ". errno " + std::to_string(errno));
+    current_ = Segment{index, fd, 0, false};
+
+    // The stream directory and the first segment are in place before any frame is committed into them
+    syncDirectory(directory);
+    syncDirectory(directory_);
+
+    if (!replay_segments_.empty()) {
+        LOG_INFO("Frame log " << directory_ << " has " << replay_segments_.size() << " segments to replay");
+    }
+
+    sync_thread_ = SdkThread::start("wal", [this]() { syncRoutine(); });
+}
+
+FrameLog::~FrameLog() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sync_thread_exit_ = true;
+        sync_cv_.notify_all();
+    }
+
+    // The commit thread commits the outstanding frames before exiting
+    sync_thread_.join();
+
+    closeFile(current_.fd);
+    if (-1 != next_fd_) {
+        closeFile(next_fd_);
+    }
+
+    for (auto& segment : sealed_segments_) {
+        if (-1 != segment.fd) {
+            closeFile(segment.fd);
+        }
+    }
+}
+
+string FrameLog::getSegmentPath(uint64_t index) const {
+    char name[32];
+    snprintf(name, sizeof(name), "%020llu", (unsigned long long) index);
+    return directory_ + "/" + name + FRAME_LOG_SEGMENT_EXTENSION;
+}
+
+int FrameLog::prepareSegment(const string& path, const string& recycled_path) {
+#if !defined(_WIN32)
+    if (!recycled_path.empty() && 0 != rename(recycled_path.c_str(), path.c_str())) {
+        LOG_WARN("Unable to recycle frame log segment " << recycled_path << ". errno " << errno);
+        unlink(recycled_path.c_str());
+    }
+
+    int fd = open(path.c_str(), O_CREAT | O_WRONLY, 0600);
+    if (-1 == fd) {
+        return -1;
+    }
+
+    // Allocating the blocks upfront keeps the commits from updating the file size and the block map
+#if defined(__linux__)
+    int result = posix_fallocate(fd, 0, (off_t) segment_size_);
+#else
+    int result = ftruncate(fd, (off_t) segment_size_);
+#endif
+    if (0 != result) {
+        LOG_WARN("Unable to preallocate frame log segment " << path << ". Error " << result);
+    }
+
+    return fd;
+#else
+    UNUSED_PARAM(path);
+    UNUSED_PARAM(recycled_path);
+    return -1;
+#endif
+}
+
+bool FrameLog::rollOver() {
+    uint64_t index = current_.index + 1;
+    int fd = next_fd_;
+    if (-1 == fd) {
+        metrics_.unprepared_segments++;
+        fd = prepareSegment(getSegmentPath(index), "");
+        if (-1 == fd) {
+            LOG_ERROR("Unable to create frame log segment " << getSegmentPath(index) << ". errno " << errno);
+            return false;
+        }
+
+        directory_changed_ = true;
+    }
+
+    // Sealed segments are closed by the commit thread once committed
+    sealed_segments_.push_back(current_);
+    current_ = Segment{index, fd, current_fragment_timecode_, false};
+    current_offset_ = 0;
+    next_fd_ = -1;
+    prepare_requested_ = true;
+    sync_cv_.notify_one();
+
+    return true;
+}
+
+STATUS FrameLog::append(const Frame& frame) {
+    FrameRecordHeader header;
+    header.magic = FRAME_RECORD_MAGIC;
+    header.presentation_ts = frame.presentationTs;
+    header.decoding_ts = frame.decodingTs;
+    header.duration = frame.duration;
+    header.track_id = frame.trackId;
+    header.flags = (uint32_t) frame.flags;
+    header.size = frame.size;
+
+    uint64_t record_size = sizeof(FrameRecordHeader) + frame.size;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (current_.has_frames && current_offset_ + record_size > segment_size_ && !rollOver()) {
+        return STATUS_INVALID_OPERATION;
+    }
+
+    header.segment_index = current_.index;
+    header.crc = getRecordCrc(header, frame.frameData);
+    if (!writeRecord(current_.fd, current_offset_, header, frame.frameData)) {
+        LOG_ERROR("Failed to append frame to frame log " << directory_ << ". errno " << errno);
+        return STATUS_INVALID_OPERATION;
+    }
+
+    if (CHECK_FRAME_FLAG_KEY_FRAME(frame.flags)) {
+        current_fragment_timecode_ = frame.presentationTs / timecode_scale_;
+    }
+
+    current_offset_ += record_size;
+    current_.has_frames = true;
+    current_.last_fragment_timecode = current_fragment_timecode_;
+    append_sequence_++;
+    metrics_.appended_frames++;
+    metrics_.appended_bytes += record_size;
+
+    return STATUS_SUCCESS;
+}
+
+uint64_t FrameLog::replay(const std::function<STATUS(Frame&)>& submit) {
+    vector<uint64_t> replay_segments;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        replay_segments.swap(replay_segments_);
+    }
+
+    vector<Segment> replayed_segments;
+    vector<uint8_t> contents;
+    uint64_t replayed_frames = 0, failed_frames = 0;
+    uint64_t fragment_timecode = 0;
+    for (auto index : replay_segments) {
+        Segment segment{index, -1, 0, false};
+        if (!readFile(getSegmentPath(index), contents)) {
+            LOG_WARN("Unable to read frame log segment " << getSegmentPath(index) << ". errno " << errno);
+            replayed_segments.push_back(segment);
+            continue;
+        }
+
+        // The records end at the zeroed preallocated space, a stale record or a torn write
+        size_t offset = 0;
+        while (offset + sizeof(FrameRecordHeader) <= contents.size()) {
+            FrameRecordHeader header;
+            memcpy(&header, contents.data() + offset, sizeof(FrameRecordHeader));
+            uint8_t* data = contents.data() + offset + sizeof(FrameRecordHeader);
+            if (FRAME_RECORD_MAGIC != header.magic || index != header.segment_index
+                    || header.size > contents.size() - offset - sizeof(FrameRecordHeader)
+                    || header.crc != getRecordCrc(header, data)) {
+                break;
+            }
+
+            Frame frame;
+            memset(&frame, 0x00, sizeof(Frame));
+            frame.version = FRAME_CURRENT_VERSION;
+            frame.flags = (FRAME_FLAGS) header.flags;
+            frame.presentationTs = header.presentation_ts;
+            frame.decodingTs = header.decoding_ts;
+            frame.duration = header.duration;
+            frame.trackId = header.track_id;
+            frame.size = header.size;
+            frame.frameData = data;
+            if (CHECK_FRAME_FLAG_KEY_FRAME(frame.flags)) {
+                fragment_timecode = frame.presentationTs / timecode_scale_;
+            }
+
+            if (STATUS_SUCCEEDED(submit(frame))) {
+                replayed_frames++;
+            } else {
+                failed_frames++;
+            }
+
+            segment.has_frames = true;
+            segment.last_fragment_timecode = fragment_timecode;
+            offset += sizeof(FrameRecordHeader) + header.size;
+        }
+
+        replayed_segments.push_back(segment);
+    }
+
+    {
+        // The replayed segments are older than the ones appended since the log was opened
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto insert_position = sealed_segments_.begin();
+        for (auto& segment : replayed_segments) {
+            if (segment.has_frames) {
+                insert_position = sealed_segments_.insert(insert_position, segment) + 1;
+            } else {
+                obsolete_segments_.push_back(segment);
+            }
+        }
+
+        metrics_.replayed_frames += replayed_frames;
+        sync_cv_.notify_one();
+    }
+
+    if (!replay_segments.empty()) {
+        LOG_INFO("Replayed " << replayed_frames << " frames from frame log " << directory_ << " with " << failed_frames << " failed frames");
+    }
+
+    return replayed_frames;
+}
+
+void FrameLog::sync() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    uint64_t target_sequence = append_sequence_;
+    sync_requested_ = true;
+    sync_cv_.notify_one();
+    synced_cv_.wait(lock, [this, target_sequence]() { return sync_thread_exit_ || synced_sequence_ >= target_sequence; });
+}
+
+void FrameLog::onFragmentPersisted(uint64_t fragment_timecode) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool deleted = false;
+    while (!sealed_segments_.empty() && sealed_segments_.front().last_fragment_timecode <= fragment_timecode) {
+        obsolete_segments_.push_back(sealed_segments_.front());
+        sealed_segments_.pop_front();
+        deleted = true;
+    }
+
+    if (deleted) {
+        sync_cv_.notify_one();
+    }
+}
+
+void FrameLog::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (current_.has_frames) {
+        rollOver();
+    }
+
+    while (!sealed_segments_.empty()) {
+        obsolete_segments_.push_back(sealed_segments_.front());
+        sealed_segments_.pop_front();
+    }
+
+    sync_cv_.notify_one();
+}
+
+FrameLogMetrics FrameLog::getMetrics() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return metrics_;
+}
+
+void FrameLog::syncRoutine() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        sync_cv_.wait_for(lock, sync_interval_, [this]() {
+            return sync_thread_exit_ || sync_requested_ || prepare_requested_ || !obsolete_segments_.empty();
+        });
+
+        bool exiting = sync_thread_exit_;
+
+        // Group commit of all of the frames appended since the previous one
+        if (append_sequence_ != synced_sequence_) {
+            uint64_t target_sequence = append_sequence_;
+            vector<int> fds;
+            vector<uint64_t> sealed_indexes;
+            for (auto& segment : sealed_segments_) {
+                if (-1 != segment.fd) {
+                    fds.push_back(segment.fd);
+                    sealed_indexes.push_back(segment.index);
+                }
+            }
+
+            fds.push_back(current_.fd);
+            bool sync_directory = directory_changed_;
+            directory_changed_ = false;
+
+            lock.unlock();
+            for (auto fd : fds) {
+                syncFile(fd);
+            }
+
+            if (sync_directory) {
+                syncDirectory(directory_);
+            }
+            lock.lock();
+
+            for (auto& segment : sealed_segments_) {
+                if (-1 != segment.fd && std::find(sealed_indexes.begin(), sealed_indexes.end(), segment.index) != sealed_indexes.end()) {
+                    closeFile(segment.fd);
+                    segment.fd = -1;
+                }
+            }
+
+            synced_sequence_ = target_sequence;
+            metrics_.syncs++;
+        }
+
+        sync_requested_ = false;
+        synced_cv_.notify_all();
+
+        // Recycle a persisted segment as the next one rather than allocating a new one
+        vector<Segment> obsolete_segments;
+        obsolete_segments.swap(obsolete_segments_);
+        bool prepare = prepare_requested_ && -1 == next_fd_ && !exiting;
+        uint64_t next_index = current_.index + 1;
+        prepare_requested_ = false;
+
+        lock.unlock();
+        string recycled_path;
+        for (auto& segment : obsolete_segments) {
+            if (-1 != segment.fd) {
+                closeFile(segment.fd);
+            }
+
+            if (prepare && recycled_path.empty()) {
+                recycled_path = getSegmentPath(segment.index);
+            } else {
+#if !defined(_WIN32)
+                unlink(getSegmentPath(segment.index).c_str());
+#endif
+            }
+        }
+
+        int fd = -1;
+        string next_path = directory_ + "/" + NEXT_SEGMENT_FILE_NAME;
+        if (prepare) {
+            fd = prepareSegment(next_path, recycled_path);
+        }
+        lock.lock();
+
+        metrics_.deleted_segments += obsolete_segments.size();
+        if (!obsolete_segments.empty() || prepare) {
+            directory_changed_ = true;
+        }
+
+        if (-1 != fd) {
+            // The put frame path might have rolled over in the meantime
+#if !defined(_WIN32)
+            if (-1 == next_fd_ && current_.index + 1 == next_index && 0 == rename(next_path.c_str(), getSegmentPath(next_index).c_str())) {
+                next_fd_ = fd;
+            } else {
+                closeFile(fd);
+                unlink(next_path.c_str());
+            }
+#endif
+        }
+
+        if (exiting) {
+            break;
+        }
+    }
+}
+
+} // namespace video
+} // namespace kinesis
+} // namespace amazonaws
+} // namespace com
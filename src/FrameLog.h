@@ -0,0 +1,217 @@
+/** Copyright 2017 Amazon.com. All rights reserved. */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "com/amazonaws/kinesis/video/client/Include.h"
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+/**
+ * Default size of the frame log segments which are preallocated on the storage
+ */
+#define DEFAULT_FRAME_LOG_SEGMENT_SIZE (64 * 1024 * 1024)
+
+/**
+ * Default period of the group commit. Bounds the frames lost at a power loss.
+ */
+#define DEFAULT_FRAME_LOG_SYNC_INTERVAL_MILLIS 100
+
+/**
+ * Extension of the frame log segment files
+ */
+#define FRAME_LOG_SEGMENT_EXTENSION ".kvswal"
+
+/**
+ * Frame log metrics
+ */
+struct FrameLogMetrics {
+    uint64_t appended_frames;
+    uint64_t appended_bytes;
+    uint64_t syncs;
+    uint64_t replayed_frames;
+    uint64_t deleted_segments;
+
+    /**
+     * Segments which had to be created on the put frame path as the preallocation fell behind
+     */
+    uint64_t unprepared_segments;
+};
+
+/**
+ * Write-ahead log of the frames accepted by a stream.
+ *
+ * The frames are appended to the preallocated segment files in a per-stream directory and made durable by a
+ * background thread which commits all of the frames appended since the previous commit with a single
+ * fdatasync. A segment is deleted once all of its fragments are acknowledged as persisted. The segments
+ * left over by a crash are replayed when the log of the stream is opened again.
+ *
+ * The fragments are matched by the key frame timecode and therefore require the absolute fragment times
+ * and the key frame fragmentation.
+ *
+ * NOTE: The delivery is at least once. The persisted frames sharing a segment with the frames which are
+ * not are replayed again.
+ */
+class FrameLog {
+public:
+    /**
+     * Opens the log of the stream picking up the segments left over by the previous run
+     *
+     * @param directory The root directory of the frame logs. The log of the stream is in its subdirectory.
+     * @param stream_name The stream name.
+     * @param timecode_scale The stream timecode scale in the Kinesis Video time units (100ns).
+     * @param segment_size The size the segments are preallocated to.
+     * @param sync_interval The group commit period.
+     * @throws std::runtime_error if the directory can't be used.
+     */
+    FrameLog(const std::string& directory,
+             const std::string& stream_name,
+             uint64_t timecode_scale,
+             uint64_t segment_size = DEFAULT_FRAME_LOG_SEGMENT_SIZE,
+             std::chrono::milliseconds sync_interval = std::chrono::milliseconds(DEFAULT_FRAME_LOG_SYNC_INTERVAL_MILLIS));
+
+    ~FrameLog();
+
+    /**
+     * Appends the frame. Durable after the next group commit.
+     *
+     * @return STATUS_SUCCESS or the failure to write the frame.
+     */
+    STATUS append(const Frame& frame);
+
+    /**
+     * Submits the frames left over by the previous run in the order they were appended
+     *
+     * @param submit Submits the frame to the stream.
+     * @return The number of the replayed frames.
+     */
+    uint64_t replay(const std::function<STATUS(Frame&)>& submit);
+
+    /**
+     * Commits the appended frames and awaits for the commit
+     */
+    void sync();
+
+    /**
+     * Deletes the segments of the fragments up to the persisted one
+     *
+     * @param fragment_timecode Timecode of the persisted fragment.
+     */
+    void onFragmentPersisted(uint64_t fragment_timecode);
+
+    /**
+     * Deletes all of the segments as the stream has been stopped with all of the fragments persisted
+     */
+    void clear();
+
+    /**
+     * @return The directory of the stream log.
+     */
+    const std::string& getDirectory() const {
+        return directory_;
+    }
+
+    FrameLogMetrics getMetrics() const;
+
+private:
+    struct Segment {
+        uint64_t index;
+
+        /**
+         * Open until committed after the segment is sealed. -1 once closed.
+         */
+        int fd;
+
+        /**
+         * Timecode of the fragment of the last frame in the segment
+         */
+        uint64_t last_fragment_timecode;
+
+        bool has_frames;
+    };
+
+    std::string getSegmentPath(uint64_t index) const;
+
+    /**
+     * Opens the segment file preallocating it. Renames the recycled file to the path if any.
+     *
+     * @return The file descriptor or -1.
+     */
+    int prepareSegment(const std::string& path, const std::string& recycled_path);
+
+    /**
+     * Seals the current segment and continues in the next one. Called under the lock.
+     */
+    bool rollOver();
+
+    /**
+     * Group commit thread routine
+     */
+    void syncRoutine();
+
+    const std::string directory_;
+    const uint64_t timecode_scale_;
+    const uint64_t segment_size_;
+    const std::chrono::milliseconds sync_interval_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable sync_cv_;
+    std::condition_variable synced_cv_;
+
+    /**
+     * The segment the frames are appended to
+     */
+    Segment current_;
+    uint64_t current_offset_;
+    uint64_t current_fragment_timecode_;
+
+    /**
+     * The next segment preallocated by the commit thread. -1 if not prepared yet.
+     */
+    int next_fd_;
+
+    /**
+     * Segments sealed in the order of appending which are not persisted yet
+     */
+    std::deque<Segment> sealed_segments_;
+
+    /**
+     * Persisted segments to be deleted or recycled by the commit thread
+     */
+    std::vector<Segment> obsolete_segments_;
+
+    /**
+     * Segments left over by the previous run which are yet to be replayed
+     */
+    std::vector<uint64_t> replay_segments_;
+
+    uint64_t append_sequence_;
+    uint64_t synced_sequence_;
+
+    /**
+     * Set when the segment files are created, renamed or deleted. The directory is synced with the next
+     * commit so that the committed records are not lost with the directory entry of their segment.
+     */
+    bool directory_changed_;
+
+    bool sync_requested_;
+    bool prepare_requested_;
+    bool sync_thread_exit_;
+
+    FrameLogMetrics metrics_;
+
+    std::thread sync_thread_;
+};
+
+} // namespace video
+} // namespace kinesis
+} // namespace amazonaws
+} // namespace com
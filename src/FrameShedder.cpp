@@ -0,0 +1,100 @@
+#include "Logger.h"
+#include "FrameShedder.h"
+
+#include <algorithm>
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+LOGGER_TAG("com.amazonaws.kinesis.video");
+
+FrameShedder::FrameShedder(uint64_t primary_track_id, std::chrono::milliseconds buffer_duration)
+        : primary_track_id_(primary_track_id),
+          buffer_duration_(buffer_duration),
+          level_(FRAME_SHEDDING_LEVEL_NONE),
+          awaiting_key_frame_(false) {
+    for (auto& shed_frames : shed_frames_) {
+        shed_frames.store(0, std::memory_order_relaxed);
+    }
+}
+
+uint32_t FrameShedder::getThreshold(uint32_t level) {
+    switch (level) {
+        case FRAME_SHEDDING_LEVEL_NON_REFERENCE:
+            return FRAME_SHEDDING_NON_REFERENCE_THRESHOLD_PERCENT;
+        case FRAME_SHEDDING_LEVEL_SECONDARY_TRACKS:
+            return FRAME_SHEDDING_SECONDARY_TRACKS_THRESHOLD_PERCENT;
+        case FRAME_SHEDDING_LEVEL_KEY_FRAME_ONLY:
+            return FRAME_SHEDDING_KEY_FRAME_ONLY_THRESHOLD_PERCENT;
+        default:
+            return 0;
+    }
+}
+
+FRAME_SHEDDING_LEVEL FrameShedder::update(std::chrono::milliseconds view_duration, uint32_t storage_percent) {
+    uint32_t pressure = storage_percent;
+    if (0 != buffer_duration_.count()) {
+        pressure = std::max(pressure, (uint32_t) (view_duration.count() * 100 / buffer_duration_.count()));
+    }
+
+    uint32_t level = level_.load(std::memory_order_relaxed);
+    uint32_t new_level = level;
+
+    // Escalate straight to the level of the pressure but step back one level at a time
+    while (new_level + 1 < FRAME_SHEDDING_LEVEL_COUNT && pressure >= getThreshold(new_level + 1)) {
+        new_level++;
+    }
+
+    if (new_level == level && level > FRAME_SHEDDING_LEVEL_NONE && pressure + FRAME_SHEDDING_HYSTERESIS_PERCENT < getThreshold(level)) {
+        new_level--;
+    }
+
+    if (new_level != level) {
+        LOG_INFO("Frame shedding level changed from " << level << " to " << new_level << " at the pressure of " << pressure << "%");
+        level_.store(new_level, std::memory_order_relaxed);
+    }
+
+    return (FRAME_SHEDDING_LEVEL) new_level;
+}
+
+bool FrameShedder::shouldShed(const Frame& frame) {
+    // The end of fragment marker carries no media
+    if (CHECK_FRAME_FLAG_END_OF_FRAGMENT(frame.flags)) {
+        return false;
+    }
+
+    uint32_t level = level_.load(std::memory_order_relaxed);
+    bool primary = frame.trackId == primary_track_id_;
+    uint32_t shed_level = FRAME_SHEDDING_LEVEL_NONE;
+
+    if (primary && CHECK_FRAME_FLAG_KEY_FRAME(frame.flags)) {
+        awaiting_key_frame_.store(false, std::memory_order_relaxed);
+    } else if (primary && (level >= FRAME_SHEDDING_LEVEL_KEY_FRAME_ONLY || awaiting_key_frame_.load(std::memory_order_relaxed))) {
+        // The following frames reference the shed ones until the next key frame
+        awaiting_key_frame_.store(true, std::memory_order_relaxed);
+        shed_level = FRAME_SHEDDING_LEVEL_KEY_FRAME_ONLY;
+    } else if (!primary && level >= FRAME_SHEDDING_LEVEL_SECONDARY_TRACKS) {
+        shed_level = FRAME_SHEDDING_LEVEL_SECONDARY_TRACKS;
+    } else if (level >= FRAME_SHEDDING_LEVEL_NON_REFERENCE && CHECK_FRAME_FLAG_DISCARDABLE_FRAME(frame.flags)) {
+        shed_level = FRAME_SHEDDING_LEVEL_NON_REFERENCE;
+    }
+
+    if (FRAME_SHEDDING_LEVEL_NONE == shed_level) {
+        return false;
+    }
+
+    shed_frames_[shed_level].fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+uint64_t FrameShedder::getShedFrames(FRAME_SHEDDING_LEVEL level) const {
+    if (level >= FRAME_SHEDDING_LEVEL_COUNT) {
+        return 0;
+    }
+
+    return shed_frames_[level].load(std::memory_order_relaxed);
+}
+
+} // namespace video
+} // namespace kinesis
+} // namespace amazonaws
+} // namespace com
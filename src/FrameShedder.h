@@ -0,0 +1,114 @@
+/** Copyright 2017 Amazon.com. All rights reserved. */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+
+#include "com/amazonaws/kinesis/video/client/Include.h"
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+/**
+ * Pressure in percent of the buffer duration or the content store at which the shedding levels are entered
+ */
+#define FRAME_SHEDDING_NON_REFERENCE_THRESHOLD_PERCENT 50
+#define FRAME_SHEDDING_SECONDARY_TRACKS_THRESHOLD_PERCENT 65
+#define FRAME_SHEDDING_KEY_FRAME_ONLY_THRESHOLD_PERCENT 80
+
+/**
+ * The pressure needs to fall this far under the threshold of the level for the shedding to step back
+ */
+#define FRAME_SHEDDING_HYSTERESIS_PERCENT 20
+
+/**
+ * Graded frame shedding levels. Each level sheds the frames of the lower levels too.
+ */
+typedef enum {
+    /**
+     * All of the frames are submitted
+     */
+    FRAME_SHEDDING_LEVEL_NONE = 0,
+
+    /**
+     * The non-reference frames flagged as discardable are shed
+     */
+    FRAME_SHEDDING_LEVEL_NON_REFERENCE,
+
+    /**
+     * The frames of the tracks other than the primary video track are shed
+     */
+    FRAME_SHEDDING_LEVEL_SECONDARY_TRACKS,
+
+    /**
+     * Only the key frames of the primary track are submitted
+     */
+    FRAME_SHEDDING_LEVEL_KEY_FRAME_ONLY,
+
+    FRAME_SHEDDING_LEVEL_COUNT
+} FRAME_SHEDDING_LEVEL;
+
+/**
+ * Priority-aware frame shedding in front of the content store.
+ *
+ * Unlike the content store pressure policies which drop whole fragments of the buffered history, the shedder
+ * drops the least important of the new frames so that the stream keeps up with the uplink at a lower quality.
+ * The level is raised by the producer metrics sampler as the buffer duration or the content store fills up
+ * and lowered step by step once the pressure clears. Leaving the key frame only mode waits for the next key
+ * frame as the skipped frames were referenced.
+ *
+ * The shedding decisions are lock-free.
+ */
+class FrameShedder {
+public:
+    /**
+     * @param primary_track_id The track which is never shed below the key frame only level. Usually the video.
+     * @param buffer_duration The stream buffer duration the view duration pressure is relative to.
+     */
+    FrameShedder(uint64_t primary_track_id, std::chrono::milliseconds buffer_duration);
+
+    /**
+     * Updates the level by the sampled pressure
+     *
+     * @param view_duration The current view duration of the stream.
+     * @param storage_percent The content store utilization in percent.
+     * @return The new level.
+     */
+    FRAME_SHEDDING_LEVEL update(std::chrono::milliseconds view_duration, uint32_t storage_percent);
+
+    /**
+     * Decides whether the frame is to be shed and accounts for it
+     *
+     * @return true if the frame is not to be submitted.
+     */
+    bool shouldShed(const Frame& frame);
+
+    FRAME_SHEDDING_LEVEL getLevel() const {
+        return (FRAME_SHEDDING_LEVEL) level_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @return The number of the frames shed by the rule of the level.
+     */
+    uint64_t getShedFrames(FRAME_SHEDDING_LEVEL level) const;
+
+private:
+    static uint32_t getThreshold(uint32_t level);
+
+    const uint64_t primary_track_id_;
+    const std::chrono::milliseconds buffer_duration_;
+
+    std::atomic<uint32_t> level_;
+
+    /**
+     * Set once a non-key frame of the primary track is shed in the key frame only mode
+     */
+    std::atomic<bool> awaiting_key_frame_;
+
+    std::atomic<uint64_t> shed_frames_[FRAME_SHEDDING_LEVEL_COUNT];
+};
+
+} // namespace video
+} // namespace kinesis
+} // namespace amazonaws
+} // namespace com
@@ -1,5 +1,8 @@
 #include "KinesisVideoProducer.h"
 #include "Logger.h"
+#include "FlightRecorder.h"
+
+#include <algorithm>
 
 namespace com { namespace amazonaws { namespace kinesis { namespace video {
 
@@ -9,6 +12,29 @@ using std::shared_ptr;
 using std::stringstream;
 using std::unique_ptr;
 
+namespace {
+
+uint64_t getSpilledSize(const KinesisVideoProducerMetrics& client_metrics, uint64_t memory_size) {
+    uint64_t allocated_size = client_metrics.getContentStoreAllocatedSize();
+    return allocated_size > memory_size ? allocated_size - memory_size : 0;
+}
+
+shared_ptr<FrameShedder> createFrameShedder(const StreamInfo& stream_info) {
+    // The video is the primary track with the others shed first
+    uint64_t primary_track_id = 0 != stream_info.streamCaps.trackInfoCount ? stream_info.streamCaps.trackInfoList[0].trackId : 0;
+    for (UINT32 i = 0; i < stream_info.streamCaps.trackInfoCount; i++) {
+        if (MKV_TRACK_INFO_TYPE_VIDEO == stream_info.streamCaps.trackInfoList[i].trackType) {
+            primary_track_id = stream_info.streamCaps.trackInfoList[i].trackId;
+            break;
+        }
+    }
+
+    return std::make_shared<FrameShedder>(primary_track_id,
+                                          std::chrono::milliseconds(stream_info.streamCaps.bufferDuration / HUNDREDS_OF_NANOS_IN_A_MILLISECOND));
+}
+
+} // namespace
+
 unique_ptr<KinesisVideoProducer> KinesisVideoProducer::create(
         unique_ptr<DeviceInfoProvider> device_info_provider,
         unique_ptr<ClientCallbackProvider> client_callback_provider,
@@ -52,7 +78,9 @@ unique_ptr<KinesisVideoProducer> KinesisVideoProducer::create(
     }
 
     kinesis_video_producer->client_handle_ = client_handle;
-    kinesis_video_producer->callback_provider_ = move(callback_provider);
+    kinesis_video_producer->setCallbackProvider(move(callback_provider));
+    kinesis_video_producer->setStorageInfo(device_info, callbacks);
+    kinesis_video_producer->startMetricsSampler();
 
     return kinesis_video_producer;
 }
@@ -102,20 +130,37 @@ unique_ptr<KinesisVideoProducer> KinesisVideoProducer::createSync(
     }
 
     kinesis_video_producer->client_handle_ = client_handle;
-    kinesis_video_producer->callback_provider_ = move(callback_provider);
+    kinesis_video_producer->setCallbackProvider(move(callback_provider));
+    kinesis_video_producer->setStorageInfo(device_info, callbacks);
+    kinesis_video_producer->startMetricsSampler();
 
     return kinesis_video_producer;
 }
 
 shared_ptr<KinesisVideoStream> KinesisVideoProducer::createStream(unique_ptr<StreamDefinition> stream_definition) {
+    return createStreamInternal(move(stream_definition), false);
+}
+
+shared_ptr<KinesisVideoStream> KinesisVideoProducer::createStreamSync(unique_ptr<StreamDefinition> stream_definition) {
+    return createStreamInternal(move(stream_definition), true);
+}
+
+shared_ptr<KinesisVideoStream> KinesisVideoProducer::createStreamInternal(unique_ptr<StreamDefinition> stream_definition, bool synchronous) {
     assert(stream_definition.get());
 
     if (stream_definition->getTrackCount() > MAX_SUPPORTED_TRACK_COUNT_PER_STREAM) {
         LOG_AND_THROW("Exceeded maximum track count: " + std::to_string(MAX_SUPPORTED_TRACK_COUNT_PER_STREAM));
     }
     StreamInfo stream_info = stream_definition->getStreamInfo();
-    std::shared_ptr<KinesisVideoStream> kinesis_video_stream(new KinesisVideoStream(*this, stream_definition->getStreamName()), KinesisVideoStream::videoStreamDeleter);
-    STATUS status = createKinesisVideoStream(client_handle_, &stream_info, kinesis_video_stream->getStreamHandle());
+    std::shared_ptr<KinesisVideoStream> kinesis_video_stream(new KinesisVideoStream(*this, stream_definition->getStreamName(), stream_definition->getAsyncIngestQueueCapacity()), KinesisVideoStream::videoStreamDeleter);
+    kinesis_video_stream->latency_tracker_ = std::make_shared<StreamLatencyTracker>(stream_info.streamCaps.timecodeScale);
+    kinesis_video_stream->bitrate_advisor_ = std::make_shared<BitrateAdvisor>(stream_info.streamCaps.avgBandwidthBps);
+    if (stream_definition->isFrameSheddingEnabled()) {
+        kinesis_video_stream->frame_shedder_ = createFrameShedder(stream_info);
+    }
+    STATUS status = synchronous ? createKinesisVideoStreamSync(client_handle_, &stream_info, kinesis_video_stream->getStreamHandle())
+                                : createKinesisVideoStream(client_handle_, &stream_info, kinesis_video_stream->getStreamHandle());
+    FlightRecorder::getInstance().record(FLIGHT_RECORDER_EVENT_STREAM_CREATE, *kinesis_video_stream->getStreamHandle(), status);
 
     if (STATUS_FAILED(status)) {
         stringstream status_strstrm;
@@ -124,34 +169,86 @@ shared_ptr<KinesisVideoStream> KinesisVideoProducer::createStream(unique_ptr<Str
                   " Error status: 0x" + status_strstrm.str());
     }
 
+    // Opened once the stream exists so that a failed create doesn't leave a log behind to be replayed.
+    // The stream is freed with the object if the log can't be opened.
+    if (!stream_definition->getFrameLogDirectory().empty()) {
+        kinesis_video_stream->frame_log_ = std::make_shared<FrameLog>(stream_definition->getFrameLogDirectory(),
+                                                                      stream_definition->getStreamName(),
+                                                                      stream_info.streamCaps.timecodeScale,
+                                                                      stream_definition->getFrameLogSegmentSize());
+    }
+
     // Add to the map
     active_streams_.put(*kinesis_video_stream->getStreamHandle(), kinesis_video_stream);
+    if (nullptr != default_callback_provider_) {
+        default_callback_provider_->registerStreamLatencyTracker(*kinesis_video_stream->getStreamHandle(), kinesis_video_stream->getLatencyTracker());
+        default_callback_provider_->registerStreamBitrateAdvisor(*kinesis_video_stream->getStreamHandle(), kinesis_video_stream->getBitrateAdvisor());
+        if (nullptr != kinesis_video_stream->getFrameLog()) {
+            default_callback_provider_->registerStreamFrameLog(*kinesis_video_stream->getStreamHandle(), kinesis_video_stream->getFrameLog());
+        }
+    }
 
     return kinesis_video_stream;
 }
 
-shared_ptr<KinesisVideoStream> KinesisVideoProducer::createStreamSync(unique_ptr<StreamDefinition> stream_definition) {
+std::vector<std::future<shared_ptr<KinesisVideoStream>>> KinesisVideoProducer::createStreams(
+        std::vector<unique_ptr<StreamDefinition>> stream_definitions, uint32_t max_in_flight) {
+    struct CreateStreamsContext {
+        std::vector<unique_ptr<StreamDefinition>> stream_definitions;
+        std::vector<std::promise<shared_ptr<KinesisVideoStream>>> promises;
+        std::atomic<size_t> next_index;
+    };
+
+    auto context = std::make_shared<CreateStreamsContext>();
+    context->stream_definitions = move(stream_definitions);
+    context->promises.resize(context->stream_definitions.size());
+    context->next_index = 0;
+
+    std::vector<std::future<shared_ptr<KinesisVideoStream>>> kinesis_video_streams;
+    for (auto& promise : context->promises) {
+        kinesis_video_streams.push_back(promise.get_future());
+    }
 
-    assert(stream_definition.get());
+    size_t worker_count = std::min((size_t) MAX(max_in_flight, 1), context->stream_definitions.size());
+    LOG_INFO("Creating " << context->stream_definitions.size() << " streams with " << worker_count << " in flight");
 
-    if (stream_definition->getTrackCount() > MAX_SUPPORTED_TRACK_COUNT_PER_STREAM) {
-        LOG_AND_THROW("Exceeded maximum track count: " + std::to_string(MAX_SUPPORTED_TRACK_COUNT_PER_STREAM));
+    std::lock_guard<std::mutex> lock(create_streams_mutex_);
+
+    // Join the workers of the earlier calls which have finished
+    for (auto it = create_streams_workers_.begin(); it != create_streams_workers_.end();) {
+        if (*it->finished) {
+            it->thread.join();
+            it = create_streams_workers_.erase(it);
+        } else {
+            ++it;
+        }
     }
-    StreamInfo stream_info = stream_definition->getStreamInfo();
-    std::shared_ptr<KinesisVideoStream> kinesis_video_stream(new KinesisVideoStream(*this, stream_definition->getStreamName()), KinesisVideoStream::videoStreamDeleter);
-    STATUS status = createKinesisVideoStreamSync(client_handle_, &stream_info, kinesis_video_stream->getStreamHandle());
 
-    if (STATUS_FAILED(status)) {
-        stringstream status_strstrm;
-        status_strstrm << std::hex << status;
-        LOG_AND_THROW(" Unable to create Kinesis Video stream. " + stream_definition->getStreamName() +
-                  " Error status: 0x" + status_strstrm.str());
+    for (size_t i = 0; i < worker_count; i++) {
+        auto finished = std::make_shared<std::atomic<bool>>(false);
+        create_streams_workers_.push_back(CreateStreamsWorker{SdkThread::start("createstream", [this, context, finished]() {
+            for (size_t index = context->next_index++; index < context->stream_definitions.size(); index = context->next_index++) {
+                try {
+                    context->promises[index].set_value(createStreamInternal(move(context->stream_definitions[index]), true));
+                } catch (...) {
+                    context->promises[index].set_exception(std::current_exception());
+                }
+            }
+
+            *finished = true;
+        }), finished});
     }
 
-    // Add to the map
-    active_streams_.put(*kinesis_video_stream->getStreamHandle(), kinesis_video_stream);
+    return kinesis_video_streams;
+}
 
-    return kinesis_video_stream;
+void KinesisVideoProducer::awaitCreateStreamsWorkers() {
+    std::lock_guard<std::mutex> lock(create_streams_mutex_);
+    for (auto& worker : create_streams_workers_) {
+        worker.thread.join();
+    }
+
+    create_streams_workers_.clear();
 }
 
 void KinesisVideoProducer::freeStream(std::shared_ptr<KinesisVideoStream> kinesis_video_stream) {
@@ -175,16 +272,21 @@ void KinesisVideoProducer::freeStream(std::shared_ptr<KinesisVideoStream> kinesi
 void KinesisVideoProducer::freeStreams() {
     {
         std::lock_guard<std::mutex> lock(free_client_mutex_);
-        auto num_streams = active_streams_.getMap().size();
 
-        for (auto i = 0; i < num_streams; i++) {
-            auto stream = active_streams_.getAt(0);
+        // Iterate over a snapshot as freeStream removes the streams from the map
+        for (auto& stream : active_streams_.snapshot()) {
             freeStream(stream);
         }
     }
 }
 
 KinesisVideoProducer::~KinesisVideoProducer() {
+    // The streams still being created would otherwise outlive the client
+    awaitCreateStreamsWorkers();
+
+    // The sampler reaches into the streams and the client
+    stopMetricsSampler();
+
     // Free the streams
     freeStreams();
 
@@ -193,10 +295,185 @@ KinesisVideoProducer::~KinesisVideoProducer() {
 }
 
 KinesisVideoProducerMetrics KinesisVideoProducer::getMetrics() const {
-    STATUS status = ::getKinesisVideoMetrics(client_handle_, (PClientMetrics) client_metrics_.getRawMetrics());
+    KinesisVideoProducerMetrics client_metrics;
+    STATUS status = ::getKinesisVideoMetrics(client_handle_, (PClientMetrics) client_metrics.getRawMetrics());
     LOG_AND_THROW_IF(STATUS_FAILED(status), "Failed to get producer metrics with: " << status);
+    client_metrics.content_store_spilled_size_ = getSpilledSize(client_metrics, content_store_memory_size_);
+
+    return client_metrics;
+}
+
+KinesisVideoProducerMetrics KinesisVideoProducer::getMetricsSnapshot() const noexcept {
+    std::shared_ptr<const KinesisVideoProducerMetrics> metrics_snapshot = std::atomic_load(&metrics_snapshot_);
+    if (nullptr == metrics_snapshot) {
+        return KinesisVideoProducerMetrics();
+    }
+
+    return *metrics_snapshot;
+}
+
+void KinesisVideoProducer::setMetricsSamplingPeriod(std::chrono::milliseconds period) {
+    stopMetricsSampler();
+    metrics_sampling_period_ = period;
+    startMetricsSampler();
+}
+
+void KinesisVideoProducer::setCallbackProvider(unique_ptr<CallbackProvider> callback_provider) {
+    callback_provider_ = move(callback_provider);
+
+    // The per-stream helpers are fed by the callbacks of the default provider only
+    default_callback_provider_ = dynamic_cast<DefaultCallbackProvider*>(callback_provider_.get());
+}
+
+void KinesisVideoProducer::setStorageInfo(const DeviceInfo& device_info, const ClientCallbacks& callbacks) {
+    content_store_memory_size_ = device_info.storageInfo.storageSize;
+    if (DEVICE_STORAGE_TYPE_HYBRID_FILE == device_info.storageInfo.storageType) {
+        content_store_memory_size_ = device_info.storageInfo.storageSize * device_info.storageInfo.spillRatio / 100;
+    }
+
+    storage_overflow_pressure_fn_ = callbacks.storageOverflowPressureFn;
+    callbacks_custom_data_ = callbacks.customData;
+}
+
+void KinesisVideoProducer::setStorageTimeToFullWarning(std::chrono::seconds threshold) {
+    storage_time_to_full_warning_seconds_ = (uint64_t) threshold.count();
+}
+
+void KinesisVideoProducer::sampleStorageMetrics(KinesisVideoProducerMetrics& client_metrics) {
+    auto now = std::chrono::steady_clock::now();
+    uint64_t allocated_size = client_metrics.getContentStoreAllocatedSize();
+    client_metrics.content_store_spilled_size_ = getSpilledSize(client_metrics, content_store_memory_size_);
+
+    bool first_sample = last_storage_sample_time_ == std::chrono::steady_clock::time_point();
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_storage_sample_time_).count();
+    if (!first_sample && elapsed > 0) {
+        // The spill rate only accounts for the growth of the spilled content as the draining is the upload
+        if (client_metrics.content_store_spilled_size_ > last_spilled_size_) {
+            client_metrics.content_store_spill_rate_ = (client_metrics.content_store_spilled_size_ - last_spilled_size_) * 1000 / elapsed;
+        }
+
+        // The allocated size grows by the put frames and shrinks by the persisted fragments so its rate of
+        // change is the fill rate net of the drain rate. Smoothed over the bursts of the key frames.
+        double fill_rate = ((double) allocated_size - (double) last_allocated_size_) * 1000 / elapsed;
+        content_store_fill_rate_ += (fill_rate - content_store_fill_rate_) * STORAGE_FILL_RATE_SMOOTHING_PERCENT / 100;
+        client_metrics.content_store_fill_rate_ = (int64_t) content_store_fill_rate_;
+        if (content_store_fill_rate_ >= 1) {
+            client_metrics.content_store_time_to_full_ = std::chrono::seconds(
+                    (int64_t) (client_metrics.getContentStoreAvailableSize() / content_store_fill_rate_));
+        }
+    }
+
+    last_spilled_size_ = client_metrics.content_store_spilled_size_;
+    last_allocated_size_ = allocated_size;
+    last_storage_sample_time_ = now;
+
+    // Warn ahead of the Kinesis Video PIC which reports the pressure only once the storage is nearly full
+    uint64_t warning_seconds = storage_time_to_full_warning_seconds_;
+    bool filling_up = 0 != warning_seconds && client_metrics.content_store_time_to_full_ < std::chrono::seconds(warning_seconds);
+    if (filling_up && !storage_pressure_reported_) {
+        LOG_WARN("Content store is estimated to be full in " << client_metrics.content_store_time_to_full_.count()
+                 << " seconds at the fill rate of " << client_metrics.content_store_fill_rate_ << " bytes per second");
+        if (nullptr != storage_overflow_pressure_fn_) {
+            storage_overflow_pressure_fn_(callbacks_custom_data_, client_metrics.getContentStoreAvailableSize());
+        }
+    }
+
+    storage_pressure_reported_ = filling_up;
+}
+
+void KinesisVideoProducer::startMetricsSampler() {
+    if (metrics_sampling_period_.count() == 0 || metrics_sampler_thread_.joinable()) {
+        return;
+    }
+
+    metrics_sampler_exit_ = false;
+    metrics_sampler_thread_ = SdkThread::start("metrics", [this]() { metricsSamplerRoutine(); });
+}
+
+void KinesisVideoProducer::stopMetricsSampler() {
+    if (!metrics_sampler_thread_.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(metrics_sampler_mutex_);
+        metrics_sampler_exit_ = true;
+        metrics_sampler_cv_.notify_all();
+    }
+
+    metrics_sampler_thread_.join();
+}
+
+void KinesisVideoProducer::metricsSamplerRoutine() {
+    std::unique_lock<std::mutex> lock(metrics_sampler_mutex_);
+    while (!metrics_sampler_exit_) {
+        lock.unlock();
+        sampleMetrics();
+        lock.lock();
 
-    return client_metrics_;
+        metrics_sampler_cv_.wait_for(lock, metrics_sampling_period_, [this]() { return metrics_sampler_exit_; });
+    }
+}
+
+void KinesisVideoProducer::sampleMetrics() {
+    std::shared_ptr<KinesisVideoProducerMetrics> client_metrics = std::make_shared<KinesisVideoProducerMetrics>();
+    STATUS status = ::getKinesisVideoMetrics(client_handle_, (PClientMetrics) client_metrics->getRawMetrics());
+    if (STATUS_FAILED(status)) {
+        LOG_WARN("Failed to sample producer metrics with: " << status);
+        return;
+    }
+
+    sampleStorageMetrics(*client_metrics);
+    std::atomic_store(&metrics_snapshot_, std::shared_ptr<const KinesisVideoProducerMetrics>(client_metrics));
+
+    auto total_transfer_rate = 8 * client_metrics->getTotalTransferRate();
+    LOG_DEBUG("Kinesis Video client metrics"
+                      << "\n\t>> Overall storage byte size: " << client_metrics->getContentStoreSizeSize()
+                      << "\n\t>> Available storage byte size: " << client_metrics->getContentStoreAvailableSize()
+                      << "\n\t>> Allocated storage byte size: " << client_metrics->getContentStoreAllocatedSize()
+                      << "\n\t>> Total view allocation byte size: " << client_metrics->getTotalContentViewsSize()
+                      << "\n\t>> Spilled storage byte size: " << client_metrics->getContentStoreSpilledSize()
+                      << "\n\t>> Storage spill rate (Bps): " << client_metrics->getContentStoreSpillRate()
+                      << "\n\t>> Storage fill rate (Bps): " << client_metrics->getContentStoreFillRate()
+                      << "\n\t>> Total streams elementary frame rate (fps): " << client_metrics->getTotalElementaryFrameRate()
+                      << "\n\t>> Total streams transfer rate (bps): " << total_transfer_rate << " (" << total_transfer_rate / 1024 << " Kbps)");
+
+    uint64_t storage_size = client_metrics->getContentStoreSizeSize();
+    uint32_t storage_percent = 0 == storage_size ? 0 : (uint32_t) (client_metrics->getContentStoreAllocatedSize() * 100 / storage_size);
+    for (auto& stream : active_streams_.snapshot()) {
+        std::shared_ptr<const KinesisVideoStreamMetrics> stream_metrics = stream->sampleMetrics();
+        if (nullptr == stream_metrics) {
+            continue;
+        }
+
+        auto transfer_rate = 8 * stream_metrics->getCurrentTransferRate();
+        LOG_DEBUG("Kinesis Video stream " << stream->getStreamName() << " metrics"
+                          << "\n\t>> Current view duration (ms): " << stream_metrics->getCurrentViewDuration().count()
+                          << "\n\t>> Overall view duration (ms): " << stream_metrics->getOverallViewDuration().count()
+                          << "\n\t>> Current view byte size: " << stream_metrics->getCurrentViewSize()
+                          << "\n\t>> Overall view byte size: " << stream_metrics->getOverallViewSize()
+                          << "\n\t>> Current elementary frame rate (fps): " << stream_metrics->getCurrentElementaryFrameRate()
+                          << "\n\t>> Current transfer rate (bps): " << transfer_rate << " (" << transfer_rate / 1024 << " Kbps)"
+                          << "\n\t>> putFrame latency p50/p99 (us): " << stream_metrics->getPutFrameLatency().p50.count()
+                          << "/" << stream_metrics->getPutFrameLatency().p99.count()
+                          << "\n\t>> Persisted ack latency p50/p99 (us): " << stream_metrics->getPersistedAckLatency().p50.count()
+                          << "/" << stream_metrics->getPersistedAckLatency().p99.count());
+
+        uint64_t recommended_bitrate = 0;
+        if (stream->getBitrateAdvisor()->update(transfer_rate,
+                                                stream_metrics->getCurrentViewDuration(),
+                                                storage_percent,
+                                                recommended_bitrate)) {
+            LOG_INFO("Recommended bitrate for stream " << stream->getStreamName() << ": " << recommended_bitrate << " bps");
+            if (nullptr != default_callback_provider_) {
+                default_callback_provider_->reportBitrateRecommendation(*stream->getStreamHandle(), recommended_bitrate);
+            }
+        }
+
+        if (nullptr != stream->getFrameShedder()) {
+            stream->getFrameShedder()->update(stream_metrics->getCurrentViewDuration(), storage_percent);
+        }
+    }
 }
 
 } // namespace video
@@ -12,12 +12,19 @@
 #include "StreamDefinition.h"
 #include "Auth.h"
 #include "KinesisVideoProducerMetrics.h"
+#include "ConcurrentMap.h"
+#include "SdkThread.h"
 
 #include <cstring>
 
 #include <memory>
 #include <mutex>
 #include <iostream>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <vector>
 
 #include "com/amazonaws/kinesis/video/cproducer/Include.h"
 
@@ -41,6 +48,27 @@ namespace com { namespace amazonaws { namespace kinesis { namespace video {
  */
 #define CLIENT_STREAM_CLOSED_CALLBACK_AWAIT_TIME_MILLIS (10 + TIMEOUT_AFTER_STREAM_STOPPED + TIMEOUT_WAIT_FOR_CURL_BUFFER)
 
+/**
+ * Default period of the background producer and stream metrics sampling.
+ **/
+#define DEFAULT_METRICS_SAMPLING_PERIOD_MILLIS 1000
+
+/**
+ * Default time to full of the content store below which the storage overflow pressure is reported early.
+ * The early reporting is opt-in as it invokes the client storage overflow callback ahead of the PIC.
+ **/
+#define DEFAULT_STORAGE_TIME_TO_FULL_WARNING_SECONDS 0
+
+/**
+ * Weight of the latest sample in the smoothed content store fill rate in percent
+ **/
+#define STORAGE_FILL_RATE_SMOOTHING_PERCENT 30
+
+/**
+ * Default maximum number of the streams being created at a time by createStreams.
+ **/
+#define DEFAULT_CREATE_STREAMS_MAX_IN_FLIGHT 8
+
 /**
 * Kinesis Video client interface for real time streaming. The structure of this class is that each instance of type <T,U>
 * is a singleton where T is the implementation of the DeviceInfoProvider interface and U is the implementation of the
@@ -108,6 +136,20 @@ public:
      */
     std::shared_ptr<KinesisVideoStream> createStreamSync(std::unique_ptr<StreamDefinition> stream_definition);
 
+    /**
+     * Creates the streams concurrently. Each of the streams is created as with createStreamSync
+     * but up to max_in_flight streams are created at a time so the control plane calls of the
+     * streams overlap rather than run back to back.
+     *
+     * @param stream_definitions The definitions of the streams to be created.
+     * @param max_in_flight Maximum number of the streams being created at a time.
+     * @return The futures of the streams in the order of the definitions. The future of a stream
+     *         which failed to be created rethrows the creation error.
+     */
+    std::vector<std::future<std::shared_ptr<KinesisVideoStream>>> createStreams(
+            std::vector<std::unique_ptr<StreamDefinition>> stream_definitions,
+            uint32_t max_in_flight = DEFAULT_CREATE_STREAMS_MAX_IN_FLIGHT);
+
     /**
      * Frees the stream and removes it from the producer stream list.
      *
@@ -123,6 +165,13 @@ public:
      */
     void freeStreams();
 
+    /**
+     * @return A snapshot of the active streams
+     */
+    std::vector<std::shared_ptr<KinesisVideoStream>> getActiveStreams() const {
+        return active_streams_.snapshot();
+    }
+
     /**
      * Gets the client metrics.
      *
@@ -130,6 +179,41 @@ public:
      */
     KinesisVideoProducerMetrics getMetrics() const;
 
+    /**
+     * Gets the latest client metrics published by the background metrics sampler.
+     *
+     * NOTE: The call does not reach into the Kinesis Video PIC and never blocks. The metrics are
+     * as old as the sampling period and are empty before the first sample.
+     *
+     * @return producer metrics snapshot.
+     */
+    KinesisVideoProducerMetrics getMetricsSnapshot() const noexcept;
+
+    /**
+     * Sets the period of the background metrics sampler which publishes the producer and stream metrics snapshots.
+     *
+     * @param period Sampling period. Zero stops the sampling.
+     */
+    void setMetricsSamplingPeriod(std::chrono::milliseconds period);
+
+    /**
+     * Sets the time to full of the content store below which the metrics sampler reports the storage overflow
+     * pressure through the client callback ahead of the Kinesis Video PIC. The pressure is reported once
+     * per crossing of the threshold. The early reporting is disabled by default.
+     *
+     * @param threshold The time to full threshold. Zero disables the early reporting.
+     */
+    void setStorageTimeToFullWarning(std::chrono::seconds threshold);
+
+    /**
+     * Gets the CPU time of the SDK threads of the process.
+     *
+     * @return The CPU time of the running threads and the totals of the exited threads by name.
+     */
+    std::vector<ThreadCpuTime> getThreadCpuTimes() const {
+        return SdkThread::getCpuTimes();
+    }
+
     /**
      * Returns the raw client handle
      */
@@ -153,9 +237,69 @@ protected:
     /**
      * Initializes an empty class. The real initialization happens through the static functions.
      */
-    KinesisVideoProducer() : client_handle_(INVALID_CLIENT_HANDLE_VALUE) {
+    KinesisVideoProducer() : client_handle_(INVALID_CLIENT_HANDLE_VALUE),
+                             default_callback_provider_(nullptr),
+                             metrics_sampling_period_(DEFAULT_METRICS_SAMPLING_PERIOD_MILLIS),
+                             metrics_sampler_exit_(false),
+                             content_store_memory_size_(0),
+                             storage_overflow_pressure_fn_(nullptr),
+                             callbacks_custom_data_(0),
+                             storage_time_to_full_warning_seconds_(DEFAULT_STORAGE_TIME_TO_FULL_WARNING_SECONDS),
+                             last_spilled_size_(0),
+                             last_allocated_size_(0),
+                             content_store_fill_rate_(0),
+                             storage_pressure_reported_(false) {
     }
 
+    /**
+     * Takes over the callback provider of the client
+     */
+    void setCallbackProvider(std::unique_ptr<CallbackProvider> callback_provider);
+
+    /**
+     * Records the content store layout and the storage overflow callback the storage metrics are derived from
+     */
+    void setStorageInfo(const DeviceInfo& device_info, const ClientCallbacks& callbacks);
+
+    /**
+     * Derives the spill and the fill metrics of the content store from the sampled client metrics and
+     * reports the storage overflow pressure early. Called by the metrics sampler.
+     */
+    void sampleStorageMetrics(KinesisVideoProducerMetrics& client_metrics);
+
+    /**
+     * Starts the background metrics sampler unless the sampling period is zero
+     */
+    void startMetricsSampler();
+
+    /**
+     * Stops and joins the background metrics sampler
+     */
+    void stopMetricsSampler();
+
+    /**
+     * Background metrics sampler routine
+     */
+    void metricsSamplerRoutine();
+
+    /**
+     * Samples the client and the active stream metrics and publishes the snapshots
+     */
+    void sampleMetrics();
+
+    /**
+     * Awaits for the streams being created by createStreams
+     */
+    void awaitCreateStreamsWorkers();
+
+    /**
+     * Creates the stream with its per-stream helpers and registers it with the client and the callback provider.
+     * Shared by createStream, createStreamSync and createStreams.
+     *
+     * @param synchronous Whether to await for the stream to be ready.
+     */
+    std::shared_ptr<KinesisVideoStream> createStreamInternal(std::unique_ptr<StreamDefinition> stream_definition, bool synchronous);
+
     /**
      * pointer to the initialized client, stored as a integer value.
      */
@@ -179,14 +323,65 @@ protected:
     std::unique_ptr<CallbackProvider> callback_provider_;
 
     /**
-     * Client metrics
+     * The callback provider as the default one which the per-stream helpers are registered with.
+     * Null with a custom callback provider.
+     */
+    DefaultCallbackProvider* default_callback_provider_;
+
+    /**
+     * Latest client metrics snapshot. Accessed via the atomic shared pointer operations.
+     */
+    std::shared_ptr<const KinesisVideoProducerMetrics> metrics_snapshot_;
+
+    /**
+     * Background metrics sampler
+     */
+    std::thread metrics_sampler_thread_;
+    std::mutex metrics_sampler_mutex_;
+    std::condition_variable metrics_sampler_cv_;
+    std::chrono::milliseconds metrics_sampling_period_;
+    bool metrics_sampler_exit_;
+
+    /**
+     * Size in bytes of the content store kept in memory. Allocations beyond it spill to the files
+     * of the hybrid file storage.
+     */
+    uint64_t content_store_memory_size_;
+
+    /**
+     * The client storage overflow pressure callback reported to early
+     */
+    StorageOverflowPressureFunc storage_overflow_pressure_fn_;
+    UINT64 callbacks_custom_data_;
+    std::atomic<uint64_t> storage_time_to_full_warning_seconds_;
+
+    /**
+     * Content store sizes at the previous sample for the rates. Accessed by the metrics sampler only.
+     */
+    uint64_t last_spilled_size_;
+    uint64_t last_allocated_size_;
+    std::chrono::steady_clock::time_point last_storage_sample_time_;
+    double content_store_fill_rate_;
+    bool storage_pressure_reported_;
+
+    /**
+     * Worker thread of a createStreams call with the flag it sets once it has no more streams to create
+     */
+    struct CreateStreamsWorker {
+        std::thread thread;
+        std::shared_ptr<std::atomic<bool>> finished;
+    };
+
+    /**
+     * Worker threads of the createStreams calls
      */
-    KinesisVideoProducerMetrics client_metrics_;
+    std::mutex create_streams_mutex_;
+    std::vector<CreateStreamsWorker> create_streams_workers_;
 
     /**
      * Map of the handle to stream object
      */
-    ThreadSafeMap<STREAM_HANDLE, std::shared_ptr<KinesisVideoStream>> active_streams_;
+    ConcurrentMap<STREAM_HANDLE, std::shared_ptr<KinesisVideoStream>> active_streams_;
 };
 
 } // namespace video
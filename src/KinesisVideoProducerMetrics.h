@@ -2,10 +2,15 @@
 
 #pragma once
 
+#include <algorithm>
+#include <chrono>
+
 #include "com/amazonaws/kinesis/video/client/Include.h"
 
 namespace com { namespace amazonaws { namespace kinesis { namespace video {
 
+class KinesisVideoProducer;
+
 /**
 * Wraps around the client metrics class
 */
@@ -16,7 +21,10 @@ public:
     /**
      * Default constructor
      */
-    KinesisVideoProducerMetrics() {
+    KinesisVideoProducerMetrics() : content_store_spilled_size_(0),
+                                    content_store_spill_rate_(0),
+                                    content_store_fill_rate_(0),
+                                    content_store_time_to_full_(std::chrono::seconds::max()) {
         memset(&client_metrics_, 0x00, sizeof(::ClientMetrics));
         client_metrics_.version = CLIENT_METRICS_CURRENT_VERSION;
     }
@@ -70,15 +78,78 @@ public:
         return client_metrics_.totalTransferRate;
     }
 
+    /**
+     * Returns the size in bytes of the content spilled from the memory to the files of the hybrid file storage
+     */
+    uint64_t getContentStoreSpilledSize() const {
+        return content_store_spilled_size_;
+    }
+
+    /**
+     * Returns the rate in bytes per second the content spills to the files of the hybrid file storage.
+     * Only sampled by the background metrics sampler.
+     */
+    uint64_t getContentStoreSpillRate() const {
+        return content_store_spill_rate_;
+    }
+
+    /**
+     * Returns the rate in bytes per second the content store fills up at, net of the draining by the
+     * upload. Negative while the content store is draining. Only sampled by the background metrics sampler.
+     */
+    int64_t getContentStoreFillRate() const {
+        return content_store_fill_rate_;
+    }
+
+    /**
+     * Returns the estimated time until the content store is full at the current fill rate.
+     * std::chrono::seconds::max() while the content store is not filling up.
+     * Only sampled by the background metrics sampler.
+     */
+    std::chrono::seconds getContentStoreTimeToFull() const {
+        return content_store_time_to_full_;
+    }
+
+    /**
+     * Adds the metrics of another client, as for the clients of a producer pool
+     */
+    void accumulate(const KinesisVideoProducerMetrics& other) {
+        client_metrics_.contentStoreSize += other.client_metrics_.contentStoreSize;
+        client_metrics_.contentStoreAvailableSize += other.client_metrics_.contentStoreAvailableSize;
+        client_metrics_.contentStoreAllocatedSize += other.client_metrics_.contentStoreAllocatedSize;
+        client_metrics_.totalContentViewsSize += other.client_metrics_.totalContentViewsSize;
+        client_metrics_.totalFrameRate += other.client_metrics_.totalFrameRate;
+        client_metrics_.totalElementaryFrameRate += other.client_metrics_.totalElementaryFrameRate;
+        client_metrics_.totalTransferRate += other.client_metrics_.totalTransferRate;
+        content_store_spilled_size_ += other.content_store_spilled_size_;
+        content_store_spill_rate_ += other.content_store_spill_rate_;
+        content_store_fill_rate_ += other.content_store_fill_rate_;
+        content_store_time_to_full_ = std::min(content_store_time_to_full_, other.content_store_time_to_full_);
+    }
+
     const ::ClientMetrics* getRawMetrics() const {
         return &client_metrics_;
     }
 
 private:
+    friend class KinesisVideoProducer;
+
     /**
      * Underlying metrics object
      */
     ::ClientMetrics client_metrics_;
+
+    /**
+     * Spill metrics of the hybrid file storage derived by the producer
+     */
+    uint64_t content_store_spilled_size_;
+    uint64_t content_store_spill_rate_;
+
+    /**
+     * Fill rate and time to full estimate of the content store derived by the producer
+     */
+    int64_t content_store_fill_rate_;
+    std::chrono::seconds content_store_time_to_full_;
 };
 
 } // namespace video
@@ -1,22 +1,38 @@
 #include "Logger.h"
 #include "KinesisVideoStream.h"
 #include "KinesisVideoStreamMetrics.h"
+#include "FlightRecorder.h"
+
+#include <algorithm>
 
 namespace com { namespace amazonaws { namespace kinesis { namespace video {
 
 LOGGER_TAG("com.amazonaws.kinesis.video");
 
-KinesisVideoStream::KinesisVideoStream(const KinesisVideoProducer& kinesis_video_producer, const std::string stream_name)
+KinesisVideoStream::KinesisVideoStream(const KinesisVideoProducer& kinesis_video_producer, const std::string stream_name, uint32_t ingest_queue_capacity)
         : stream_handle_(INVALID_STREAM_HANDLE_VALUE),
           stream_name_(stream_name),
           kinesis_video_producer_(kinesis_video_producer),
-          debug_dump_frame_info_(false) {
+          debug_dump_frame_info_(false),
+          stream_freed_(false),
+          ingest_idle_(false),
+          ingest_thread_exit_(false),
+          ingest_queue_high_water_mark_(0),
+          ingest_queue_dropped_frames_(0) {
     LOG_INFO("Creating Kinesis Video Stream " << stream_name_);
     // the handle is NULL to start. We will set it later once Kinesis Video PIC gives us a stream handle.
 
     if (getenv(DEBUG_DUMP_FRAME_INFO)) {
         debug_dump_frame_info_ = true;
     }
+
+    if (0 != ingest_queue_capacity) {
+        // The frames are queued only after the stream creation returns so the ingest thread
+        // always observes a valid stream handle.
+        ingest_queue_.reset(new SpscRingBuffer<IngestSlot>(ingest_queue_capacity));
+        ingest_thread_ = SdkThread::start("ingest", [this]() { ingestRoutine(); });
+        LOG_INFO("Asynchronous ingest enabled for stream " << stream_name_ << " with queue capacity " << ingest_queue_->capacity());
+    }
 }
 
 bool KinesisVideoStream::putFrame(KinesisVideoFrame frame) const {
@@ -26,70 +42,256 @@ bool KinesisVideoStream::putFrame(KinesisVideoFrame frame) const {
     }
 
     assert(0 != stream_handle_);
-    STATUS status = putKinesisVideoFrame(stream_handle_, &frame);
+    if (ingest_queue_) {
+        return STATUS_SUCCEEDED(enqueueFrame(frame));
+    }
+
+    auto put_time = std::chrono::steady_clock::now();
+    STATUS status = submitFrame(frame, put_time);
     if (STATUS_FAILED(status)) {
         return false;
     }
 
-    // Print metrics on every key-frame
-    // TODO: this will create too much spam in case of audio
-    if (CHECK_FRAME_FLAG_KEY_FRAME(frame.flags)) {
-        // Extract metrics and print out
-        auto stream_metrics = getMetrics();
-        auto client_metrics = kinesis_video_producer_.getMetrics();
-        auto total_transfer_tate = 8 * client_metrics.getTotalTransferRate();
-        auto transfer_rate = 8 * stream_metrics.getCurrentTransferRate();
-
-        LOG_DEBUG("Kinesis Video client and stream metrics"
-                          << "\n\t>> Overall storage byte size: " << client_metrics.getContentStoreSizeSize()
-                          << "\n\t>> Available storage byte size: " << client_metrics.getContentStoreAvailableSize()
-                          << "\n\t>> Allocated storage byte size: " << client_metrics.getContentStoreAllocatedSize()
-                          << "\n\t>> Total view allocation byte size: " << client_metrics.getTotalContentViewsSize()
-                          << "\n\t>> Total streams elementary frame rate (fps): " << client_metrics.getTotalElementaryFrameRate()
-                          << "\n\t>> Total streams transfer rate (bps): " <<  total_transfer_tate << " (" << total_transfer_tate / 1024 << " Kbps)"
-                          << "\n\t>> Current view duration (ms): " << stream_metrics.getCurrentViewDuration().count()
-                          << "\n\t>> Overall view duration (ms): " << stream_metrics.getOverallViewDuration().count()
-                          << "\n\t>> Current view byte size: " << stream_metrics.getCurrentViewSize()
-                          << "\n\t>> Overall view byte size: " << stream_metrics.getOverallViewSize()
-                          << "\n\t>> Current elementary frame rate (fps): " << stream_metrics.getCurrentElementaryFrameRate()
-                          << "\n\t>> Current transfer rate (bps): " << transfer_rate << " (" << transfer_rate / 1024 << " Kbps)");
+    return true;
+}
+
+bool KinesisVideoStream::putFrame(KinesisVideoFrame frame, FrameBuffer frame_buffer) const {
+    frame.frameData = frame_buffer.data();
+    frame.size = (UINT32) frame_buffer.size();
+
+    if (ingest_queue_) {
+        if (debug_dump_frame_info_) {
+            LOG_DEBUG("pts: " << frame.presentationTs << ", dts: " << frame.decodingTs << ", duration: " << frame.duration << ", size: " << frame.size << ", trackId: " << frame.trackId
+                              << ", isKey: " << CHECK_FRAME_FLAG_KEY_FRAME(frame.flags));
+        }
+
+        assert(0 != stream_handle_);
+        return STATUS_SUCCEEDED(enqueueFrame(frame, &frame_buffer));
     }
 
-    return true;
+    // The frame is copied into the content store so the buffer is released on return
+    return putFrame(frame);
 }
 
-bool KinesisVideoStream::start(const std::string& hexEncodedCodecPrivateData, uint64_t trackId) {
-    // Hex-decode the string
-    const char* pStrCpd = hexEncodedCodecPrivateData.c_str();
-    UINT32 size = 0;
-    PBYTE pBuffer = nullptr;
+std::vector<STATUS> KinesisVideoStream::putFrames(const KinesisVideoFrame* frames, size_t frame_count) const {
+    std::vector<STATUS> statuses(frame_count, STATUS_INVALID_ARG);
+
+    if (nullptr == frames || 0 == frame_count) {
+        return statuses;
+    }
+
+    if (debug_dump_frame_info_) {
+        for (size_t i = 0; i < frame_count; i++) {
+            LOG_DEBUG("pts: " << frames[i].presentationTs << ", dts: " << frames[i].decodingTs << ", duration: " << frames[i].duration << ", size: " << frames[i].size << ", trackId: " << frames[i].trackId
+                              << ", isKey: " << CHECK_FRAME_FLAG_KEY_FRAME(frames[i].flags));
+        }
+    }
+
+    assert(0 != stream_handle_);
+    if (ingest_queue_) {
+        enqueueFrames(frames, frame_count, statuses.data());
+        return statuses;
+    }
+
+    // The completion time of a frame is the put time of the next one
+    auto put_time = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < frame_count; i++) {
+        // PIC takes a non-const frame pointer so submit a stack copy of the descriptor
+        KinesisVideoFrame frame = frames[i];
+        statuses[i] = submitFrame(frame, put_time);
+    }
+
+    return statuses;
+}
+
+std::vector<STATUS> KinesisVideoStream::putFrames(const std::vector<KinesisVideoFrame>& frames) const {
+    return putFrames(frames.data(), frames.size());
+}
+
+STATUS KinesisVideoStream::submitFrame(KinesisVideoFrame& frame, std::chrono::steady_clock::time_point& put_time) const {
     STATUS status;
+    if (nullptr != frame_log_) {
+        replayFrameLog();
+    }
 
-    if (STATUS_FAILED(status = hexDecode((PCHAR) pStrCpd, 0, NULL, &size))) {
-        LOG_ERROR("Failed to get the size of the buffer for hex decoding the codec private data with: " << status);
-        return false;
+    // The shed frames are dropped on purpose so the put succeeds
+    if (nullptr != frame_shedder_ && frame_shedder_->shouldShed(frame)) {
+        return STATUS_SUCCESS;
     }
 
-    // Allocate the buffer needed
-    pBuffer = reinterpret_cast<PBYTE>(malloc(size));
-    if (nullptr == pBuffer) {
-        LOG_ERROR("Failed to allocate enough buffer for hex decoding. Size: " << size);
-        return false;
+    if (nullptr == latency_tracker_) {
+        status = putKinesisVideoFrame(stream_handle_, &frame);
+    } else {
+        status = putKinesisVideoFrame(stream_handle_, &frame);
+        auto completion_time = std::chrono::steady_clock::now();
+        if (STATUS_SUCCEEDED(status)) {
+            latency_tracker_->recordPutFrame(frame, put_time, completion_time - put_time);
+        }
+
+        put_time = completion_time;
+    }
+
+    // Only the frames accepted by the content store are logged so the replay never trips over a rejected one
+    if (nullptr != frame_log_ && STATUS_SUCCEEDED(status)) {
+        STATUS log_status = frame_log_->append(frame);
+        if (STATUS_FAILED(log_status)) {
+            LOG_WARN("Failed to log frame for stream " << stream_name_ << " with: " << log_status);
+        }
+    }
+
+    FlightRecorder::getInstance().record(FLIGHT_RECORDER_EVENT_PUT_FRAME, stream_handle_, status, frame.presentationTs, (uint16_t) frame.flags);
+    return status;
+}
+
+void KinesisVideoStream::replayFrameLog() const {
+    std::call_once(frame_log_replay_flag_, [this]() {
+        frame_log_->replay([this](Frame& frame) {
+            return putKinesisVideoFrame(stream_handle_, &frame);
+        });
+    });
+}
+
+STATUS KinesisVideoStream::enqueueFrame(const KinesisVideoFrame& frame, FrameBuffer* frame_buffer) const {
+    IngestSlot* slot = ingest_queue_->claim();
+    if (nullptr == slot) {
+        ingest_queue_dropped_frames_++;
+        return STATUS_NOT_ENOUGH_MEMORY;
+    }
+
+    fillIngestSlot(*slot, frame, frame_buffer);
+    publishIngestSlots(1);
+    return STATUS_SUCCESS;
+}
+
+void KinesisVideoStream::enqueueFrames(const KinesisVideoFrame* frames, size_t frame_count, STATUS* statuses) const {
+    size_t enqueued = 0;
+    while (enqueued < frame_count) {
+        // The consumer only frees up the slots so the batch is filled in up to the free slots and published at once
+        size_t count = std::min(frame_count - enqueued, ingest_queue_->available());
+        if (0 == count) {
+            break;
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            fillIngestSlot(*ingest_queue_->claim(i), frames[enqueued + i], nullptr);
+            statuses[enqueued + i] = STATUS_SUCCESS;
+        }
+
+        publishIngestSlots(count);
+        enqueued += count;
+    }
+
+    for (size_t i = enqueued; i < frame_count; i++) {
+        statuses[i] = STATUS_NOT_ENOUGH_MEMORY;
+    }
+
+    ingest_queue_dropped_frames_ += frame_count - enqueued;
+}
+
+void KinesisVideoStream::fillIngestSlot(IngestSlot& slot, const KinesisVideoFrame& frame, FrameBuffer* frame_buffer) const {
+    slot.frame = frame;
+    if (nullptr != frame_buffer) {
+        slot.frame_buffer = std::move(*frame_buffer);
+    } else {
+        // The caller owns the frame data only for the duration of the call
+        slot.frame_data.assign(frame.frameData, frame.frameData + frame.size);
+        slot.frame.frameData = slot.frame_data.data();
+    }
+}
+
+void KinesisVideoStream::publishIngestSlots(size_t count) const {
+    ingest_queue_->publish(count);
+
+    uint64_t depth = ingest_queue_->size();
+    if (depth > ingest_queue_high_water_mark_.load(std::memory_order_relaxed)) {
+        ingest_queue_high_water_mark_.store(depth, std::memory_order_relaxed);
+    }
+
+    // Pairs with the fence in the ingest thread so that either the thread observes the published
+    // slot before parking or we observe the thread being idle and wake it up.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (ingest_idle_.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(ingest_mutex_);
+        ingest_cv_.notify_all();
     }
+}
+
+void KinesisVideoStream::ingestRoutine() {
+    LOG_DEBUG("Ingest thread started for stream " << stream_name_);
+
+    while (!ingest_thread_exit_) {
+        IngestSlot* slot = ingest_queue_->front();
+        if (nullptr == slot) {
+            std::unique_lock<std::mutex> lock(ingest_mutex_);
+            ingest_idle_.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            // Wake up the flush waiters as the queue is depleted
+            ingest_cv_.notify_all();
+            ingest_cv_.wait(lock, [this]() { return ingest_thread_exit_ || !ingest_queue_->empty(); });
+            ingest_idle_.store(false, std::memory_order_relaxed);
+            continue;
+        }
+
+        auto put_time = std::chrono::steady_clock::now();
+        STATUS status = submitFrame(slot->frame, put_time);
+
+        // The frame is packaged at this stage so the caller provided buffer can be returned
+        slot->frame_buffer.release();
+        ingest_queue_->pop();
+
+        if (STATUS_FAILED(status)) {
+            LOG_WARN("Failed to submit a queued frame for stream " << stream_name_ << " with: " << status);
+        }
+    }
+
+    {
+        // Release the flush waiters which might still be blocked
+        std::lock_guard<std::mutex> lock(ingest_mutex_);
+        ingest_idle_ = true;
+        ingest_cv_.notify_all();
+    }
+
+    LOG_DEBUG("Ingest thread exiting for stream " << stream_name_);
+}
+
+void KinesisVideoStream::flushIngestQueue() {
+    if (!ingest_queue_) {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(ingest_mutex_);
+    ingest_cv_.wait(lock, [this]() { return ingest_thread_exit_ || (ingest_idle_ && ingest_queue_->empty()); });
+}
+
+void KinesisVideoStream::stopIngestThread() {
+    if (!ingest_thread_.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(ingest_mutex_);
+        ingest_thread_exit_ = true;
+        ingest_cv_.notify_all();
+    }
+
+    ingest_thread_.join();
+}
 
-    if (STATUS_FAILED(status = hexDecode((PCHAR) pStrCpd, 0, pBuffer, &size))) {
+bool KinesisVideoStream::start(const std::string& hexEncodedCodecPrivateData, uint64_t trackId) {
+    // Hex-decode the string in a single pass as the decoded size is bounded by half of the string length
+    std::vector<uint8_t> buffer(hexEncodedCodecPrivateData.size() / 2 + 1);
+    UINT32 size = (UINT32) buffer.size();
+    STATUS status;
+
+    if (STATUS_FAILED(status = hexDecode((PCHAR) hexEncodedCodecPrivateData.c_str(), (UINT32) hexEncodedCodecPrivateData.size(),
+                                         buffer.data(), &size))) {
         LOG_ERROR("Failed to hex decode the codec private data with: " << status);
-        ::free(pBuffer);
         return false;
     }
 
     // Start the stream with the binary codec private data buffer
-    bool retVal = start(reinterpret_cast<unsigned char*> (pBuffer), size, trackId);
-
-    // Free the allocated buffer before returning
-    ::free(pBuffer);
-
-    return retVal;
+    return start(buffer.data(), size, trackId);
 }
 
 bool KinesisVideoStream::start(const unsigned char* codecPrivateData, size_t codecPrivateDataSize, uint64_t trackId) {
@@ -97,6 +299,7 @@ bool KinesisVideoStream::start(const unsigned char* codecPrivateData, size_t cod
 
     if (STATUS_FAILED(status = kinesisVideoStreamFormatChanged(stream_handle_, (UINT32) codecPrivateDataSize,
                                                                (PBYTE) codecPrivateData, (UINT64) trackId))) {
+        FlightRecorder::getInstance().record(FLIGHT_RECORDER_EVENT_STREAM_START, stream_handle_, status);
         LOG_ERROR("Failed to set the codec private data with: " << status);
         return false;
     }
@@ -106,7 +309,12 @@ bool KinesisVideoStream::start(const unsigned char* codecPrivateData, size_t cod
 }
 
 bool KinesisVideoStream::start() {
-    // No-op for now
+    FlightRecorder::getInstance().record(FLIGHT_RECORDER_EVENT_STREAM_START, stream_handle_);
+
+    // The frames of the previous run go first, after the codec private data is in place
+    if (nullptr != frame_log_) {
+        replayFrameLog();
+    }
 
     return true;
 }
@@ -114,7 +322,9 @@ bool KinesisVideoStream::start() {
 bool KinesisVideoStream::resetConnection() {
     STATUS status = STATUS_SUCCESS;
 
-    if (STATUS_FAILED(status = kinesisVideoStreamResetConnection(stream_handle_))) {
+    status = kinesisVideoStreamResetConnection(stream_handle_);
+    FlightRecorder::getInstance().record(FLIGHT_RECORDER_EVENT_STREAM_RESET_CONNECTION, stream_handle_, status);
+    if (STATUS_FAILED(status)) {
         LOG_ERROR("Failed to reset the connection with: " << status);
         return false;
     }
@@ -125,7 +335,9 @@ bool KinesisVideoStream::resetConnection() {
 bool KinesisVideoStream::resetStream() {
     STATUS status = STATUS_SUCCESS;
 
-    if (STATUS_FAILED(status = kinesisVideoStreamResetStream(stream_handle_))) {
+    status = kinesisVideoStreamResetStream(stream_handle_);
+    FlightRecorder::getInstance().record(FLIGHT_RECORDER_EVENT_STREAM_RESET, stream_handle_, status);
+    if (STATUS_FAILED(status)) {
         LOG_ERROR("Failed to reset the stream with: " << status);
         return false;
     }
@@ -136,14 +348,25 @@ bool KinesisVideoStream::resetStream() {
 void KinesisVideoStream::free() {
     LOG_INFO("Freeing Kinesis Video Stream " << stream_name_);
 
+    // Stop submitting the queued frames before the stream goes away
+    stopIngestThread();
+
     // Free the underlying stream
+    FlightRecorder::getInstance().record(FLIGHT_RECORDER_EVENT_STREAM_FREE, stream_handle_);
+    std::lock_guard<std::mutex> lock(stream_free_mutex_);
+    stream_freed_ = true;
     std::call_once(free_kinesis_video_stream_flag_, freeKinesisVideoStream, getStreamHandle());
 }
 
 bool KinesisVideoStream::stop() {
     STATUS status;
 
-    if (STATUS_FAILED(status = stopKinesisVideoStream(stream_handle_))) {
+    // Submit the queued frames ahead of the end-of-stream
+    flushIngestQueue();
+
+    status = stopKinesisVideoStream(stream_handle_);
+    FlightRecorder::getInstance().record(FLIGHT_RECORDER_EVENT_STREAM_STOP, stream_handle_, status);
+    if (STATUS_FAILED(status)) {
         LOG_ERROR("Failed to stop the stream with: " << status);
         return false;
     }
@@ -154,19 +377,90 @@ bool KinesisVideoStream::stop() {
 bool KinesisVideoStream::stopSync() {
     STATUS status;
 
-    if (STATUS_FAILED(status = stopKinesisVideoStreamSync(stream_handle_))) {
+    // Submit the queued frames ahead of the end-of-stream
+    flushIngestQueue();
+
+    status = stopKinesisVideoStreamSync(stream_handle_);
+    FlightRecorder::getInstance().record(FLIGHT_RECORDER_EVENT_STREAM_STOP_SYNC, stream_handle_, status);
+    if (STATUS_FAILED(status)) {
         LOG_ERROR("Failed to stop the stream with: " << status);
         return false;
     }
 
+    // The buffer is depleted so nothing is left to replay
+    if (nullptr != frame_log_) {
+        frame_log_->clear();
+    }
+
     return true;
 }
 
 KinesisVideoStreamMetrics KinesisVideoStream::getMetrics() const {
-    STATUS status = ::getKinesisVideoStreamMetrics(stream_handle_, (PStreamMetrics) stream_metrics_.getRawMetrics());
+    KinesisVideoStreamMetrics stream_metrics;
+    STATUS status = fillMetrics(stream_metrics);
     LOG_AND_THROW_IF(STATUS_FAILED(status), "Failed to get stream metrics with: " << status);
 
-    return stream_metrics_;
+    return stream_metrics;
+}
+
+KinesisVideoStreamMetrics KinesisVideoStream::getMetricsSnapshot() const noexcept {
+    std::shared_ptr<const KinesisVideoStreamMetrics> metrics_snapshot = std::atomic_load(&metrics_snapshot_);
+    if (nullptr == metrics_snapshot) {
+        return KinesisVideoStreamMetrics();
+    }
+
+    return *metrics_snapshot;
+}
+
+STATUS KinesisVideoStream::fillMetrics(KinesisVideoStreamMetrics& stream_metrics) const {
+    STATUS status = ::getKinesisVideoStreamMetrics(stream_handle_, (PStreamMetrics) stream_metrics.getRawMetrics());
+    if (STATUS_FAILED(status)) {
+        return status;
+    }
+
+    if (ingest_queue_) {
+        stream_metrics.ingest_queue_depth_ = ingest_queue_->size();
+        stream_metrics.ingest_queue_high_water_mark_ = ingest_queue_high_water_mark_;
+        stream_metrics.ingest_queue_dropped_frames_ = ingest_queue_dropped_frames_;
+    }
+
+    if (nullptr != latency_tracker_) {
+        stream_metrics.put_frame_latency_ = latency_tracker_->getPutFrameLatency();
+        stream_metrics.buffering_ack_latency_ = latency_tracker_->getBufferingAckLatency();
+        stream_metrics.received_ack_latency_ = latency_tracker_->getReceivedAckLatency();
+        stream_metrics.persisted_ack_latency_ = latency_tracker_->getPersistedAckLatency();
+    }
+
+    if (nullptr != frame_shedder_) {
+        stream_metrics.frame_shedding_level_ = frame_shedder_->getLevel();
+        stream_metrics.shed_non_reference_frames_ = frame_shedder_->getShedFrames(FRAME_SHEDDING_LEVEL_NON_REFERENCE);
+        stream_metrics.shed_secondary_track_frames_ = frame_shedder_->getShedFrames(FRAME_SHEDDING_LEVEL_SECONDARY_TRACKS);
+        stream_metrics.shed_key_frame_only_frames_ = frame_shedder_->getShedFrames(FRAME_SHEDDING_LEVEL_KEY_FRAME_ONLY);
+    }
+
+    return STATUS_SUCCESS;
+}
+
+std::shared_ptr<const KinesisVideoStreamMetrics> KinesisVideoStream::sampleMetrics() {
+    std::shared_ptr<KinesisVideoStreamMetrics> stream_metrics = std::make_shared<KinesisVideoStreamMetrics>();
+
+    {
+        std::lock_guard<std::mutex> lock(stream_free_mutex_);
+        if (stream_freed_) {
+            return nullptr;
+        }
+
+        STATUS status = fillMetrics(*stream_metrics);
+        if (STATUS_FAILED(status)) {
+            LOG_WARN("Failed to sample metrics for stream " << stream_name_ << " with: " << status);
+            return nullptr;
+        }
+    }
+
+    std::shared_ptr<const KinesisVideoStreamMetrics> metrics_snapshot = stream_metrics;
+    std::atomic_store(&metrics_snapshot_, metrics_snapshot);
+
+    return metrics_snapshot;
 }
 
 bool KinesisVideoStream::putFragmentMetadata(const std::string &name, const std::string &value, bool persistent){
@@ -6,10 +6,19 @@
 #include <iostream>
 #include <utility>
 #include <condition_variable>
+#include <atomic>
+#include <thread>
+#include <vector>
 
 #include "KinesisVideoProducer.h"
 #include "KinesisVideoStreamMetrics.h"
 #include "StreamDefinition.h"
+#include "SpscRingBuffer.h"
+#include "FrameBuffer.h"
+#include "StreamLatencyTracker.h"
+#include "FrameLog.h"
+#include "BitrateAdvisor.h"
+#include "FrameShedder.h"
 
 namespace com { namespace amazonaws { namespace kinesis { namespace video {
 
@@ -57,11 +66,56 @@ public:
     /**
      * Packages and streams the frame to Kinesis Video service.
      *
+     * NOTE: In the asynchronous ingest mode the frame is copied into the ingest queue and the
+     * call returns without waiting for the frame to be packaged. The ingest queue is single producer,
+     * so the frames of the stream must then be put from a single thread at a time, across all of the
+     * putFrame and putFrames overloads.
+     *
      * @param frame The frame to be packaged and streamed.
-     * @return true if the encoder accepted the frame and false otherwise.
+     * @return true if the encoder (or the ingest queue) accepted the frame and false otherwise.
      */
     bool putFrame(KinesisVideoFrame frame) const;
 
+    /**
+     * Packages and streams the frame to Kinesis Video service taking over the ownership of the payload.
+     *
+     * The frame data and size are taken from the frame buffer. The buffer is released as soon as the
+     * frame has been packaged into the content store - on return in the synchronous mode or once the
+     * ingest thread submits the frame in the asynchronous ingest mode, in which case no copy is made.
+     *
+     * NOTE: Single producer thread in the asynchronous ingest mode as with putFrame(KinesisVideoFrame).
+     *
+     * @param frame The frame to be packaged and streamed.
+     * @param frame_buffer The frame payload.
+     * @return true if the encoder (or the ingest queue) accepted the frame and false otherwise.
+     */
+    bool putFrame(KinesisVideoFrame frame, FrameBuffer frame_buffer) const;
+
+    /**
+     * Packages and streams a batch of frames to Kinesis Video service.
+     *
+     * Each frame is validated by the Kinesis Video PIC as it is submitted, the same as with putFrame.
+     * The Kinesis Video PIC has no batch entry point so the client lock is still taken per frame. The batch
+     * saves the per-call overhead of the SDK. In the asynchronous ingest mode the frames are queued and the
+     * ingest thread is woken up once per batch.
+     *
+     * NOTE: The frames are submitted in order. A failed frame does not stop the rest of the batch.
+     * Single producer thread in the asynchronous ingest mode as with putFrame(KinesisVideoFrame).
+     *
+     * @param frames Pointer to a contiguous array of frames to be packaged and streamed.
+     * @param frame_count Number of frames in the array.
+     * @return Per-frame statuses in submission order. STATUS_SUCCESS indicates the frame was accepted.
+     */
+    std::vector<STATUS> putFrames(const KinesisVideoFrame* frames, size_t frame_count) const;
+
+    /**
+     * Packages and streams a batch of frames to Kinesis Video service.
+     *
+     * @param frames The frames to be packaged and streamed.
+     * @return Per-frame statuses in submission order. STATUS_SUCCESS indicates the frame was accepted.
+     */
+    std::vector<STATUS> putFrames(const std::vector<KinesisVideoFrame>& frames) const;
+
     /**
      * Gets the stream metrics.
      *
@@ -69,6 +123,16 @@ public:
      */
     KinesisVideoStreamMetrics getMetrics() const;
 
+    /**
+     * Gets the latest stream metrics published by the producer metrics sampler.
+     *
+     * NOTE: The call does not reach into the Kinesis Video PIC and never blocks. The metrics are
+     * as old as the producer metrics sampling period and are empty before the first sample.
+     *
+     * @return Stream metrics snapshot.
+     */
+    KinesisVideoStreamMetrics getMetricsSnapshot() const noexcept;
+
     /**
      * Appends a "metadata" - a key/value string pair into the stream.
      *
@@ -140,6 +204,12 @@ public:
      */
     bool stopSync();
 
+    /**
+     * Awaits until the frames queued in the asynchronous ingest mode are submitted.
+     * No-op if the asynchronous ingest mode is disabled.
+     */
+    void flushIngestQueue();
+
     bool operator==(const KinesisVideoStream &rhs) const {
         return stream_handle_ == rhs.stream_handle_ &&
                stream_name_ == rhs.stream_name_;
@@ -152,7 +222,12 @@ public:
     KinesisVideoStream(const KinesisVideoStream &rhs)
             : stream_handle_(rhs.stream_handle_),
               kinesis_video_producer_(rhs.kinesis_video_producer_),
-              stream_name_(rhs.stream_name_) {}
+              stream_name_(rhs.stream_name_),
+              stream_freed_(false),
+              ingest_idle_(false),
+              ingest_thread_exit_(false),
+              ingest_queue_high_water_mark_(0),
+              ingest_queue_dropped_frames_(0) {}
 
     std::string getStreamName() {
         return stream_name_;
@@ -162,11 +237,107 @@ public:
         return kinesis_video_producer_;
     }
 
+    /**
+     * @return The stream latency tracker. nullptr until the stream is created by the producer.
+     */
+    std::shared_ptr<StreamLatencyTracker> getLatencyTracker() const {
+        return latency_tracker_;
+    }
+
+    /**
+     * @return The write-ahead frame log. nullptr if the log is disabled.
+     */
+    std::shared_ptr<FrameLog> getFrameLog() const {
+        return frame_log_;
+    }
+
+    /**
+     * @return The encoder bitrate advisor. nullptr until the stream is created by the producer.
+     */
+    std::shared_ptr<BitrateAdvisor> getBitrateAdvisor() const {
+        return bitrate_advisor_;
+    }
+
+    /**
+     * @return The frame shedder. nullptr if the shedding is disabled.
+     */
+    std::shared_ptr<FrameShedder> getFrameShedder() const {
+        return frame_shedder_;
+    }
+
 protected:
     /**
      * Non-public constructor as streams should be only created by the producer client
      */
-    KinesisVideoStream(const KinesisVideoProducer& kinesis_video_producer, const std::string stream_name);
+    KinesisVideoStream(const KinesisVideoProducer& kinesis_video_producer, const std::string stream_name, uint32_t ingest_queue_capacity = 0);
+
+    /**
+     * Fills in the stream metrics from the Kinesis Video PIC and the ingest queue
+     */
+    STATUS fillMetrics(KinesisVideoStreamMetrics& stream_metrics) const;
+
+    /**
+     * Samples the current stream metrics and publishes the snapshot. Called by the producer metrics sampler.
+     *
+     * @return The published snapshot or nullptr if the stream has been freed or the sampling failed.
+     */
+    std::shared_ptr<const KinesisVideoStreamMetrics> sampleMetrics();
+
+    /**
+     * Asynchronous ingest queue slot owning either a copy of the frame payload
+     * or the frame buffer handed over by the caller
+     */
+    struct IngestSlot {
+        KinesisVideoFrame frame;
+        std::vector<uint8_t> frame_data;
+        FrameBuffer frame_buffer;
+    };
+
+    /**
+     * Submits the frame to the Kinesis Video PIC
+     *
+     * @param frame The frame to submit.
+     * @param put_time The time the put started at for the latency tracking. Set to the completion time
+     * so that a batch reads the clock once per frame.
+     */
+    STATUS submitFrame(KinesisVideoFrame& frame, std::chrono::steady_clock::time_point& put_time) const;
+
+    /**
+     * Submits the frames left over in the frame log by the previous run. Runs once ahead of the first frame.
+     */
+    void replayFrameLog() const;
+
+    /**
+     * Queues the frame in the asynchronous ingest queue. The payload is either moved from the
+     * optional frame buffer or copied from the frame data.
+     */
+    STATUS enqueueFrame(const KinesisVideoFrame& frame, FrameBuffer* frame_buffer = nullptr) const;
+
+    /**
+     * Queues the frames in the asynchronous ingest queue, copying the frame data. The slots are published
+     * and the ingest thread woken up once for the batch. The frames which don't fit the queue are dropped.
+     */
+    void enqueueFrames(const KinesisVideoFrame* frames, size_t frame_count, STATUS* statuses) const;
+
+    /**
+     * Fills in the claimed ingest queue slot with the frame
+     */
+    void fillIngestSlot(IngestSlot& slot, const KinesisVideoFrame& frame, FrameBuffer* frame_buffer) const;
+
+    /**
+     * Publishes the filled in ingest queue slots and wakes up the ingest thread if it is idle
+     */
+    void publishIngestSlots(size_t count) const;
+
+    /**
+     * Asynchronous ingest thread routine draining the ingest queue
+     */
+    void ingestRoutine();
+
+    /**
+     * Stops and joins the asynchronous ingest thread. Queued frames are discarded.
+     */
+    void stopIngestThread();
 
     /**
      * Non-public destructor as the streams should be de-allocated by the producer client
@@ -212,14 +383,66 @@ protected:
     volatile bool stream_closed_;
 
     /**
-     * Stream metrics
+     * Latest stream metrics snapshot published by the producer metrics sampler.
+     * Accessed via the atomic shared pointer operations.
+     */
+    std::shared_ptr<const KinesisVideoStreamMetrics> metrics_snapshot_;
+
+    /**
+     * Guards the stream handle against being freed while the metrics are sampled
      */
-    KinesisVideoStreamMetrics stream_metrics_;
+    std::mutex stream_free_mutex_;
+    bool stream_freed_;
 
     /**
      * Whether to dump frame info into file.
      */
     bool debug_dump_frame_info_;
+
+    /**
+     * Latency histograms shared with the fragment ack callback
+     */
+    std::shared_ptr<StreamLatencyTracker> latency_tracker_;
+
+    /**
+     * Write-ahead frame log shared with the fragment ack callback. nullptr if disabled
+     */
+    std::shared_ptr<FrameLog> frame_log_;
+    mutable std::once_flag frame_log_replay_flag_;
+
+    /**
+     * Encoder bitrate recommendation updated by the producer metrics sampler
+     */
+    std::shared_ptr<BitrateAdvisor> bitrate_advisor_;
+
+    /**
+     * Frame shedding in front of the content store. nullptr if disabled
+     */
+    std::shared_ptr<FrameShedder> frame_shedder_;
+
+    /**
+     * Asynchronous ingest queue. nullptr if the mode is disabled
+     */
+    std::unique_ptr<SpscRingBuffer<IngestSlot>> ingest_queue_;
+
+    /**
+     * Asynchronous ingest thread draining the queue
+     */
+    std::thread ingest_thread_;
+
+    /**
+     * Synchronization of the ingest thread parking and the flush waiters
+     */
+    mutable std::mutex ingest_mutex_;
+    mutable std::condition_variable ingest_cv_;
+    mutable std::atomic<bool> ingest_idle_;
+    std::atomic<bool> ingest_thread_exit_;
+
+    /**
+     * Asynchronous ingest queue counters
+     */
+    mutable std::atomic<uint64_t> ingest_queue_high_water_mark_;
+    mutable std::atomic<uint64_t> ingest_queue_dropped_frames_;
 };
 
 } // namespace video
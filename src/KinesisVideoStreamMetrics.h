@@ -3,20 +3,31 @@
 #pragma once
 
 #include "com/amazonaws/kinesis/video/client/Include.h"
+#include "LatencyHistogram.h"
 
 namespace com { namespace amazonaws { namespace kinesis { namespace video {
 
+class KinesisVideoStream;
+
 /**
 * Wraps around the stream metrics class
 */
 class KinesisVideoStreamMetrics {
+    friend KinesisVideoStream;
 
 public:
 
     /**
      * Default constructor
      */
-    KinesisVideoStreamMetrics() {
+    KinesisVideoStreamMetrics()
+            : ingest_queue_depth_(0),
+              ingest_queue_high_water_mark_(0),
+              ingest_queue_dropped_frames_(0),
+              frame_shedding_level_(0),
+              shed_non_reference_frames_(0),
+              shed_secondary_track_frames_(0),
+              shed_key_frame_only_frames_(0) {
         memset(&stream_metrics_, 0x00, sizeof(::StreamMetrics));
         stream_metrics_.version = STREAM_METRICS_CURRENT_VERSION;
     }
@@ -70,6 +81,83 @@ public:
         return stream_metrics_.currentTransferRate;
     }
 
+    /**
+     * Returns the number of frames awaiting submission in the asynchronous ingest queue
+     */
+    uint64_t getIngestQueueDepth() const {
+        return ingest_queue_depth_;
+    }
+
+    /**
+     * Returns the maximum observed asynchronous ingest queue depth
+     */
+    uint64_t getIngestQueueHighWaterMark() const {
+        return ingest_queue_high_water_mark_;
+    }
+
+    /**
+     * Returns the number of frames dropped due to the asynchronous ingest queue overflow
+     */
+    uint64_t getIngestQueueDroppedFrames() const {
+        return ingest_queue_dropped_frames_;
+    }
+
+    /**
+     * Returns the current frame shedding level. 0 if not shedding or the shedding is disabled
+     */
+    uint32_t getFrameSheddingLevel() const {
+        return frame_shedding_level_;
+    }
+
+    /**
+     * Returns the number of the non-reference frames shed under the pressure
+     */
+    uint64_t getShedNonReferenceFrames() const {
+        return shed_non_reference_frames_;
+    }
+
+    /**
+     * Returns the number of the frames of the secondary tracks shed under the pressure
+     */
+    uint64_t getShedSecondaryTrackFrames() const {
+        return shed_secondary_track_frames_;
+    }
+
+    /**
+     * Returns the number of the non-key frames shed in the key frame only mode
+     */
+    uint64_t getShedKeyFrameOnlyFrames() const {
+        return shed_key_frame_only_frames_;
+    }
+
+    /**
+     * Returns the putFrame call duration percentiles
+     */
+    const LatencyPercentiles& getPutFrameLatency() const {
+        return put_frame_latency_;
+    }
+
+    /**
+     * Returns the percentiles of the time from putting the fragment key frame to the buffering ack
+     */
+    const LatencyPercentiles& getBufferingAckLatency() const {
+        return buffering_ack_latency_;
+    }
+
+    /**
+     * Returns the percentiles of the time from putting the fragment key frame to the received ack
+     */
+    const LatencyPercentiles& getReceivedAckLatency() const {
+        return received_ack_latency_;
+    }
+
+    /**
+     * Returns the percentiles of the time from putting the fragment key frame to the persisted ack
+     */
+    const LatencyPercentiles& getPersistedAckLatency() const {
+        return persisted_ack_latency_;
+    }
+
     const ::StreamMetrics* getRawMetrics() const {
         return &stream_metrics_;
     }
@@ -79,6 +167,29 @@ private:
      * Underlying metrics object
      */
     ::StreamMetrics stream_metrics_;
+
+    /**
+     * Asynchronous ingest queue metrics. Zero if the mode is disabled
+     */
+    uint64_t ingest_queue_depth_;
+    uint64_t ingest_queue_high_water_mark_;
+    uint64_t ingest_queue_dropped_frames_;
+
+    /**
+     * Frame shedding metrics. Zero if the shedding is disabled
+     */
+    uint32_t frame_shedding_level_;
+    uint64_t shed_non_reference_frames_;
+    uint64_t shed_secondary_track_frames_;
+    uint64_t shed_key_frame_only_frames_;
+
+    /**
+     * Latency percentiles
+     */
+    LatencyPercentiles put_frame_latency_;
+    LatencyPercentiles buffering_ack_latency_;
+    LatencyPercentiles received_ack_latency_;
+    LatencyPercentiles persisted_ack_latency_;
 };
 
 } // namespace video
@@ -0,0 +1,177 @@
+/** Copyright 2017 Amazon.com. All rights reserved. */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+/**
+ * Number of the sub-buckets per power of two as a power of two. 4 bits bound the relative
+ * error of the reported values to 1/16th.
+ */
+#define LATENCY_HISTOGRAM_SUB_BUCKET_BITS 4
+#define LATENCY_HISTOGRAM_SUB_BUCKET_COUNT (1u << LATENCY_HISTOGRAM_SUB_BUCKET_BITS)
+
+/**
+ * Highest trackable value as a power of two in microseconds - about 19 hours. Larger values are clamped.
+ */
+#define LATENCY_HISTOGRAM_MAX_VALUE_BITS 36
+
+/**
+ * Total number of the buckets
+ */
+#define LATENCY_HISTOGRAM_BUCKET_COUNT \
+    ((LATENCY_HISTOGRAM_MAX_VALUE_BITS - LATENCY_HISTOGRAM_SUB_BUCKET_BITS + 1) * LATENCY_HISTOGRAM_SUB_BUCKET_COUNT)
+
+/**
+ * Latency percentiles computed from a histogram
+ */
+struct LatencyPercentiles {
+    LatencyPercentiles()
+            : count(0), p50(0), p90(0), p99(0), p999(0), max(0) {
+    }
+
+    /**
+     * Number of the recorded values
+     */
+    uint64_t count;
+
+    std::chrono::microseconds p50;
+    std::chrono::microseconds p90;
+    std::chrono::microseconds p99;
+    std::chrono::microseconds p999;
+    std::chrono::microseconds max;
+};
+
+/**
+ * Fixed size log-bucketed latency histogram in the spirit of HdrHistogram.
+ *
+ * The values are recorded into a linear run of sub-buckets within each power of two so the
+ * bucket width grows with the value while the relative error stays constant.
+ *
+ * Recording is a single relaxed atomic increment - no locks and no allocations - which makes it
+ * suitable for the frame path and the callback threads. The percentiles are computed off the hot
+ * path and are approximate while the values are being recorded concurrently.
+ */
+class LatencyHistogram {
+public:
+    LatencyHistogram() : max_value_(0) {
+        reset();
+    }
+
+    /**
+     * Records a single value
+     */
+    void record(std::chrono::microseconds value) {
+        uint64_t micros = value.count() < 0 ? 0 : (uint64_t) value.count();
+        counts_[bucketIndex(micros)].fetch_add(1, std::memory_order_relaxed);
+
+        uint64_t max_value = max_value_.load(std::memory_order_relaxed);
+        while (micros > max_value && !max_value_.compare_exchange_weak(max_value, micros, std::memory_order_relaxed)) {
+        }
+    }
+
+    /**
+     * Computes p50/p90/p99/p999 and the max. The percentiles report the upper bound of the bucket.
+     */
+    LatencyPercentiles getPercentiles() const {
+        LatencyPercentiles percentiles;
+        uint64_t counts[LATENCY_HISTOGRAM_BUCKET_COUNT];
+        for (uint32_t i = 0; i < LATENCY_HISTOGRAM_BUCKET_COUNT; i++) {
+            counts[i] = counts_[i].load(std::memory_order_relaxed);
+            percentiles.count += counts[i];
+        }
+
+        if (0 == percentiles.count) {
+            return percentiles;
+        }
+
+        percentiles.p50 = valueAtPercentile(counts, percentiles.count, 500);
+        percentiles.p90 = valueAtPercentile(counts, percentiles.count, 900);
+        percentiles.p99 = valueAtPercentile(counts, percentiles.count, 990);
+        percentiles.p999 = valueAtPercentile(counts, percentiles.count, 999);
+        percentiles.max = std::chrono::microseconds(max_value_.load(std::memory_order_relaxed));
+
+        return percentiles;
+    }
+
+    /**
+     * Clears the recorded values. Not atomic with respect to the concurrent recording.
+     */
+    void reset() {
+        for (auto& count : counts_) {
+            count.store(0, std::memory_order_relaxed);
+        }
+
+        max_value_.store(0, std::memory_order_relaxed);
+    }
+
+    /**
+     * Maps the value to the bucket index
+     */
+    static uint32_t bucketIndex(uint64_t value) {
+        if (value < LATENCY_HISTOGRAM_SUB_BUCKET_COUNT) {
+            return (uint32_t) value;
+        }
+
+        uint32_t msb = mostSignificantBit(value);
+        if (msb >= LATENCY_HISTOGRAM_MAX_VALUE_BITS) {
+            return LATENCY_HISTOGRAM_BUCKET_COUNT - 1;
+        }
+
+        uint32_t sub_bucket = (uint32_t) (value >> (msb - LATENCY_HISTOGRAM_SUB_BUCKET_BITS)) & (LATENCY_HISTOGRAM_SUB_BUCKET_COUNT - 1);
+        return (msb - LATENCY_HISTOGRAM_SUB_BUCKET_BITS + 1) * LATENCY_HISTOGRAM_SUB_BUCKET_COUNT + sub_bucket;
+    }
+
+    /**
+     * Returns the highest value which maps to the bucket
+     */
+    static uint64_t bucketUpperBound(uint32_t index) {
+        if (index < LATENCY_HISTOGRAM_SUB_BUCKET_COUNT) {
+            return index;
+        }
+
+        uint32_t shift = index / LATENCY_HISTOGRAM_SUB_BUCKET_COUNT - 1;
+        uint64_t lower_bound = (uint64_t) (LATENCY_HISTOGRAM_SUB_BUCKET_COUNT + index % LATENCY_HISTOGRAM_SUB_BUCKET_COUNT) << shift;
+        return lower_bound + (1ull << shift) - 1;
+    }
+
+private:
+    static uint32_t mostSignificantBit(uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+        return 63 - (uint32_t) __builtin_clzll(value);
+#else
+        uint32_t msb = 0;
+        while (value >>= 1) {
+            msb++;
+        }
+
+        return msb;
+#endif
+    }
+
+    static std::chrono::microseconds valueAtPercentile(const uint64_t* counts, uint64_t total, uint32_t per_mille) {
+        // Rank of the value rounded up so that p999 of a small sample is the max
+        uint64_t rank = (total * per_mille + 999) / 1000;
+        uint64_t cumulative = 0;
+        for (uint32_t i = 0; i < LATENCY_HISTOGRAM_BUCKET_COUNT; i++) {
+            cumulative += counts[i];
+            if (cumulative >= rank && 0 != counts[i]) {
+                return std::chrono::microseconds(bucketUpperBound(i));
+            }
+        }
+
+        return std::chrono::microseconds(bucketUpperBound(LATENCY_HISTOGRAM_BUCKET_COUNT - 1));
+    }
+
+    std::atomic<uint64_t> counts_[LATENCY_HISTOGRAM_BUCKET_COUNT];
+    std::atomic<uint64_t> max_value_;
+};
+
+} // namespace video
+} // namespace kinesis
+} // namespace amazonaws
+} // namespace com
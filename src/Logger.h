@@ -6,11 +6,25 @@
 #include <log4cplus/consoleappender.h>
 #include <log4cplus/layout.h>
 #include <log4cplus/version.h>
+#include <atomic>
+#include <chrono>
 #include <sstream>
 #include <stdexcept>
 
+#include "AsyncLogger.h"
+
 namespace com { namespace amazonaws { namespace kinesis { namespace video {
 
+// compile time log levels. the statements below KVS_MIN_LOG_LEVEL are compiled out - the logger
+// lookup and the level check are skipped altogether. set through the KVS_MIN_LOG_LEVEL CMake option.
+#define KVS_LOG_LEVEL_TRACE 0
+#define KVS_LOG_LEVEL_DEBUG 1
+#define KVS_LOG_LEVEL_INFO  2
+
+#ifndef KVS_MIN_LOG_LEVEL
+#define KVS_MIN_LOG_LEVEL KVS_LOG_LEVEL_TRACE
+#endif
+
 // configure the logger by loading configuration from specific properties file.
 // generally, it should be called only once in your main() function.
 #define LOG_CONFIGURE(filename) \
@@ -42,21 +56,93 @@ namespace com { namespace amazonaws { namespace kinesis { namespace video {
 #define LOG_CONFIGURE_STDERR(level) _LOG_CONFIGURE_CONSOLE(level, true)
 
 // runtime queries for enabled log level. useful if message construction is expensive.
+#if KVS_MIN_LOG_LEVEL > KVS_LOG_LEVEL_TRACE
+#define LOG_IS_TRACE_ENABLED (false)
+#else
 #define LOG_IS_TRACE_ENABLED (KinesisVideoLogger::getInstance().isEnabledFor(log4cplus::TRACE_LOG_LEVEL))
+#endif
+#if KVS_MIN_LOG_LEVEL > KVS_LOG_LEVEL_DEBUG
+#define LOG_IS_DEBUG_ENABLED (false)
+#else
 #define LOG_IS_DEBUG_ENABLED (KinesisVideoLogger::getInstance().isEnabledFor(log4cplus::DEBUG_LOG_LEVEL))
+#endif
+#if KVS_MIN_LOG_LEVEL > KVS_LOG_LEVEL_INFO
+#define LOG_IS_INFO_ENABLED  (false)
+#else
 #define LOG_IS_INFO_ENABLED  (KinesisVideoLogger::getInstance().isEnabledFor(log4cplus::INFO_LOG_LEVEL))
+#endif
 #define LOG_IS_WARN_ENABLED  (KinesisVideoLogger::getInstance().isEnabledFor(log4cplus::WARN_LOG_LEVEL))
 #define LOG_IS_ERROR_ENABLED (KinesisVideoLogger::getInstance().isEnabledFor(log4cplus::ERROR_LOG_LEVEL))
 #define LOG_IS_FATAL_ENABLED (KinesisVideoLogger::getInstance().isEnabledFor(log4cplus::FATAL_LOG_LEVEL))
 
+// routes the message to the asynchronous log backend when it's turned on. the message is still
+// formatted on the calling thread while the appender I/O is moved to the background thread.
+#define _LOG_AT_LEVEL(level, log4cplus_macro, msg) \
+  do { \
+    if (::com::amazonaws::kinesis::video::AsyncLogger::isActive()) { \
+      log4cplus::Logger const& __logger = KinesisVideoLogger::getInstance(); \
+      if (__logger.isEnabledFor(level)) { \
+        std::ostringstream __oss; \
+        __oss << msg; \
+        ::com::amazonaws::kinesis::video::AsyncLogger::getInstance().log(__logger, level, __FILE__, __LINE__, __oss.str()); \
+      } \
+    } else { \
+      log4cplus_macro(KinesisVideoLogger::getInstance(), msg); \
+    } \
+  } while (0)
+
+// the compiled out statements are kept type checked but are never evaluated
+#define _LOG_COMPILED_OUT(msg) \
+  do { \
+    if (false) { \
+      std::ostringstream __oss; \
+      __oss << msg; \
+    } \
+  } while (0)
+
 // logging macros - any usage must be preceded by a LOGGER_TAG definition visible at the current scope.
 // failure to use the LOGGER_TAG macro will result in "error: 'KinesisVideoLogger' has not been declared"
-#define LOG_TRACE(msg)   LOG4CPLUS_TRACE(KinesisVideoLogger::getInstance(), msg);
-#define LOG_DEBUG(msg)   LOG4CPLUS_DEBUG(KinesisVideoLogger::getInstance(), msg);
-#define LOG_INFO(msg)    LOG4CPLUS_INFO(KinesisVideoLogger::getInstance(), msg);
-#define LOG_WARN(msg)    LOG4CPLUS_WARN(KinesisVideoLogger::getInstance(), msg);
-#define LOG_ERROR(msg)   LOG4CPLUS_ERROR(KinesisVideoLogger::getInstance(), msg);
-#define LOG_FATAL(msg)   LOG4CPLUS_FATAL(KinesisVideoLogger::getInstance(), msg);
+#if KVS_MIN_LOG_LEVEL > KVS_LOG_LEVEL_TRACE
+#define LOG_TRACE(msg)   _LOG_COMPILED_OUT(msg);
+#else
+#define LOG_TRACE(msg)   _LOG_AT_LEVEL(log4cplus::TRACE_LOG_LEVEL, LOG4CPLUS_TRACE, msg);
+#endif
+#if KVS_MIN_LOG_LEVEL > KVS_LOG_LEVEL_DEBUG
+#define LOG_DEBUG(msg)   _LOG_COMPILED_OUT(msg);
+#else
+#define LOG_DEBUG(msg)   _LOG_AT_LEVEL(log4cplus::DEBUG_LOG_LEVEL, LOG4CPLUS_DEBUG, msg);
+#endif
+#if KVS_MIN_LOG_LEVEL > KVS_LOG_LEVEL_INFO
+#define LOG_INFO(msg)    _LOG_COMPILED_OUT(msg);
+#else
+#define LOG_INFO(msg)    _LOG_AT_LEVEL(log4cplus::INFO_LOG_LEVEL, LOG4CPLUS_INFO, msg);
+#endif
+#define LOG_WARN(msg)    _LOG_AT_LEVEL(log4cplus::WARN_LOG_LEVEL, LOG4CPLUS_WARN, msg);
+#define LOG_ERROR(msg)   _LOG_AT_LEVEL(log4cplus::ERROR_LOG_LEVEL, LOG4CPLUS_ERROR, msg);
+#define LOG_FATAL(msg)   _LOG_AT_LEVEL(log4cplus::FATAL_LOG_LEVEL, LOG4CPLUS_FATAL, msg);
+
+// turns on/off the asynchronous log backend. ring_capacity is the number of records buffered per logging thread.
+#define LOG_START_ASYNC(ring_capacity) ::com::amazonaws::kinesis::video::AsyncLogger::getInstance().start(ring_capacity)
+#define LOG_STOP_ASYNC() ::com::amazonaws::kinesis::video::AsyncLogger::getInstance().stop()
+
+// per call site rate limited logging. at most one message is logged per period and the number of
+// the messages suppressed in the meantime is appended to the next logged message.
+#define _LOG_RATE_LIMITED(log_macro, period_millis, msg) \
+  do { \
+    static ::com::amazonaws::kinesis::video::LogRateLimiter __rate_limiter(period_millis); \
+    uint64_t __suppressed = 0; \
+    if (__rate_limiter.tryAcquire(__suppressed)) { \
+      if (0 == __suppressed) { \
+        log_macro(msg); \
+      } else { \
+        log_macro(msg << " (" << __suppressed << " similar messages suppressed)"); \
+      } \
+    } \
+  } while (0)
+
+#define LOG_INFO_RATE_LIMITED(period_millis, msg)   _LOG_RATE_LIMITED(LOG_INFO, period_millis, msg);
+#define LOG_WARN_RATE_LIMITED(period_millis, msg)   _LOG_RATE_LIMITED(LOG_WARN, period_millis, msg);
+#define LOG_ERROR_RATE_LIMITED(period_millis, msg)  _LOG_RATE_LIMITED(LOG_ERROR, period_millis, msg);
 
 #define LOG_AND_THROW(msg) \
   do { \
@@ -79,6 +165,40 @@ namespace com { namespace amazonaws { namespace kinesis { namespace video {
   ASSERT_MSG(cond, "Assertion failed");
 
 
+/**
+ * Lock-free per call site log rate limiter backing the LOG_*_RATE_LIMITED macros
+ */
+class LogRateLimiter {
+public:
+    explicit LogRateLimiter(uint64_t period_millis)
+            : period_(std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::milliseconds(period_millis)).count()),
+              next_allowed_time_(0),
+              suppressed_(0) {
+    }
+
+    /**
+     * @param suppressed Set to the number of the messages suppressed since the last allowed one.
+     * @return true if the message is to be logged and false if it's suppressed.
+     */
+    bool tryAcquire(uint64_t& suppressed) {
+        int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
+        int64_t next_allowed_time = next_allowed_time_.load(std::memory_order_relaxed);
+        if (now < next_allowed_time ||
+            !next_allowed_time_.compare_exchange_strong(next_allowed_time, now + period_, std::memory_order_relaxed)) {
+            suppressed_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        suppressed = suppressed_.exchange(0, std::memory_order_relaxed);
+        return true;
+    }
+
+private:
+    const int64_t period_;
+    std::atomic<int64_t> next_allowed_time_;
+    std::atomic<uint64_t> suppressed_;
+};
+
 // defines a class which contains a logger instance with the given tag
 #define LOGGER_TAG(tag) \
   struct KinesisVideoLogger { \
@@ -0,0 +1,241 @@
+#include "NalScanner.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define NAL_SCANNER_X86
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define NAL_SCANNER_NEON
+#include <arm_neon.h>
+#endif
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+/**
+ * H.264 NAL unit types
+ */
+#define H264_NAL_TYPE_SLICE 1
+#define H264_NAL_TYPE_SLICE_PARTITION_C 4
+#define H264_NAL_TYPE_IDR_SLICE 5
+#define H264_NAL_TYPE_SPS 7
+#define H264_NAL_TYPE_PPS 8
+
+/**
+ * H.265 NAL unit types
+ */
+#define H265_NAL_TYPE_RSV_VCL_N14 14
+#define H265_NAL_TYPE_BLA_W_LP 16
+#define H265_NAL_TYPE_CRA 21
+#define H265_NAL_TYPE_VPS 32
+#define H265_NAL_TYPE_SPS 33
+#define H265_NAL_TYPE_PPS 34
+
+namespace {
+
+#if defined(NAL_SCANNER_X86)
+
+/**
+ * The vectors are compared at the offsets of the three start code bytes so that a set bit of the mask
+ * is the start of the start code. A match in the last lanes reads two bytes past the vector.
+ */
+__attribute__((target("sse2"))) size_t findStartCodeSse2(const uint8_t* data, size_t size, size_t offset) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi8(1);
+    size_t i = offset;
+    for (; i + sizeof(__m128i) + 2 <= size; i += sizeof(__m128i)) {
+        __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 1));
+        __m128i third = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 2));
+        __m128i match = _mm_and_si128(_mm_and_si128(_mm_cmpeq_epi8(first, zero), _mm_cmpeq_epi8(second, zero)),
+                                      _mm_cmpeq_epi8(third, one));
+        int mask = _mm_movemask_epi8(match);
+        if (0 != mask) {
+            return i + __builtin_ctz((unsigned int) mask);
+        }
+    }
+
+    return NalScanner::findStartCodeScalar(data, size, i);
+}
+
+__attribute__((target("avx2"))) size_t findStartCodeAvx2(const uint8_t* data, size_t size, size_t offset) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi8(1);
+    size_t i = offset;
+    for (; i + sizeof(__m256i) + 2 <= size; i += sizeof(__m256i)) {
+        __m256i first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        __m256i second = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + 1));
+        __m256i third = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + 2));
+        __m256i match = _mm256_and_si256(_mm256_and_si256(_mm256_cmpeq_epi8(first, zero), _mm256_cmpeq_epi8(second, zero)),
+                                         _mm256_cmpeq_epi8(third, one));
+        unsigned int mask = (unsigned int) _mm256_movemask_epi8(match);
+        if (0 != mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+
+    return NalScanner::findStartCodeScalar(data, size, i);
+}
+
+#elif defined(NAL_SCANNER_NEON)
+
+size_t findStartCodeNeon(const uint8_t* data, size_t size, size_t offset) {
+    const uint8x16_t zero = vdupq_n_u8(0);
+    const uint8x16_t one = vdupq_n_u8(1);
+    size_t i = offset;
+    for (; i + sizeof(uint8x16_t) + 2 <= size; i += sizeof(uint8x16_t)) {
+        uint8x16_t match = vandq_u8(vandq_u8(vceqq_u8(vld1q_u8(data + i), zero), vceqq_u8(vld1q_u8(data + i + 1), zero)),
+                                    vceqq_u8(vld1q_u8(data + i + 2), one));
+
+        // NEON has no move mask so the vector with a match is searched again
+        if (0 != vmaxvq_u8(match)) {
+            return NalScanner::findStartCodeScalar(data, i + sizeof(uint8x16_t) + 2, i);
+        }
+    }
+
+    return NalScanner::findStartCodeScalar(data, size, i);
+}
+
+#endif
+
+const StartCodeSearch& getStartCodeSearch() {
+    static const StartCodeSearch start_code_search = NalScanner::getSupportedStartCodeSearches().front();
+    return start_code_search;
+}
+
+void appendParameterSets(NAL_CODEC codec, const std::vector<NalUnit>& nal_units, uint8_t nal_unit_type, std::vector<uint8_t>& codec_private_data) {
+    static const uint8_t start_code[] = {0x00, 0x00, 0x00, 0x01};
+    for (const auto& nal_unit : nal_units) {
+        if (nal_unit_type == NalScanner::getNalUnitType(codec, nal_unit)) {
+            codec_private_data.insert(codec_private_data.end(), start_code, start_code + sizeof(start_code));
+            codec_private_data.insert(codec_private_data.end(), nal_unit.data, nal_unit.data + nal_unit.size);
+        }
+    }
+}
+
+} // namespace
+
+size_t NalScanner::findStartCode(const uint8_t* data, size_t size, size_t offset) {
+    return getStartCodeSearch().find(data, size, offset);
+}
+
+size_t NalScanner::findStartCodeScalar(const uint8_t* data, size_t size, size_t offset) {
+    for (size_t i = offset; i + 2 < size; i++) {
+        if (0x00 == data[i] && 0x00 == data[i + 1] && 0x01 == data[i + 2]) {
+            return i;
+        }
+    }
+
+    return size;
+}
+
+const char* NalScanner::getImplementationName() {
+    return getStartCodeSearch().name;
+}
+
+std::vector<StartCodeSearch> NalScanner::getSupportedStartCodeSearches() {
+    std::vector<StartCodeSearch> start_code_searches;
+#if defined(NAL_SCANNER_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        start_code_searches.push_back(StartCodeSearch{findStartCodeAvx2, "avx2"});
+    }
+
+    if (__builtin_cpu_supports("sse2")) {
+        start_code_searches.push_back(StartCodeSearch{findStartCodeSse2, "sse2"});
+    }
+#elif defined(NAL_SCANNER_NEON)
+    start_code_searches.push_back(StartCodeSearch{findStartCodeNeon, "neon"});
+#endif
+
+    start_code_searches.push_back(StartCodeSearch{findStartCodeScalar, "scalar"});
+    return start_code_searches;
+}
+
+void NalScanner::split(const uint8_t* data, size_t size, std::vector<NalUnit>& nal_units) {
+    nal_units.clear();
+    size_t start_code = findStartCode(data, size, 0);
+    while (start_code < size) {
+        size_t nal_start = start_code + ANNEX_B_START_CODE_SIZE;
+        start_code = findStartCode(data, size, nal_start);
+
+        // The zero byte of the four byte start codes and the trailing zeros are not part of the NAL unit
+        size_t nal_end = start_code;
+        while (nal_end > nal_start && 0x00 == data[nal_end - 1]) {
+            nal_end--;
+        }
+
+        if (nal_end > nal_start) {
+            nal_units.push_back(NalUnit{data + nal_start, nal_end - nal_start});
+        }
+    }
+}
+
+uint8_t NalScanner::getNalUnitType(NAL_CODEC codec, const NalUnit& nal_unit) {
+    if (0 == nal_unit.size) {
+        return 0;
+    }
+
+    return NAL_CODEC_H265 == codec ? (uint8_t) ((nal_unit.data[0] >> 1) & 0x3f) : (uint8_t) (nal_unit.data[0] & 0x1f);
+}
+
+NAL_SLICE_TYPE NalScanner::classifySlice(NAL_CODEC codec, const NalUnit& nal_unit) {
+    if (0 == nal_unit.size) {
+        return NAL_SLICE_TYPE_NONE;
+    }
+
+    uint8_t nal_unit_type = getNalUnitType(codec, nal_unit);
+    if (NAL_CODEC_H265 == codec) {
+        if (nal_unit_type >= H265_NAL_TYPE_BLA_W_LP && nal_unit_type <= H265_NAL_TYPE_CRA) {
+            return NAL_SLICE_TYPE_IDR;
+        }
+
+        return nal_unit_type < H265_NAL_TYPE_RSV_VCL_N14 ? NAL_SLICE_TYPE_NON_IDR : NAL_SLICE_TYPE_NONE;
+    }
+
+    if (H264_NAL_TYPE_IDR_SLICE == nal_unit_type) {
+        return NAL_SLICE_TYPE_IDR;
+    }
+
+    return nal_unit_type >= H264_NAL_TYPE_SLICE && nal_unit_type <= H264_NAL_TYPE_SLICE_PARTITION_C ? NAL_SLICE_TYPE_NON_IDR : NAL_SLICE_TYPE_NONE;
+}
+
+bool NalScanner::isKeyFrame(NAL_CODEC codec, const std::vector<NalUnit>& nal_units) {
+    for (const auto& nal_unit : nal_units) {
+        if (NAL_SLICE_TYPE_IDR == classifySlice(codec, nal_unit)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool NalScanner::extractCodecPrivateData(NAL_CODEC codec, const std::vector<NalUnit>& nal_units, std::vector<uint8_t>& codec_private_data) {
+    codec_private_data.clear();
+
+    if (NAL_CODEC_H265 == codec) {
+        appendParameterSets(codec, nal_units, H265_NAL_TYPE_VPS, codec_private_data);
+        bool has_vps = !codec_private_data.empty();
+        size_t vps_size = codec_private_data.size();
+        appendParameterSets(codec, nal_units, H265_NAL_TYPE_SPS, codec_private_data);
+        bool has_sps = codec_private_data.size() > vps_size;
+        size_t sps_size = codec_private_data.size();
+        appendParameterSets(codec, nal_units, H265_NAL_TYPE_PPS, codec_private_data);
+        if (has_vps && has_sps && codec_private_data.size() > sps_size) {
+            return true;
+        }
+    } else {
+        appendParameterSets(codec, nal_units, H264_NAL_TYPE_SPS, codec_private_data);
+        size_t sps_size = codec_private_data.size();
+        appendParameterSets(codec, nal_units, H264_NAL_TYPE_PPS, codec_private_data);
+        if (0 != sps_size && codec_private_data.size() > sps_size) {
+            return true;
+        }
+    }
+
+    codec_private_data.clear();
+    return false;
+}
+
+} // namespace video
+} // namespace kinesis
+} // namespace amazonaws
+} // namespace com
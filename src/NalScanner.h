@@ -0,0 +1,132 @@
+/** Copyright 2017 Amazon.com. All rights reserved. */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+/**
+ * Length of the short Annex-B start code 00 00 01
+ */
+#define ANNEX_B_START_CODE_SIZE 3
+
+/**
+ * Codecs of the Annex-B elementary streams
+ */
+typedef enum {
+    NAL_CODEC_H264,
+    NAL_CODEC_H265
+} NAL_CODEC;
+
+/**
+ * Slice classification of a NAL unit
+ */
+typedef enum {
+    /**
+     * Not a slice. Parameter sets, SEI, delimiters etc.
+     */
+    NAL_SLICE_TYPE_NONE,
+
+    /**
+     * Random access slice. IDR for H.264 and IRAP (IDR, CRA, BLA) for H.265.
+     */
+    NAL_SLICE_TYPE_IDR,
+
+    NAL_SLICE_TYPE_NON_IDR
+} NAL_SLICE_TYPE;
+
+/**
+ * NAL unit within an access unit without the start code. Points into the access unit.
+ */
+struct NalUnit {
+    const uint8_t* data;
+    size_t size;
+};
+
+/**
+ * Start code search implementation
+ */
+typedef size_t (*FindStartCodeFunc)(const uint8_t* data, size_t size, size_t offset);
+
+struct StartCodeSearch {
+    FindStartCodeFunc find;
+    const char* name;
+};
+
+/**
+ * Annex-B elementary stream scanner.
+ *
+ * Splits the access units into the NAL units, classifies the slices and extracts the in-band parameter sets
+ * as the codec private data so that the raw Annex-B sources can be streamed without the codec_data of
+ * a parser. The start code search is vectorized with AVX2 or SSE2 on x86 and NEON on AArch64, picked at
+ * runtime by the CPU features.
+ */
+class NalScanner {
+public:
+    /**
+     * Finds the next start code
+     *
+     * @param data The access unit.
+     * @param size The access unit size.
+     * @param offset Offset to search from.
+     * @return Offset of the 00 00 01 start code or the size if none.
+     */
+    static size_t findStartCode(const uint8_t* data, size_t size, size_t offset);
+
+    /**
+     * Byte by byte search. The baseline of the vectorized one.
+     *
+     * @copydoc findStartCode()
+     */
+    static size_t findStartCodeScalar(const uint8_t* data, size_t size, size_t offset);
+
+    /**
+     * @return The name of the start code search implementation picked for the CPU.
+     */
+    static const char* getImplementationName();
+
+    /**
+     * @return The start code search implementations the CPU supports, the preferred first. The scalar one is last.
+     */
+    static std::vector<StartCodeSearch> getSupportedStartCodeSearches();
+
+    /**
+     * Splits the access unit into the NAL units. The trailing zero bytes are trimmed.
+     *
+     * @param data The Annex-B access unit.
+     * @param size The access unit size.
+     * @param nal_units Filled with the NAL units. Cleared first.
+     */
+    static void split(const uint8_t* data, size_t size, std::vector<NalUnit>& nal_units);
+
+    /**
+     * @return The NAL unit type from the NAL unit header.
+     */
+    static uint8_t getNalUnitType(NAL_CODEC codec, const NalUnit& nal_unit);
+
+    static NAL_SLICE_TYPE classifySlice(NAL_CODEC codec, const NalUnit& nal_unit);
+
+    /**
+     * @return Whether the access unit has a random access slice.
+     */
+    static bool isKeyFrame(NAL_CODEC codec, const std::vector<NalUnit>& nal_units);
+
+    /**
+     * Builds the Annex-B codec private data out of the in-band parameter sets. The Kinesis Video PIC adapts
+     * it with the NAL_ADAPTATION_ANNEXB_CPD_NALS flag.
+     *
+     * @param codec The codec of the stream.
+     * @param nal_units The NAL units of the access unit.
+     * @param codec_private_data Set to the VPS (H.265 only), SPS and PPS with the start codes.
+     * @return Whether all of the parameter sets are present.
+     */
+    static bool extractCodecPrivateData(NAL_CODEC codec, const std::vector<NalUnit>& nal_units, std::vector<uint8_t>& codec_private_data);
+};
+
+} // namespace video
+} // namespace kinesis
+} // namespace amazonaws
+} // namespace com
@@ -0,0 +1,412 @@
+#include "Logger.h"
+#include "OpenMetricsExporter.h"
+#include "SdkThread.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#if !defined(_WIN32)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+LOGGER_TAG("com.amazonaws.kinesis.video");
+
+using std::string;
+using std::stringstream;
+using std::ostream;
+using std::vector;
+
+/**
+ * How often the HTTP thread checks for the exit while awaiting the connections
+ */
+#define OPEN_METRICS_EXPORTER_POLL_TIMEOUT_MILLIS 200
+
+/**
+ * Maximum size of the HTTP request read. Only the request line is of interest.
+ */
+#define OPEN_METRICS_EXPORTER_MAX_REQUEST_SIZE 4096
+
+/**
+ * Longest time a client is waited on to send the request or take the response. Bounds the stop as the
+ * clients are served on the HTTP thread.
+ */
+#define OPEN_METRICS_EXPORTER_CLIENT_TIMEOUT_MILLIS 2000
+
+#define OPEN_METRICS_CONTENT_TYPE "application/openmetrics-text; version=1.0.0; charset=utf-8"
+
+namespace {
+
+string escapeLabelValue(const string& value) {
+    string escaped;
+    escaped.reserve(value.size());
+    for (char c : value) {
+        switch (c) {
+            case '\\':
+                escaped += "\\\\";
+                break;
+            case '"':
+                escaped += "\\\"";
+                break;
+            case '\n':
+                escaped += "\\n";
+                break;
+            default:
+                escaped += c;
+        }
+    }
+
+    return escaped;
+}
+
+void writeFamily(ostream& out, const char* name, const char* type, const char* unit, const char* help) {
+    out << "# TYPE " << name << " " << type << "\n";
+    if (nullptr != unit) {
+        out << "# UNIT " << name << " " << unit << "\n";
+    }
+
+    out << "# HELP " << name << " " << help << "\n";
+}
+
+template <typename T> void writeSample(ostream& out, const char* name, const string& labels, T value) {
+    out << name;
+    if (!labels.empty()) {
+        out << "{" << labels << "}";
+    }
+
+    out << " " << value << "\n";
+}
+
+/**
+ * Stream series are rendered family by family as OpenMetrics requires the samples of a family to be contiguous
+ */
+struct StreamSeries {
+    string labels;
+    KinesisVideoStreamMetrics metrics;
+};
+
+template <typename F> void writeStreamGauge(ostream& out, const vector<StreamSeries>& series, const char* name,
+                                            const char* unit, const char* help, F value) {
+    writeFamily(out, name, "gauge", unit, help);
+    for (const auto& stream : series) {
+        writeSample(out, name, stream.labels, value(stream.metrics));
+    }
+}
+
+void writeStreamLatency(ostream& out, const vector<StreamSeries>& series, const char* name, const char* help,
+                        const LatencyPercentiles& (KinesisVideoStreamMetrics::*getter)() const) {
+    static const struct {
+        const char* quantile;
+        std::chrono::microseconds LatencyPercentiles::*value;
+    } quantiles[] = {
+            {"0.5", &LatencyPercentiles::p50},
+            {"0.9", &LatencyPercentiles::p90},
+            {"0.99", &LatencyPercentiles::p99},
+            {"0.999", &LatencyPercentiles::p999},
+    };
+
+    writeFamily(out, name, "summary", "seconds", help);
+    string count_name = string(name) + "_count";
+    for (const auto& stream : series) {
+        const LatencyPercentiles& percentiles = (stream.metrics.*getter)();
+        for (const auto& quantile : quantiles) {
+            writeSample(out, name, stream.labels + ",quantile=\"" + quantile.quantile + "\"",
+                        (double) (percentiles.*quantile.value).count() / 1000000);
+        }
+
+        writeSample(out, count_name.c_str(), stream.labels, percentiles.count);
+    }
+}
+
+} // namespace
+
+OpenMetricsExporter::OpenMetricsExporter(const KinesisVideoProducer& kinesis_video_producer)
+        : kinesis_video_producer_(kinesis_video_producer),
+          exporter_exit_(false),
+          listen_socket_(-1),
+          file_period_(OPEN_METRICS_EXPORTER_DEFAULT_FILE_PERIOD_MILLIS) {
+}
+
+OpenMetricsExporter::~OpenMetricsExporter() {
+    stop();
+}
+
+string OpenMetricsExporter::render() const {
+    stringstream out;
+    KinesisVideoProducerMetrics client_metrics = kinesis_video_producer_.getMetricsSnapshot();
+
+    writeFamily(out, "kvs_producer_content_store_size_bytes", "gauge", "bytes", "Overall content store size.");
+    writeSample(out, "kvs_producer_content_store_size_bytes", "", client_metrics.getContentStoreSizeSize());
+    writeFamily(out, "kvs_producer_content_store_available_bytes", "gauge", "bytes", "Available content store size.");
+    writeSample(out, "kvs_producer_content_store_available_bytes", "", client_metrics.getContentStoreAvailableSize());
+    writeFamily(out, "kvs_producer_content_store_allocated_bytes", "gauge", "bytes", "Allocated content store size.");
+    writeSample(out, "kvs_producer_content_store_allocated_bytes", "", client_metrics.getContentStoreAllocatedSize());
+    writeFamily(out, "kvs_producer_content_views_bytes", "gauge", "bytes", "Total content view allocation size.");
+    writeSample(out, "kvs_producer_content_views_bytes", "", client_metrics.getTotalContentViewsSize());
+    writeFamily(out, "kvs_producer_content_store_spilled_bytes", "gauge", "bytes", "Content spilled to the files of the hybrid file storage.");
+    writeSample(out, "kvs_producer_content_store_spilled_bytes", "", client_metrics.getContentStoreSpilledSize());
+    writeFamily(out, "kvs_producer_content_store_spill_rate_bytes_per_second", "gauge", nullptr, "Rate the content spills to the files of the hybrid file storage.");
+    writeSample(out, "kvs_producer_content_store_spill_rate_bytes_per_second", "", client_metrics.getContentStoreSpillRate());
+    writeFamily(out, "kvs_producer_content_store_fill_rate_bytes_per_second", "gauge", nullptr, "Content store fill rate net of the upload.");
+    writeSample(out, "kvs_producer_content_store_fill_rate_bytes_per_second", "", client_metrics.getContentStoreFillRate());
+    if (client_metrics.getContentStoreTimeToFull() != std::chrono::seconds::max()) {
+        writeFamily(out, "kvs_producer_content_store_time_to_full_seconds", "gauge", "seconds", "Estimated time until the content store is full.");
+        writeSample(out, "kvs_producer_content_store_time_to_full_seconds", "", client_metrics.getContentStoreTimeToFull().count());
+    }
+    writeFamily(out, "kvs_producer_frame_rate", "gauge", nullptr, "Total frame rate of the streams in frames per second.");
+    writeSample(out, "kvs_producer_frame_rate", "", client_metrics.getTotalFrameRate());
+    writeFamily(out, "kvs_producer_elementary_frame_rate", "gauge", nullptr, "Total elementary frame rate of the streams in frames per second.");
+    writeSample(out, "kvs_producer_elementary_frame_rate", "", client_metrics.getTotalElementaryFrameRate());
+    writeFamily(out, "kvs_producer_transfer_rate_bytes_per_second", "gauge", nullptr, "Total transfer rate of the streams.");
+    writeSample(out, "kvs_producer_transfer_rate_bytes_per_second", "", client_metrics.getTotalTransferRate());
+
+    vector<StreamSeries> series;
+    for (auto& stream : kinesis_video_producer_.getActiveStreams()) {
+        StreamSeries stream_series;
+        stream_series.labels = "stream=\"" + escapeLabelValue(stream->getStreamName()) + "\"";
+        stream_series.metrics = stream->getMetricsSnapshot();
+        series.push_back(stream_series);
+    }
+
+    writeStreamGauge(out, series, "kvs_stream_current_view_duration_seconds", "seconds", "Current view duration.",
+                     [](const KinesisVideoStreamMetrics& metrics) { return (double) metrics.getCurrentViewDuration().count() / 1000; });
+    writeStreamGauge(out, series, "kvs_stream_overall_view_duration_seconds", "seconds", "Overall view duration.",
+                     [](const KinesisVideoStreamMetrics& metrics) { return (double) metrics.getOverallViewDuration().count() / 1000; });
+    writeStreamGauge(out, series, "kvs_stream_current_view_bytes", "bytes", "Current view size.",
+                     [](const KinesisVideoStreamMetrics& metrics) { return metrics.getCurrentViewSize(); });
+    writeStreamGauge(out, series, "kvs_stream_overall_view_bytes", "bytes", "Overall view size.",
+                     [](const KinesisVideoStreamMetrics& metrics) { return metrics.getOverallViewSize(); });
+    writeStreamGauge(out, series, "kvs_stream_frame_rate", nullptr, "Observed frame rate in frames per second.",
+                     [](const KinesisVideoStreamMetrics& metrics) { return metrics.getCurrentFrameRate(); });
+    writeStreamGauge(out, series, "kvs_stream_elementary_frame_rate", nullptr, "Elementary stream frame rate in frames per second.",
+                     [](const KinesisVideoStreamMetrics& metrics) { return metrics.getCurrentElementaryFrameRate(); });
+    writeStreamGauge(out, series, "kvs_stream_transfer_rate_bytes_per_second", nullptr, "Observed transfer rate.",
+                     [](const KinesisVideoStreamMetrics& metrics) { return metrics.getCurrentTransferRate(); });
+    writeStreamGauge(out, series, "kvs_stream_ingest_queue_depth", nullptr, "Frames awaiting submission in the asynchronous ingest queue.",
+                     [](const KinesisVideoStreamMetrics& metrics) { return metrics.getIngestQueueDepth(); });
+
+    writeFamily(out, "kvs_stream_ingest_queue_dropped_frames", "counter", nullptr, "Frames dropped due to the asynchronous ingest queue overflow.");
+    for (const auto& stream : series) {
+        writeSample(out, "kvs_stream_ingest_queue_dropped_frames_total", stream.labels, stream.metrics.getIngestQueueDroppedFrames());
+    }
+
+    writeStreamGauge(out, series, "kvs_stream_frame_shedding_level", nullptr, "Frame shedding level. 0 if not shedding.",
+                     [](const KinesisVideoStreamMetrics& metrics) { return metrics.getFrameSheddingLevel(); });
+    writeFamily(out, "kvs_stream_shed_frames", "counter", nullptr, "Frames shed under the pressure by the shedding level.");
+    for (const auto& stream : series) {
+        writeSample(out, "kvs_stream_shed_frames_total", stream.labels + ",level=\"non_reference\"", stream.metrics.getShedNonReferenceFrames());
+        writeSample(out, "kvs_stream_shed_frames_total", stream.labels + ",level=\"secondary_tracks\"", stream.metrics.getShedSecondaryTrackFrames());
+        writeSample(out, "kvs_stream_shed_frames_total", stream.labels + ",level=\"key_frame_only\"", stream.metrics.getShedKeyFrameOnlyFrames());
+    }
+
+    writeStreamLatency(out, series, "kvs_stream_put_frame_latency_seconds", "putFrame call duration.",
+                       &KinesisVideoStreamMetrics::getPutFrameLatency);
+    writeStreamLatency(out, series, "kvs_stream_buffering_ack_latency_seconds", "Time from the fragment key frame put to the buffering ack.",
+                       &KinesisVideoStreamMetrics::getBufferingAckLatency);
+    writeStreamLatency(out, series, "kvs_stream_received_ack_latency_seconds", "Time from the fragment key frame put to the received ack.",
+                       &KinesisVideoStreamMetrics::getReceivedAckLatency);
+    writeStreamLatency(out, series, "kvs_stream_persisted_ack_latency_seconds", "Time from the fragment key frame put to the persisted ack.",
+                       &KinesisVideoStreamMetrics::getPersistedAckLatency);
+
+    writeFamily(out, "kvs_thread_cpu_seconds", "counter", "seconds", "CPU time of the SDK threads. Exited threads are totalled by name with tid 0.");
+    for (const auto& thread_cpu_time : kinesis_video_producer_.getThreadCpuTimes()) {
+        writeSample(out, "kvs_thread_cpu_seconds_total",
+                    "thread=\"" + escapeLabelValue(thread_cpu_time.name) + "\",tid=\"" + std::to_string(thread_cpu_time.thread_id) + "\"",
+                    (double) thread_cpu_time.cpu_time.count() / 1000000000);
+    }
+
+    out << "# EOF\n";
+    return out.str();
+}
+
+bool OpenMetricsExporter::startTextFile(const string& file_path, std::chrono::milliseconds period) {
+    if (exporter_thread_.joinable()) {
+        LOG_ERROR("Metrics exporter is already running");
+        return false;
+    }
+
+    if (file_path.empty() || 0 == period.count()) {
+        LOG_ERROR("Invalid metrics exporter file path or period");
+        return false;
+    }
+
+    file_path_ = file_path;
+    file_period_ = period;
+    exporter_exit_ = false;
+    exporter_thread_ = SdkThread::start("om-file", [this]() { textFileRoutine(); });
+
+    LOG_INFO("Exporting metrics into " << file_path_ << " every " << file_period_.count() << " ms");
+    return true;
+}
+
+void OpenMetricsExporter::textFileRoutine() {
+    std::unique_lock<std::mutex> lock(exporter_mutex_);
+    while (!exporter_exit_) {
+        lock.unlock();
+        if (!writeTextFile()) {
+            LOG_WARN("Failed to write the metrics into " << file_path_);
+        }
+
+        lock.lock();
+        exporter_cv_.wait_for(lock, file_period_, [this]() { return exporter_exit_.load(); });
+    }
+}
+
+bool OpenMetricsExporter::writeTextFile() const {
+    // The collector may read the file at any time so write aside and rename over
+    string temp_file_path = file_path_ + ".tmp";
+    {
+        std::ofstream out(temp_file_path, std::ios::out | std::ios::trunc);
+        if (!out) {
+            return false;
+        }
+
+        out << render();
+        if (!out.flush()) {
+            return false;
+        }
+    }
+
+    return 0 == std::rename(temp_file_path.c_str(), file_path_.c_str());
+}
+
+#if defined(_WIN32)
+
+bool OpenMetricsExporter::startHttp(uint16_t port, const string& bind_address) {
+    UNUSED_PARAM(port);
+    UNUSED_PARAM(bind_address);
+    LOG_ERROR("Metrics exporter HTTP mode is not supported on this platform. Use the text file mode instead");
+    return false;
+}
+
+void OpenMetricsExporter::httpRoutine() {
+}
+
+#else
+
+bool OpenMetricsExporter::startHttp(uint16_t port, const string& bind_address) {
+    if (exporter_thread_.joinable()) {
+        LOG_ERROR("Metrics exporter is already running");
+        return false;
+    }
+
+    struct sockaddr_in address;
+    MEMSET(&address, 0x00, SIZEOF(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    if (1 != inet_pton(AF_INET, bind_address.c_str(), &address.sin_addr)) {
+        LOG_ERROR("Invalid metrics exporter bind address " << bind_address);
+        return false;
+    }
+
+    int listen_socket = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_socket < 0) {
+        LOG_ERROR("Failed to create the metrics exporter socket with errno " << errno);
+        return false;
+    }
+
+    int reuse = 1;
+    setsockopt(listen_socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    if (0 != bind(listen_socket, (struct sockaddr*) &address, sizeof(address)) || 0 != listen(listen_socket, SOMAXCONN)) {
+        LOG_ERROR("Failed to listen on " << bind_address << ":" << port << " with errno " << errno);
+        close(listen_socket);
+        return false;
+    }
+
+    listen_socket_ = listen_socket;
+    exporter_exit_ = false;
+    exporter_thread_ = SdkThread::start("om-http", [this]() { httpRoutine(); });
+
+    LOG_INFO("Serving metrics on http://" << bind_address << ":" << port << OPEN_METRICS_EXPORTER_HTTP_PATH);
+    return true;
+}
+
+void OpenMetricsExporter::httpRoutine() {
+    char request[OPEN_METRICS_EXPORTER_MAX_REQUEST_SIZE];
+
+    while (!exporter_exit_) {
+        struct pollfd poll_fd;
+        poll_fd.fd = listen_socket_;
+        poll_fd.events = POLLIN;
+        if (poll(&poll_fd, 1, OPEN_METRICS_EXPORTER_POLL_TIMEOUT_MILLIS) <= 0) {
+            continue;
+        }
+
+        int client_socket = accept(listen_socket_, nullptr, nullptr);
+        if (client_socket < 0) {
+            continue;
+        }
+
+        // A client which connects and never sends must not hold up the thread
+        struct timeval client_timeout;
+        client_timeout.tv_sec = OPEN_METRICS_EXPORTER_CLIENT_TIMEOUT_MILLIS / 1000;
+        client_timeout.tv_usec = (OPEN_METRICS_EXPORTER_CLIENT_TIMEOUT_MILLIS % 1000) * 1000;
+        setsockopt(client_socket, SOL_SOCKET, SO_RCVTIMEO, &client_timeout, sizeof(client_timeout));
+        setsockopt(client_socket, SOL_SOCKET, SO_SNDTIMEO, &client_timeout, sizeof(client_timeout));
+
+        // The scrapers send small requests - a single read covers the request line
+        ssize_t read_size = recv(client_socket, request, SIZEOF(request) - 1, 0);
+        string response;
+        if (read_size > 0) {
+            request[read_size] = '\0';
+            string request_line(request, strcspn(request, "\r\n"));
+            if (0 == request_line.find("GET " OPEN_METRICS_EXPORTER_HTTP_PATH " ") ||
+                0 == request_line.find("GET " OPEN_METRICS_EXPORTER_HTTP_PATH "?")) {
+                string body = render();
+                stringstream header;
+                header << "HTTP/1.1 200 OK\r\n"
+                       << "Content-Type: " << OPEN_METRICS_CONTENT_TYPE << "\r\n"
+                       << "Content-Length: " << body.size() << "\r\n"
+                       << "Connection: close\r\n\r\n";
+                response = header.str() + body;
+            } else {
+                response = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+            }
+        }
+
+        size_t sent = 0;
+        while (sent < response.size() && !exporter_exit_) {
+            ssize_t sent_size = send(client_socket, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+            if (sent_size <= 0) {
+                break;
+            }
+
+            sent += (size_t) sent_size;
+        }
+
+        close(client_socket);
+    }
+
+    close(listen_socket_);
+    listen_socket_ = -1;
+}
+
+#endif
+
+void OpenMetricsExporter::stop() {
+    if (!exporter_thread_.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(exporter_mutex_);
+        exporter_exit_ = true;
+        exporter_cv_.notify_all();
+    }
+
+    exporter_thread_.join();
+}
+
+} // namespace video
+} // namespace kinesis
+} // namespace amazonaws
+} // namespace com
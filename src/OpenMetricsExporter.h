@@ -0,0 +1,108 @@
+/** Copyright 2017 Amazon.com. All rights reserved. */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "KinesisVideoProducer.h"
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+/**
+ * Default HTTP bind address. Only the local scrapers are served by default.
+ */
+#define OPEN_METRICS_EXPORTER_DEFAULT_BIND_ADDRESS "127.0.0.1"
+
+/**
+ * Path served over HTTP
+ */
+#define OPEN_METRICS_EXPORTER_HTTP_PATH "/metrics"
+
+/**
+ * Default period of the text file rendering
+ */
+#define OPEN_METRICS_EXPORTER_DEFAULT_FILE_PERIOD_MILLIS 15000
+
+/**
+ * Exports the producer and the stream metrics in the OpenMetrics text format either over
+ * a local HTTP endpoint or by periodically writing a text file for the node_exporter textfile collector.
+ *
+ * The exporter renders the metrics snapshots published by the producer metrics sampler and never
+ * calls into the Kinesis Video PIC. The series are as fresh as the producer metrics sampling period.
+ * Every stream series is labeled with the stream name.
+ *
+ * Example Usage:
+ * @code:
+ * OpenMetricsExporter exporter(*kinesis_video_producer);
+ * exporter.startHttp(9464);
+ * ...
+ * exporter.stop();
+ * @endcode
+ *
+ * NOTE: The exporter must be stopped before the producer is destroyed.
+ */
+class OpenMetricsExporter {
+public:
+    explicit OpenMetricsExporter(const KinesisVideoProducer& kinesis_video_producer);
+
+    ~OpenMetricsExporter();
+
+    /**
+     * Starts serving the metrics over HTTP.
+     *
+     * @param port The port to listen on.
+     * @param bind_address The address to bind to.
+     * @return true if the exporter has been started and false otherwise.
+     */
+    bool startHttp(uint16_t port, const std::string& bind_address = OPEN_METRICS_EXPORTER_DEFAULT_BIND_ADDRESS);
+
+    /**
+     * Starts writing the metrics into a text file. The file is replaced atomically on every write.
+     *
+     * @param file_path The file to write. Should have the .prom extension for the textfile collector.
+     * @param period The write period.
+     * @return true if the exporter has been started and false otherwise.
+     */
+    bool startTextFile(const std::string& file_path,
+                       std::chrono::milliseconds period = std::chrono::milliseconds(OPEN_METRICS_EXPORTER_DEFAULT_FILE_PERIOD_MILLIS));
+
+    /**
+     * Stops the exporter. Idempotent.
+     */
+    void stop();
+
+    /**
+     * Renders the current metrics snapshots in the OpenMetrics text format
+     */
+    std::string render() const;
+
+private:
+    void httpRoutine();
+    void textFileRoutine();
+    bool writeTextFile() const;
+
+    const KinesisVideoProducer& kinesis_video_producer_;
+
+    std::thread exporter_thread_;
+    std::mutex exporter_mutex_;
+    std::condition_variable exporter_cv_;
+    std::atomic<bool> exporter_exit_;
+
+    /**
+     * Listening socket in the HTTP mode, -1 otherwise
+     */
+    int listen_socket_;
+
+    std::string file_path_;
+    std::chrono::milliseconds file_period_;
+};
+
+} // namespace video
+} // namespace kinesis
+} // namespace amazonaws
+} // namespace com
@@ -0,0 +1,246 @@
+#include "Logger.h"
+#include "PersistentCache.h"
+#include "GetTime.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+LOGGER_TAG("com.amazonaws.kinesis.video");
+
+using std::string;
+
+namespace {
+
+/**
+ * FNV-1a of the file contents preceding the checksum
+ */
+uint64_t checksum(const char* data, size_t size) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= (uint8_t) data[i];
+        hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+template <typename T> void writeValue(string& buffer, T value) {
+    buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void writeString(string& buffer, const string& value) {
+    writeValue(buffer, (uint32_t) value.size());
+    buffer.append(value);
+}
+
+template <typename T> bool readValue(const string& buffer, size_t& offset, T& value) {
+    if (buffer.size() - offset < sizeof(value)) {
+        return false;
+    }
+
+    memcpy(&value, buffer.data() + offset, sizeof(value));
+    offset += sizeof(value);
+    return true;
+}
+
+bool readString(const string& buffer, size_t& offset, string& value) {
+    uint32_t size;
+    if (!readValue(buffer, offset, size) || buffer.size() - offset < size) {
+        return false;
+    }
+
+    value.assign(buffer.data() + offset, size);
+    offset += size;
+    return true;
+}
+
+#if !defined(_WIN32)
+
+bool writeFully(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0) {
+            if (EINTR == errno) {
+                continue;
+            }
+
+            return false;
+        }
+
+        data += written;
+        size -= (size_t) written;
+    }
+
+    return true;
+}
+
+/**
+ * Syncs the directory holding the file so the rename itself is durable
+ */
+void syncParentDirectory(const string& file_path) {
+    size_t separator = file_path.find_last_of('/');
+    string directory = string::npos == separator ? "." : (0 == separator ? "/" : file_path.substr(0, separator));
+    int fd = ::open(directory.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        ::fsync(fd);
+        ::close(fd);
+    }
+}
+
+#endif
+
+} // namespace
+
+PersistentCache::PersistentCache(const string& file_path) : file_path_(file_path) {
+}
+
+bool PersistentCache::load() {
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    entries_.clear();
+
+    std::ifstream in(file_path_, std::ios::in | std::ios::binary);
+    if (!in) {
+        LOG_DEBUG("Persistent cache " << file_path_ << " doesn't exist");
+        return false;
+    }
+
+    std::stringstream contents;
+    contents << in.rdbuf();
+    const string buffer = contents.str();
+
+    // Everything is validated before the entries are taken
+    size_t offset = PERSISTENT_CACHE_FILE_MAGIC_SIZE;
+    uint32_t version, entry_count;
+    uint64_t stored_checksum;
+    bool valid = buffer.size() >= PERSISTENT_CACHE_FILE_MAGIC_SIZE + sizeof(stored_checksum) &&
+                 0 == memcmp(buffer.data(), PERSISTENT_CACHE_FILE_MAGIC, PERSISTENT_CACHE_FILE_MAGIC_SIZE);
+    if (valid) {
+        size_t checksum_offset = buffer.size() - sizeof(stored_checksum);
+        memcpy(&stored_checksum, buffer.data() + checksum_offset, sizeof(stored_checksum));
+        valid = checksum(buffer.data(), checksum_offset) == stored_checksum &&
+                readValue(buffer, offset, version) && PERSISTENT_CACHE_FILE_VERSION == version &&
+                readValue(buffer, offset, entry_count);
+    }
+
+    std::map<string, PersistentCacheEntry> entries;
+    for (uint32_t i = 0; valid && i < entry_count; i++) {
+        string key;
+        PersistentCacheEntry entry;
+        uint64_t expiration;
+        valid = readString(buffer, offset, key) && readString(buffer, offset, entry.value) &&
+                readValue(buffer, offset, expiration);
+        entry.expiration = std::chrono::duration<uint64_t>(expiration);
+        entries[key] = entry;
+    }
+
+    if (!valid || offset + sizeof(stored_checksum) != buffer.size()) {
+        LOG_WARN("Ignoring invalid persistent cache " << file_path_);
+        return false;
+    }
+
+    entries_.swap(entries);
+    LOG_INFO("Loaded " << entries_.size() << " entries from persistent cache " << file_path_);
+    return true;
+}
+
+bool PersistentCache::get(const string& key, PersistentCacheEntry& entry) const {
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    auto it = entries_.find(key);
+    if (entries_.end() == it) {
+        return false;
+    }
+
+    entry = it->second;
+    return true;
+}
+
+bool PersistentCache::put(const string& key, const string& value, std::chrono::duration<uint64_t> expiration) {
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    PersistentCacheEntry& entry = entries_[key];
+    entry.value = value;
+    entry.expiration = expiration;
+    return persist();
+}
+
+bool PersistentCache::remove(const string& key) {
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    if (0 == entries_.erase(key)) {
+        return true;
+    }
+
+    return persist();
+}
+
+bool PersistentCache::persist() {
+    auto now_time = std::chrono::duration_cast<std::chrono::seconds>(systemCurrentTime().time_since_epoch());
+    for (auto it = entries_.begin(); it != entries_.end();) {
+        if (it->second.expiration <= now_time) {
+            it = entries_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    string buffer(PERSISTENT_CACHE_FILE_MAGIC, PERSISTENT_CACHE_FILE_MAGIC_SIZE);
+    writeValue(buffer, (uint32_t) PERSISTENT_CACHE_FILE_VERSION);
+    writeValue(buffer, (uint32_t) entries_.size());
+    for (const auto& entry : entries_) {
+        writeString(buffer, entry.first);
+        writeString(buffer, entry.second.value);
+        writeValue(buffer, (uint64_t) entry.second.expiration.count());
+    }
+
+    writeValue(buffer, checksum(buffer.data(), buffer.size()));
+
+    // The processes sharing the cache file each write their own temporary file so the renames never interleave
+    // the writes of two of them. The last rename wins.
+    std::stringstream temp_file_path;
+#if !defined(_WIN32)
+    temp_file_path << file_path_ << ".tmp." << ::getpid();
+    int fd = ::open(temp_file_path.str().c_str(), O_WRONLY | O_CREAT | O_TRUNC, PERSISTENT_CACHE_FILE_MODE);
+    if (fd < 0) {
+        LOG_ERROR("Failed to open the persistent cache file " << temp_file_path.str() << " errno " << errno);
+        return false;
+    }
+
+    bool written = writeFully(fd, buffer.data(), buffer.size()) && 0 == ::fsync(fd);
+    ::close(fd);
+#else
+    temp_file_path << file_path_ << ".tmp";
+    bool written;
+    {
+        std::ofstream out(temp_file_path.str(), std::ios::out | std::ios::trunc | std::ios::binary);
+        written = out.write(buffer.data(), buffer.size()) && out.flush();
+    }
+
+    // Rename doesn't replace the existing files on Windows
+    std::remove(file_path_.c_str());
+#endif
+
+    if (!written || 0 != std::rename(temp_file_path.str().c_str(), file_path_.c_str())) {
+        LOG_ERROR("Failed to write the persistent cache file " << file_path_);
+        std::remove(temp_file_path.str().c_str());
+        return false;
+    }
+
+#if !defined(_WIN32)
+    syncParentDirectory(file_path_);
+#endif
+
+    return true;
+}
+
+} // namespace video
+} // namespace kinesis
+} // namespace amazonaws
+} // namespace com
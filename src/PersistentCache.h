@@ -0,0 +1,109 @@
+/** Copyright 2017 Amazon.com. All rights reserved. */
+
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+/**
+ * Persistent cache file magic
+ */
+#define PERSISTENT_CACHE_FILE_MAGIC "KVSCACHE"
+#define PERSISTENT_CACHE_FILE_MAGIC_SIZE 8
+
+/**
+ * Persistent cache file format version
+ */
+#define PERSISTENT_CACHE_FILE_VERSION 1
+
+/**
+ * Persistent cache file permissions. The cache may hold credentials so it's only accessible to the owner.
+ */
+#define PERSISTENT_CACHE_FILE_MODE 0600
+
+/**
+ * Cached value with its expiration
+ */
+struct PersistentCacheEntry {
+    std::string value;
+
+    /**
+     * Expiration as the duration since the epoch, in seconds like the credentials expiration
+     */
+    std::chrono::duration<uint64_t> expiration;
+};
+
+/**
+ * File backed key/value cache which survives the process restarts.
+ *
+ * The whole cache is rewritten on every update into a temporary file which is synced and renamed over
+ * the cache file so a crash at any point leaves either the previous or the new cache behind. A torn
+ * or corrupt file fails the checksum and is ignored. The expired entries are dropped on write.
+ *
+ * NOTE: The processes may share a cache file. Each one writes its own temporary file so the cache file is
+ * always a complete one, but the file is rewritten from the in-memory entries of the writer, so the last
+ * writer wins and the entries the other processes put since their load are lost from the file.
+ *
+ * Example Usage:
+ * @code:
+ * PersistentCache cache("/var/cache/kvs/producer.cache");
+ * cache.load();
+ * PersistentCacheEntry entry;
+ * if (!cache.get("key", entry) || entry.expiration < now) {
+ *     cache.put("key", fetch(), expiration);
+ * }
+ * @endcode
+ */
+class PersistentCache {
+public:
+    explicit PersistentCache(const std::string& file_path);
+
+    /**
+     * Loads the entries from the cache file replacing the in-memory ones.
+     *
+     * @return false if the file is missing or invalid. The cache is left empty then.
+     */
+    bool load();
+
+    /**
+     * Gets the entry regardless of its expiration so the callers are able to fall back onto a stale one.
+     *
+     * @return false if there is no entry for the key.
+     */
+    bool get(const std::string& key, PersistentCacheEntry& entry) const;
+
+    /**
+     * Stores the entry and persists the cache.
+     *
+     * @return false if the cache file couldn't be written. The entry is kept in memory regardless.
+     */
+    bool put(const std::string& key, const std::string& value, std::chrono::duration<uint64_t> expiration);
+
+    /**
+     * Removes the entry and persists the cache.
+     */
+    bool remove(const std::string& key);
+
+    const std::string& getFilePath() const {
+        return file_path_;
+    }
+
+private:
+    /**
+     * Writes out the entries. Must be called with the cache mutex held.
+     */
+    bool persist();
+
+    const std::string file_path_;
+    mutable std::mutex cache_mutex_;
+    std::map<std::string, PersistentCacheEntry> entries_;
+};
+
+} // namespace video
+} // namespace kinesis
+} // namespace amazonaws
+} // namespace com
@@ -0,0 +1,159 @@
+#include "Logger.h"
+#include "ProducerPool.h"
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+LOGGER_TAG("com.amazonaws.kinesis.video");
+
+using std::shared_ptr;
+using std::unique_ptr;
+using std::vector;
+
+unique_ptr<ProducerPool> ProducerPool::create(size_t producer_count, const ProducerFactory& producer_factory) {
+    LOG_AND_THROW_IF(0 == producer_count, "Producer pool needs at least one producer");
+
+    vector<unique_ptr<KinesisVideoProducer>> producers;
+    for (size_t i = 0; i < producer_count; i++) {
+        producers.push_back(producer_factory(i));
+    }
+
+    return unique_ptr<ProducerPool>(new ProducerPool(move(producers)));
+}
+
+ProducerPool::ProducerPool(vector<unique_ptr<KinesisVideoProducer>> producers)
+        : producers_(move(producers)),
+          pending_counts_(producers_.size(), 0) {
+    LOG_AND_THROW_IF(producers_.empty(), "Producer pool needs at least one producer");
+    for (auto& producer : producers_) {
+        LOG_AND_THROW_IF(nullptr == producer, "Producer pool producer can't be null");
+    }
+
+    LOG_INFO("Creating producer pool of " << producers_.size() << " producers");
+}
+
+shared_ptr<KinesisVideoStream> ProducerPool::createStream(unique_ptr<StreamDefinition> stream_definition) {
+    return placeAndCreateStream(move(stream_definition), false);
+}
+
+shared_ptr<KinesisVideoStream> ProducerPool::createStreamSync(unique_ptr<StreamDefinition> stream_definition) {
+    return placeAndCreateStream(move(stream_definition), true);
+}
+
+shared_ptr<KinesisVideoStream> ProducerPool::placeAndCreateStream(unique_ptr<StreamDefinition> stream_definition, bool sync) {
+    size_t index;
+    {
+        std::lock_guard<std::mutex> lock(placement_mutex_);
+        index = placeStream();
+    }
+
+    LOG_DEBUG("Placing stream " << stream_definition->getStreamName() << " onto pooled producer " << index);
+    shared_ptr<KinesisVideoStream> kinesis_video_stream;
+    try {
+        kinesis_video_stream = sync ? producers_[index]->createStreamSync(move(stream_definition))
+                                    : producers_[index]->createStream(move(stream_definition));
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(placement_mutex_);
+        pending_counts_[index]--;
+        throw;
+    }
+
+    // The stream is accounted for in the active streams of the producer from now on
+    std::lock_guard<std::mutex> lock(placement_mutex_);
+    pending_counts_[index]--;
+    return kinesis_video_stream;
+}
+
+size_t ProducerPool::placeStream() {
+    vector<size_t> stream_counts = getStreamCounts();
+    vector<uint64_t> transfer_rates(producers_.size());
+    uint64_t total_transfer_rate = 0;
+    size_t total_stream_count = 0;
+    for (size_t i = 0; i < producers_.size(); i++) {
+        transfer_rates[i] = producers_[i]->getMetricsSnapshot().getTotalTransferRate();
+        total_transfer_rate += transfer_rates[i];
+        total_stream_count += stream_counts[i];
+    }
+
+    // The load is the mean of the stream count and the transfer rate expressed in the streams of the average
+    // rate. The streams just created haven't got a rate yet and are accounted for by the count alone.
+    double average_stream_rate = 0 == total_stream_count ? 0 : (double) total_transfer_rate / total_stream_count;
+    size_t least_loaded_index = 0;
+    double least_load = 0;
+    for (size_t i = 0; i < producers_.size(); i++) {
+        double load = (double) (stream_counts[i] + pending_counts_[i]);
+        if (average_stream_rate > 0) {
+            load = (load + transfer_rates[i] / average_stream_rate) / 2;
+        }
+
+        if (0 == i || load < least_load) {
+            least_loaded_index = i;
+            least_load = load;
+        }
+    }
+
+    pending_counts_[least_loaded_index]++;
+    return least_loaded_index;
+}
+
+void ProducerPool::freeStream(shared_ptr<KinesisVideoStream> kinesis_video_stream) {
+    if (nullptr == kinesis_video_stream) {
+        LOG_AND_THROW("Kinesis Video stream can't be null");
+    }
+
+    for (auto& producer : producers_) {
+        if (&kinesis_video_stream->getProducer() == producer.get()) {
+            producer->freeStream(kinesis_video_stream);
+            return;
+        }
+    }
+
+    LOG_AND_THROW("Kinesis Video stream " + kinesis_video_stream->getStreamName() + " doesn't belong to the producer pool");
+}
+
+void ProducerPool::freeStreams() {
+    for (auto& producer : producers_) {
+        producer->freeStreams();
+    }
+}
+
+vector<shared_ptr<KinesisVideoStream>> ProducerPool::getActiveStreams() const {
+    vector<shared_ptr<KinesisVideoStream>> active_streams;
+    for (auto& producer : producers_) {
+        auto producer_streams = producer->getActiveStreams();
+        active_streams.insert(active_streams.end(), producer_streams.begin(), producer_streams.end());
+    }
+
+    return active_streams;
+}
+
+vector<size_t> ProducerPool::getStreamCounts() const {
+    vector<size_t> stream_counts;
+    for (auto& producer : producers_) {
+        stream_counts.push_back(producer->getActiveStreams().size());
+    }
+
+    return stream_counts;
+}
+
+KinesisVideoProducerMetrics ProducerPool::getMetrics() const {
+    KinesisVideoProducerMetrics client_metrics;
+    for (auto& producer : producers_) {
+        client_metrics.accumulate(producer->getMetrics());
+    }
+
+    return client_metrics;
+}
+
+KinesisVideoProducerMetrics ProducerPool::getMetricsSnapshot() const noexcept {
+    KinesisVideoProducerMetrics client_metrics;
+    for (auto& producer : producers_) {
+        client_metrics.accumulate(producer->getMetricsSnapshot());
+    }
+
+    return client_metrics;
+}
+
+} // namespace video
+} // namespace kinesis
+} // namespace amazonaws
+} // namespace com
@@ -0,0 +1,143 @@
+/** Copyright 2017 Amazon.com. All rights reserved. */
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "KinesisVideoProducer.h"
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+/**
+ * Pool of the producers the streams are sharded across.
+ *
+ * All of the streams of a producer share its Kinesis Video client lock and content store. With many
+ * streams in a process the client lock limits the ingest throughput before the CPUs or the network do.
+ * The pool owns a number of the producers, each with its own client and content store, and places
+ * each new stream onto the least loaded one. The load of a producer weighs its stream count along
+ * with its transfer rate, so a producer running a few high bitrate streams takes on fewer new ones
+ * than a producer running as many low bitrate streams.
+ *
+ * A live stream stays on its producer for its lifetime as moving it would mean recreating it. The
+ * capacity released by the freed streams is what the placement of the new streams rebalances onto.
+ *
+ * Example Usage:
+ * @code:
+ * auto producer_pool = ProducerPool::create(4, [&](size_t index) {
+ *     return KinesisVideoProducer::createSync(createDeviceInfoProvider(index), createCallbackProvider(index));
+ * });
+ * auto kinesis_video_stream = producer_pool->createStreamSync(move(stream_definition));
+ * ...
+ * producer_pool->freeStream(kinesis_video_stream);
+ * @endcode
+ *
+ * NOTE: Each of the producers allocates the content store of its device info. The pool doesn't change
+ * the device info the factory creates the producers with, so the factory is expected to divide the storage
+ * size by the producer count to keep the overall memory footprint of a single producer.
+ */
+class ProducerPool {
+public:
+    /**
+     * Creates the producer with the index in the pool
+     */
+    using ProducerFactory = std::function<std::unique_ptr<KinesisVideoProducer>(size_t index)>;
+
+    /**
+     * Creates the pool of the producers.
+     *
+     * @param producer_count The number of the producers.
+     * @param producer_factory Creates each of the producers. Expected to give each its own device info provider
+     *                         with its share of the storage size.
+     * @throws std::runtime_error if a producer fails to be created.
+     */
+    static std::unique_ptr<ProducerPool> create(size_t producer_count, const ProducerFactory& producer_factory);
+
+    /**
+     * @param producers The producers to shard the streams across.
+     */
+    explicit ProducerPool(std::vector<std::unique_ptr<KinesisVideoProducer>> producers);
+
+    /**
+     * Creates the stream on the least loaded producer as with KinesisVideoProducer::createStream
+     */
+    std::shared_ptr<KinesisVideoStream> createStream(std::unique_ptr<StreamDefinition> stream_definition);
+
+    /**
+     * Creates the stream on the least loaded producer as with KinesisVideoProducer::createStreamSync
+     */
+    std::shared_ptr<KinesisVideoStream> createStreamSync(std::unique_ptr<StreamDefinition> stream_definition);
+
+    /**
+     * Frees the stream on the producer it was created with.
+     *
+     * @throws std::runtime_error if the stream hasn't been created by the pool.
+     */
+    void freeStream(std::shared_ptr<KinesisVideoStream> kinesis_video_stream);
+
+    /**
+     * Stops and frees the active streams of all of the producers
+     */
+    void freeStreams();
+
+    /**
+     * @return A snapshot of the active streams of all of the producers
+     */
+    std::vector<std::shared_ptr<KinesisVideoStream>> getActiveStreams() const;
+
+    /**
+     * Gets the client metrics aggregated across the producers.
+     *
+     * NOTE: The rates are summed and the content store sizes are the totals of the content stores.
+     */
+    KinesisVideoProducerMetrics getMetrics() const;
+
+    /**
+     * Gets the aggregated latest client metrics published by the background metrics samplers of the producers
+     */
+    KinesisVideoProducerMetrics getMetricsSnapshot() const noexcept;
+
+    size_t getProducerCount() const {
+        return producers_.size();
+    }
+
+    KinesisVideoProducer& getProducer(size_t index) const {
+        return *producers_.at(index);
+    }
+
+    /**
+     * @return The number of the active streams of each of the producers
+     */
+    std::vector<size_t> getStreamCounts() const;
+
+private:
+    /**
+     * Picks the least loaded producer and accounts for the stream being created on it.
+     * Called with the placement lock held.
+     */
+    size_t placeStream();
+
+    /**
+     * Places and creates the stream
+     */
+    std::shared_ptr<KinesisVideoStream> placeAndCreateStream(std::unique_ptr<StreamDefinition> stream_definition, bool sync);
+
+    const std::vector<std::unique_ptr<KinesisVideoProducer>> producers_;
+
+    /**
+     * Serializes the placements so the concurrent creations spread across the producers
+     */
+    std::mutex placement_mutex_;
+
+    /**
+     * Number of the streams being created on each of the producers
+     */
+    std::vector<size_t> pending_counts_;
+};
+
+} // namespace video
+} // namespace kinesis
+} // namespace amazonaws
+} // namespace com
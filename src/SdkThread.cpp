@@ -0,0 +1,247 @@
+#include "Logger.h"
+#include "SdkThread.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#if !defined(_WIN32)
+#include <climits>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+LOGGER_TAG("com.amazonaws.kinesis.video");
+
+using std::string;
+using std::vector;
+
+namespace {
+
+/**
+ * Role of the threads created by the Kinesis Video client
+ */
+const char CLIENT_THREAD_ROLE[] = "client";
+
+struct ClientThreadContext {
+    startRoutine start_routine;
+    PVOID args;
+};
+
+struct RunningThread {
+    string name;
+    uint64_t thread_id;
+#if defined(__linux__)
+    clockid_t clock_id;
+#endif
+};
+
+struct ThreadRegistry {
+    std::mutex policy_mutex;
+    ThreadPolicy policy;
+
+    std::mutex threads_mutex;
+    std::map<uint64_t, RunningThread> running_threads;
+    std::map<string, std::chrono::nanoseconds> exited_cpu_times;
+    uint64_t next_thread_key = 0;
+};
+
+/**
+ * Never destroyed as the threads may outlive the static objects at the exit
+ */
+ThreadRegistry& getRegistry() {
+    static ThreadRegistry* registry = new ThreadRegistry();
+    return *registry;
+}
+
+string makeThreadName(const ThreadPolicy& thread_policy, const string& role) {
+    string name = thread_policy.name_prefix.empty() ? role : thread_policy.name_prefix + "-" + role;
+    return name.substr(0, MAX_THREAD_NAME_LEN);
+}
+
+void applyPolicy(const ThreadPolicy& thread_policy, const string& name) {
+#if defined(__linux__)
+    pthread_setname_np(pthread_self(), name.c_str());
+
+    if (!thread_policy.cpu_affinity.empty()) {
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        for (auto cpu : thread_policy.cpu_affinity) {
+            if (cpu < CPU_SETSIZE) {
+                CPU_SET(cpu, &cpu_set);
+            }
+        }
+
+        int result = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+        if (0 != result) {
+            LOG_WARN("Unable to set the CPU affinity of thread " << name << ". Error " << result);
+        }
+    }
+
+    // The niceness is per thread on Linux
+    if (0 != thread_policy.nice && 0 != setpriority(PRIO_PROCESS, (id_t) syscall(SYS_gettid), thread_policy.nice)) {
+        LOG_WARN("Unable to set the niceness of thread " << name << ". errno " << errno);
+    }
+#elif defined(__APPLE__)
+    pthread_setname_np(name.c_str());
+#endif
+
+#if !defined(_WIN32)
+    if (thread_policy.realtime_priority > 0) {
+        struct sched_param param;
+        param.sched_priority = thread_policy.realtime_priority;
+        int result = pthread_setschedparam(pthread_self(), SCHED_RR, &param);
+        if (0 != result) {
+            LOG_WARN("Unable to set the real time priority of thread " << name << ". Error " << result);
+        }
+    }
+#endif
+}
+
+std::chrono::nanoseconds getCpuTime(const RunningThread& running_thread) {
+#if defined(__linux__)
+    struct timespec cpu_time;
+    if (0 == clock_gettime(running_thread.clock_id, &cpu_time)) {
+        return std::chrono::seconds(cpu_time.tv_sec) + std::chrono::nanoseconds(cpu_time.tv_nsec);
+    }
+#endif
+    return std::chrono::nanoseconds(0);
+}
+
+/**
+ * Accounts for the CPU time of the calling thread while it's in scope
+ */
+class ThreadRegistration {
+public:
+    explicit ThreadRegistration(const string& name) : registry_(getRegistry()) {
+        RunningThread running_thread;
+        running_thread.name = name;
+#if defined(__linux__)
+        running_thread.thread_id = (uint64_t) syscall(SYS_gettid);
+        pthread_getcpuclockid(pthread_self(), &running_thread.clock_id);
+#endif
+
+        std::lock_guard<std::mutex> lock(registry_.threads_mutex);
+        key_ = registry_.next_thread_key++;
+#if !defined(__linux__)
+        running_thread.thread_id = key_ + 1;
+#endif
+        registry_.running_threads[key_] = running_thread;
+    }
+
+    ~ThreadRegistration() {
+        std::lock_guard<std::mutex> lock(registry_.threads_mutex);
+        auto it = registry_.running_threads.find(key_);
+        registry_.exited_cpu_times[it->second.name] += getCpuTime(it->second);
+        registry_.running_threads.erase(it);
+    }
+
+private:
+    ThreadRegistry& registry_;
+    uint64_t key_;
+};
+
+} // namespace
+
+void SdkThread::setPolicy(const ThreadPolicy& thread_policy) {
+    {
+        ThreadRegistry& registry = getRegistry();
+        std::lock_guard<std::mutex> lock(registry.policy_mutex);
+        registry.policy = thread_policy;
+    }
+
+#if !defined(_WIN32)
+    globalCreateThread = createClientThread;
+#endif
+}
+
+ThreadPolicy SdkThread::getPolicy() {
+    ThreadRegistry& registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.policy_mutex);
+    return registry.policy;
+}
+
+std::thread SdkThread::start(const string& role, std::function<void()> routine) {
+    return std::thread(&SdkThread::run, role, std::move(routine));
+}
+
+void SdkThread::run(const string& role, const std::function<void()>& routine) {
+    ThreadPolicy thread_policy = getPolicy();
+    string name = makeThreadName(thread_policy, role);
+    applyPolicy(thread_policy, name);
+
+    ThreadRegistration registration(name);
+    routine();
+}
+
+STATUS SdkThread::createClientThread(PTID thread_id, startRoutine start_routine, PVOID args) {
+    if (NULL == thread_id || NULL == start_routine) {
+        return STATUS_NULL_ARG;
+    }
+
+#if defined(_WIN32)
+    return STATUS_INVALID_OPERATION;
+#else
+    size_t stack_size = getPolicy().stack_size;
+    std::unique_ptr<ClientThreadContext> context(new ClientThreadContext{start_routine, args});
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    if (0 != stack_size) {
+        pthread_attr_setstacksize(&attr, std::max<size_t>(stack_size, PTHREAD_STACK_MIN));
+    }
+
+    pthread_t thread;
+    int result = pthread_create(&thread, &attr, clientThreadRoutine, context.get());
+    pthread_attr_destroy(&attr);
+    if (0 != result) {
+        LOG_ERROR("Unable to create client thread. Error " << result);
+        return STATUS_INVALID_OPERATION;
+    }
+
+    // Owned by the thread from now on
+    context.release();
+    *thread_id = (TID) thread;
+    return STATUS_SUCCESS;
+#endif
+}
+
+PVOID SdkThread::clientThreadRoutine(PVOID args) {
+    std::unique_ptr<ClientThreadContext> context(reinterpret_cast<ClientThreadContext*>(args));
+    PVOID result = NULL;
+    run(CLIENT_THREAD_ROLE, [&context, &result]() {
+        result = context->start_routine(context->args);
+    });
+
+    return result;
+}
+
+vector<ThreadCpuTime> SdkThread::getCpuTimes() {
+    vector<ThreadCpuTime> cpu_times;
+    ThreadRegistry& registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.threads_mutex);
+    for (auto& running_thread : registry.running_threads) {
+        cpu_times.push_back(ThreadCpuTime{running_thread.second.name, running_thread.second.thread_id, getCpuTime(running_thread.second)});
+    }
+
+    for (auto& exited_cpu_time : registry.exited_cpu_times) {
+        cpu_times.push_back(ThreadCpuTime{exited_cpu_time.first, 0, exited_cpu_time.second});
+    }
+
+    return cpu_times;
+}
+
+} // namespace video
+} // namespace kinesis
+} // namespace amazonaws
+} // namespace com
@@ -0,0 +1,128 @@
+/** Copyright 2017 Amazon.com. All rights reserved. */
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "com/amazonaws/kinesis/video/client/Include.h"
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+/**
+ * Default prefix of the SDK thread names
+ */
+#define DEFAULT_THREAD_NAME_PREFIX "kvs"
+
+/**
+ * Maximum thread name length without the terminating null as limited by Linux
+ */
+#define MAX_THREAD_NAME_LEN 15
+
+/**
+ * Placement of the SDK threads
+ */
+struct ThreadPolicy {
+    /**
+     * The CPUs the threads may run on. Empty leaves the threads unpinned.
+     */
+    std::vector<uint32_t> cpu_affinity;
+
+    /**
+     * Niceness of the threads. Zero leaves the default.
+     */
+    int32_t nice;
+
+    /**
+     * Priority of the threads in the round robin real time scheduling. Zero leaves the default scheduling.
+     */
+    int32_t realtime_priority;
+
+    /**
+     * Stack size of the threads in bytes. Zero leaves the default.
+     *
+     * NOTE: Applies to the threads created by the Kinesis Video client, like the curl upload threads
+     * which are created per stream. The SDK worker threads are std::threads with the default stack size.
+     */
+    size_t stack_size;
+
+    /**
+     * Prefix of the thread names followed by the role of the thread
+     */
+    std::string name_prefix;
+
+    ThreadPolicy() : nice(0), realtime_priority(0), stack_size(0), name_prefix(DEFAULT_THREAD_NAME_PREFIX) {
+    }
+};
+
+/**
+ * CPU time consumed by an SDK thread
+ */
+struct ThreadCpuTime {
+    std::string name;
+
+    /**
+     * The OS thread id of a running thread. Zero for the total of the exited threads of the name.
+     */
+    uint64_t thread_id;
+
+    std::chrono::nanoseconds cpu_time;
+};
+
+/**
+ * Creates the SDK threads under the process-wide thread policy and accounts for their CPU time.
+ *
+ * The threads created by the Kinesis Video client, the curl upload and the callback threads, are created through
+ * the client thread creation hook once a policy is set. The SDK worker threads are started with start().
+ */
+class SdkThread {
+public:
+    /**
+     * Sets the process-wide policy applied to the threads created from now on and installs the client thread
+     * creation hook.
+     *
+     * NOTE: The policy applies to the threads of all of the producers in the process, including the curl upload
+     * and the callback threads created by the Kinesis Video client. Set it once ahead of creating the producers
+     * as the client threads created earlier keep their placement.
+     */
+    static void setPolicy(const ThreadPolicy& thread_policy);
+
+    static ThreadPolicy getPolicy();
+
+    /**
+     * Starts an SDK worker thread
+     *
+     * @param role Role of the thread which the name is made of.
+     * @param routine The thread routine.
+     */
+    static std::thread start(const std::string& role, std::function<void()> routine);
+
+    /**
+     * Client thread creation hook creating the thread under the policy
+     */
+    static STATUS createClientThread(PTID thread_id, startRoutine start_routine, PVOID args);
+
+    /**
+     * @return The CPU time of the running SDK threads and the totals of the exited ones by name.
+     */
+    static std::vector<ThreadCpuTime> getCpuTimes();
+
+private:
+    /**
+     * Routine of the client threads running the client start routine
+     */
+    static PVOID clientThreadRoutine(PVOID args);
+
+    /**
+     * Applies the policy to the calling thread, runs the routine and accounts for its CPU time
+     */
+    static void run(const std::string& role, const std::function<void()>& routine);
+};
+
+} // namespace video
+} // namespace kinesis
+} // namespace amazonaws
+} // namespace com
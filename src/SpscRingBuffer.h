@@ -0,0 +1,129 @@
+/** Copyright 2017 Amazon.com. All rights reserved. */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+/**
+ * Cache line size used to keep the producer and consumer indexes apart
+ */
+#define SPSC_RING_BUFFER_CACHE_LINE_SIZE 64
+
+/**
+ * Bounded lock-free single-producer/single-consumer ring buffer.
+ *
+ * The slots are pre-allocated and handed out in-place so that slot owned resources (ex: payload buffers)
+ * are reused across the laps of the ring instead of being re-allocated for every item.
+ *
+ * NOTE: Exactly one thread may call the producer side APIs (claim/publish) and exactly one thread
+ * may call the consumer side APIs (front/pop) at any given time.
+ *
+ * @tparam T The slot type. Must be default constructible.
+ */
+template <typename T> class SpscRingBuffer {
+public:
+    /**
+     * @param capacity Requested capacity. Rounded up to the next power of two.
+     */
+    explicit SpscRingBuffer(size_t capacity)
+            : capacity_(roundUpToPowerOfTwo(capacity)),
+              mask_(capacity_ - 1),
+              slots_(capacity_),
+              write_index_(0),
+              read_index_(0) {
+    }
+
+    /**
+     * Producer side. Returns the free slot the offset past the next free one to be filled in or nullptr
+     * if there are not as many free slots. The slots become visible to the consumer only after publish() is called.
+     *
+     * @param offset Offset of the slot past the next free one. Allows a batch of slots to be filled in and
+     * published at once.
+     */
+    T* claim(size_t offset = 0) {
+        size_t write_index = write_index_.load(std::memory_order_relaxed) + offset;
+        if (write_index - read_index_.load(std::memory_order_acquire) >= capacity_) {
+            return nullptr;
+        }
+
+        return &slots_[write_index & mask_];
+    }
+
+    /**
+     * Producer side. Publishes the count of the slots previously returned by claim() in order.
+     */
+    void publish(size_t count = 1) {
+        write_index_.store(write_index_.load(std::memory_order_relaxed) + count, std::memory_order_release);
+    }
+
+    /**
+     * Consumer side. Returns the oldest published slot or nullptr if the ring is empty.
+     * The slot is returned to the producer only after pop() is called.
+     */
+    T* front() {
+        size_t read_index = read_index_.load(std::memory_order_relaxed);
+        if (read_index == write_index_.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+
+        return &slots_[read_index & mask_];
+    }
+
+    /**
+     * Consumer side. Releases the slot previously returned by front().
+     */
+    void pop() {
+        read_index_.store(read_index_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /**
+     * @return Number of published and not yet consumed slots. Exact only when called from the producer or consumer.
+     */
+    size_t size() const {
+        return write_index_.load(std::memory_order_acquire) - read_index_.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @return Number of the free slots. Exact only when called from the producer, the consumer can only free up more.
+     */
+    size_t available() const {
+        return capacity_ - size();
+    }
+
+    bool empty() const {
+        return 0 == size();
+    }
+
+    size_t capacity() const {
+        return capacity_;
+    }
+
+private:
+    static size_t roundUpToPowerOfTwo(size_t value) {
+        size_t result = 1;
+        while (result < value) {
+            result <<= 1;
+        }
+
+        return result;
+    }
+
+    const size_t capacity_;
+    const size_t mask_;
+    std::vector<T> slots_;
+
+    /**
+     * Indexes are free running and are kept on separate cache lines to avoid false sharing
+     */
+    alignas(SPSC_RING_BUFFER_CACHE_LINE_SIZE) std::atomic<size_t> write_index_;
+    alignas(SPSC_RING_BUFFER_CACHE_LINE_SIZE) std::atomic<size_t> read_index_;
+};
+
+} // namespace video
+} // namespace kinesis
+} // namespace amazonaws
+} // namespace com
@@ -6,6 +6,17 @@
 
 namespace com { namespace amazonaws { namespace kinesis { namespace video {
 
+/**
+ * Reports the encoder bitrate recommended for the stream to keep up with the uplink.
+ *
+ * @param 1 UINT64 - Custom handle passed by the caller.
+ * @param 2 STREAM_HANDLE - The stream to report for.
+ * @param 3 UINT64 - The recommended bitrate in bits per second.
+ *
+ * @return Status of the callback
+ */
+typedef STATUS (*StreamBitrateRecommendationFunc)(UINT64, STREAM_HANDLE, UINT64);
+
 /**
 * Kinesis Video Stream level callback provider
 *
@@ -19,6 +30,7 @@ namespace com { namespace amazonaws { namespace kinesis { namespace video {
 *    getStreamClosedCallback();
 *    getStreamDataAvailableCallback();
 *    getFragmentAckReceivedCallback();
+*    getBitrateRecommendationCallback();
 *
 * The optional callbacks are virtual, but there are default implementations defined for them that return nullptr,
 * which will therefore use the defaults provided by the Kinesis Video SDK.
@@ -216,6 +228,27 @@ public:
         return nullptr;
     };
 
+    /**
+     * Reports the encoder bitrate recommended for the stream
+     *
+     * Optional callback.
+     *
+     * The recommendation is derived from the stream transfer rate, the buffer duration growth and the content store
+     * pressure by the producer metrics sampler. It's reported only when it changes by at least
+     * BITRATE_ADVISOR_REPORT_THRESHOLD_PERCENT and requires the metrics sampling to be enabled.
+     *
+     * The function returned by this callback takes the following arguments:
+     *
+     * @param 1 UINT64 - Custom handle passed by the caller.
+     * @param 2 STREAM_HANDLE - The stream to report for.
+     * @param 3 UINT64 - The recommended bitrate in bits per second.
+     *
+     *  @return a function pointer conforming to the description above.
+     */
+    virtual StreamBitrateRecommendationFunc getBitrateRecommendationCallback() {
+        return nullptr;
+    };
+
     virtual ~StreamCallbackProvider() {};
 };
 
@@ -9,6 +9,7 @@ using std::map;
 using std::milli;
 using std::ratio;
 using std::string;
+using std::unique_ptr;
 using std::vector;
 using std::chrono::duration;
 using std::chrono::duration_cast;
@@ -45,7 +46,11 @@ StreamDefinition::StreamDefinition(
         CONTENT_STORE_PRESSURE_POLICY contentStorePressurePolicy,
         CONTENT_VIEW_OVERFLOW_POLICY contentViewOverflowPolicy)
         : tags_(tags),
-          stream_name_(stream_name) {
+          stream_name_(stream_name),
+          track_info_(std::make_shared<vector<StreamTrackInfo>>()),
+          async_ingest_queue_capacity_(0),
+          frame_log_segment_size_(DEFAULT_FRAME_LOG_SEGMENT_SIZE),
+          frame_shedding_(false) {
     memset(&stream_info_, 0x00, sizeof(StreamInfo));
 
     LOG_AND_THROW_IF(MAX_STREAM_NAME_LEN < stream_name.size(), "StreamName exceeded max length " << MAX_STREAM_NAME_LEN);
@@ -95,11 +100,61 @@ StreamDefinition::StreamDefinition(
     LOG_AND_THROW_IF(MKV_MAX_CODEC_ID_LEN < codec_id.size(), "CodecId exceeded max length of " << MKV_MAX_CODEC_ID_LEN);
     LOG_AND_THROW_IF(MKV_MAX_TRACK_NAME_LEN < track_name.size(), "TrackName exceeded max length of " << MKV_MAX_TRACK_NAME_LEN);
 
-    track_info_.push_back(StreamTrackInfo{default_track_id, track_name, codec_id, codecPrivateData, codecPrivateDataSize, track_type});
+    track_info_->push_back(StreamTrackInfo{default_track_id, track_name, codec_id, codecPrivateData, codecPrivateDataSize, track_type});
+}
 
-    // Set the tags
-    stream_info_.tagCount = (UINT32)tags_.count();
-    stream_info_.tags = tags_.asPTag();
+StreamDefinition::StreamDefinition(const StreamDefinition& other, const string& stream_name)
+        : stream_name_(stream_name),
+          tags_(other.tags_),
+          track_info_(other.track_info_),
+          stream_info_(other.stream_info_),
+          async_ingest_queue_capacity_(other.async_ingest_queue_capacity_),
+          frame_log_directory_(other.frame_log_directory_),
+          frame_log_segment_size_(other.frame_log_segment_size_),
+          frame_shedding_(other.frame_shedding_) {
+    LOG_AND_THROW_IF(MAX_STREAM_NAME_LEN < stream_name.size(), "StreamName exceeded max length " << MAX_STREAM_NAME_LEN);
+    strcpy(stream_info_.name, stream_name.c_str());
+
+    memcpy(segment_uuid_, other.segment_uuid_, MKV_SEGMENT_UUID_LEN);
+    if (NULL != stream_info_.streamCaps.segmentUuid) {
+        stream_info_.streamCaps.segmentUuid = segment_uuid_;
+    }
+
+    // The tracks and the tags are materialized into the own arena
+    stream_info_.tagCount = 0;
+    stream_info_.tags = nullptr;
+    stream_info_.streamCaps.trackInfoCount = 0;
+    stream_info_.streamCaps.trackInfoList = nullptr;
+}
+
+unique_ptr<StreamDefinition> StreamDefinition::clone(const string& stream_name) const {
+    return unique_ptr<StreamDefinition>(new StreamDefinition(*this, stream_name));
+}
+
+void StreamDefinition::setTags(const map<string, string>& tags) {
+    invalidateStreamInfo();
+    tags_ = StreamTags(&tags);
+}
+
+void StreamDefinition::setCodecPrivateData(uint64_t track_id, const uint8_t* codecPrivateData, uint32_t codecPrivateDataSize) {
+    for (auto& track : getMutableTrackInfo()) {
+        if (track.track_id == track_id) {
+            invalidateStreamInfo();
+            track.cpd = codecPrivateData;
+            track.cpd_size = codecPrivateDataSize;
+            return;
+        }
+    }
+
+    LOG_AND_THROW("Track " << track_id << " not found in stream definition " << stream_name_);
+}
+
+vector<StreamTrackInfo>& StreamDefinition::getMutableTrackInfo() {
+    if (1 != track_info_.use_count()) {
+        track_info_ = std::make_shared<vector<StreamTrackInfo>>(*track_info_);
+    }
+
+    return *track_info_;
 }
 
 void StreamDefinition::addTrack(const uint64_t track_id,
@@ -109,7 +164,8 @@ void StreamDefinition::addTrack(const uint64_t track_id,
                                 const uint8_t* codecPrivateData,
                                 uint32_t codecPrivateDataSize) {
     stream_info_.streamCaps.frameOrderingMode = FRAME_ORDERING_MODE_MULTI_TRACK_AV_COMPARE_PTS_ONE_MS_COMPENSATE_EOFR;
-    track_info_.push_back(StreamTrackInfo{track_id,
+    invalidateStreamInfo();
+    getMutableTrackInfo().push_back(StreamTrackInfo{track_id,
                                           track_name,
                                           codec_id,
                                           codecPrivateData,
@@ -121,16 +177,37 @@ void StreamDefinition::setFrameOrderMode(FRAME_ORDER_MODE mode) {
     stream_info_.streamCaps.frameOrderingMode = mode;
 }
 
-StreamDefinition::~StreamDefinition() {
-    for (size_t i = 0; i < stream_info_.tagCount; ++i) {
-        Tag &tag = stream_info_.tags[i];
-        free(tag.name);
-        free(tag.value);
-    }
+void StreamDefinition::setAsyncIngestQueueCapacity(uint32_t queue_capacity) {
+    async_ingest_queue_capacity_ = queue_capacity;
+}
 
-    free(stream_info_.tags);
+uint32_t StreamDefinition::getAsyncIngestQueueCapacity() const {
+    return async_ingest_queue_capacity_;
+}
+
+void StreamDefinition::setFrameLog(const string& directory, uint64_t segment_size) {
+    LOG_AND_THROW_IF(0 == segment_size, "Frame log segment size can't be 0");
+    frame_log_directory_ = directory;
+    frame_log_segment_size_ = segment_size;
+}
+
+const string& StreamDefinition::getFrameLogDirectory() const {
+    return frame_log_directory_;
+}
+
+uint64_t StreamDefinition::getFrameLogSegmentSize() const {
+    return frame_log_segment_size_;
+}
+
+void StreamDefinition::setFrameShedding(bool enable) {
+    frame_shedding_ = enable;
+}
 
-    delete [] stream_info_.streamCaps.trackInfoList;
+bool StreamDefinition::isFrameSheddingEnabled() const {
+    return frame_shedding_;
+}
+
+StreamDefinition::~StreamDefinition() {
 }
 
 const string& StreamDefinition::getStreamName() const {
@@ -138,31 +215,55 @@ const string& StreamDefinition::getStreamName() const {
 }
 
 const size_t StreamDefinition::getTrackCount() const {
-    return track_info_.size();
+    return track_info_->size();
 }
 
 const StreamInfo& StreamDefinition::getStreamInfo() {
-    stream_info_.streamCaps.trackInfoCount = static_cast<UINT32>(track_info_.size());
-    stream_info_.streamCaps.trackInfoList = new TrackInfo[track_info_.size()];
-    memset(stream_info_.streamCaps.trackInfoList, 0, sizeof(TrackInfo) * track_info_.size());
-    for (size_t i = 0; i < track_info_.size(); ++i) {
+    if (!stream_info_arena_) {
+        materializeStreamInfo();
+    }
+
+    return stream_info_;
+}
+
+void StreamDefinition::materializeStreamInfo() {
+    const vector<StreamTrackInfo>& track_info = *track_info_;
+    size_t track_info_size = sizeof(TrackInfo) * track_info.size();
+
+    // TrackInfo size is a multiple of its alignment so the tags following the tracks stay aligned
+    stream_info_arena_.reset(new uint8_t[track_info_size + tags_.getMaterializedSize()]);
+
+    stream_info_.streamCaps.trackInfoCount = static_cast<UINT32>(track_info.size());
+    stream_info_.streamCaps.trackInfoList = reinterpret_cast<PTrackInfo>(stream_info_arena_.get());
+    memset(stream_info_.streamCaps.trackInfoList, 0, track_info_size);
+    for (size_t i = 0; i < track_info.size(); ++i) {
         TrackInfo &trackInfo = stream_info_.streamCaps.trackInfoList[i];
-        trackInfo.trackId = track_info_[i].track_id;
-        trackInfo.trackType = track_info_[i].track_type;
+        trackInfo.trackId = track_info[i].track_id;
+        trackInfo.trackType = track_info[i].track_type;
 
-        strncpy(trackInfo.trackName, track_info_[i].track_name.c_str(), MKV_MAX_TRACK_NAME_LEN + 1);
+        strncpy(trackInfo.trackName, track_info[i].track_name.c_str(), MKV_MAX_TRACK_NAME_LEN + 1);
         trackInfo.trackName[MKV_MAX_TRACK_NAME_LEN] = '\0';
 
-        strncpy(trackInfo.codecId, track_info_[i].codec_id.c_str(), MKV_MAX_CODEC_ID_LEN + 1);
+        strncpy(trackInfo.codecId, track_info[i].codec_id.c_str(), MKV_MAX_CODEC_ID_LEN + 1);
         trackInfo.codecId[MKV_MAX_CODEC_ID_LEN] = '\0';
 
         // Set the Codec Private Data.
         // NOTE: We are not actually copying the bits
-        trackInfo.codecPrivateData = const_cast<PBYTE>(track_info_[i].cpd);
-        trackInfo.codecPrivateDataSize = (UINT32) track_info_[i].cpd_size;
+        trackInfo.codecPrivateData = const_cast<PBYTE>(track_info[i].cpd);
+        trackInfo.codecPrivateDataSize = (UINT32) track_info[i].cpd_size;
     }
 
-    return stream_info_;
+    // Set the tags
+    stream_info_.tagCount = (UINT32) tags_.count();
+    stream_info_.tags = tags_.materialize(stream_info_arena_.get() + track_info_size);
+}
+
+void StreamDefinition::invalidateStreamInfo() {
+    stream_info_.tagCount = 0;
+    stream_info_.tags = nullptr;
+    stream_info_.streamCaps.trackInfoCount = 0;
+    stream_info_.streamCaps.trackInfoList = nullptr;
+    stream_info_arena_.reset();
 }
 
 } // namespace video
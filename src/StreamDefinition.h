@@ -11,6 +11,7 @@
 #include <chrono>
 
 #include "StreamTags.h"
+#include "FrameLog.h"
 
 #define DEFAULT_TRACK_ID 1
 
@@ -83,6 +84,82 @@ public:
 
     void setFrameOrderMode(FRAME_ORDER_MODE mode);
 
+    /**
+     * Creates a definition for another stream with the same settings.
+     *
+     * The tags and the tracks are shared with this definition until overridden on either of them
+     * so provisioning many streams from a single template definition is cheap.
+     *
+     * @param stream_name Human readable name of the new stream.
+     * @return The new definition
+     */
+    std::unique_ptr<StreamDefinition> clone(const std::string& stream_name) const;
+
+    /**
+     * Replaces the tags to be set on the stream.
+     */
+    void setTags(const std::map<std::string, std::string>& tags);
+
+    /**
+     * Replaces the codec private data of the track.
+     * NOTE: The bits are not copied and must stay valid until the stream is created.
+     *
+     * @param track_id The track to update.
+     */
+    void setCodecPrivateData(uint64_t track_id, const uint8_t* codecPrivateData, uint32_t codecPrivateDataSize);
+
+    /**
+     * Enables the asynchronous ingest mode for the stream.
+     *
+     * In the asynchronous mode putFrame() copies the frame into a bounded queue and returns immediately.
+     * A dedicated per-stream thread submits the queued frames to the Kinesis Video PIC so the caller
+     * never blocks on the content store. Frames are dropped and accounted for when the queue is full.
+     *
+     * NOTE: putFrame() and putFrames() must be called from a single thread at a time in the asynchronous mode
+     * as the queue is single producer. Concurrent calls corrupt the queue.
+     *
+     * @param queue_capacity Maximum number of queued frames. Rounded up to the power of two. 0 disables the mode.
+     */
+    void setAsyncIngestQueueCapacity(uint32_t queue_capacity);
+
+    /**
+     * @return The asynchronous ingest queue capacity. 0 if the mode is disabled.
+     */
+    uint32_t getAsyncIngestQueueCapacity() const;
+
+    /**
+     * Enables the write-ahead frame log for the stream.
+     *
+     * The frames accepted by putFrame() are appended to the log in the subdirectory of the stream and
+     * deleted once their fragments are persisted. The frames left over by a crash are replayed into the
+     * stream when it's started again. Requires the absolute fragment times and the key frame fragmentation.
+     *
+     * @param directory The root directory of the frame logs. Empty disables the log.
+     * @param segment_size The size the log segments are preallocated to.
+     */
+    void setFrameLog(const std::string& directory, uint64_t segment_size = DEFAULT_FRAME_LOG_SEGMENT_SIZE);
+
+    /**
+     * @return The root directory of the frame logs. Empty if the log is disabled.
+     */
+    const std::string& getFrameLogDirectory() const;
+
+    uint64_t getFrameLogSegmentSize() const;
+
+    /**
+     * Enables the priority-aware frame shedding for the stream.
+     *
+     * Under the buffer duration or the content store pressure the new frames are shed in the order of
+     * the non-reference frames flagged as discardable, the frames of the tracks other than the first video
+     * track and all but the key frames, instead of the content store dropping whole fragments of the
+     * history. The stream goes back to the full rate as the pressure clears. Requires the metrics sampling.
+     *
+     * @param enable Whether to shed the frames.
+     */
+    void setFrameShedding(bool enable);
+
+    bool isFrameSheddingEnabled() const;
+
     ~StreamDefinition();
 
     /**
@@ -96,11 +173,29 @@ public:
     const size_t getTrackCount() const;
 
     /**
-     * @return An Kinesis Video StreamInfo object
+     * @return An Kinesis Video StreamInfo object. The tracks and the tags are materialized on the first
+     * call and stay valid until the tracks or the tags are changed.
      */
     const StreamInfo& getStreamInfo();
 
 private:
+    StreamDefinition(const StreamDefinition& other, const std::string& stream_name);
+
+    /**
+     * @return The tracks for the modification. Copied first if shared with another definition.
+     */
+    std::vector<StreamTrackInfo>& getMutableTrackInfo();
+
+    /**
+     * Lays out the tracks and the tags in a single allocation and points the StreamInfo at them
+     */
+    void materializeStreamInfo();
+
+    /**
+     * Releases the materialized tracks and tags after a change
+     */
+    void invalidateStreamInfo();
+
     /**
      * Human readable name of the stream. Usually: <sensor ID>.camera_<stream_tag>
      */
@@ -112,19 +207,40 @@ private:
     StreamTags tags_;
 
     /**
-     * Vector of StreamTrackInfo that contain track metadata
+     * Vector of StreamTrackInfo that contain track metadata. Shared between the clones until modified.
      */
-    std::vector<StreamTrackInfo> track_info_;
+    std::shared_ptr<std::vector<StreamTrackInfo>> track_info_;
 
     /**
      * The underlying object
      */
     StreamInfo stream_info_;
 
+    /**
+     * Backing storage of the StreamInfo track list and tags. Empty until materialized.
+     */
+    std::unique_ptr<uint8_t[]> stream_info_arena_;
+
     /**
      * Segment UUID bytes
      */
      uint8_t segment_uuid_[MKV_SEGMENT_UUID_LEN];
+
+    /**
+     * Asynchronous ingest queue capacity. 0 if the mode is disabled
+     */
+    uint32_t async_ingest_queue_capacity_;
+
+    /**
+     * Write-ahead frame log root directory and segment size. Empty directory if the log is disabled
+     */
+    std::string frame_log_directory_;
+    uint64_t frame_log_segment_size_;
+
+    /**
+     * Whether the frames are shed under the pressure
+     */
+    bool frame_shedding_;
 };
 
 } // namespace video
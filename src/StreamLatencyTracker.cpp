@@ -0,0 +1,75 @@
+#include "StreamLatencyTracker.h"
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+using std::chrono::steady_clock;
+using std::chrono::microseconds;
+using std::chrono::duration_cast;
+
+/**
+ * Timecode of the slots which are not tracking a fragment
+ */
+#define INVALID_FRAGMENT_TIMECODE ((uint64_t) -1)
+
+StreamLatencyTracker::StreamLatencyTracker(uint64_t timecode_scale)
+        : timecode_scale_(0 == timecode_scale ? 1 : timecode_scale),
+          fragment_index_(0) {
+    for (auto& fragment : fragments_) {
+        fragment.timecode.store(INVALID_FRAGMENT_TIMECODE, std::memory_order_relaxed);
+        fragment.put_time.store(0, std::memory_order_relaxed);
+    }
+}
+
+void StreamLatencyTracker::recordPutFrame(const Frame& frame,
+                                          steady_clock::time_point put_time,
+                                          steady_clock::duration put_duration) {
+    put_frame_latency_.record(duration_cast<microseconds>(put_duration));
+
+    if (!CHECK_FRAME_FLAG_KEY_FRAME(frame.flags)) {
+        return;
+    }
+
+    // The fragment ack carries the cluster timecode which is the key frame timestamp in the timecode scale
+    FragmentSlot& fragment = fragments_[fragment_index_.fetch_add(1, std::memory_order_relaxed) % STREAM_LATENCY_TRACKER_FRAGMENT_COUNT];
+    fragment.timecode.store(INVALID_FRAGMENT_TIMECODE, std::memory_order_relaxed);
+    fragment.put_time.store(put_time.time_since_epoch().count(), std::memory_order_release);
+    fragment.timecode.store(frame.presentationTs / timecode_scale_, std::memory_order_release);
+}
+
+void StreamLatencyTracker::recordFragmentAck(const FragmentAck& fragment_ack) {
+    LatencyHistogram* histogram;
+    switch (fragment_ack.ackType) {
+        case FRAGMENT_ACK_TYPE_BUFFERING:
+            histogram = &buffering_ack_latency_;
+            break;
+        case FRAGMENT_ACK_TYPE_RECEIVED:
+            histogram = &received_ack_latency_;
+            break;
+        case FRAGMENT_ACK_TYPE_PERSISTED:
+            histogram = &persisted_ack_latency_;
+            break;
+        default:
+            return;
+    }
+
+    steady_clock::time_point now = steady_clock::now();
+    for (auto& fragment : fragments_) {
+        if (fragment.timecode.load(std::memory_order_acquire) != fragment_ack.timestamp) {
+            continue;
+        }
+
+        int64_t put_time = fragment.put_time.load(std::memory_order_acquire);
+        if (fragment.timecode.load(std::memory_order_acquire) != fragment_ack.timestamp) {
+            // Overwritten by a newer fragment in the meantime
+            return;
+        }
+
+        histogram->record(duration_cast<microseconds>(now - steady_clock::time_point(steady_clock::duration(put_time))));
+        return;
+    }
+}
+
+} // namespace video
+} // namespace kinesis
+} // namespace amazonaws
+} // namespace com
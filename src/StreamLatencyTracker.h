@@ -0,0 +1,91 @@
+/** Copyright 2017 Amazon.com. All rights reserved. */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+
+#include "com/amazonaws/kinesis/video/client/Include.h"
+#include "LatencyHistogram.h"
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+/**
+ * Number of the in-flight fragments tracked for the ack latencies. Needs to cover the fragments
+ * between the put of the key frame and the persisted ack.
+ */
+#define STREAM_LATENCY_TRACKER_FRAGMENT_COUNT 64
+
+/**
+ * Per-stream latency histograms.
+ *
+ * Tracks the putFrame call duration and the time from the key frame starting a fragment being put
+ * to the fragment being acknowledged as buffering, received and persisted. The ack latencies are
+ * matched by the fragment timecode and therefore require the absolute fragment times.
+ *
+ * All of the recording paths are lock-free and allocation-free.
+ */
+class StreamLatencyTracker {
+public:
+    /**
+     * @param timecode_scale The stream timecode scale in the Kinesis Video time units (100ns)
+     */
+    explicit StreamLatencyTracker(uint64_t timecode_scale);
+
+    /**
+     * Records the duration of the frame submission and tracks the frame if it starts a fragment
+     *
+     * @param frame The submitted frame
+     * @param put_time Time at which the frame was submitted
+     * @param put_duration Duration of the submission
+     */
+    void recordPutFrame(const Frame& frame,
+                        std::chrono::steady_clock::time_point put_time,
+                        std::chrono::steady_clock::duration put_duration);
+
+    /**
+     * Records the latency of the fragment ack. Acks of untracked fragments are ignored.
+     */
+    void recordFragmentAck(const FragmentAck& fragment_ack);
+
+    LatencyPercentiles getPutFrameLatency() const {
+        return put_frame_latency_.getPercentiles();
+    }
+
+    LatencyPercentiles getBufferingAckLatency() const {
+        return buffering_ack_latency_.getPercentiles();
+    }
+
+    LatencyPercentiles getReceivedAckLatency() const {
+        return received_ack_latency_.getPercentiles();
+    }
+
+    LatencyPercentiles getPersistedAckLatency() const {
+        return persisted_ack_latency_.getPercentiles();
+    }
+
+private:
+    /**
+     * In-flight fragment. The timecode is published last and re-validated by the readers
+     * so that a slot overwritten concurrently is not matched.
+     */
+    struct FragmentSlot {
+        std::atomic<uint64_t> timecode;
+        std::atomic<int64_t> put_time;
+    };
+
+    const uint64_t timecode_scale_;
+
+    LatencyHistogram put_frame_latency_;
+    LatencyHistogram buffering_ack_latency_;
+    LatencyHistogram received_ack_latency_;
+    LatencyHistogram persisted_ack_latency_;
+
+    FragmentSlot fragments_[STREAM_LATENCY_TRACKER_FRAGMENT_COUNT];
+    std::atomic<uint64_t> fragment_index_;
+};
+
+} // namespace video
+} // namespace kinesis
+} // namespace amazonaws
+} // namespace com
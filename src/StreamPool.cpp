@@ -0,0 +1,167 @@
+#include "Logger.h"
+#include "StreamPool.h"
+#include "SdkThread.h"
+
+#include <algorithm>
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+LOGGER_TAG("com.amazonaws.kinesis.video");
+
+using std::chrono::steady_clock;
+using std::shared_ptr;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+StreamPool::StreamPool(KinesisVideoProducer& kinesis_video_producer,
+                       unique_ptr<StreamDefinition> template_definition,
+                       const vector<string>& stream_names,
+                       size_t target_size,
+                       std::chrono::seconds max_idle_time)
+        : kinesis_video_producer_(kinesis_video_producer),
+          template_definition_(move(template_definition)),
+          target_size_(target_size),
+          max_idle_time_(max_idle_time),
+          free_stream_names_(stream_names.begin(), stream_names.end()),
+          pending_count_(0),
+          refill_exit_(false) {
+    LOG_AND_THROW_IF(nullptr == template_definition_, "Stream pool template definition can't be null");
+    memset(&stats_, 0, sizeof(stats_));
+
+    LOG_INFO("Creating stream pool of " << target_size_ << " ready streams out of " << stream_names.size() << " stream names");
+    refill_thread_ = SdkThread::start("pool", [this]() { refillRoutine(); });
+}
+
+StreamPool::~StreamPool() {
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex_);
+        refill_exit_ = true;
+        refill_cv_.notify_all();
+    }
+
+    refill_thread_.join();
+
+    for (auto& idle_stream : idle_streams_) {
+        kinesis_video_producer_.freeStream(idle_stream.stream);
+    }
+}
+
+shared_ptr<KinesisVideoStream> StreamPool::acquire() {
+    string stream_name;
+    {
+        std::unique_lock<std::mutex> lock(pool_mutex_);
+
+        // With all of the names taken a stream being created in the background is awaited
+        ready_cv_.wait(lock, [this]() {
+            return !idle_streams_.empty() || !free_stream_names_.empty() || 0 == pending_count_;
+        });
+
+        if (!idle_streams_.empty()) {
+            // The oldest stream is the closest to the expiry
+            shared_ptr<KinesisVideoStream> kinesis_video_stream = idle_streams_.front().stream;
+            idle_streams_.pop_front();
+            stats_.hits++;
+            refill_cv_.notify_all();
+            return kinesis_video_stream;
+        }
+
+        stats_.misses++;
+        LOG_AND_THROW_IF(free_stream_names_.empty(), "All of the stream pool stream names are in use");
+        stream_name = free_stream_names_.front();
+        free_stream_names_.pop_front();
+    }
+
+    LOG_WARN("Stream pool is empty. Creating stream " << stream_name);
+    return createStream(stream_name);
+}
+
+void StreamPool::release(shared_ptr<KinesisVideoStream> kinesis_video_stream) {
+    if (nullptr == kinesis_video_stream) {
+        return;
+    }
+
+    freeStream(kinesis_video_stream);
+}
+
+StreamPoolStats StreamPool::getStats() const {
+    std::lock_guard<std::mutex> lock(pool_mutex_);
+    StreamPoolStats stats = stats_;
+    stats.ready = idle_streams_.size();
+    return stats;
+}
+
+shared_ptr<KinesisVideoStream> StreamPool::createStream(const string& stream_name) {
+    try {
+        return kinesis_video_producer_.createStreamSync(template_definition_->clone(stream_name));
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(pool_mutex_);
+        free_stream_names_.push_back(stream_name);
+        throw;
+    }
+}
+
+void StreamPool::freeStream(shared_ptr<KinesisVideoStream> kinesis_video_stream) {
+    string stream_name = kinesis_video_stream->getStreamName();
+    kinesis_video_producer_.freeStream(kinesis_video_stream);
+
+    std::lock_guard<std::mutex> lock(pool_mutex_);
+    free_stream_names_.push_back(stream_name);
+    refill_cv_.notify_all();
+}
+
+void StreamPool::refillRoutine() {
+    std::unique_lock<std::mutex> lock(pool_mutex_);
+    while (!refill_exit_) {
+        // Recreate the streams which have been idle for too long
+        auto now = steady_clock::now();
+        if (!idle_streams_.empty() && now - idle_streams_.front().ready_time >= max_idle_time_) {
+            shared_ptr<KinesisVideoStream> kinesis_video_stream = idle_streams_.front().stream;
+            idle_streams_.pop_front();
+            stats_.expired++;
+
+            lock.unlock();
+            LOG_INFO("Recreating idle pooled stream " << kinesis_video_stream->getStreamName());
+            freeStream(kinesis_video_stream);
+            lock.lock();
+            continue;
+        }
+
+        if (idle_streams_.size() + pending_count_ < target_size_ && !free_stream_names_.empty()) {
+            string stream_name = free_stream_names_.front();
+            free_stream_names_.pop_front();
+            pending_count_++;
+
+            lock.unlock();
+            shared_ptr<KinesisVideoStream> kinesis_video_stream;
+            try {
+                kinesis_video_stream = createStream(stream_name);
+            } catch (std::exception& err) {
+                LOG_ERROR("Failed to create pooled stream " << stream_name << ": " << err.what());
+            }
+            lock.lock();
+
+            pending_count_--;
+            ready_cv_.notify_all();
+            if (nullptr != kinesis_video_stream) {
+                idle_streams_.push_back(IdleStream{kinesis_video_stream, steady_clock::now()});
+                continue;
+            }
+
+            // The name is back in the free names and is retried after backing off until the next period
+            stats_.refill_failures++;
+        }
+
+        auto wait_time = std::chrono::duration_cast<steady_clock::duration>(std::chrono::milliseconds(STREAM_POOL_REFILL_PERIOD_MILLIS));
+        if (!idle_streams_.empty()) {
+            wait_time = std::min(wait_time, idle_streams_.front().ready_time + max_idle_time_ - now);
+        }
+
+        refill_cv_.wait_for(lock, wait_time);
+    }
+}
+
+} // namespace video
+} // namespace kinesis
+} // namespace amazonaws
+} // namespace com
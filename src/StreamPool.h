@@ -0,0 +1,157 @@
+/** Copyright 2017 Amazon.com. All rights reserved. */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "KinesisVideoProducer.h"
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+/**
+ * Default time a ready stream may stay in the pool before it's recreated with a fresh streaming token
+ */
+#define DEFAULT_STREAM_POOL_MAX_IDLE_SECONDS 1200
+
+/**
+ * How often the refill thread retries after a failed stream creation and checks the idle streams for expiry
+ */
+#define STREAM_POOL_REFILL_PERIOD_MILLIS 1000
+
+/**
+ * Stream pool statistics
+ */
+struct StreamPoolStats {
+    /**
+     * Number of the acquisitions served with a ready stream from the pool
+     */
+    uint64_t hits;
+
+    /**
+     * Number of the acquisitions which had to create the stream
+     */
+    uint64_t misses;
+
+    /**
+     * Number of the ready streams recreated after staying in the pool for too long
+     */
+    uint64_t expired;
+
+    /**
+     * Number of the failed background stream creations
+     */
+    uint64_t refill_failures;
+
+    /**
+     * Number of the ready streams in the pool
+     */
+    size_t ready;
+};
+
+/**
+ * Pool of the pre-created streams which are ready to stream.
+ *
+ * The streams are created in the background from a template definition with the names taken from
+ * a fixed set so an acquired stream is handed over without waiting on the control plane calls. The
+ * pool keeps up to the target number of the ready streams and recreates the ones which stayed idle
+ * for longer than the max idle time so the handed over streams never carry a stale streaming token.
+ *
+ * Example Usage:
+ * @code:
+ * StreamPool stream_pool(*kinesis_video_producer, move(template_definition), {"camera_0", "camera_1", "camera_2"}, 2);
+ * auto kinesis_video_stream = stream_pool.acquire();
+ * ...
+ * kinesis_video_stream->stopSync();
+ * stream_pool.release(kinesis_video_stream);
+ * @endcode
+ *
+ * NOTE: The pool must be destroyed before the producer.
+ */
+class StreamPool {
+public:
+    /**
+     * @param kinesis_video_producer The producer to create the streams with.
+     * @param template_definition The definition the streams are cloned from.
+     * @param stream_names The names of the streams the pool may create. Each name is used by a single stream at a time.
+     * @param target_size The number of the ready streams to keep in the pool.
+     * @param max_idle_time The time after which an idle ready stream is recreated.
+     */
+    StreamPool(KinesisVideoProducer& kinesis_video_producer,
+               std::unique_ptr<StreamDefinition> template_definition,
+               const std::vector<std::string>& stream_names,
+               size_t target_size,
+               std::chrono::seconds max_idle_time = std::chrono::seconds(DEFAULT_STREAM_POOL_MAX_IDLE_SECONDS));
+
+    /**
+     * Stops the refill and frees the ready streams. The acquired streams are left to the caller.
+     */
+    ~StreamPool();
+
+    /**
+     * Hands over a ready stream. Creates the stream synchronously if the pool is empty
+     * or awaits for the stream being created by the refill if all of the names are taken.
+     *
+     * @return The ready stream.
+     * @throws std::runtime_error if all of the names are in use or the stream creation fails.
+     */
+    std::shared_ptr<KinesisVideoStream> acquire();
+
+    /**
+     * Frees an acquired stream and makes its name available for the refill.
+     * The stream is expected to have been stopped.
+     */
+    void release(std::shared_ptr<KinesisVideoStream> kinesis_video_stream);
+
+    StreamPoolStats getStats() const;
+
+private:
+    struct IdleStream {
+        std::shared_ptr<KinesisVideoStream> stream;
+        std::chrono::steady_clock::time_point ready_time;
+    };
+
+    void refillRoutine();
+
+    /**
+     * Creates a stream with the name. Returns the name to the free names on failure.
+     */
+    std::shared_ptr<KinesisVideoStream> createStream(const std::string& stream_name);
+
+    /**
+     * Frees a stream and returns its name to the free names
+     */
+    void freeStream(std::shared_ptr<KinesisVideoStream> kinesis_video_stream);
+
+    KinesisVideoProducer& kinesis_video_producer_;
+    const std::unique_ptr<StreamDefinition> template_definition_;
+    const size_t target_size_;
+    const std::chrono::seconds max_idle_time_;
+
+    mutable std::mutex pool_mutex_;
+    std::condition_variable refill_cv_;
+    std::condition_variable ready_cv_;
+    std::deque<IdleStream> idle_streams_;
+    std::deque<std::string> free_stream_names_;
+
+    /**
+     * Number of the streams being created by the refill thread
+     */
+    size_t pending_count_;
+    bool refill_exit_;
+
+    StreamPoolStats stats_;
+
+    std::thread refill_thread_;
+};
+
+} // namespace video
+} // namespace kinesis
+} // namespace amazonaws
+} // namespace com
@@ -8,14 +8,29 @@ using std::get;
 using std::string;
 using std::map;
 
-StreamTags::StreamTags(const map<string, string>* tags) : tags_(tags) {}
+StreamTags::StreamTags(const map<string, string>* tags)
+        : tags_(nullptr == tags ? nullptr : std::make_shared<const map<string, string>>(*tags)) {}
 
-PTag StreamTags::asPTag() const {
+size_t StreamTags::getMaterializedSize() const {
     if (nullptr == tags_) {
+        return 0;
+    }
+
+    size_t size = sizeof(Tag) * tags_->size();
+    for (const auto &pair : *tags_) {
+        size += get<0>(pair).size() + 1 + get<1>(pair).size() + 1;
+    }
+
+    return size;
+}
+
+PTag StreamTags::materialize(PBYTE buffer) const {
+    if (nullptr == tags_ || tags_->empty()) {
         return nullptr;
     }
 
-    PTag tags = reinterpret_cast<PTag>(malloc(sizeof(Tag) * tags_->size()));
+    PTag tags = reinterpret_cast<PTag>(buffer);
+    PCHAR strings = reinterpret_cast<PCHAR>(buffer + sizeof(Tag) * tags_->size());
     size_t i = 0;
     for (const auto &pair : *tags_) {
         Tag &tag = tags[i];
@@ -25,10 +40,13 @@ PTag StreamTags::asPTag() const {
         assert(MAX_TAG_NAME_LEN >= name.size());
         assert(MAX_TAG_VALUE_LEN >= val.size());
 
-        tag.name = reinterpret_cast<PCHAR>(calloc(name.size() + 1, name.size()));
-        tag.value = reinterpret_cast<PCHAR>(calloc(val.size() + 1, val.size()));
-        std::memcpy(tag.name, name.c_str(), name.size());
-        std::memcpy(tag.value, val.c_str(), val.size());
+        tag.name = strings;
+        std::memcpy(strings, name.c_str(), name.size() + 1);
+        strings += name.size() + 1;
+
+        tag.value = strings;
+        std::memcpy(strings, val.c_str(), val.size() + 1);
+        strings += val.size() + 1;
         ++i;
     }
 
@@ -6,6 +6,7 @@
 
 #include <map>
 #include <cstring>
+#include <memory>
 #include <string>
 
 namespace com { namespace amazonaws { namespace kinesis { namespace video {
@@ -15,6 +16,9 @@ namespace com { namespace amazonaws { namespace kinesis { namespace video {
 */
 class StreamTags {
 public:
+    /**
+     * @param tags The tags to set. Copied. nullptr for no tags.
+     */
     explicit StreamTags(const std::map<std::string, std::string>* tags);
 
     /**
@@ -23,17 +27,26 @@ public:
     size_t count() const;
 
     /**
-     * Convenience method to translate the tags into an Kinesis Video SDK representation of the tags.
+     * @return The size of the buffer needed by materialize().
+     */
+    size_t getMaterializedSize() const;
+
+    /**
+     * Translates the tags into an Kinesis Video SDK representation laid out in the given buffer.
+     * The tag array comes first followed by the tag names and values.
+     *
+     * @param buffer Buffer of at least getMaterializedSize() bytes aligned for Tag.
+     * @return The tag array in the buffer or nullptr if there are no tags.
      */
-    PTag asPTag() const;
+    PTag materialize(PBYTE buffer) const;
 
 private:
 
     /**
      * Mapping of key/val pairs which are to be set on the Kinesis Video stream for which the tags are associated in the
-     * stream definition.
+     * stream definition. Immutable so the copies share the map.
      */
-    const std::map<std::string, std::string>* tags_;
+    std::shared_ptr<const std::map<std::string, std::string>> tags_;
 
 };
 
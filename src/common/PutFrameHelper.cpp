@@ -27,6 +27,13 @@ void PutFrameHelper::putFrameMultiTrack(Frame frame, bool isVideo) {
     }
 }
 
+void PutFrameHelper::putFrameMultiTrack(Frame frame, FrameBuffer frame_buffer, bool isVideo) {
+    if (!kinesis_video_stream->putFrame(frame, std::move(frame_buffer))) {
+        put_frame_status = false;
+        LOG_WARN("Failed to put normal frame");
+    }
+}
+
 void PutFrameHelper::flush() {
     // no-op
 }
@@ -56,6 +56,12 @@ public:
      */
     void putFrameMultiTrack(Frame frame, bool isVideo);
 
+    /*
+     * same as putFrameMultiTrack() except that the frame payload is handed over to the sdk, so the application
+     * does not need to copy the frame data into the buffer returned by getFrameDataBuffer().
+     */
+    void putFrameMultiTrack(Frame frame, FrameBuffer frame_buffer, bool isVideo);
+
     /*
      * application should call flush() at end of file to release any frames still in queue.
      */
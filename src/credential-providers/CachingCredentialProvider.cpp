@@ -0,0 +1,73 @@
+#include "CachingCredentialProvider.h"
+#include <sstream>
+
+LOGGER_TAG("com.amazonaws.kinesis.video");
+
+using namespace com::amazonaws::kinesis::video;
+using namespace std;
+
+CachingCredentialProvider::CachingCredentialProvider(unique_ptr<CredentialProvider> credential_provider,
+                                                     const string& cache_file_path,
+                                                     const string& cache_key)
+        : CachingCredentialProvider(move(credential_provider), make_shared<PersistentCache>(cache_file_path), cache_key) {
+    cache_->load();
+}
+
+CachingCredentialProvider::CachingCredentialProvider(unique_ptr<CredentialProvider> credential_provider,
+                                                     shared_ptr<PersistentCache> cache,
+                                                     const string& cache_key)
+        : credential_provider_(move(credential_provider)),
+          cache_(cache),
+          cache_key_(cache_key) {
+    LOG_AND_THROW_IF(nullptr == credential_provider_, "Credential provider can't be null");
+    LOG_AND_THROW_IF(nullptr == cache_, "Persistent cache can't be null");
+}
+
+void CachingCredentialProvider::updateCredentials(Credentials& credentials) {
+    // Compared in seconds as the expiration of the non-expiring credentials overflows the finer durations
+    auto now_time = std::chrono::duration_cast<std::chrono::seconds>(systemCurrentTime().time_since_epoch());
+    PersistentCacheEntry entry;
+    Credentials cached_credentials;
+    bool cached = false;
+
+    if (cache_->get(cache_key_, entry)) {
+        cached = deserializeCredentials(entry, cached_credentials);
+    }
+
+    if (cached && now_time + CredentialProviderGracePeriod < entry.expiration) {
+        LOG_DEBUG("Using the persisted credentials " << cache_key_ << " expiring at " << entry.expiration.count());
+        credentials = cached_credentials;
+        return;
+    }
+
+    try {
+        credential_provider_->getUpdatedCredentials(credentials);
+    } catch (std::runtime_error& err) {
+        if (!cached || now_time >= entry.expiration) {
+            throw;
+        }
+
+        LOG_WARN("Failed to refresh credentials: " << err.what() << ". Falling back onto the stale persisted credentials " << cache_key_);
+        credentials = cached_credentials;
+        return;
+    }
+
+    cache_->put(cache_key_, serializeCredentials(credentials), credentials.getExpiration());
+}
+
+string CachingCredentialProvider::serializeCredentials(const Credentials& credentials) {
+    // The keys and the token never contain new lines
+    return credentials.getAccessKey() + "\n" + credentials.getSecretKey() + "\n" + credentials.getSessionToken();
+}
+
+bool CachingCredentialProvider::deserializeCredentials(const PersistentCacheEntry& entry, Credentials& credentials) {
+    std::istringstream value(entry.value);
+    string access_key, secret_key, session_token;
+    if (!getline(value, access_key) || !getline(value, secret_key)) {
+        return false;
+    }
+
+    getline(value, session_token);
+    credentials = Credentials(access_key, secret_key, session_token, entry.expiration);
+    return true;
+}
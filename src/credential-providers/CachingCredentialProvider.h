@@ -0,0 +1,68 @@
+#ifndef __CACHING_CREDENTIAL_PROVIDER_H__
+#define __CACHING_CREDENTIAL_PROVIDER_H__
+
+#include <memory>
+#include <string>
+
+#include "Auth.h"
+#include "PersistentCache.h"
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+    /**
+     * Credential provider which persists the credentials of the wrapped provider along with their
+     * expiration so a restarted process reuses them instead of fetching new ones for every stream.
+     *
+     * The persisted credentials are used until they are within the grace period of their expiration.
+     * If the wrapped provider fails to refresh them, the stale credentials are used until they expire.
+     *
+     * NOTE: Only the providers refreshing the credentials in updateCredentials can be wrapped. The ones
+     * handing over the C producer auth callbacks, like the IoT and the rotating file providers, can't.
+     */
+    class CachingCredentialProvider : public CredentialProvider {
+    public:
+        /**
+         * @param credential_provider The provider to fetch the credentials with.
+         * @param cache_file_path The file to persist the credentials in.
+         * @param cache_key The key of the credentials in the cache, identifying the wrapped provider.
+         */
+        CachingCredentialProvider(std::unique_ptr<CredentialProvider> credential_provider,
+                                  const std::string& cache_file_path,
+                                  const std::string& cache_key = "credentials");
+
+        /**
+         * @param credential_provider The provider to fetch the credentials with.
+         * @param cache The cache to persist the credentials in. Allows several providers to share a file.
+         * @param cache_key The key of the credentials in the cache, identifying the wrapped provider.
+         */
+        CachingCredentialProvider(std::unique_ptr<CredentialProvider> credential_provider,
+                                  std::shared_ptr<PersistentCache> cache,
+                                  const std::string& cache_key);
+
+        /**
+         * Serializes the keys and the token of the credentials into a persistent cache value
+         */
+        static std::string serializeCredentials(const Credentials& credentials);
+
+        /**
+         * Restores the credentials from a persistent cache entry
+         *
+         * @return false if the entry doesn't hold credentials.
+         */
+        static bool deserializeCredentials(const PersistentCacheEntry& entry, Credentials& credentials);
+
+    protected:
+        void updateCredentials(Credentials& credentials) override;
+
+    private:
+        std::unique_ptr<CredentialProvider> credential_provider_;
+        std::shared_ptr<PersistentCache> cache_;
+        const std::string cache_key_;
+    };
+
+}
+}
+}
+}
+
+#endif /* __CACHING_CREDENTIAL_PROVIDER_H__ */
@@ -0,0 +1,259 @@
+#include "CredentialFileWatcher.h"
+#include "SdkThread.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <vector>
+#include <sstream>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#endif
+
+LOGGER_TAG("com.amazonaws.kinesis.video");
+
+using namespace com::amazonaws::kinesis::video;
+using namespace std;
+
+namespace {
+
+/**
+ * The credential file keyword preceding the credentials
+ */
+const char CREDENTIAL_FILE_KEYWORD[] = "CREDENTIALS";
+
+/**
+ * Size of the inotify event buffer. Fits a number of events for the long file names.
+ */
+const size_t INOTIFY_EVENT_BUFFER_SIZE = 4096;
+
+mutex g_watchers_mutex;
+map<string, weak_ptr<CredentialFileWatcher>> g_watchers;
+
+/**
+ * Converts a civil UTC date into the days since the epoch without depending on timegm
+ */
+int64_t daysFromCivil(int64_t year, uint32_t month, uint32_t day) {
+    year -= month <= 2;
+    const int64_t era = (year >= 0 ? year : year - 399) / 400;
+    const uint32_t year_of_era = (uint32_t) (year - era * 400);
+    const uint32_t day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const uint32_t day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + (int64_t) day_of_era - 719468;
+}
+
+bool parseExpiration(const string& value, chrono::duration<uint64_t>& expiration) {
+    int year, month, day, hour, minute, second;
+    if (6 != sscanf(value.c_str(), "%4d-%2d-%2dT%2d:%2d:%2d", &year, &month, &day, &hour, &minute, &second) ||
+        month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60) {
+        return false;
+    }
+
+    int64_t epoch_seconds = daysFromCivil(year, (uint32_t) month, (uint32_t) day) * 86400 + hour * 3600 + minute * 60 + second;
+    if (epoch_seconds < 0) {
+        return false;
+    }
+
+    expiration = chrono::seconds(epoch_seconds);
+    return true;
+}
+
+} // namespace
+
+shared_ptr<CredentialFileWatcher> CredentialFileWatcher::getInstance(const string& credential_file_path) {
+    lock_guard<mutex> lock(g_watchers_mutex);
+    auto watcher = g_watchers[credential_file_path].lock();
+    if (nullptr == watcher) {
+        watcher.reset(new CredentialFileWatcher(credential_file_path));
+        g_watchers[credential_file_path] = watcher;
+    }
+
+    return watcher;
+}
+
+CredentialFileWatcher::CredentialFileWatcher(const string& credential_file_path)
+        : credential_file_path_(credential_file_path),
+          parse_count_(0),
+          watch_exit_(false) {
+    wakeup_pipe_[0] = wakeup_pipe_[1] = -1;
+    reload();
+    LOG_AND_THROW_IF(nullptr == getCredentials(), "Unable to read credentials from " + credential_file_path_);
+
+#if !defined(_WIN32)
+    if (0 != ::pipe(wakeup_pipe_)) {
+        wakeup_pipe_[0] = wakeup_pipe_[1] = -1;
+    }
+#endif
+
+    watch_thread_ = SdkThread::start("cred-file", [this]() { watchRoutine(); });
+}
+
+CredentialFileWatcher::~CredentialFileWatcher() {
+    {
+        lock_guard<mutex> lock(watch_mutex_);
+        watch_exit_ = true;
+        watch_cv_.notify_all();
+    }
+
+#if !defined(_WIN32)
+    if (wakeup_pipe_[1] >= 0) {
+        char wakeup = 0;
+        while (::write(wakeup_pipe_[1], &wakeup, 1) < 0 && EINTR == errno);
+    }
+#endif
+
+    watch_thread_.join();
+
+#if !defined(_WIN32)
+    if (wakeup_pipe_[0] >= 0) {
+        ::close(wakeup_pipe_[0]);
+        ::close(wakeup_pipe_[1]);
+    }
+#endif
+}
+
+bool CredentialFileWatcher::parseCredentials(const string& contents, Credentials& credentials) {
+    istringstream stream(contents);
+    chrono::duration<uint64_t> expiration;
+    vector<string> values;
+    string value;
+    while (stream >> value) {
+        values.push_back(value);
+    }
+
+    if (values.empty() || CREDENTIAL_FILE_KEYWORD != values[0]) {
+        return false;
+    }
+
+    if (3 == values.size()) {
+        credentials = Credentials(values[1], values[2]);
+        return true;
+    }
+
+    if (5 == values.size() && parseExpiration(values[2], expiration)) {
+        credentials = Credentials(values[1], values[3], values[4], expiration);
+        return true;
+    }
+
+    return false;
+}
+
+bool CredentialFileWatcher::reload() {
+    ifstream in(credential_file_path_, ios::in | ios::binary);
+    if (!in) {
+        LOG_WARN("Unable to open the credential file " << credential_file_path_);
+        return false;
+    }
+
+    stringstream contents;
+    contents << in.rdbuf();
+    if (nullptr != getCredentials() && contents.str() == contents_) {
+        return true;
+    }
+
+    parse_count_++;
+    auto credentials = make_shared<Credentials>();
+    if (!parseCredentials(contents.str(), *credentials)) {
+        // Keep the current credentials as the file may be in the middle of being rewritten
+        LOG_WARN("Invalid credential file " << credential_file_path_);
+        return false;
+    }
+
+    contents_ = contents.str();
+    atomic_store(&credentials_, shared_ptr<const Credentials>(credentials));
+    LOG_INFO("Loaded credentials from " << credential_file_path_ << " expiring at " << credentials->getExpiration().count());
+    return true;
+}
+
+void CredentialFileWatcher::watchRoutine() {
+    if (watchNotifications()) {
+        return;
+    }
+
+    LOG_INFO("Polling the credential file " << credential_file_path_ << " every " << CREDENTIAL_FILE_POLL_PERIOD_SECONDS << " seconds");
+    unique_lock<mutex> lock(watch_mutex_);
+    while (!watch_exit_) {
+        watch_cv_.wait_for(lock, chrono::seconds(CREDENTIAL_FILE_POLL_PERIOD_SECONDS), [this]() { return watch_exit_; });
+        if (!watch_exit_) {
+            lock.unlock();
+            reload();
+            lock.lock();
+        }
+    }
+}
+
+bool CredentialFileWatcher::watchNotifications() {
+#if defined(__linux__)
+    if (wakeup_pipe_[0] < 0) {
+        return false;
+    }
+
+    size_t separator = credential_file_path_.find_last_of('/');
+    string directory = string::npos == separator ? "." : (0 == separator ? "/" : credential_file_path_.substr(0, separator));
+    string file_name = string::npos == separator ? credential_file_path_ : credential_file_path_.substr(separator + 1);
+
+    int fd = ::inotify_init1(IN_CLOEXEC);
+    if (fd < 0) {
+        LOG_WARN("Unable to watch the credential file. inotify_init1 failed with errno " << errno);
+        return false;
+    }
+
+    // Written in place or replaced by a rename
+    if (::inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        LOG_WARN("Unable to watch the credential file directory " << directory << ". errno " << errno);
+        ::close(fd);
+        return false;
+    }
+
+    // Pick up the changes made before the watch was added
+    reload();
+
+    alignas(struct inotify_event) char buffer[INOTIFY_EVENT_BUFFER_SIZE];
+    bool watching = true;
+    while (watching) {
+        struct pollfd fds[2] = {{fd, POLLIN, 0}, {wakeup_pipe_[0], POLLIN, 0}};
+        if (::poll(fds, 2, -1) < 0) {
+            watching = EINTR == errno;
+            continue;
+        }
+
+        if (0 != fds[1].revents) {
+            break;
+        }
+
+        ssize_t length = ::read(fd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            watching = length < 0 && EINTR == errno;
+            continue;
+        }
+
+        bool changed = false;
+        for (char* ptr = buffer; ptr < buffer + length;) {
+            auto event = reinterpret_cast<const struct inotify_event*>(ptr);
+            changed = changed || (event->len > 0 && file_name == event->name);
+            ptr += sizeof(struct inotify_event) + event->len;
+        }
+
+        if (changed) {
+            reload();
+        }
+    }
+
+    ::close(fd);
+    if (!watching) {
+        LOG_WARN("Failed watching the credential file " << credential_file_path_ << ". errno " << errno);
+    }
+
+    return watching;
+#else
+    return false;
+#endif
+}
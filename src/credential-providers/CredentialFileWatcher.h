@@ -0,0 +1,101 @@
+#ifndef __CREDENTIAL_FILE_WATCHER_H__
+#define __CREDENTIAL_FILE_WATCHER_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "Auth.h"
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+    /**
+     * How often the credential file is re-read where the file change notifications aren't available
+     */
+    #define CREDENTIAL_FILE_POLL_PERIOD_SECONDS 5
+
+    /**
+     * Keeps the credentials parsed out of a credential file up to date.
+     *
+     * The file is parsed once up front and then only when it changes, as notified by inotify on Linux
+     * or found by polling the file contents elsewhere. The directory is watched rather than the file
+     * itself so the rotations replacing the file are picked up. A single watcher is shared by all of
+     * the providers of the file in the process.
+     *
+     * The file holds either the static credentials
+     *     CREDENTIALS <access key> <secret key>
+     * or the rotating ones expiring at an ISO 8601 UTC time
+     *     CREDENTIALS <access key> <expiration, e.g. 2019-01-01T00:00:00Z> <secret key> <session token>
+     */
+    class CredentialFileWatcher {
+    public:
+        /**
+         * Gets the watcher of the file shared in the process. Creates it on the first use.
+         *
+         * @throws std::runtime_error if the file can't be read or parsed.
+         */
+        static std::shared_ptr<CredentialFileWatcher> getInstance(const std::string& credential_file_path);
+
+        ~CredentialFileWatcher();
+
+        /**
+         * @return The credentials from the last successfully parsed version of the file.
+         */
+        std::shared_ptr<const Credentials> getCredentials() const {
+            return std::atomic_load(&credentials_);
+        }
+
+        /**
+         * @return How many times the file has been parsed.
+         */
+        uint64_t getParseCount() const {
+            return parse_count_;
+        }
+
+        /**
+         * Parses the credential file contents.
+         *
+         * @return false if the contents are not in either of the credential file formats.
+         */
+        static bool parseCredentials(const std::string& contents, Credentials& credentials);
+
+    private:
+        explicit CredentialFileWatcher(const std::string& credential_file_path);
+
+        /**
+         * Reads the file and publishes the credentials if the contents have changed
+         */
+        bool reload();
+
+        void watchRoutine();
+
+        /**
+         * @return false if the file change notifications are unavailable and the file needs to be polled.
+         */
+        bool watchNotifications();
+
+        const std::string credential_file_path_;
+        std::shared_ptr<const Credentials> credentials_;
+        std::string contents_;
+        std::atomic<uint64_t> parse_count_;
+
+        std::mutex watch_mutex_;
+        std::condition_variable watch_cv_;
+        bool watch_exit_;
+
+        /**
+         * Wakes up the notification wait on shutdown
+         */
+        int wakeup_pipe_[2];
+        std::thread watch_thread_;
+    };
+
+}
+}
+}
+}
+
+#endif /* __CREDENTIAL_FILE_WATCHER_H__ */
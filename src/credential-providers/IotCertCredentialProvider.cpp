@@ -4,10 +4,36 @@ LOGGER_TAG("com.amazonaws.kinesis.video");
 
 using namespace com::amazonaws::kinesis::video;
 
+IotCertCredentialProvider::~IotCertCredentialProvider() {
+    stopCredentialRefresh();
+}
+
+void IotCertCredentialProvider::updateCredentials(Credentials& credentials) {
+    if (!shared_credential_cache_) {
+        return;
+    }
+
+    IotCredentialParams params;
+    params.iot_get_credential_endpoint = iot_get_credential_endpoint_;
+    params.cert_path = cert_path_;
+    params.private_key_path = private_key_path_;
+    params.role_alias = role_alias_;
+    params.ca_cert_path = ca_cert_path_;
+    params.thing_name = stream_name_;
+
+    // Required to outlive the next background refresh so the providers refresh off the same fetch
+    credentials = IotCredentialCache::getInstance().getCredentials(params,
+            CredentialProviderGracePeriod + std::chrono::seconds(CREDENTIAL_REFRESH_AHEAD_SECONDS));
+}
+
 IotCertCredentialProvider::callback_t IotCertCredentialProvider::getCallbacks(PClientCallbacks client_callbacks)
 {
     STATUS retStatus = STATUS_SUCCESS;
 
+    if (shared_credential_cache_) {
+        return CredentialProvider::getCallbacks(client_callbacks);
+    }
+
     LOG_DEBUG("Creating IoT auth callbacks.");
     if (STATUS_FAILED(retStatus = createIotAuthCallbacks(client_callbacks,
                            STRING_TO_PCHAR(iot_get_credential_endpoint_),
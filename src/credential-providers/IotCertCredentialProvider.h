@@ -3,12 +3,14 @@
 
 #include <string>
 #include <Auth.h>
+#include "IotCredentialCache.h"
 
 namespace com { namespace amazonaws { namespace kinesis { namespace video {
     class IotCertCredentialProvider : public CredentialProvider {
         PAuthCallbacks iot_callbacks;
         const std::string iot_get_credential_endpoint_, cert_path_, private_key_path_, ca_cert_path_,
 	                  role_alias_,stream_name_;
+        const bool shared_credential_cache_;
 
     public:
         IotCertCredentialProvider(const std::string iot_get_credential_endpoint,
@@ -16,19 +18,33 @@ namespace com { namespace amazonaws { namespace kinesis { namespace video {
                                   const std::string private_key_path,
                                   const std::string role_alias,
                                   const std::string ca_cert_path,
- 				    const std::string stream_name):
+ 				    const std::string stream_name,
+                                  bool shared_credential_cache = false):
                 iot_get_credential_endpoint_(iot_get_credential_endpoint),
                 cert_path_(cert_path),
                 private_key_path_(private_key_path),
                 role_alias_(role_alias),
                 ca_cert_path_(ca_cert_path),
-	          stream_name_(stream_name) {}
+	          stream_name_(stream_name),
+                shared_credential_cache_(shared_credential_cache) {}
 
-        void updateCredentials(Credentials& credentials) override {
-            // no-op as credential update is handled in c producer iot auth callbacks
-        }
+        ~IotCertCredentialProvider();
+
+        /**
+         * Gets the credentials from the process-wide IoT credential cache when it's shared. Otherwise
+         * no-op as credential update is handled in c producer iot auth callbacks.
+         */
+        void updateCredentials(Credentials& credentials) override;
 
         callback_t getCallbacks(PClientCallbacks) override;
+
+    protected:
+        /**
+         * The c producer iot auth callbacks fetch the credentials by themselves
+         */
+        bool isCredentialRefreshNeeded() const override {
+            return shared_credential_cache_;
+        }
     };
 
 }
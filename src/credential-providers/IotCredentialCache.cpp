@@ -0,0 +1,124 @@
+#include "IotCredentialCache.h"
+#include "CachingCredentialProvider.h"
+
+#include <sstream>
+
+LOGGER_TAG("com.amazonaws.kinesis.video");
+
+using namespace com::amazonaws::kinesis::video;
+using namespace std;
+
+IotCredentialCache::IotCredentialCache() : fetch_func_(fetchCredentials), fetch_count_(0) {
+}
+
+IotCredentialCache& IotCredentialCache::getInstance() {
+    static IotCredentialCache instance;
+    return instance;
+}
+
+string IotCredentialCache::getCacheKey(const IotCredentialParams& params) {
+    return "iot|" + params.iot_get_credential_endpoint + "|" + params.role_alias + "|" + params.thing_name;
+}
+
+Credentials IotCredentialCache::getCredentials(const IotCredentialParams& params, chrono::duration<uint64_t> min_validity) {
+    const string cache_key = getCacheKey(params);
+    shared_ptr<Entry> entry;
+    shared_ptr<PersistentCache> persistent_cache;
+    FetchFunc fetch_func;
+    {
+        lock_guard<mutex> lock(cache_mutex_);
+        auto& cache_entry = entries_[cache_key];
+        if (nullptr == cache_entry) {
+            cache_entry = make_shared<Entry>();
+        }
+
+        entry = cache_entry;
+        persistent_cache = persistent_cache_;
+        fetch_func = fetch_func_;
+    }
+
+    // The callers waiting on the fetch in progress pick up its result
+    lock_guard<mutex> fetch_lock(entry->fetch_mutex);
+
+    // Compared in seconds as the expiration of the non-expiring credentials overflows the finer durations
+    auto now_time = chrono::duration_cast<chrono::seconds>(systemCurrentTime().time_since_epoch());
+    if (nullptr != entry->credentials && now_time + min_validity <= entry->credentials->getExpiration()) {
+        return *entry->credentials;
+    }
+
+    PersistentCacheEntry persisted_entry;
+    Credentials credentials;
+    if (nullptr != persistent_cache && persistent_cache->get(cache_key, persisted_entry) &&
+        CachingCredentialProvider::deserializeCredentials(persisted_entry, credentials) &&
+        now_time + min_validity <= credentials.getExpiration()) {
+        LOG_INFO("Using the persisted IoT credentials of " << cache_key);
+    } else {
+        LOG_INFO("Fetching IoT credentials of " << cache_key);
+        fetch_count_++;
+        credentials = fetch_func(params);
+        if (nullptr != persistent_cache) {
+            persistent_cache->put(cache_key, CachingCredentialProvider::serializeCredentials(credentials), credentials.getExpiration());
+        }
+    }
+
+    entry->credentials = make_shared<const Credentials>(credentials);
+    return credentials;
+}
+
+void IotCredentialCache::setPersistentCachePath(const string& cache_file_path) {
+    lock_guard<mutex> lock(cache_mutex_);
+    if (cache_file_path.empty()) {
+        persistent_cache_ = nullptr;
+        return;
+    }
+
+    if (nullptr != persistent_cache_ && cache_file_path == persistent_cache_->getFilePath()) {
+        return;
+    }
+
+    auto persistent_cache = make_shared<PersistentCache>(cache_file_path);
+    persistent_cache->load();
+    persistent_cache_ = persistent_cache;
+}
+
+void IotCredentialCache::setFetchFunc(FetchFunc fetch_func) {
+    lock_guard<mutex> lock(cache_mutex_);
+    fetch_func_ = nullptr == fetch_func ? FetchFunc(fetchCredentials) : fetch_func;
+}
+
+void IotCredentialCache::clear() {
+    lock_guard<mutex> lock(cache_mutex_);
+    entries_.clear();
+}
+
+Credentials IotCredentialCache::fetchCredentials(const IotCredentialParams& params) {
+    STATUS retStatus = STATUS_SUCCESS;
+    PAwsCredentialProvider iot_credential_provider = NULL;
+    PAwsCredentials aws_credentials = NULL;
+    Credentials credentials;
+
+    if (STATUS_SUCCEEDED(retStatus = createCurlIotCredentialProvider(STRING_TO_PCHAR(params.iot_get_credential_endpoint),
+                                                                     STRING_TO_PCHAR(params.cert_path),
+                                                                     STRING_TO_PCHAR(params.private_key_path),
+                                                                     STRING_TO_PCHAR(params.ca_cert_path),
+                                                                     STRING_TO_PCHAR(params.role_alias),
+                                                                     STRING_TO_PCHAR(params.thing_name),
+                                                                     &iot_credential_provider)) &&
+        STATUS_SUCCEEDED(retStatus = iot_credential_provider->getCredentialsFn(iot_credential_provider, &aws_credentials))) {
+        credentials = Credentials(string(aws_credentials->accessKeyId, aws_credentials->accessKeyIdLen),
+                                  string(aws_credentials->secretKey, aws_credentials->secretKeyLen),
+                                  string(aws_credentials->sessionToken, aws_credentials->sessionTokenLen),
+                                  chrono::seconds(aws_credentials->expiration / HUNDREDS_OF_NANOS_IN_A_SECOND));
+    }
+
+    // The credentials are owned by the provider
+    freeIotCredentialProvider(&iot_credential_provider);
+
+    if (STATUS_FAILED(retStatus)) {
+        std::stringstream status_strstrm;
+        status_strstrm << std::hex << retStatus;
+        LOG_AND_THROW("Unable to fetch Iot credentials. Error status: 0x" + status_strstrm.str());
+    }
+
+    return credentials;
+}
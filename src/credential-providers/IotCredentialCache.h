@@ -0,0 +1,107 @@
+#ifndef __IOT_CREDENTIAL_CACHE_H__
+#define __IOT_CREDENTIAL_CACHE_H__
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "Auth.h"
+#include "PersistentCache.h"
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+    /**
+     * Parameters of the IoT role alias credential fetch
+     */
+    struct IotCredentialParams {
+        std::string iot_get_credential_endpoint;
+        std::string cert_path;
+        std::string private_key_path;
+        std::string role_alias;
+        std::string ca_cert_path;
+        std::string thing_name;
+    };
+
+    /**
+     * Process-wide cache of the IoT role alias credentials.
+     *
+     * The credentials are keyed by the endpoint, the role alias and the thing name so the producers of
+     * the same thing share them. When the credentials need a refresh, the first caller fetches them while
+     * the concurrent callers wait for and reuse the result, so the mTLS handshake happens once per key.
+     * The credentials can be persisted so a restarted process reuses them as well.
+     */
+    class IotCredentialCache {
+    public:
+        /**
+         * Fetches the credentials. Throws std::runtime_error on failure.
+         */
+        using FetchFunc = std::function<Credentials(const IotCredentialParams&)>;
+
+        static IotCredentialCache& getInstance();
+
+        /**
+         * Gets the credentials, fetching them only if the cached ones expire sooner than the required validity.
+         *
+         * @param params The fetch parameters.
+         * @param min_validity How long the returned credentials need to remain valid for.
+         * @throws std::runtime_error if the fetch fails.
+         */
+        Credentials getCredentials(const IotCredentialParams& params, std::chrono::duration<uint64_t> min_validity);
+
+        /**
+         * Persists the credentials in the file and reuses the ones persisted there earlier.
+         * The file is only set up once, the later calls with the same path are no-op. An empty path stops persisting.
+         */
+        void setPersistentCachePath(const std::string& cache_file_path);
+
+        /**
+         * Replaces the credential fetch. Null restores the default fetch through the c producer IoT credential provider.
+         */
+        void setFetchFunc(FetchFunc fetch_func);
+
+        /**
+         * Drops the credentials cached in memory
+         */
+        void clear();
+
+        /**
+         * @return Number of the fetches.
+         */
+        uint64_t getFetchCount() const {
+            return fetch_count_;
+        }
+
+        /**
+         * Fetches the credentials through the c producer IoT credential provider
+         */
+        static Credentials fetchCredentials(const IotCredentialParams& params);
+
+    private:
+        struct Entry {
+            /**
+             * Serializes the fetches of the key
+             */
+            std::mutex fetch_mutex;
+            std::shared_ptr<const Credentials> credentials;
+        };
+
+        IotCredentialCache();
+
+        static std::string getCacheKey(const IotCredentialParams& params);
+
+        std::mutex cache_mutex_;
+        std::map<std::string, std::shared_ptr<Entry>> entries_;
+        std::shared_ptr<PersistentCache> persistent_cache_;
+        FetchFunc fetch_func_;
+        std::atomic<uint64_t> fetch_count_;
+    };
+
+}
+}
+}
+}
+
+#endif /* __IOT_CREDENTIAL_CACHE_H__ */
@@ -8,9 +8,31 @@ LOGGER_TAG("com.amazonaws.kinesis.video");
 using namespace com::amazonaws::kinesis::video;
 using namespace std;
 
+RotatingCredentialProvider::RotatingCredentialProvider(string credential_file_path, bool watch_credential_file)
+        : credential_file_path_(credential_file_path) {
+    if (watch_credential_file) {
+        credential_file_watcher_ = CredentialFileWatcher::getInstance(credential_file_path_);
+    }
+}
+
+RotatingCredentialProvider::~RotatingCredentialProvider() {
+    stopCredentialRefresh();
+}
+
+void RotatingCredentialProvider::updateCredentials(Credentials& credentials) {
+    // Otherwise no-op as credential update is handled in c producer file auth callbacks
+    if (nullptr != credential_file_watcher_) {
+        credentials = *credential_file_watcher_->getCredentials();
+    }
+}
+
 RotatingCredentialProvider::callback_t RotatingCredentialProvider::getCallbacks(PClientCallbacks client_callbacks) {
     STATUS retStatus = STATUS_SUCCESS;
 
+    if (nullptr != credential_file_watcher_) {
+        return CredentialProvider::getCallbacks(client_callbacks);
+    }
+
     if (STATUS_FAILED(retStatus = createFileAuthCallbacks(client_callbacks,
                            STRING_TO_PCHAR(credential_file_path_),
                            &rotating_callbacks))) {
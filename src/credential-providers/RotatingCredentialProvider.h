@@ -2,18 +2,33 @@
 #define __ROTATING_CREDENTIAL_PROVIDER_H__
 
 #include "Auth.h"
+#include "CredentialFileWatcher.h"
 
 namespace com { namespace amazonaws { namespace kinesis { namespace video {
 
     class RotatingCredentialProvider : public CredentialProvider {
         std::string credential_file_path_;
         PAuthCallbacks rotating_callbacks;
+        std::shared_ptr<CredentialFileWatcher> credential_file_watcher_;
     public:
-        RotatingCredentialProvider(std::string credential_file_path): credential_file_path_(credential_file_path) {}
-        void updateCredentials(Credentials& credentials) override {
-            // no-op as credential update is handled in c producer file auth callbacks
-        }
+        /**
+         * @param credential_file_path Path to the credential file.
+         * @param watch_credential_file Whether to parse the file only when it changes, sharing the credentials
+         *        with the other providers of the file in the process, instead of the c producer file auth callbacks
+         *        re-reading it.
+         */
+        RotatingCredentialProvider(std::string credential_file_path, bool watch_credential_file = false);
+        ~RotatingCredentialProvider();
+        void updateCredentials(Credentials& credentials) override;
         callback_t getCallbacks(PClientCallbacks) override;
+
+    protected:
+        /**
+         * The c producer file auth callbacks re-read the file by themselves
+         */
+        bool isCredentialRefreshNeeded() const override {
+            return nullptr != credential_file_watcher_;
+        }
     };
 
 }
@@ -2,9 +2,18 @@
 
 using namespace com::amazonaws::kinesis::video;
 
+KvsSinkDeviceInfoProvider::KvsSinkDeviceInfoProvider(uint64_t storage_size_mb, uint64_t avg_bandwidth_bps, uint64_t buffer_duration_seconds)
+        : storage_size_mb_(storage_size_mb) {
+    if (0 == storage_size_mb_) {
+        setAutoStorageSize({StreamStorageDemand{avg_bandwidth_bps, std::chrono::seconds(buffer_duration_seconds)}});
+    }
+}
+
 KvsSinkDeviceInfoProvider::device_info_t KvsSinkDeviceInfoProvider::getDeviceInfo(){
     auto device_info = DefaultDeviceInfoProvider::getDeviceInfo();
-    // Set the storage size to user specified size in MB
-    device_info.storageInfo.storageSize = static_cast<UINT64>(storage_size_mb_) * 1024 * 1024;
+    // Set the storage size to user specified size in MB unless auto-sized
+    if (0 != storage_size_mb_) {
+        device_info.storageInfo.storageSize = static_cast<UINT64>(storage_size_mb_) * 1024 * 1024;
+    }
     return device_info;
 }
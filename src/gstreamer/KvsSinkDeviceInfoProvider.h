@@ -7,7 +7,10 @@ namespace com { namespace amazonaws { namespace kinesis { namespace video {
     class KvsSinkDeviceInfoProvider: public DefaultDeviceInfoProvider {
         uint64_t storage_size_mb_;
     public:
-        KvsSinkDeviceInfoProvider(uint64_t storage_size_mb): storage_size_mb_(storage_size_mb) {}
+        /**
+         * @param storage_size_mb The storage size in MB. 0 sizes the storage for the stream.
+         */
+        KvsSinkDeviceInfoProvider(uint64_t storage_size_mb, uint64_t avg_bandwidth_bps = 0, uint64_t buffer_duration_seconds = 0);
         device_info_t getDeviceInfo() override;
     };
 }
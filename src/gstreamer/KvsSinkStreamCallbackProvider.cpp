@@ -4,6 +4,11 @@ LOGGER_TAG("com.amazonaws.kinesis.video.gstkvs");
 
 using namespace com::amazonaws::kinesis::video;
 
+/**
+ * Dropped frames come in bursts under the network pressure. Log at most once per period.
+ */
+#define DROPPED_FRAME_LOG_PERIOD_MILLIS 1000
+
 STATUS
 KvsSinkStreamCallbackProvider::streamConnectionStaleHandler(UINT64 custom_data,
                                                             STREAM_HANDLE stream_handle,
@@ -35,7 +40,8 @@ KvsSinkStreamCallbackProvider::droppedFrameReportHandler(UINT64 custom_data,
                                                          STREAM_HANDLE stream_handle,
                                                          UINT64 dropped_frame_timecode) {
     UNUSED_PARAM(custom_data);
-    LOG_WARN("Reported droppedFrame callback for stream handle " << stream_handle << ". Dropped frame timecode in 100ns: " << dropped_frame_timecode);
+    LOG_WARN_RATE_LIMITED(DROPPED_FRAME_LOG_PERIOD_MILLIS,
+                          "Reported droppedFrame callback for stream handle " << stream_handle << ". Dropped frame timecode in 100ns: " << dropped_frame_timecode);
     return STATUS_SUCCESS; // continue streaming
 }
 
@@ -57,4 +63,15 @@ KvsSinkStreamCallbackProvider::streamClosedHandler(UINT64 custom_data,
     return STATUS_SUCCESS;
 }
 
+STATUS
+KvsSinkStreamCallbackProvider::bitrateRecommendationHandler(UINT64 custom_data,
+                                                            STREAM_HANDLE stream_handle,
+                                                            UINT64 recommended_bitrate_bps) {
+    auto customDataObj = reinterpret_cast<KvsSinkCustomData*>(custom_data);
+    LOG_INFO("Reported bitrate recommendation for stream handle " << stream_handle << ". Recommended bitrate in bps: " << recommended_bitrate_bps);
 
+    // Bindings to the encoder bitrate are updated by the notification
+    customDataObj->recommended_bitrate_kbps = (guint) (recommended_bitrate_bps / 1000);
+    g_object_notify(G_OBJECT(customDataObj->kvsSink), "recommended-bitrate");
+    return STATUS_SUCCESS;
+}
@@ -11,6 +11,10 @@ static const std::set<std::string> iot_param_set = {IOT_GET_CREDENTIAL_ENDPOINT,
                                                     ROLE_ALIASES,
                                                     IOT_THING_NAME};
 
+static const std::set<std::string> iot_optional_param_set = {IOT_THING_NAME,
+                                                             IOT_SHARED_CREDENTIALS,
+                                                             IOT_CREDENTIAL_CACHE_PATH};
+
 static const time_t time_point = std::time(NULL);
 static const long timezone_offset =
         static_cast<long> (std::mktime(std::gmtime(&time_point)) - std::mktime(std::localtime(&time_point)));
@@ -68,9 +72,10 @@ gboolean parseIotCredentialGstructure(GstStructure *g_struct, std::map<std::stri
         params_key_set.insert(it->first);
     }
 
-    if(params_key_set.count(IOT_THING_NAME) == 0) {
-        params_key_set.insert(IOT_THING_NAME);
+    for(std::set<std::string>::iterator it = iot_optional_param_set.begin(); it != iot_optional_param_set.end(); ++it) {
+        params_key_set.erase(*it);
     }
+    params_key_set.insert(IOT_THING_NAME);
 
     if (params_key_set != iot_param_set) {
         std::ostringstream ostream;
@@ -14,6 +14,8 @@
 #define CA_CERT_PATH "ca-path"
 #define ROLE_ALIASES "role-aliases"
 #define IOT_THING_NAME "iot-thing-name"
+#define IOT_SHARED_CREDENTIALS "shared-credentials"
+#define IOT_CREDENTIAL_CACHE_PATH "credential-cache-path"
 
 namespace kvs_sink_util{
 
@@ -106,6 +106,8 @@ GST_DEBUG_CATEGORY_STATIC (gst_kvs_sink_debug);
 #define DEFAULT_LOG_FILE_PATH "../kvs_log_configuration"
 #define DEFAULT_STORAGE_SIZE_MB 128
 #define DEFAULT_CREDENTIAL_FILE_PATH ".kvs/credential"
+#define DEFAULT_CREDENTIAL_FILE_WATCH FALSE
+#define DEFAULT_FRAME_SHEDDING FALSE
 #define DEFAULT_FRAME_DURATION_MS 2
 
 #define KVS_ADD_METADATA_G_STRUCT_NAME "kvs-add-metadata"
@@ -160,7 +162,10 @@ enum {
     PROP_IOT_CERTIFICATE,
     PROP_STREAM_TAGS,
     PROP_FILE_START_TIME,
-    PROP_DISABLE_BUFFER_CLIPPING
+    PROP_DISABLE_BUFFER_CLIPPING,
+    PROP_CREDENTIAL_FILE_WATCH,
+    PROP_RECOMMENDED_BITRATE,
+    PROP_FRAME_SHEDDING
 };
 
 #define GST_TYPE_KVS_SINK_STREAMING_TYPE (gst_kvs_sink_streaming_type_get_type())
@@ -199,7 +204,9 @@ static GstStaticPadTemplate videosink_templ =
                                  GST_PAD_REQUEST,
                                  GST_STATIC_CAPS (
                                          "video/x-h264, stream-format = (string) avc, alignment = (string) au, width = (int) [ 16, MAX ], height = (int) [ 16, MAX ] ; " \
-                                         "video/x-h265, alignment = (string) au, width = (int) [ 16, MAX ], height = (int) [ 16, MAX ] ;"
+                                         "video/x-h264, stream-format = (string) byte-stream, alignment = (string) au ; " \
+                                         "video/x-h265, alignment = (string) au, width = (int) [ 16, MAX ], height = (int) [ 16, MAX ] ; " \
+                                         "video/x-h265, stream-format = (string) byte-stream, alignment = (string) au ;"
                                  )
         );
 
@@ -235,7 +242,9 @@ static void gst_kvs_sink_release_pad (GstElement *element, GstPad *pad);
 void kinesis_video_producer_init(GstKvsSink *kvssink)
 {
     auto data = kvssink->data;
-    unique_ptr<DeviceInfoProvider> device_info_provider(new KvsSinkDeviceInfoProvider(kvssink->storage_size));
+    unique_ptr<DeviceInfoProvider> device_info_provider(new KvsSinkDeviceInfoProvider(kvssink->storage_size,
+                                                                                           kvssink->avg_bandwidth_bps,
+                                                                                           kvssink->buffer_duration_seconds));
     unique_ptr<ClientCallbackProvider> client_callback_provider(new KvsSinkClientCallbackProvider());
     unique_ptr<StreamCallbackProvider> stream_callback_provider(new KvsSinkStreamCallbackProvider(data));
 
@@ -300,14 +309,22 @@ void kinesis_video_producer_init(GstKvsSink *kvssink)
             iot_cert_params.insert( std::pair<std::string,std::string>(IOT_THING_NAME, kvssink->stream_name) );
         }
 
+        // The sinks of the thing share one credential fetch, optionally persisted across the restarts
+        bool shared_credentials = "true" == iot_cert_params[IOT_SHARED_CREDENTIALS];
+        if (!iot_cert_params[IOT_CREDENTIAL_CACHE_PATH].empty()) {
+            IotCredentialCache::getInstance().setPersistentCachePath(iot_cert_params[IOT_CREDENTIAL_CACHE_PATH]);
+            shared_credentials = true;
+        }
+
         credential_provider.reset(new IotCertCredentialProvider(iot_cert_params[IOT_GET_CREDENTIAL_ENDPOINT],
                 iot_cert_params[CERTIFICATE_PATH],
                 iot_cert_params[PRIVATE_KEY_PATH],
                 iot_cert_params[ROLE_ALIASES],
                 iot_cert_params[CA_CERT_PATH],
-                iot_cert_params[IOT_THING_NAME] ) );
+                iot_cert_params[IOT_THING_NAME],
+                shared_credentials) );
     } else {
-        credential_provider.reset(new RotatingCredentialProvider(kvssink->credential_file_path));
+        credential_provider.reset(new RotatingCredentialProvider(kvssink->credential_file_path, kvssink->credential_file_watch));
     }
 
     data->kinesis_video_producer = KinesisVideoProducer::createSync(move(device_info_provider),
@@ -396,6 +413,7 @@ void create_kinesis_video_stream(GstKvsSink *kvssink) {
         stream_definition->setFrameOrderMode(FRAME_ORDERING_MODE_MULTI_TRACK_AV_COMPARE_PTS_ONE_MS_COMPENSATE_EOFR);
     }
 
+    stream_definition->setFrameShedding(kvssink->frame_shedding);
     data->kinesis_video_stream = data->kinesis_video_producer->createStreamSync(move(stream_definition));
     data->frame_count = 0;
     cout << "Stream is ready" << endl;
@@ -550,7 +568,7 @@ gst_kvs_sink_class_init(GstKvsSinkClass *klass) {
 
     g_object_class_install_property (gobject_class, PROP_STORAGE_SIZE,
                                      g_param_spec_uint ("storage-size", "Storage Size",
-                                                        "Storage Size. Unit: MB", 0, G_MAXUINT, DEFAULT_STORAGE_SIZE_MB, (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+                                                        "Storage Size. Unit: MB. 0 sizes the storage by the average bandwidth and the buffer duration capped by the cgroup memory limit", 0, G_MAXUINT, DEFAULT_STORAGE_SIZE_MB, (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
 
     g_object_class_install_property (gobject_class, PROP_CREDENTIAL_FILE_PATH,
                                      g_param_spec_string ("credential-path", "Credential File Path",
@@ -576,6 +594,20 @@ gst_kvs_sink_class_init(GstKvsSinkClass *klass) {
                                                            "Set to true only if your src/mux elements produce GST_CLOCK_TIME_NONE for segment start times.  It is non-standard behavior to set this to true, only use if there are known issues with your src/mux segment start/stop times.", DEFAULT_DISABLE_BUFFER_CLIPPING,
                                                            (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
 
+    g_object_class_install_property (gobject_class, PROP_CREDENTIAL_FILE_WATCH,
+                                     g_param_spec_boolean ("credential-file-watch", "Credential File Watch",
+                                                           "Parse the credential file only when it changes, sharing the credentials with the other sinks using the same file", DEFAULT_CREDENTIAL_FILE_WATCH,
+                                                           (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    g_object_class_install_property (gobject_class, PROP_RECOMMENDED_BITRATE,
+                                     g_param_spec_uint ("recommended-bitrate", "Recommended Bitrate",
+                                                        "Encoder bitrate recommended to keep up with the uplink. Bind to the bitrate of the encoder, notified on change. Unit: kbps", 0, G_MAXUINT, 0, (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+
+    g_object_class_install_property (gobject_class, PROP_FRAME_SHEDDING,
+                                     g_param_spec_boolean ("frame-shedding", "Frame Shedding",
+                                                           "Shed the droppable frames, the audio and then all but the key frames under the buffer pressure instead of dropping whole fragments", DEFAULT_FRAME_SHEDDING,
+                                                           (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
     gst_element_class_set_static_metadata(gstelement_class,
                                           "KVS Sink",
                                           "Sink/Video/Network",
@@ -631,12 +663,15 @@ gst_kvs_sink_init(GstKvsSink *kvssink) {
     kvssink->log_config_path = g_strdup (DEFAULT_LOG_FILE_PATH);
     kvssink->storage_size = DEFAULT_STORAGE_SIZE_MB;
     kvssink->credential_file_path = g_strdup (DEFAULT_CREDENTIAL_FILE_PATH);
+    kvssink->credential_file_watch = DEFAULT_CREDENTIAL_FILE_WATCH;
+    kvssink->frame_shedding = DEFAULT_FRAME_SHEDDING;
     kvssink->file_start_time = (uint64_t) chrono::duration_cast<seconds>(
             systemCurrentTime().time_since_epoch()).count();
     kvssink->track_info_type = MKV_TRACK_INFO_TYPE_VIDEO;
     kvssink->audio_codec_id = g_strdup (DEFAULT_AUDIO_CODEC_ID_AAC);
 
     kvssink->data = make_shared<KvsSinkCustomData>();
+    kvssink->data->kvsSink = kvssink;
 
     // Mark plugin as sink
     GST_OBJECT_FLAG_SET (kvssink, GST_ELEMENT_FLAG_SINK);
@@ -797,6 +832,12 @@ gst_kvs_sink_set_property(GObject *object, guint prop_id,
         case PROP_DISABLE_BUFFER_CLIPPING:
             kvssink->disable_buffer_clipping = g_value_get_boolean(value);
             break;
+        case PROP_CREDENTIAL_FILE_WATCH:
+            kvssink->credential_file_watch = g_value_get_boolean(value);
+            break;
+        case PROP_FRAME_SHEDDING:
+            kvssink->frame_shedding = g_value_get_boolean(value);
+            break;
         default:
             G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
             break;
@@ -904,6 +945,17 @@ gst_kvs_sink_get_property(GObject *object, guint prop_id, GValue *value,
         case PROP_DISABLE_BUFFER_CLIPPING:
             g_value_set_boolean (value, kvssink->disable_buffer_clipping);
             break;
+        case PROP_CREDENTIAL_FILE_WATCH:
+            g_value_set_boolean (value, kvssink->credential_file_watch);
+            break;
+        case PROP_FRAME_SHEDDING:
+            g_value_set_boolean (value, kvssink->frame_shedding);
+            break;
+        case PROP_RECOMMENDED_BITRATE:
+            // The average bandwidth until the first recommendation
+            g_value_set_uint (value, 0 != kvssink->data->recommended_bitrate_kbps ?
+                                     (guint) kvssink->data->recommended_bitrate_kbps : kvssink->avg_bandwidth_bps / 1000);
+            break;
         default:
             G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
             break;
@@ -961,13 +1013,34 @@ gst_kvs_sink_handle_sink_event (GstCollectPads *pads,
 
             } else if (data->track_cpd_received.count(track_id) == 0 && gst_structure_has_field(gststructforcaps, "codec_data")) {
                 const GValue *gstStreamFormat = gst_structure_get_value(gststructforcaps, "codec_data");
-                gchar *cpd = gst_value_serialize(gstStreamFormat);
-                string cpd_str = string(cpd);
                 data->track_cpd_received.insert(track_id);
-                g_free(cpd);
 
-                // Send cpd to kinesis video stream
-                ret = data->kinesis_video_stream->start(cpd_str, track_id);
+                if (GST_VALUE_HOLDS_BUFFER(gstStreamFormat)) {
+                    // Send the cpd buffer as is rather than serializing it to hex to be decoded again
+                    GstMapInfo cpd_info;
+                    GstBuffer *cpd_buffer = gst_value_get_buffer(gstStreamFormat);
+                    if (gst_buffer_map(cpd_buffer, &cpd_info, GST_MAP_READ)) {
+                        ret = data->kinesis_video_stream->start(cpd_info.data, cpd_info.size, track_id);
+                        gst_buffer_unmap(cpd_buffer, &cpd_info);
+                    } else {
+                        GST_ERROR_OBJECT (kvssink, "Failed to map the codec_data buffer");
+                        ret = FALSE;
+                    }
+                } else {
+                    gchar *cpd = gst_value_serialize(gstStreamFormat);
+                    string cpd_str = string(cpd);
+                    g_free(cpd);
+
+                    // Send cpd to kinesis video stream
+                    ret = data->kinesis_video_stream->start(cpd_str, track_id);
+                }
+            } else if (kvs_sink_track_data->track_type == MKV_TRACK_INFO_TYPE_VIDEO && !gst_structure_has_field(gststructforcaps, "codec_data")) {
+                // Raw Annex-B sources such as the RTSP depayloaders carry the parameter sets in-band
+                kvs_sink_track_data->in_band_cpd = TRUE;
+                kvs_sink_track_data->nal_codec = !strcmp (media_type, GSTREAMER_MEDIA_TYPE_H265) ? NAL_CODEC_H265 : NAL_CODEC_H264;
+                if (kvs_sink_track_data->in_band_cpd_state == NULL) {
+                    kvs_sink_track_data->in_band_cpd_state = new KvsSinkInBandCpdState();
+                }
             }
 
             gst_event_unref (event);
@@ -1036,13 +1109,53 @@ void create_kinesis_video_frame(Frame *frame, const nanoseconds &pts, const nano
 }
 
 bool
-put_frame(shared_ptr<KinesisVideoStream> kinesis_video_stream, void *frame_data, size_t len, const nanoseconds &pts,
+put_frame(const shared_ptr<KinesisVideoStream> &kinesis_video_stream, void *frame_data, size_t len, const nanoseconds &pts,
           const nanoseconds &dts, FRAME_FLAGS flags, uint64_t track_id, uint32_t index) {
     Frame frame;
     create_kinesis_video_frame(&frame, pts, dts, flags, frame_data, len, track_id, index);
     return kinesis_video_stream->putFrame(frame);
 }
 
+/*
+ * Finds the key frames of the in-band Annex-B stream and starts the stream with the codec private data out of
+ * the first access unit with the parameter sets. The access units ahead of it can't be decoded so they are
+ * dropped. The parameter sets changing mid-stream are logged as the codec private data of the stream is fixed.
+ */
+static gboolean
+scan_in_band_access_unit (GstKvsSink *kvssink, GstKvsSinkTrackData *kvs_sink_track_data, const GstMapInfo *info,
+                          bool *key_frame, bool *drop) {
+    auto data = kvssink->data;
+    auto state = kvs_sink_track_data->in_band_cpd_state;
+    uint64_t track_id = kvs_sink_track_data->track_id;
+
+    NalScanner::split(info->data, info->size, state->nal_units);
+    *key_frame = NalScanner::isKeyFrame(kvs_sink_track_data->nal_codec, state->nal_units);
+    *drop = false;
+
+    if (data->track_cpd_received.count(track_id) == 0) {
+        if (!NalScanner::extractCodecPrivateData(kvs_sink_track_data->nal_codec, state->nal_units, state->codec_private_data)) {
+            LOG_DEBUG("Dropping access unit ahead of the in-band parameter sets of track " << track_id);
+            *drop = true;
+            return TRUE;
+        }
+
+        data->track_cpd_received.insert(track_id);
+        state->started_codec_private_data = state->codec_private_data;
+        return data->kinesis_video_stream->start(state->codec_private_data.data(), state->codec_private_data.size(), track_id);
+    }
+
+    // The parameter sets are repeated ahead of the key frames
+    if (*key_frame &&
+        NalScanner::extractCodecPrivateData(kvs_sink_track_data->nal_codec, state->nal_units, state->codec_private_data) &&
+        state->codec_private_data != state->started_codec_private_data) {
+        GST_WARNING_OBJECT (kvssink, "In-band parameter sets of track %" G_GUINT64_FORMAT " changed mid-stream. "
+                            "The stream keeps the codec private data it was started with", track_id);
+        state->started_codec_private_data = state->codec_private_data;
+    }
+
+    return TRUE;
+}
+
 static GstFlowReturn
 gst_kvs_sink_handle_buffer (GstCollectPads * pads,
                             GstCollectData * track_data, GstBuffer * buf, gpointer user_data) {
@@ -1122,6 +1235,28 @@ gst_kvs_sink_handle_buffer (GstCollectPads * pads,
 
     delta = GST_BUFFER_FLAG_IS_SET(buf, GST_BUFFER_FLAG_DELTA_UNIT);
 
+    if (kvs_sink_track_data->in_band_cpd) {
+        bool key_frame, drop;
+        if (!scan_in_band_access_unit(kvssink, kvs_sink_track_data, &info, &key_frame, &drop)) {
+            GST_ELEMENT_ERROR(kvssink, STREAM, FAILED, (NULL), ("Failed to start stream"));
+            ret = GST_FLOW_ERROR;
+            goto CleanUp;
+        }
+
+        if (drop) {
+            goto CleanUp;
+        }
+
+        // The delta unit flag is not reliable without a parser
+        delta = !key_frame;
+    }
+
+    // The droppable delta units are not referenced so they are shed first under the pressure. The flag is
+    // only meaningful to the frame shedder so the frames are passed to the PIC unchanged without it.
+    if (kvssink->frame_shedding && delta && GST_BUFFER_FLAG_IS_SET(buf, GST_BUFFER_FLAG_DROPPABLE)) {
+        kinesis_video_flags = FRAME_FLAG_DISCARDABLE_FRAME;
+    }
+
     switch (data->media_type) {
         case AUDIO_ONLY:
         case VIDEO_ONLY:
@@ -1167,6 +1302,13 @@ CleanUp:
     return ret;
 }
 
+static void
+gst_kvs_sink_free_track_data (GstCollectData *track_data) {
+    GstKvsSinkTrackData *kvs_sink_track_data = (GstKvsSinkTrackData *) track_data;
+    delete kvs_sink_track_data->in_band_cpd_state;
+    kvs_sink_track_data->in_band_cpd_state = NULL;
+}
+
 static GstPad *
 gst_kvs_sink_request_new_pad (GstElement * element, GstPadTemplate * templ,
                                     const gchar * req_name, const GstCaps * caps)
@@ -1226,7 +1368,7 @@ gst_kvs_sink_request_new_pad (GstElement * element, GstPadTemplate * templ,
     kvs_sink_track_data = (GstKvsSinkTrackData *)
             gst_collect_pads_add_pad (kvssink->collect, GST_PAD (newpad),
                                       sizeof (GstKvsSinkTrackData),
-                                      NULL, locked);
+                                      gst_kvs_sink_free_track_data, locked);
     kvs_sink_track_data->kvssink = kvssink;
     kvs_sink_track_data->track_type = track_type;
     kvs_sink_track_data->track_id = KVS_SINK_DEFAULT_TRACKID;
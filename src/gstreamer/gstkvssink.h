@@ -33,6 +33,7 @@
 
 #include <gst/gst.h>
 #include <KinesisVideoProducer.h>
+#include <NalScanner.h>
 #include <string.h>
 #include <mutex>
 #include <atomic>
@@ -62,12 +63,22 @@ typedef struct _GstKvsSink GstKvsSink;
 typedef struct _GstKvsSinkClass GstKvsSinkClass;
 typedef struct _KvsSinkCustomData KvsSinkCustomData;
 
+/* scratch of the in-band parameter set scan reused across the access units of a track */
+typedef struct _KvsSinkInBandCpdState {
+    std::vector<NalUnit> nal_units;
+    std::vector<uint8_t> codec_private_data;
+    std::vector<uint8_t> started_codec_private_data;  /* the codec private data the track was started with */
+} KvsSinkInBandCpdState;
+
 /* all information needed for one track */
 typedef struct _GstKvsSinkTrackData {
     GstCollectData collect;       /* we extend the CollectData */
     MKV_TRACK_INFO_TYPE track_type;
     GstKvsSink *kvssink;
     guint track_id;
+    gboolean in_band_cpd;         /* Annex-B video without codec_data, scanned for the parameter sets and key frames */
+    NAL_CODEC nal_codec;
+    KvsSinkInBandCpdState *in_band_cpd_state;  /* the track data is zero-allocated by the collect pads so the state is owned through a pointer */
 } GstKvsSinkTrackData;
 
 typedef enum _MediaType {
@@ -116,6 +127,8 @@ struct _GstKvsSink {
     gchar                       *log_config_path;
     guint                       storage_size;
     gchar                       *credential_file_path;
+    gboolean                    credential_file_watch;
+    gboolean                    frame_shedding;
     GstStructure                *iot_certificate;
     GstStructure                *stream_tags;
     guint64                     file_start_time;
@@ -149,7 +162,8 @@ struct _KvsSinkCustomData {
             first_video_frame(true),
             frame_count(0),
             first_pts(GST_CLOCK_TIME_NONE),
-            producer_start_time(GST_CLOCK_TIME_NONE) {}
+            producer_start_time(GST_CLOCK_TIME_NONE),
+            recommended_bitrate_kbps(0) {}
     std::unique_ptr<KinesisVideoProducer> kinesis_video_producer;
     std::shared_ptr<KinesisVideoStream> kinesis_video_stream;
 
@@ -165,6 +179,9 @@ struct _KvsSinkCustomData {
     uint64_t pts_base;
     uint64_t first_pts;
     uint64_t producer_start_time;
+
+    // Set by the bitrate recommendation callback and read by the recommended-bitrate property
+    std::atomic_uint recommended_bitrate_kbps;
 };
 
 #endif /* __GST_KVS_SINK_H__ */
@@ -0,0 +1,152 @@
+#include "ProducerTestFixture.h"
+#include "AsyncLogger.h"
+
+#include <log4cplus/fileappender.h>
+#include <cinttypes>
+#include <thread>
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+using namespace std;
+using namespace std::chrono;
+
+#define TEST_LOG_THREAD_COUNT                               4
+#define TEST_LOG_ITERATIONS                                 50000
+#define TEST_LOG_RING_CAPACITY                              4096
+#define TEST_LOG_RATE_LIMIT_PERIOD_MILLIS                   100
+
+/**
+ * Captures the arguments into a record, formats it back and compares with vsnprintf
+ */
+void expectRoundTrip(const char* format, ...) {
+    char expected[ASYNC_LOG_MAX_MESSAGE_SIZE];
+    AsyncLogRecord record;
+    string actual;
+    va_list args;
+
+    va_start(args, format);
+    vsnprintf(expected, SIZEOF(expected), format, args);
+    va_end(args);
+
+    va_start(args, format);
+    EXPECT_TRUE(AsyncLogger::captureArguments(record, format, args)) << format;
+    va_end(args);
+
+    record.format = format;
+    AsyncLogger::formatRecord(record, actual);
+    EXPECT_EQ(string(expected), actual) << format;
+}
+
+bool canCapture(const char* format, ...) {
+    AsyncLogRecord record;
+    va_list args;
+
+    va_start(args, format);
+    bool captured = AsyncLogger::captureArguments(record, format, args);
+    va_end(args);
+
+    return captured;
+}
+
+/**
+ * Runs the PIC style log calls at the DEBUG level into /dev/null and returns the achieved calls per second
+ */
+uint64_t runLogThroughput() {
+    vector<thread> threads;
+    auto start = steady_clock::now();
+
+    for (uint32_t i = 0; i < TEST_LOG_THREAD_COUNT; i++) {
+        threads.push_back(thread([i]() {
+            for (uint32_t iteration = 0; iteration < TEST_LOG_ITERATIONS; iteration++) {
+                DefaultCallbackProvider::logPrintHandler(LOG_LEVEL_DEBUG, (PCHAR) "test",
+                                                         (PCHAR) "putFrame(): stream 0x%" PRIx64 " frame index %u, duration %" PRIu64 ", state %s",
+                                                         (UINT64) i, iteration, (UINT64) iteration * 1000, "STREAMING");
+            }
+        }));
+    }
+
+    for (auto& logging_thread : threads) {
+        logging_thread.join();
+    }
+
+    AsyncLogger::getInstance().flush();
+
+    auto elapsed = duration_cast<microseconds>(steady_clock::now() - start).count();
+    return (uint64_t) TEST_LOG_THREAD_COUNT * TEST_LOG_ITERATIONS * 1000000 / MAX(elapsed, 1);
+}
+
+TEST(AsyncLoggerTest, deferred_formatting_matches_vsnprintf)
+{
+    int value = -42;
+    expectRoundTrip("no arguments");
+    expectRoundTrip("percent %% sign %d", 1);
+    expectRoundTrip("%d %i %u %x %X %o %c", -1, 2, 3U, 0xabU, 0xcdU, 8U, 'z');
+    expectRoundTrip("%hhd %hd %ld %lld %lu %llx", 1, 2, -3L, -4LL, 5UL, 0xffffffffffULL);
+    expectRoundTrip("%zu %td %jd", (size_t) 7, (ptrdiff_t) -8, (intmax_t) 9);
+    expectRoundTrip("0x%08x %-5d| %+d %05.2f %e %g", 0x1234U, 5, 6, 3.14159, 1e-10, 2.5);
+    expectRoundTrip("%*d|%-*.*f|%.*s", 6, 42, 10, 3, 2.71828, 3, "truncated");
+    expectRoundTrip("%Lf", (long double) 1.25);
+    expectRoundTrip("%s and %s", "first", (const char*) nullptr);
+    expectRoundTrip("%p", (void*) &value);
+    expectRoundTrip("%" PRIu64 " %" PRId64 " %" PRIx64, (UINT64) MAX_UINT64, (INT64) -1, (UINT64) 0xdeadbeef);
+}
+
+TEST(AsyncLoggerTest, unsupported_formats_are_not_deferred)
+{
+    int written = 0;
+    string long_string(ASYNC_LOG_RECORD_PAYLOAD_SIZE, 'x');
+
+    EXPECT_FALSE(canCapture("%n", &written));
+    EXPECT_FALSE(canCapture("%ls", L"wide"));
+    EXPECT_FALSE(canCapture("%s", long_string.c_str()));
+    EXPECT_FALSE(canCapture("%d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d", 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17));
+}
+
+TEST(AsyncLoggerTest, rate_limiter_reports_suppressed_count)
+{
+    LogRateLimiter rate_limiter(TEST_LOG_RATE_LIMIT_PERIOD_MILLIS);
+    uint64_t suppressed = MAX_UINT64;
+
+    EXPECT_TRUE(rate_limiter.tryAcquire(suppressed));
+    EXPECT_EQ(0, suppressed);
+
+    for (uint32_t i = 0; i < 10; i++) {
+        EXPECT_FALSE(rate_limiter.tryAcquire(suppressed));
+    }
+
+    this_thread::sleep_for(milliseconds(TEST_LOG_RATE_LIMIT_PERIOD_MILLIS + 10));
+    EXPECT_TRUE(rate_limiter.tryAcquire(suppressed));
+    EXPECT_EQ(10, suppressed);
+}
+
+TEST(AsyncLoggerTest, debug_level_sync_vs_async_benchmark)
+{
+    // Route the producer logger into /dev/null at the DEBUG level for the duration of the test
+    log4cplus::Logger logger = log4cplus::Logger::getInstance("com.amazonaws.kinesis.video");
+    log4cplus::LogLevel log_level = logger.getLogLevel();
+    logger.setLogLevel(log4cplus::DEBUG_LOG_LEVEL);
+    logger.setAdditivity(false);
+    logger.addAppender(log4cplus::SharedAppenderPtr(new log4cplus::FileAppender("/dev/null")));
+
+    uint64_t sync_rate = runLogThroughput();
+
+    EXPECT_TRUE(LOG_START_ASYNC(TEST_LOG_RING_CAPACITY));
+    uint64_t dropped_records = AsyncLogger::getInstance().getDroppedRecords();
+    uint64_t async_rate = runLogThroughput();
+    dropped_records = AsyncLogger::getInstance().getDroppedRecords() - dropped_records;
+    LOG_STOP_ASYNC();
+
+    logger.removeAllAppenders();
+    logger.setAdditivity(true);
+    logger.setLogLevel(log_level);
+
+    LOG_WARN("PIC debug log calls/sec from " << TEST_LOG_THREAD_COUNT << " threads: synchronous " << sync_rate
+             << ", asynchronous " << async_rate << " (" << dropped_records << " records dropped)");
+
+    EXPECT_FALSE(AsyncLogger::isActive());
+}
+
+}  // namespace video
+}  // namespace kinesis
+}  // namespace amazonaws
+}  // namespace com
@@ -0,0 +1,140 @@
+#include "ProducerTestFixture.h"
+#include "BitrateAdvisor.h"
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+using namespace std;
+using namespace std::chrono;
+
+#define TEST_MAX_BITRATE                                    (4 * 1000 * 1000ull)
+#define TEST_UPLINK_BITRATE                                 (2 * 1000 * 1000ull)
+#define TEST_BUFFER_DURATION                                milliseconds(2000)
+
+TEST(BitrateAdvisorTest, latency_pressure_drops_under_transfer_rate)
+{
+    BitrateAdvisor bitrate_advisor(TEST_MAX_BITRATE);
+    EXPECT_EQ(TEST_MAX_BITRATE, bitrate_advisor.getRecommendedBitrate());
+
+    // Nothing to report at the average bandwidth
+    uint64_t recommended_bitrate = 0;
+    EXPECT_FALSE(bitrate_advisor.update(TEST_MAX_BITRATE, TEST_BUFFER_DURATION, 0, recommended_bitrate));
+
+    bitrate_advisor.onLatencyPressure(10 * HUNDREDS_OF_NANOS_IN_A_SECOND);
+    ASSERT_TRUE(bitrate_advisor.update(TEST_UPLINK_BITRATE, TEST_BUFFER_DURATION, 0, recommended_bitrate));
+    EXPECT_EQ(TEST_UPLINK_BITRATE * BITRATE_ADVISOR_DECREASE_PERCENT / 100, recommended_bitrate);
+    EXPECT_EQ(recommended_bitrate, bitrate_advisor.getRecommendedBitrate());
+
+    // The pressure is consumed by the update
+    uint64_t pressured_bitrate = recommended_bitrate;
+    EXPECT_TRUE(bitrate_advisor.update(TEST_UPLINK_BITRATE, TEST_BUFFER_DURATION, 0, recommended_bitrate));
+    EXPECT_LT(pressured_bitrate, recommended_bitrate);
+}
+
+TEST(BitrateAdvisorTest, recovers_to_average_bandwidth)
+{
+    BitrateAdvisor bitrate_advisor(TEST_MAX_BITRATE);
+    uint64_t recommended_bitrate = 0;
+    for (uint32_t i = 0; i < 100; i++) {
+        bitrate_advisor.update(0, TEST_BUFFER_DURATION, 100, recommended_bitrate);
+    }
+
+    // Bounded by the minimum under the sustained storage pressure
+    EXPECT_EQ(TEST_MAX_BITRATE * BITRATE_ADVISOR_MIN_BITRATE_PERCENT / 100, bitrate_advisor.getRecommendedBitrate());
+
+    uint32_t updates = 0;
+    while (bitrate_advisor.getRecommendedBitrate() < TEST_MAX_BITRATE && updates < 100) {
+        bitrate_advisor.update(TEST_MAX_BITRATE, TEST_BUFFER_DURATION, 0, recommended_bitrate);
+        updates++;
+    }
+
+    EXPECT_EQ(TEST_MAX_BITRATE, recommended_bitrate);
+    EXPECT_EQ((100 - BITRATE_ADVISOR_MIN_BITRATE_PERCENT) / BITRATE_ADVISOR_INCREASE_PERCENT, updates);
+}
+
+TEST(BitrateAdvisorTest, sustained_buffer_growth_is_pressure)
+{
+    BitrateAdvisor bitrate_advisor(TEST_MAX_BITRATE);
+    uint64_t recommended_bitrate = 0;
+
+    // The buffer duration growing within a fragment is not the congestion
+    milliseconds buffer_duration(0);
+    for (uint32_t i = 0; i < BITRATE_ADVISOR_BUFFER_GROWTH_SAMPLES - 1; i++) {
+        buffer_duration += milliseconds(500);
+        EXPECT_FALSE(bitrate_advisor.update(TEST_UPLINK_BITRATE, buffer_duration, 0, recommended_bitrate));
+    }
+
+    EXPECT_FALSE(bitrate_advisor.update(TEST_UPLINK_BITRATE, milliseconds(0), 0, recommended_bitrate));
+    EXPECT_EQ(TEST_MAX_BITRATE, bitrate_advisor.getRecommendedBitrate());
+
+    for (uint32_t i = 0; i < BITRATE_ADVISOR_BUFFER_GROWTH_SAMPLES; i++) {
+        buffer_duration += milliseconds(500);
+        bitrate_advisor.update(TEST_UPLINK_BITRATE, buffer_duration, 0, recommended_bitrate);
+    }
+
+    EXPECT_EQ(TEST_UPLINK_BITRATE * BITRATE_ADVISOR_DECREASE_PERCENT / 100, bitrate_advisor.getRecommendedBitrate());
+}
+
+TEST(BitrateAdvisorTest, sustained_storage_pressure_decreases_once_per_hold)
+{
+    BitrateAdvisor bitrate_advisor(TEST_MAX_BITRATE);
+    uint64_t recommended_bitrate = 0;
+
+    // The storage pressure is reported on every sample while the content store is filling up
+    ASSERT_TRUE(bitrate_advisor.update(TEST_UPLINK_BITRATE, TEST_BUFFER_DURATION, 100, recommended_bitrate));
+    uint64_t decreased_bitrate = TEST_UPLINK_BITRATE * BITRATE_ADVISOR_DECREASE_PERCENT / 100;
+    EXPECT_EQ(decreased_bitrate, recommended_bitrate);
+
+    // Held while the encoder catches up rather than increased or decreased again
+    for (uint32_t i = 1; i < BITRATE_ADVISOR_DECREASE_HOLD_SAMPLES; i++) {
+        EXPECT_FALSE(bitrate_advisor.update(TEST_UPLINK_BITRATE, TEST_BUFFER_DURATION, 100, recommended_bitrate));
+        EXPECT_EQ(decreased_bitrate, bitrate_advisor.getRecommendedBitrate());
+    }
+
+    ASSERT_TRUE(bitrate_advisor.update(TEST_UPLINK_BITRATE, TEST_BUFFER_DURATION, 100, recommended_bitrate));
+    EXPECT_EQ(decreased_bitrate * BITRATE_ADVISOR_DECREASE_PERCENT / 100, recommended_bitrate);
+}
+
+TEST(BitrateAdvisorTest, storage_utilization_over_threshold_is_pressure)
+{
+    BitrateAdvisor bitrate_advisor(TEST_MAX_BITRATE);
+    uint64_t recommended_bitrate = 0;
+
+    // No time to full warning is involved. The utilization alone is the storage pressure.
+    EXPECT_FALSE(bitrate_advisor.update(TEST_UPLINK_BITRATE, TEST_BUFFER_DURATION,
+                                        BITRATE_ADVISOR_STORAGE_PRESSURE_PERCENT - 1, recommended_bitrate));
+    EXPECT_EQ(TEST_MAX_BITRATE, bitrate_advisor.getRecommendedBitrate());
+
+    ASSERT_TRUE(bitrate_advisor.update(TEST_UPLINK_BITRATE, TEST_BUFFER_DURATION,
+                                       BITRATE_ADVISOR_STORAGE_PRESSURE_PERCENT, recommended_bitrate));
+    EXPECT_EQ(TEST_UPLINK_BITRATE * BITRATE_ADVISOR_DECREASE_PERCENT / 100, recommended_bitrate);
+}
+
+TEST(BitrateAdvisorTest, small_changes_are_not_reported)
+{
+    BitrateAdvisor bitrate_advisor(TEST_MAX_BITRATE);
+    uint64_t recommended_bitrate = 0;
+
+    // Slightly under the recommendation the decrease is the multiplicative step only
+    uint64_t transfer_rate = TEST_MAX_BITRATE * 97 / 100;
+    bitrate_advisor.onLatencyPressure(0);
+    ASSERT_TRUE(bitrate_advisor.update(transfer_rate, TEST_BUFFER_DURATION, 0, recommended_bitrate));
+    uint64_t reported_bitrate = recommended_bitrate;
+
+    // The first additive step back is under the reporting threshold of the reported recommendation
+    EXPECT_FALSE(bitrate_advisor.update(TEST_MAX_BITRATE, TEST_BUFFER_DURATION, 0, recommended_bitrate));
+    EXPECT_EQ(reported_bitrate, recommended_bitrate);
+    EXPECT_LT(reported_bitrate, bitrate_advisor.getRecommendedBitrate());
+
+    EXPECT_TRUE(bitrate_advisor.update(TEST_MAX_BITRATE, TEST_BUFFER_DURATION, 0, recommended_bitrate));
+    EXPECT_EQ(reported_bitrate + 2 * TEST_MAX_BITRATE * BITRATE_ADVISOR_INCREASE_PERCENT / 100, recommended_bitrate);
+
+    // A disabled advisor never reports
+    BitrateAdvisor disabled_advisor(0);
+    disabled_advisor.onLatencyPressure(0);
+    EXPECT_FALSE(disabled_advisor.update(TEST_UPLINK_BITRATE, TEST_BUFFER_DURATION, 100, recommended_bitrate));
+}
+
+}  // namespace video
+}  // namespace kinesis
+}  // namespace amazonaws
+}  // namespace com
@@ -0,0 +1,141 @@
+#include "ProducerTestFixture.h"
+#include "ConcurrentMap.h"
+
+#include <thread>
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+using namespace std;
+using namespace std::chrono;
+
+#define TEST_REGISTRY_STREAM_COUNT                          512
+#define TEST_REGISTRY_READER_COUNT                          4
+#define TEST_REGISTRY_WRITER_COUNT                          2
+#define TEST_REGISTRY_CHURN_ITERATIONS                      50
+
+/**
+ * Single mutex map mirroring the registry it replaced. Used as the contention baseline.
+ */
+class MutexMap {
+public:
+    void put(STREAM_HANDLE k, shared_ptr<uint64_t> v) {
+        lock_guard<mutex> lock(mutex_);
+        map_[k] = v;
+    }
+
+    shared_ptr<uint64_t> get(STREAM_HANDLE k) {
+        lock_guard<mutex> lock(mutex_);
+        auto it = map_.find(k);
+        return it == map_.end() ? nullptr : it->second;
+    }
+
+    shared_ptr<uint64_t> remove(STREAM_HANDLE k) {
+        lock_guard<mutex> lock(mutex_);
+        auto it = map_.find(k);
+        if (it == map_.end()) {
+            return nullptr;
+        }
+
+        auto value = it->second;
+        map_.erase(it);
+        return value;
+    }
+
+private:
+    map<STREAM_HANDLE, shared_ptr<uint64_t>> map_;
+    mutex mutex_;
+};
+
+/**
+ * Simulates the callback threads looking up the stream handles while the streams are being
+ * created and freed. Returns the achieved lookups per second.
+ */
+template <typename M> uint64_t runRegistryContention(M& registry) {
+    atomic<bool> stop(false);
+    atomic<uint64_t> lookups(0);
+    vector<thread> threads;
+
+    for (uint32_t i = 0; i < TEST_REGISTRY_READER_COUNT; i++) {
+        threads.push_back(thread([&registry, &stop, &lookups, i]() {
+            uint64_t count = 0;
+            STREAM_HANDLE handle = i;
+            while (!stop) {
+                handle = (handle * 6364136223846793005ULL + 1442695040888963407ULL);
+                registry.get((handle % TEST_REGISTRY_STREAM_COUNT) + 1);
+                count++;
+            }
+
+            lookups += count;
+        }));
+    }
+
+    auto start = steady_clock::now();
+    vector<thread> writers;
+    for (uint32_t i = 0; i < TEST_REGISTRY_WRITER_COUNT; i++) {
+        writers.push_back(thread([&registry, i]() {
+            for (uint32_t iteration = 0; iteration < TEST_REGISTRY_CHURN_ITERATIONS; iteration++) {
+                for (STREAM_HANDLE handle = i + 1; handle <= TEST_REGISTRY_STREAM_COUNT; handle += TEST_REGISTRY_WRITER_COUNT) {
+                    registry.put(handle, make_shared<uint64_t>(handle));
+                }
+
+                for (STREAM_HANDLE handle = i + 1; handle <= TEST_REGISTRY_STREAM_COUNT; handle += TEST_REGISTRY_WRITER_COUNT) {
+                    EXPECT_NE(nullptr, registry.remove(handle));
+                }
+            }
+        }));
+    }
+
+    for (auto& writer : writers) {
+        writer.join();
+    }
+
+    auto elapsed = duration_cast<microseconds>(steady_clock::now() - start).count();
+    stop = true;
+    for (auto& reader : threads) {
+        reader.join();
+    }
+
+    return lookups * 1000000 / MAX(elapsed, 1);
+}
+
+TEST(ConcurrentMapTest, put_get_remove_snapshot)
+{
+    ConcurrentMap<STREAM_HANDLE, shared_ptr<uint64_t>> registry;
+
+    for (STREAM_HANDLE handle = 1; handle <= TEST_REGISTRY_STREAM_COUNT; handle++) {
+        registry.put(handle, make_shared<uint64_t>(handle));
+    }
+
+    EXPECT_EQ(TEST_REGISTRY_STREAM_COUNT, registry.size());
+    EXPECT_EQ(TEST_REGISTRY_STREAM_COUNT, registry.snapshot().size());
+    EXPECT_EQ(42, *registry.get(42));
+    EXPECT_EQ(nullptr, registry.get(TEST_REGISTRY_STREAM_COUNT + 1));
+
+    // Bulk removal over the snapshot while the registry is being modified
+    for (auto& value : registry.snapshot()) {
+        EXPECT_EQ(*value, *registry.remove(*value));
+    }
+
+    EXPECT_EQ(0, registry.size());
+    EXPECT_FALSE(registry.exists(42));
+    EXPECT_EQ(nullptr, registry.remove(42));
+}
+
+TEST(ConcurrentMapTest, create_free_contention_benchmark)
+{
+    ConcurrentMap<STREAM_HANDLE, shared_ptr<uint64_t>> registry;
+    MutexMap baseline;
+
+    uint64_t baseline_rate = runRegistryContention(baseline);
+    uint64_t registry_rate = runRegistryContention(registry);
+
+    LOG_INFO("Handle lookups/sec while creating and freeing " << TEST_REGISTRY_STREAM_COUNT << " streams: "
+             << "single mutex map " << baseline_rate << ", sharded registry " << registry_rate);
+
+    EXPECT_EQ(0, registry.size());
+}
+
+}  // namespace video
+}  // namespace kinesis
+}  // namespace amazonaws
+}  // namespace com
@@ -0,0 +1,108 @@
+#include "ProducerTestFixture.h"
+#include "CredentialFileWatcher.h"
+#include "RotatingCredentialProvider.h"
+
+#include <cstdio>
+#include <fstream>
+#include <thread>
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+using namespace std;
+using namespace std::chrono;
+
+#define TEST_CREDENTIAL_FILE                                "kvs_credential_file_watcher_test"
+#define TEST_CREDENTIAL_FILE_CHANGE_TIMEOUT_SECONDS         (2 * CREDENTIAL_FILE_POLL_PERIOD_SECONDS + 1)
+
+/**
+ * Replaces the credential file like the credential rotation does
+ */
+void writeCredentialFile(const string& contents) {
+    string temp_file_path = string(TEST_CREDENTIAL_FILE) + ".tmp";
+    {
+        ofstream out(temp_file_path, ios::out | ios::trunc);
+        out << contents;
+    }
+
+    std::remove(TEST_CREDENTIAL_FILE);
+    ASSERT_EQ(0, std::rename(temp_file_path.c_str(), TEST_CREDENTIAL_FILE));
+}
+
+bool awaitAccessKey(CredentialFileWatcher& watcher, const string& access_key) {
+    auto deadline = steady_clock::now() + seconds(TEST_CREDENTIAL_FILE_CHANGE_TIMEOUT_SECONDS);
+    while (steady_clock::now() < deadline) {
+        if (access_key == watcher.getCredentials()->getAccessKey()) {
+            return true;
+        }
+
+        this_thread::sleep_for(milliseconds(10));
+    }
+
+    return false;
+}
+
+TEST(CredentialFileWatcherTest, parses_credential_file_formats)
+{
+    Credentials credentials;
+    ASSERT_TRUE(CredentialFileWatcher::parseCredentials("CREDENTIALS AKID SECRET\n", credentials));
+    EXPECT_EQ("AKID", credentials.getAccessKey());
+    EXPECT_EQ("SECRET", credentials.getSecretKey());
+    EXPECT_EQ("", credentials.getSessionToken());
+    EXPECT_EQ(MAX_UINT64, credentials.getExpiration().count());
+
+    ASSERT_TRUE(CredentialFileWatcher::parseCredentials("CREDENTIALS AKID 2019-01-01T08:30:15Z SECRET TOKEN", credentials));
+    EXPECT_EQ("SECRET", credentials.getSecretKey());
+    EXPECT_EQ("TOKEN", credentials.getSessionToken());
+    EXPECT_EQ(1546331415u, credentials.getExpiration().count());
+
+    EXPECT_FALSE(CredentialFileWatcher::parseCredentials("", credentials));
+    EXPECT_FALSE(CredentialFileWatcher::parseCredentials("CREDENTIALS AKID", credentials));
+    EXPECT_FALSE(CredentialFileWatcher::parseCredentials("KEYS AKID SECRET", credentials));
+    EXPECT_FALSE(CredentialFileWatcher::parseCredentials("CREDENTIALS AKID 2019-13-01T00:00:00Z SECRET TOKEN", credentials));
+}
+
+TEST(CredentialFileWatcherTest, file_is_parsed_only_on_change)
+{
+    writeCredentialFile("CREDENTIALS AKID1 SECRET1");
+    auto watcher = CredentialFileWatcher::getInstance(TEST_CREDENTIAL_FILE);
+    EXPECT_EQ(watcher, CredentialFileWatcher::getInstance(TEST_CREDENTIAL_FILE));
+    EXPECT_EQ("AKID1", watcher->getCredentials()->getAccessKey());
+    EXPECT_EQ(1u, watcher->getParseCount());
+
+    // The same contents aren't parsed again. The events are handled in order so the second
+    // rotation being picked up means the first has been handled as well.
+    writeCredentialFile("CREDENTIALS AKID1 SECRET1");
+    writeCredentialFile("CREDENTIALS AKID2 SECRET2");
+    ASSERT_TRUE(awaitAccessKey(*watcher, "AKID2"));
+    EXPECT_EQ("SECRET2", watcher->getCredentials()->getSecretKey());
+    EXPECT_EQ(2u, watcher->getParseCount());
+
+    // The credentials are kept while the file is invalid
+    writeCredentialFile("CREDENTIALS");
+    writeCredentialFile("CREDENTIALS AKID3 SECRET3");
+    ASSERT_TRUE(awaitAccessKey(*watcher, "AKID3"));
+
+    watcher.reset();
+    std::remove(TEST_CREDENTIAL_FILE);
+}
+
+TEST(CredentialFileWatcherTest, providers_share_the_watcher)
+{
+    writeCredentialFile("CREDENTIALS AKID 2100-01-01T00:00:00Z SECRET TOKEN");
+    RotatingCredentialProvider first_provider(TEST_CREDENTIAL_FILE, true);
+    RotatingCredentialProvider second_provider(TEST_CREDENTIAL_FILE, true);
+
+    auto first_credentials = first_provider.getCredentialsSnapshot(true);
+    auto second_credentials = second_provider.getCredentialsSnapshot(true);
+    EXPECT_EQ("AKID", first_credentials->getAccessKey());
+    EXPECT_EQ("TOKEN", second_credentials->getSessionToken());
+    EXPECT_EQ(1u, CredentialFileWatcher::getInstance(TEST_CREDENTIAL_FILE)->getParseCount());
+
+    EXPECT_THROW(RotatingCredentialProvider("kvs_missing_credential_file", true), runtime_error);
+    std::remove(TEST_CREDENTIAL_FILE);
+}
+
+}  // namespace video
+}  // namespace kinesis
+}  // namespace amazonaws
+}  // namespace com
@@ -0,0 +1,164 @@
+#include "ProducerTestFixture.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+using namespace std;
+using namespace std::chrono;
+
+#define TEST_TOKEN_REQUEST_COUNT                            100
+#define TEST_DEADLOCK_GUARD                                 seconds(10)
+
+/**
+ * Provider handing out credentials which are due for the background refresh. Once blocked, the update waits
+ * on a latch so that the test controls how long it is in progress.
+ */
+class LatchedCredentialProvider : public CredentialProvider {
+public:
+    LatchedCredentialProvider() : update_count_(0), blocked_(false), update_entered_(false) {}
+
+    ~LatchedCredentialProvider() {
+        release();
+        stopCredentialRefresh();
+    }
+
+    void block() {
+        lock_guard<mutex> lock(latch_mutex_);
+        blocked_ = true;
+        update_entered_ = false;
+    }
+
+    void release() {
+        lock_guard<mutex> lock(latch_mutex_);
+        blocked_ = false;
+        latch_cv_.notify_all();
+    }
+
+    /**
+     * @return Whether an update entered the latch since it was blocked. Bounded only to fail rather than hang the test.
+     */
+    bool awaitUpdateEntered() {
+        unique_lock<mutex> lock(latch_mutex_);
+        return latch_cv_.wait_for(lock, TEST_DEADLOCK_GUARD, [this]() { return update_entered_; });
+    }
+
+    atomic<uint32_t> update_count_;
+
+private:
+    void updateCredentials(Credentials& credentials) override {
+        {
+            unique_lock<mutex> lock(latch_mutex_);
+            update_entered_ = true;
+            latch_cv_.notify_all();
+            latch_cv_.wait(lock, [this]() { return !blocked_; });
+        }
+
+        update_count_++;
+
+        // Fresh for a while but already within the background refresh window
+        auto now_time = duration_cast<seconds>(systemCurrentTime().time_since_epoch());
+        credentials = Credentials("access" + to_string(update_count_), "secret", "token",
+                                  now_time + CredentialProviderGracePeriod + seconds(10));
+    }
+
+    mutex latch_mutex_;
+    condition_variable latch_cv_;
+    bool blocked_;
+    bool update_entered_;
+};
+
+/**
+ * Provider handing out credentials due for the background refresh whose background updates throw
+ * an exception which doesn't derive from std::exception
+ */
+class ThrowingCredentialProvider : public CredentialProvider {
+public:
+    ThrowingCredentialProvider() : update_count_(0) {}
+
+    ~ThrowingCredentialProvider() {
+        stopCredentialRefresh();
+    }
+
+    promise<void> update_thrown_;
+
+private:
+    void updateCredentials(Credentials& credentials) override {
+        if (0 != update_count_++) {
+            update_thrown_.set_value();
+            throw TEST_MAGIC_NUMBER;
+        }
+
+        auto now_time = duration_cast<seconds>(systemCurrentTime().time_since_epoch());
+        credentials = Credentials("access", "secret", "token", now_time + CredentialProviderGracePeriod + seconds(10));
+    }
+
+    uint32_t update_count_;
+};
+
+TEST(CredentialProviderTest, snapshot_is_shared_until_refreshed)
+{
+    LatchedCredentialProvider credential_provider;
+    auto credentials = credential_provider.getCredentialsSnapshot();
+    EXPECT_EQ(credentials, credential_provider.getCredentialsSnapshot());
+    EXPECT_EQ("access1", credentials->getAccessKey());
+
+    // Forced update replaces the snapshot while the earlier one stays intact
+    Credentials updated_credentials;
+    credential_provider.getUpdatedCredentials(updated_credentials);
+    EXPECT_EQ("access2", updated_credentials.getAccessKey());
+    EXPECT_EQ("access1", credentials->getAccessKey());
+    EXPECT_NE(credentials, credential_provider.getCredentialsSnapshot());
+}
+
+TEST(CredentialProviderTest, token_requests_are_served_from_snapshot_during_update)
+{
+    LatchedCredentialProvider credential_provider;
+    auto credentials = credential_provider.getCredentialsSnapshot();
+    ASSERT_EQ(1u, credential_provider.update_count_);
+
+    // The background refresh picks up the credentials due for the refresh and blocks in the update
+    credential_provider.block();
+    credential_provider.startCredentialRefresh();
+    ASSERT_TRUE(credential_provider.awaitUpdateEntered());
+
+    // The token requests of the producer threads force the update but are served from the current snapshot.
+    // Issued off the test thread so that a request waiting on the update fails the test rather than hangs it.
+    auto requests = async(launch::async, [&credential_provider, &credentials]() {
+        for (uint32_t i = 0; i < TEST_TOKEN_REQUEST_COUNT; i++) {
+            EXPECT_EQ(credentials, credential_provider.getCredentialsSnapshot(true));
+        }
+    });
+
+    bool served = future_status::ready == requests.wait_for(TEST_DEADLOCK_GUARD);
+    EXPECT_EQ(1u, credential_provider.update_count_);
+    credential_provider.release();
+    requests.wait();
+    EXPECT_TRUE(served);
+
+    credential_provider.stopCredentialRefresh();
+    EXPECT_EQ(2u, credential_provider.update_count_);
+    EXPECT_EQ("access2", credential_provider.getCredentialsSnapshot()->getAccessKey());
+}
+
+TEST(CredentialProviderTest, background_refresh_survives_any_exception)
+{
+    ThrowingCredentialProvider credential_provider;
+    auto credentials = credential_provider.getCredentialsSnapshot();
+
+    // An exception escaping the refresh thread would terminate the test process
+    auto update_thrown = credential_provider.update_thrown_.get_future();
+    credential_provider.startCredentialRefresh();
+    ASSERT_EQ(future_status::ready, update_thrown.wait_for(TEST_DEADLOCK_GUARD));
+
+    credential_provider.stopCredentialRefresh();
+    EXPECT_EQ(credentials, credential_provider.getCredentialsSnapshot());
+}
+
+}  // namespace video
+}  // namespace kinesis
+}  // namespace amazonaws
+}  // namespace com
@@ -0,0 +1,123 @@
+#include "ProducerTestFixture.h"
+#include "DefaultDeviceInfoProvider.h"
+
+#include <fstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+using namespace std;
+
+#define TEST_HYBRID_STORAGE_DIRECTORY                       "kvs_hybrid_storage_test"
+#define TEST_HYBRID_FILE_STORAGE_SIZE                       (768 * 1024 * 1024ull)
+#define TEST_HYBRID_MEMORY_STORAGE_SIZE                     (256 * 1024 * 1024ull)
+#define TEST_HYBRID_SPILL_RATIO                             25
+#define TEST_CGROUP_ROOT                                    "kvs_cgroup_test"
+#define TEST_CGROUP_PROC_FILE                               "kvs_cgroup_test.proc"
+
+TEST(DefaultDeviceInfoProviderTest, hybrid_file_storage_splits_storage_size)
+{
+    rmdir(TEST_HYBRID_STORAGE_DIRECTORY);
+
+    DefaultDeviceInfoProvider device_info_provider;
+    EXPECT_EQ(DEVICE_STORAGE_TYPE_IN_MEM, device_info_provider.getDeviceInfo().storageInfo.storageType);
+
+    device_info_provider.setHybridFileStorage(TEST_HYBRID_STORAGE_DIRECTORY, TEST_HYBRID_MEMORY_STORAGE_SIZE, TEST_HYBRID_FILE_STORAGE_SIZE);
+    DeviceInfo device_info = device_info_provider.getDeviceInfo();
+    EXPECT_EQ(DEVICE_STORAGE_TYPE_HYBRID_FILE, device_info.storageInfo.storageType);
+    EXPECT_EQ(TEST_HYBRID_SPILL_RATIO, device_info.storageInfo.spillRatio);
+    EXPECT_STREQ(TEST_HYBRID_STORAGE_DIRECTORY, device_info.storageInfo.rootDirectory);
+
+    // The memory part on top of the file part
+    EXPECT_EQ(1024 * 1024 * 1024ull, device_info.storageInfo.storageSize);
+    EXPECT_EQ(TEST_HYBRID_FILE_STORAGE_SIZE,
+              device_info.storageInfo.storageSize * (100 - device_info.storageInfo.spillRatio) / 100);
+
+    // The memory part is rounded down to the whole percents so it never exceeds the requested size
+    device_info_provider.setHybridFileStorage(TEST_HYBRID_STORAGE_DIRECTORY, TEST_HYBRID_MEMORY_STORAGE_SIZE + 1024, TEST_HYBRID_FILE_STORAGE_SIZE);
+    device_info = device_info_provider.getDeviceInfo();
+    EXPECT_EQ(TEST_HYBRID_SPILL_RATIO, device_info.storageInfo.spillRatio);
+    EXPECT_LE(device_info.storageInfo.storageSize * device_info.storageInfo.spillRatio / 100, TEST_HYBRID_MEMORY_STORAGE_SIZE + 1024);
+
+    // A large memory part stays below the full ratio
+    device_info_provider.setHybridFileStorage(TEST_HYBRID_STORAGE_DIRECTORY, 1000 * TEST_HYBRID_FILE_STORAGE_SIZE, TEST_HYBRID_FILE_STORAGE_SIZE);
+    EXPECT_EQ(99, device_info_provider.getDeviceInfo().storageInfo.spillRatio);
+
+    struct stat dir_stat;
+    ASSERT_EQ(0, stat(TEST_HYBRID_STORAGE_DIRECTORY, &dir_stat));
+    EXPECT_TRUE(S_ISDIR(dir_stat.st_mode));
+
+    // An existing directory is reused
+    device_info_provider.setHybridFileStorage(TEST_HYBRID_STORAGE_DIRECTORY, 0, TEST_HYBRID_FILE_STORAGE_SIZE);
+    EXPECT_EQ(TEST_HYBRID_FILE_STORAGE_SIZE, device_info_provider.getDeviceInfo().storageInfo.storageSize);
+
+    rmdir(TEST_HYBRID_STORAGE_DIRECTORY);
+}
+
+TEST(DefaultDeviceInfoProviderTest, hybrid_file_storage_invalid_input_throws)
+{
+    DefaultDeviceInfoProvider device_info_provider;
+    EXPECT_THROW(device_info_provider.setHybridFileStorage(TEST_HYBRID_STORAGE_DIRECTORY, MAX_UINT64, TEST_HYBRID_FILE_STORAGE_SIZE), runtime_error);
+    EXPECT_THROW(device_info_provider.setHybridFileStorage(TEST_HYBRID_STORAGE_DIRECTORY, TEST_HYBRID_MEMORY_STORAGE_SIZE, 0), runtime_error);
+    EXPECT_THROW(device_info_provider.setHybridFileStorage("", TEST_HYBRID_MEMORY_STORAGE_SIZE, TEST_HYBRID_FILE_STORAGE_SIZE), runtime_error);
+    EXPECT_THROW(device_info_provider.setHybridFileStorage("/proc/kvs_hybrid_storage_test", TEST_HYBRID_MEMORY_STORAGE_SIZE, TEST_HYBRID_FILE_STORAGE_SIZE), runtime_error);
+
+    // The storage is left as is
+    EXPECT_EQ(DEVICE_STORAGE_TYPE_IN_MEM, device_info_provider.getDeviceInfo().storageInfo.storageType);
+}
+
+TEST(DefaultDeviceInfoProviderTest, storage_is_sized_by_stream_demand)
+{
+    // 4 Mbps and 2 Mbps for two minutes with the headroom on top
+    vector<StreamStorageDemand> stream_demands;
+    stream_demands.push_back(StreamStorageDemand{4 * 1000 * 1000, chrono::seconds(120)});
+    stream_demands.push_back(StreamStorageDemand{2 * 1000 * 1000, chrono::seconds(120)});
+    uint64_t storage_size = DefaultDeviceInfoProvider::computeStorageSize(stream_demands, 0);
+    EXPECT_EQ(90 * 1000 * 1000ull * (100 + AUTO_STORAGE_HEADROOM_PERCENT) / 100, storage_size);
+
+    // Capped by the memory limit
+    uint64_t memory_limit = 128 * 1024 * 1024;
+    EXPECT_EQ(memory_limit * AUTO_STORAGE_MEMORY_LIMIT_PERCENT / 100, DefaultDeviceInfoProvider::computeStorageSize(stream_demands, memory_limit));
+    EXPECT_EQ(storage_size, DefaultDeviceInfoProvider::computeStorageSize(stream_demands, 4 * storage_size));
+
+    // Low bitrate streams get the minimum
+    stream_demands.clear();
+    stream_demands.push_back(StreamStorageDemand{64 * 1000, chrono::seconds(10)});
+    EXPECT_EQ(AUTO_STORAGE_MIN_SIZE, DefaultDeviceInfoProvider::computeStorageSize(stream_demands, 0));
+
+    DefaultDeviceInfoProvider device_info_provider;
+    uint64_t auto_storage_size = device_info_provider.setAutoStorageSize(stream_demands);
+    EXPECT_EQ(auto_storage_size, device_info_provider.getDeviceInfo().storageInfo.storageSize);
+}
+
+TEST(DefaultDeviceInfoProviderTest, cgroup_memory_limit_is_lowest_in_hierarchy)
+{
+    mkdir(TEST_CGROUP_ROOT, 0700);
+    mkdir(TEST_CGROUP_ROOT "/parent", 0700);
+    mkdir(TEST_CGROUP_ROOT "/parent/camera", 0700);
+    ofstream(TEST_CGROUP_PROC_FILE) << "0::/parent/camera\n";
+    ofstream(TEST_CGROUP_ROOT "/parent/camera/memory.max") << "max\n";
+    ofstream(TEST_CGROUP_ROOT "/parent/memory.max") << "268435456\n";
+
+    EXPECT_EQ(268435456, DefaultDeviceInfoProvider::getCgroupMemoryLimit(TEST_CGROUP_PROC_FILE, TEST_CGROUP_ROOT));
+
+    ofstream(TEST_CGROUP_ROOT "/parent/camera/memory.max") << "134217728\n";
+    EXPECT_EQ(134217728, DefaultDeviceInfoProvider::getCgroupMemoryLimit(TEST_CGROUP_PROC_FILE, TEST_CGROUP_ROOT));
+
+    // Unlimited without the cgroup v2 membership
+    ofstream(TEST_CGROUP_PROC_FILE) << "4:memory:/parent/camera\n";
+    EXPECT_EQ(0, DefaultDeviceInfoProvider::getCgroupMemoryLimit(TEST_CGROUP_PROC_FILE, TEST_CGROUP_ROOT));
+
+    unlink(TEST_CGROUP_PROC_FILE);
+    unlink(TEST_CGROUP_ROOT "/parent/camera/memory.max");
+    unlink(TEST_CGROUP_ROOT "/parent/memory.max");
+    rmdir(TEST_CGROUP_ROOT "/parent/camera");
+    rmdir(TEST_CGROUP_ROOT "/parent");
+    rmdir(TEST_CGROUP_ROOT);
+}
+
+}  // namespace video
+}  // namespace kinesis
+}  // namespace amazonaws
+}  // namespace com
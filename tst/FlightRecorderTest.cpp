@@ -0,0 +1,173 @@
+#include "ProducerTestFixture.h"
+#include "FlightRecorder.h"
+
+#include <csignal>
+#include <cstdio>
+#include <thread>
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+using namespace std;
+using namespace std::chrono;
+
+#define TEST_FLIGHT_RECORDER_CAPACITY                       8
+#define TEST_FLIGHT_RECORDER_THREAD_COUNT                   4
+#define TEST_FLIGHT_RECORDER_ITERATIONS                     100000
+#define TEST_FLIGHT_RECORDER_DUMP_FILE                      "kvs_flight_recorder_test.bin"
+
+TEST(FlightRecorderTest, keeps_latest_entries_in_order)
+{
+    FlightRecorder recorder(TEST_FLIGHT_RECORDER_CAPACITY);
+    for (uint64_t i = 0; i < 3 * TEST_FLIGHT_RECORDER_CAPACITY; i++) {
+        recorder.record(FLIGHT_RECORDER_EVENT_PUT_FRAME, (STREAM_HANDLE) 1, STATUS_SUCCESS, i, FRAME_FLAG_KEY_FRAME);
+    }
+
+    recorder.record(FLIGHT_RECORDER_EVENT_STREAM_ERROR, (STREAM_HANDLE) 2, STATUS_INVALID_ARG, 42);
+
+    auto entries = recorder.getEntries();
+    ASSERT_EQ(TEST_FLIGHT_RECORDER_CAPACITY, entries.size());
+    EXPECT_EQ(3 * TEST_FLIGHT_RECORDER_CAPACITY + 1, recorder.getRecordedCount());
+
+    for (size_t i = 1; i < entries.size(); i++) {
+        EXPECT_LE(entries[i - 1].timestamp, entries[i].timestamp);
+        EXPECT_EQ(FLIGHT_RECORDER_EVENT_PUT_FRAME, entries[i - 1].event);
+        EXPECT_EQ(FRAME_FLAG_KEY_FRAME, entries[i - 1].aux);
+        EXPECT_EQ(2 * TEST_FLIGHT_RECORDER_CAPACITY + i, entries[i - 1].value);
+    }
+
+    const auto& last = entries.back();
+    EXPECT_EQ(FLIGHT_RECORDER_EVENT_STREAM_ERROR, last.event);
+    EXPECT_EQ(2u, last.stream_handle);
+    EXPECT_EQ(STATUS_INVALID_ARG, last.status);
+    EXPECT_EQ(42u, last.value);
+    EXPECT_STREQ("STREAM_ERROR", FlightRecorder::getEventName(last.event));
+
+    recorder.setEnabled(false);
+    recorder.record(FLIGHT_RECORDER_EVENT_STREAM_FREE, (STREAM_HANDLE) 2);
+    EXPECT_EQ(3 * TEST_FLIGHT_RECORDER_CAPACITY + 1, recorder.getRecordedCount());
+}
+
+TEST(FlightRecorderTest, dump_round_trips)
+{
+    FlightRecorder recorder(TEST_FLIGHT_RECORDER_CAPACITY);
+    for (uint64_t i = 0; i < TEST_FLIGHT_RECORDER_CAPACITY + 3; i++) {
+        recorder.record(FLIGHT_RECORDER_EVENT_FRAGMENT_ACK, (STREAM_HANDLE) 7, STATUS_SUCCESS, i, FRAGMENT_ACK_TYPE_PERSISTED);
+    }
+
+    ASSERT_TRUE(recorder.dump(TEST_FLIGHT_RECORDER_DUMP_FILE));
+
+    FlightRecorderFileHeader header;
+    vector<FlightRecorderEntry> entries;
+    ASSERT_TRUE(FlightRecorder::readDumpFile(TEST_FLIGHT_RECORDER_DUMP_FILE, header, entries));
+    EXPECT_EQ(FLIGHT_RECORDER_DUMP_REASON_ON_DEMAND, header.reason);
+    EXPECT_EQ(3u, header.overwritten_count);
+
+    auto expected = recorder.getEntries();
+    ASSERT_EQ(expected.size(), entries.size());
+    EXPECT_EQ(0, memcmp(expected.data(), entries.data(), entries.size() * sizeof(FlightRecorderEntry)));
+
+    std::remove(TEST_FLIGHT_RECORDER_DUMP_FILE);
+    EXPECT_FALSE(FlightRecorder::readDumpFile(TEST_FLIGHT_RECORDER_DUMP_FILE, header, entries));
+}
+
+TEST(FlightRecorderTest, corrupt_entry_count_is_rejected)
+{
+    FlightRecorder recorder(TEST_FLIGHT_RECORDER_CAPACITY);
+    recorder.record(FLIGHT_RECORDER_EVENT_PUT_FRAME, (STREAM_HANDLE) 1);
+    ASSERT_TRUE(recorder.dump(TEST_FLIGHT_RECORDER_DUMP_FILE));
+
+    FlightRecorderFileHeader header;
+    vector<FlightRecorderEntry> entries;
+    ASSERT_TRUE(FlightRecorder::readDumpFile(TEST_FLIGHT_RECORDER_DUMP_FILE, header, entries));
+
+    // The count beyond the entries in the file is not allocated for
+    header.entry_count = MAX_UINT64 / sizeof(FlightRecorderEntry);
+    FILE* file = fopen(TEST_FLIGHT_RECORDER_DUMP_FILE, "r+b");
+    ASSERT_NE(nullptr, file);
+    ASSERT_EQ(1u, fwrite(&header, sizeof(header), 1, file));
+    fclose(file);
+    EXPECT_FALSE(FlightRecorder::readDumpFile(TEST_FLIGHT_RECORDER_DUMP_FILE, header, entries));
+
+    std::remove(TEST_FLIGHT_RECORDER_DUMP_FILE);
+}
+
+TEST(FlightRecorderTest, concurrent_entries_are_consistent)
+{
+    FlightRecorder recorder(1024);
+    atomic<bool> done(false);
+    vector<thread> threads;
+
+    for (uint32_t i = 0; i < TEST_FLIGHT_RECORDER_THREAD_COUNT; i++) {
+        threads.push_back(thread([&recorder, i]() {
+            for (uint64_t iteration = 0; iteration < TEST_FLIGHT_RECORDER_ITERATIONS; iteration++) {
+                recorder.record(FLIGHT_RECORDER_EVENT_PUT_FRAME, (STREAM_HANDLE) i, (STATUS) iteration, iteration, (uint16_t) i);
+            }
+        }));
+    }
+
+    // The entries being written must never be observed torn
+    thread reader([&recorder, &done]() {
+        while (!done) {
+            for (const auto& entry : recorder.getEntries()) {
+                EXPECT_EQ(FLIGHT_RECORDER_EVENT_PUT_FRAME, entry.event);
+                EXPECT_EQ(entry.stream_handle, entry.aux);
+                EXPECT_EQ((uint32_t) entry.value, entry.status);
+            }
+        }
+    });
+
+    for (auto& recording_thread : threads) {
+        recording_thread.join();
+    }
+
+    done = true;
+    reader.join();
+
+    EXPECT_EQ((uint64_t) TEST_FLIGHT_RECORDER_THREAD_COUNT * TEST_FLIGHT_RECORDER_ITERATIONS, recorder.getRecordedCount());
+    EXPECT_EQ(1024u, recorder.getEntries().size());
+}
+
+TEST(FlightRecorderTest, record_cost_benchmark)
+{
+    FlightRecorder recorder;
+    auto start = steady_clock::now();
+    for (uint64_t i = 0; i < TEST_FLIGHT_RECORDER_ITERATIONS; i++) {
+        recorder.record(FLIGHT_RECORDER_EVENT_PUT_FRAME, (STREAM_HANDLE) 1, STATUS_SUCCESS, i);
+    }
+
+    auto elapsed = duration_cast<nanoseconds>(steady_clock::now() - start).count();
+    LOG_WARN("Flight recorder ns/record: " << (double) elapsed / TEST_FLIGHT_RECORDER_ITERATIONS);
+}
+
+#if !defined(_WIN32)
+
+TEST(FlightRecorderTest, sigusr1_dumps_process_recorder)
+{
+    ASSERT_TRUE(FlightRecorder::installSignalHandlers(TEST_FLIGHT_RECORDER_DUMP_FILE));
+    EXPECT_FALSE(FlightRecorder::installSignalHandlers(TEST_FLIGHT_RECORDER_DUMP_FILE));
+
+    FlightRecorder::getInstance().record(FLIGHT_RECORDER_EVENT_STREAM_RESET, (STREAM_HANDLE) 3, STATUS_SUCCESS, 12345);
+    raise(SIGUSR1);
+    FlightRecorder::uninstallSignalHandlers();
+
+    FlightRecorderFileHeader header;
+    vector<FlightRecorderEntry> entries;
+    ASSERT_TRUE(FlightRecorder::readDumpFile(TEST_FLIGHT_RECORDER_DUMP_FILE, header, entries));
+    EXPECT_EQ((uint32_t) SIGUSR1, header.reason);
+    ASSERT_FALSE(entries.empty());
+
+    bool found = false;
+    for (const auto& entry : entries) {
+        found = found || (FLIGHT_RECORDER_EVENT_STREAM_RESET == entry.event && 3 == entry.stream_handle && 12345 == entry.value);
+    }
+
+    EXPECT_TRUE(found);
+    std::remove(TEST_FLIGHT_RECORDER_DUMP_FILE);
+}
+
+#endif
+
+}  // namespace video
+}  // namespace kinesis
+}  // namespace amazonaws
+}  // namespace com
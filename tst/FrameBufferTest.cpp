@@ -0,0 +1,114 @@
+#include "ProducerTestFixture.h"
+#include "FrameBuffer.h"
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+using namespace std;
+
+#define TEST_PAYLOAD_SIZE                                   1024
+
+/**
+ * External payload which records the release callback invocations
+ */
+struct TestPayload {
+    TestPayload() : data(TEST_PAYLOAD_SIZE, 0xAB), release_count(0), released_size(0) {}
+
+    FrameBuffer wrap() {
+        return FrameBuffer(data.data(), data.size(), [this](uint8_t* released_data, size_t size) {
+            EXPECT_EQ(data.data(), released_data);
+            released_size = size;
+            release_count++;
+        });
+    }
+
+    vector<uint8_t> data;
+    uint32_t release_count;
+    size_t released_size;
+};
+
+TEST(FrameBufferTest, external_payload_is_released_once_on_destruction)
+{
+    TestPayload payload;
+    {
+        FrameBuffer frame_buffer = payload.wrap();
+        EXPECT_FALSE(frame_buffer.empty());
+        EXPECT_EQ(payload.data.data(), frame_buffer.data());
+        EXPECT_EQ(TEST_PAYLOAD_SIZE, frame_buffer.size());
+        EXPECT_EQ(0, payload.release_count);
+    }
+
+    EXPECT_EQ(1, payload.release_count);
+    EXPECT_EQ(TEST_PAYLOAD_SIZE, payload.released_size);
+}
+
+TEST(FrameBufferTest, release_is_idempotent)
+{
+    TestPayload payload;
+    FrameBuffer frame_buffer = payload.wrap();
+
+    frame_buffer.release();
+    EXPECT_EQ(1, payload.release_count);
+    EXPECT_TRUE(frame_buffer.empty());
+    EXPECT_EQ(0, frame_buffer.size());
+
+    frame_buffer.release();
+    EXPECT_EQ(1, payload.release_count);
+}
+
+TEST(FrameBufferTest, move_construction_transfers_ownership)
+{
+    TestPayload payload;
+    FrameBuffer source = payload.wrap();
+
+    FrameBuffer destination(std::move(source));
+    EXPECT_TRUE(source.empty());
+    EXPECT_EQ(0, source.size());
+    EXPECT_EQ(payload.data.data(), destination.data());
+    EXPECT_EQ(TEST_PAYLOAD_SIZE, destination.size());
+
+    // The moved from buffer no longer owns the payload
+    source.release();
+    EXPECT_EQ(0, payload.release_count);
+
+    destination.release();
+    EXPECT_EQ(1, payload.release_count);
+}
+
+TEST(FrameBufferTest, move_assignment_releases_previous_payload)
+{
+    TestPayload first_payload;
+    TestPayload second_payload;
+    FrameBuffer frame_buffer = first_payload.wrap();
+
+    frame_buffer = second_payload.wrap();
+    EXPECT_EQ(1, first_payload.release_count);
+    EXPECT_EQ(0, second_payload.release_count);
+    EXPECT_EQ(second_payload.data.data(), frame_buffer.data());
+
+    frame_buffer = FrameBuffer();
+    EXPECT_EQ(1, second_payload.release_count);
+    EXPECT_TRUE(frame_buffer.empty());
+}
+
+TEST(FrameBufferTest, adopted_vector_is_not_copied)
+{
+    vector<uint8_t> data(TEST_PAYLOAD_SIZE, 0xCD);
+    uint8_t* raw_data = data.data();
+
+    FrameBuffer frame_buffer(std::move(data));
+    EXPECT_EQ(raw_data, frame_buffer.data());
+    EXPECT_EQ(TEST_PAYLOAD_SIZE, frame_buffer.size());
+
+    // Moving the buffer keeps the adopted heap block
+    FrameBuffer moved(std::move(frame_buffer));
+    EXPECT_EQ(raw_data, moved.data());
+    EXPECT_EQ(0xCD, moved.data()[TEST_PAYLOAD_SIZE - 1]);
+
+    moved.release();
+    EXPECT_TRUE(moved.empty());
+}
+
+}  // namespace video
+}  // namespace kinesis
+}  // namespace amazonaws
+}  // namespace com
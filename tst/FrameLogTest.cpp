@@ -0,0 +1,247 @@
+#include "ProducerTestFixture.h"
+#include "FrameLog.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <dirent.h>
+#include <unistd.h>
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+using namespace std;
+using namespace std::chrono;
+
+#define TEST_FRAME_LOG_DIRECTORY                            "kvs_frame_log_test"
+#define TEST_FRAME_LOG_STREAM_NAME                          "frame-log-stream"
+#define TEST_FRAME_LOG_SEGMENT_SIZE                         (64 * 1024)
+#define TEST_FRAME_LOG_FRAME_SIZE                           1000
+#define TEST_FRAME_LOG_FRAME_COUNT                          300
+#define TEST_FRAME_LOG_KEY_FRAME_INTERVAL                   30
+#define TEST_FRAME_LOG_FRAME_DURATION                       (33 * HUNDREDS_OF_NANOS_IN_A_MILLISECOND)
+#define TEST_FRAME_LOG_TRACK_ID                             1
+
+#define TEST_THROUGHPUT_FRAME_SIZE                          (50 * 1024)
+#define TEST_THROUGHPUT_FRAME_COUNT                         300
+#define TEST_THROUGHPUT_FPS                                 30
+#define TEST_THROUGHPUT_SEGMENT_SIZE                        (1024 * 1024)
+
+class FrameLogTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        removeLogs();
+    }
+
+    void TearDown() override {
+        removeLogs();
+    }
+
+    static void removeLogs() {
+        string directory = string(TEST_FRAME_LOG_DIRECTORY) + "/" + TEST_FRAME_LOG_STREAM_NAME;
+        for (auto& name : listFiles(directory)) {
+            unlink((directory + "/" + name).c_str());
+        }
+
+        rmdir(directory.c_str());
+        rmdir(TEST_FRAME_LOG_DIRECTORY);
+    }
+
+    static vector<string> listFiles(const string& directory) {
+        vector<string> names;
+        DIR* dir = opendir(directory.c_str());
+        if (nullptr == dir) {
+            return names;
+        }
+
+        struct dirent* entry;
+        while (nullptr != (entry = readdir(dir))) {
+            string name = entry->d_name;
+            if (name != "." && name != "..") {
+                names.push_back(name);
+            }
+        }
+
+        closedir(dir);
+        return names;
+    }
+
+    static Frame makeFrame(uint32_t index, vector<uint8_t>& frame_data) {
+        frame_data.assign(TEST_FRAME_LOG_FRAME_SIZE, (uint8_t) index);
+        Frame frame;
+        memset(&frame, 0x00, sizeof(Frame));
+        frame.version = FRAME_CURRENT_VERSION;
+        frame.flags = 0 == index % TEST_FRAME_LOG_KEY_FRAME_INTERVAL ? FRAME_FLAG_KEY_FRAME : FRAME_FLAG_NONE;
+        frame.presentationTs = frame.decodingTs = (index + 1) * TEST_FRAME_LOG_FRAME_DURATION;
+        frame.duration = TEST_FRAME_LOG_FRAME_DURATION;
+        frame.trackId = TEST_FRAME_LOG_TRACK_ID;
+        frame.size = TEST_FRAME_LOG_FRAME_SIZE;
+        frame.frameData = frame_data.data();
+        return frame;
+    }
+
+    static unique_ptr<FrameLog> openLog() {
+        return unique_ptr<FrameLog>(new FrameLog(TEST_FRAME_LOG_DIRECTORY, TEST_FRAME_LOG_STREAM_NAME, 1, TEST_FRAME_LOG_SEGMENT_SIZE));
+    }
+
+    static void appendFrames(FrameLog& frame_log, uint32_t frame_count) {
+        vector<uint8_t> frame_data;
+        for (uint32_t i = 0; i < frame_count; i++) {
+            Frame frame = makeFrame(i, frame_data);
+            ASSERT_EQ(STATUS_SUCCESS, frame_log.append(frame));
+        }
+    }
+
+    static vector<Frame> replayFrames(FrameLog& frame_log, vector<vector<uint8_t>>& frame_data) {
+        vector<Frame> frames;
+        frame_log.replay([&frames, &frame_data](Frame& frame) {
+            frame_data.push_back(vector<uint8_t>(frame.frameData, frame.frameData + frame.size));
+            frames.push_back(frame);
+            return STATUS_SUCCESS;
+        });
+
+        return frames;
+    }
+};
+
+TEST_F(FrameLogTest, unacknowledged_frames_are_replayed)
+{
+    {
+        auto frame_log = openLog();
+        appendFrames(*frame_log, TEST_FRAME_LOG_FRAME_COUNT);
+        frame_log->sync();
+
+        auto metrics = frame_log->getMetrics();
+        EXPECT_EQ(TEST_FRAME_LOG_FRAME_COUNT, metrics.appended_frames);
+        EXPECT_LE(1, metrics.syncs);
+    }
+
+    // Opened again as after a crash
+    auto frame_log = openLog();
+    vector<vector<uint8_t>> frame_data;
+    vector<Frame> frames = replayFrames(*frame_log, frame_data);
+    ASSERT_EQ(TEST_FRAME_LOG_FRAME_COUNT, frames.size());
+    for (uint32_t i = 0; i < TEST_FRAME_LOG_FRAME_COUNT; i++) {
+        vector<uint8_t> expected_data;
+        Frame expected = makeFrame(i, expected_data);
+        EXPECT_EQ(expected.presentationTs, frames[i].presentationTs);
+        EXPECT_EQ(expected.decodingTs, frames[i].decodingTs);
+        EXPECT_EQ(expected.duration, frames[i].duration);
+        EXPECT_EQ(expected.flags, frames[i].flags);
+        EXPECT_EQ(expected.trackId, frames[i].trackId);
+        EXPECT_EQ(expected_data, frame_data[i]);
+    }
+
+    // Replayed once only
+    EXPECT_TRUE(replayFrames(*frame_log, frame_data).empty());
+}
+
+TEST_F(FrameLogTest, persisted_fragments_are_deleted)
+{
+    uint32_t persisted_frame_count = TEST_FRAME_LOG_FRAME_COUNT / 2;
+    vector<uint8_t> frame_data;
+    uint64_t persisted_fragment_timecode = makeFrame(persisted_frame_count - TEST_FRAME_LOG_KEY_FRAME_INTERVAL, frame_data).presentationTs;
+    {
+        auto frame_log = openLog();
+        appendFrames(*frame_log, TEST_FRAME_LOG_FRAME_COUNT);
+        frame_log->onFragmentPersisted(persisted_fragment_timecode);
+        frame_log->sync();
+
+        // Processed by the commit thread
+        for (uint32_t i = 0; i < 100 && 0 == frame_log->getMetrics().deleted_segments; i++) {
+            this_thread::sleep_for(milliseconds(10));
+        }
+
+        EXPECT_LT(0, frame_log->getMetrics().deleted_segments);
+    }
+
+    // All of the frames of the fragments not persisted are replayed
+    auto frame_log = openLog();
+    vector<vector<uint8_t>> replayed_data;
+    vector<Frame> frames = replayFrames(*frame_log, replayed_data);
+    ASSERT_FALSE(frames.empty());
+    EXPECT_GT(TEST_FRAME_LOG_FRAME_COUNT, frames.size());
+    EXPECT_LE(TEST_FRAME_LOG_FRAME_COUNT - persisted_frame_count, frames.size());
+    EXPECT_EQ(makeFrame(TEST_FRAME_LOG_FRAME_COUNT - 1, frame_data).presentationTs, frames.back().presentationTs);
+}
+
+TEST_F(FrameLogTest, torn_record_is_not_replayed)
+{
+    {
+        auto frame_log = openLog();
+        appendFrames(*frame_log, 10);
+    }
+
+    // Corrupt the data of the last frame
+    string directory = string(TEST_FRAME_LOG_DIRECTORY) + "/" + TEST_FRAME_LOG_STREAM_NAME;
+    string segment_path;
+    for (auto& name : listFiles(directory)) {
+        if (name < segment_path || segment_path.empty()) {
+            segment_path = name;
+        }
+    }
+
+    FILE* file = fopen((directory + "/" + segment_path).c_str(), "r+b");
+    ASSERT_NE(nullptr, file);
+    fseek(file, 10 * (56 + TEST_FRAME_LOG_FRAME_SIZE) - 1, SEEK_SET);
+    fputc(0xff, file);
+    fclose(file);
+
+    auto frame_log = openLog();
+    vector<vector<uint8_t>> frame_data;
+    EXPECT_EQ(9, replayFrames(*frame_log, frame_data).size());
+}
+
+TEST_F(FrameLogTest, cleared_log_is_not_replayed)
+{
+    {
+        auto frame_log = openLog();
+        appendFrames(*frame_log, TEST_FRAME_LOG_FRAME_COUNT);
+        frame_log->clear();
+        frame_log->sync();
+    }
+
+    auto frame_log = openLog();
+    vector<vector<uint8_t>> frame_data;
+    EXPECT_TRUE(replayFrames(*frame_log, frame_data).empty());
+}
+
+TEST_F(FrameLogTest, frame_log_keeps_up_with_stream)
+{
+    vector<uint8_t> frame_data(TEST_THROUGHPUT_FRAME_SIZE, 0x5a);
+    Frame frame;
+    memset(&frame, 0x00, sizeof(Frame));
+    frame.size = TEST_THROUGHPUT_FRAME_SIZE;
+    frame.frameData = frame_data.data();
+
+    FrameLog frame_log(TEST_FRAME_LOG_DIRECTORY, TEST_FRAME_LOG_STREAM_NAME, 1, TEST_THROUGHPUT_SEGMENT_SIZE);
+    auto start = steady_clock::now();
+    for (uint32_t i = 0; i < TEST_THROUGHPUT_FRAME_COUNT; i++) {
+        frame.flags = 0 == i % TEST_FRAME_LOG_KEY_FRAME_INTERVAL ? FRAME_FLAG_KEY_FRAME : FRAME_FLAG_NONE;
+        frame.presentationTs = frame.decodingTs = i;
+        EXPECT_EQ(STATUS_SUCCESS, frame_log.append(frame));
+
+        // Persisted acks trailing by a couple of fragments keep the log bounded
+        if (CHECK_FRAME_FLAG_KEY_FRAME(frame.flags) && i >= 3 * TEST_FRAME_LOG_KEY_FRAME_INTERVAL) {
+            frame_log.onFragmentPersisted(i - 2 * TEST_FRAME_LOG_KEY_FRAME_INTERVAL);
+        }
+    }
+
+    frame_log.sync();
+    auto elapsed = duration_cast<milliseconds>(steady_clock::now() - start);
+    auto metrics = frame_log.getMetrics();
+
+    // Logging and committing the frames takes less than streaming them in real time
+    auto stream_duration = milliseconds(1000 * TEST_THROUGHPUT_FRAME_COUNT / TEST_THROUGHPUT_FPS);
+    LOG_INFO("Frame log of " << stream_duration.count() << " ms of the stream took " << elapsed.count() << " ms"
+             << ". Commits: " << metrics.syncs << ", deleted segments: " << metrics.deleted_segments
+             << ", unprepared segments: " << metrics.unprepared_segments);
+
+    EXPECT_LT(elapsed, stream_duration);
+    EXPECT_EQ(TEST_THROUGHPUT_FRAME_COUNT, metrics.appended_frames);
+    EXPECT_LT(metrics.syncs, metrics.appended_frames);
+    EXPECT_LT(0u, metrics.deleted_segments);
+}
+
+}  // namespace video
+}  // namespace kinesis
+}  // namespace amazonaws
+}  // namespace com
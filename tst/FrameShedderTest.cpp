@@ -0,0 +1,248 @@
+#include "ProducerTestFixture.h"
+#include "FrameShedder.h"
+
+#include <algorithm>
+#include <deque>
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+using namespace std;
+using namespace std::chrono;
+
+#define TEST_VIDEO_TRACK_ID                                 1
+#define TEST_AUDIO_TRACK_ID                                 2
+#define TEST_BUFFER_DURATION                                milliseconds(10000)
+
+#define TEST_VIDEO_FPS                                      30
+#define TEST_AUDIO_FPS                                      50
+#define TEST_KEY_FRAME_INTERVAL                             30
+#define TEST_KEY_FRAME_SIZE                                 40000
+#define TEST_DELTA_FRAME_SIZE                               10000
+#define TEST_AUDIO_FRAME_SIZE                               400
+#define TEST_CONTENT_STORE_SIZE                             (1000 * 1000)
+#define TEST_SAMPLING_PERIOD_MILLIS                         1000
+
+static Frame makeFrame(uint64_t track_id, FRAME_FLAGS flags) {
+    Frame frame;
+    memset(&frame, 0x00, sizeof(Frame));
+    frame.version = FRAME_CURRENT_VERSION;
+    frame.trackId = track_id;
+    frame.flags = flags;
+    return frame;
+}
+
+TEST(FrameShedderTest, levels_follow_pressure_with_hysteresis)
+{
+    FrameShedder frame_shedder(TEST_VIDEO_TRACK_ID, TEST_BUFFER_DURATION);
+    EXPECT_EQ(FRAME_SHEDDING_LEVEL_NONE, frame_shedder.update(milliseconds(1000), 10));
+
+    // The view duration pressure
+    EXPECT_EQ(FRAME_SHEDDING_LEVEL_NON_REFERENCE, frame_shedder.update(milliseconds(5000), 10));
+
+    // The storage pressure escalates straight to the level
+    EXPECT_EQ(FRAME_SHEDDING_LEVEL_KEY_FRAME_ONLY, frame_shedder.update(milliseconds(0), FRAME_SHEDDING_KEY_FRAME_ONLY_THRESHOLD_PERCENT));
+
+    // Steps back one level at a time and only well under the threshold
+    EXPECT_EQ(FRAME_SHEDDING_LEVEL_KEY_FRAME_ONLY, frame_shedder.update(milliseconds(0), FRAME_SHEDDING_KEY_FRAME_ONLY_THRESHOLD_PERCENT - FRAME_SHEDDING_HYSTERESIS_PERCENT));
+    EXPECT_EQ(FRAME_SHEDDING_LEVEL_SECONDARY_TRACKS, frame_shedder.update(milliseconds(0), 0));
+    EXPECT_EQ(FRAME_SHEDDING_LEVEL_NON_REFERENCE, frame_shedder.update(milliseconds(0), 0));
+    EXPECT_EQ(FRAME_SHEDDING_LEVEL_NONE, frame_shedder.update(milliseconds(0), 0));
+    EXPECT_EQ(FRAME_SHEDDING_LEVEL_NONE, frame_shedder.getLevel());
+}
+
+TEST(FrameShedderTest, frames_are_shed_by_priority)
+{
+    FrameShedder frame_shedder(TEST_VIDEO_TRACK_ID, TEST_BUFFER_DURATION);
+    Frame key_frame = makeFrame(TEST_VIDEO_TRACK_ID, FRAME_FLAG_KEY_FRAME);
+    Frame delta_frame = makeFrame(TEST_VIDEO_TRACK_ID, FRAME_FLAG_NONE);
+    Frame non_reference_frame = makeFrame(TEST_VIDEO_TRACK_ID, FRAME_FLAG_DISCARDABLE_FRAME);
+    Frame audio_frame = makeFrame(TEST_AUDIO_TRACK_ID, FRAME_FLAG_NONE);
+    Frame eofr_frame = makeFrame(TEST_VIDEO_TRACK_ID, FRAME_FLAG_END_OF_FRAGMENT);
+
+    EXPECT_FALSE(frame_shedder.shouldShed(non_reference_frame));
+
+    frame_shedder.update(milliseconds(0), FRAME_SHEDDING_NON_REFERENCE_THRESHOLD_PERCENT);
+    EXPECT_TRUE(frame_shedder.shouldShed(non_reference_frame));
+    EXPECT_FALSE(frame_shedder.shouldShed(delta_frame));
+    EXPECT_FALSE(frame_shedder.shouldShed(audio_frame));
+
+    frame_shedder.update(milliseconds(0), FRAME_SHEDDING_SECONDARY_TRACKS_THRESHOLD_PERCENT);
+    EXPECT_TRUE(frame_shedder.shouldShed(audio_frame));
+    EXPECT_FALSE(frame_shedder.shouldShed(delta_frame));
+
+    frame_shedder.update(milliseconds(0), FRAME_SHEDDING_KEY_FRAME_ONLY_THRESHOLD_PERCENT);
+    EXPECT_FALSE(frame_shedder.shouldShed(key_frame));
+    EXPECT_TRUE(frame_shedder.shouldShed(delta_frame));
+    EXPECT_FALSE(frame_shedder.shouldShed(eofr_frame));
+
+    // The delta frames are shed until the next key frame after the pressure clears
+    frame_shedder.update(milliseconds(0), 0);
+    frame_shedder.update(milliseconds(0), 0);
+    frame_shedder.update(milliseconds(0), 0);
+    EXPECT_EQ(FRAME_SHEDDING_LEVEL_NONE, frame_shedder.getLevel());
+    EXPECT_TRUE(frame_shedder.shouldShed(delta_frame));
+    EXPECT_FALSE(frame_shedder.shouldShed(key_frame));
+    EXPECT_FALSE(frame_shedder.shouldShed(delta_frame));
+    EXPECT_FALSE(frame_shedder.shouldShed(audio_frame));
+
+    EXPECT_EQ(1, frame_shedder.getShedFrames(FRAME_SHEDDING_LEVEL_NON_REFERENCE));
+    EXPECT_EQ(1, frame_shedder.getShedFrames(FRAME_SHEDDING_LEVEL_SECONDARY_TRACKS));
+    EXPECT_EQ(2, frame_shedder.getShedFrames(FRAME_SHEDDING_LEVEL_KEY_FRAME_ONLY));
+    EXPECT_EQ(0, frame_shedder.getShedFrames(FRAME_SHEDDING_LEVEL_NONE));
+}
+
+/**
+ * Content store drained by a synthetic uplink. The oldest fragment short of the one being uploaded is
+ * dropped as by the tail drop pressure policy when a new frame doesn't fit.
+ */
+class SyntheticUplink {
+public:
+    explicit SyntheticUplink(FrameShedder* frame_shedder)
+            : frame_shedder_(frame_shedder), used_size_(0), budget_(0), max_gap_(0), last_delivered_(-1), delivered_frames_(0) {}
+
+    void putFrame(const Frame& frame, uint32_t size, int64_t time_ms) {
+        if (nullptr != frame_shedder_ && frame_shedder_->shouldShed(frame)) {
+            return;
+        }
+
+        while (used_size_ + size > TEST_CONTENT_STORE_SIZE) {
+            if (!dropTailFragment()) {
+                return;
+            }
+        }
+
+        store_.push_back(StoredFrame{time_ms, size, frame.trackId, CHECK_FRAME_FLAG_KEY_FRAME(frame.flags)});
+        used_size_ += size;
+    }
+
+    void tick(int64_t time_ms, uint64_t bytes_per_second) {
+        budget_ += bytes_per_second / 1000;
+        while (!store_.empty() && store_.front().size <= budget_) {
+            budget_ -= store_.front().size;
+            used_size_ -= store_.front().size;
+            if (TEST_VIDEO_TRACK_ID == store_.front().track_id) {
+                if (last_delivered_ >= 0) {
+                    max_gap_ = max(max_gap_, store_.front().time_ms - last_delivered_);
+                }
+
+                last_delivered_ = store_.front().time_ms;
+                delivered_frames_++;
+            }
+
+            store_.pop_front();
+        }
+
+        if (store_.empty()) {
+            budget_ = 0;
+        }
+
+        if (nullptr != frame_shedder_ && 0 == time_ms % TEST_SAMPLING_PERIOD_MILLIS) {
+            frame_shedder_->update(milliseconds(0), (uint32_t) (used_size_ * 100 / TEST_CONTENT_STORE_SIZE));
+        }
+    }
+
+    int64_t getMaxGap() const {
+        return max_gap_;
+    }
+
+    uint64_t getDeliveredFrames() const {
+        return delivered_frames_;
+    }
+
+private:
+    struct StoredFrame {
+        int64_t time_ms;
+        uint32_t size;
+        uint64_t track_id;
+        bool key_frame;
+    };
+
+    static bool isFragmentStart(const StoredFrame& stored_frame) {
+        return TEST_VIDEO_TRACK_ID == stored_frame.track_id && stored_frame.key_frame;
+    }
+
+    /**
+     * Drops the oldest fragment which is not being uploaded
+     */
+    bool dropTailFragment() {
+        auto begin = find_if(store_.begin(), store_.end(), isFragmentStart);
+        if (begin == store_.end()) {
+            return false;
+        }
+
+        auto end = find_if(begin + 1, store_.end(), isFragmentStart);
+        for (auto it = begin; it != end; it++) {
+            used_size_ -= it->size;
+        }
+
+        store_.erase(begin, end);
+        return true;
+    }
+
+    FrameShedder* frame_shedder_;
+    deque<StoredFrame> store_;
+    uint64_t used_size_;
+    uint64_t budget_;
+    int64_t max_gap_;
+    int64_t last_delivered_;
+    uint64_t delivered_frames_;
+};
+
+static void streamOverUplink(SyntheticUplink& uplink) {
+    // 350 KBps at the full rate over the uplink of 250 KBps, then 60 KBps and back to 1 MBps
+    uint32_t video_index = 0;
+    uint32_t audio_index = 0;
+    for (int64_t time_ms = 0; time_ms < 60000; time_ms++) {
+        uint64_t bytes_per_second = time_ms < 20000 ? 250000 : time_ms < 40000 ? 60000 : 1000000;
+
+        if (time_ms >= (int64_t) video_index * 1000 / TEST_VIDEO_FPS) {
+            uint32_t gop_index = video_index % TEST_KEY_FRAME_INTERVAL;
+            if (0 == gop_index) {
+                uplink.putFrame(makeFrame(TEST_VIDEO_TRACK_ID, FRAME_FLAG_KEY_FRAME), TEST_KEY_FRAME_SIZE, time_ms);
+            } else {
+                // Every other delta frame is not referenced
+                FRAME_FLAGS flags = 0 == gop_index % 2 ? FRAME_FLAG_DISCARDABLE_FRAME : FRAME_FLAG_NONE;
+                uplink.putFrame(makeFrame(TEST_VIDEO_TRACK_ID, flags), TEST_DELTA_FRAME_SIZE, time_ms);
+            }
+
+            video_index++;
+        }
+
+        if (time_ms >= (int64_t) audio_index * 1000 / TEST_AUDIO_FPS) {
+            uplink.putFrame(makeFrame(TEST_AUDIO_TRACK_ID, FRAME_FLAG_NONE), TEST_AUDIO_FRAME_SIZE, time_ms);
+            audio_index++;
+        }
+
+        uplink.tick(time_ms, bytes_per_second);
+    }
+}
+
+TEST(FrameShedderTest, shedding_leaves_smaller_gaps_than_tail_drop)
+{
+    SyntheticUplink tail_drop_uplink(nullptr);
+    streamOverUplink(tail_drop_uplink);
+
+    FrameShedder frame_shedder(TEST_VIDEO_TRACK_ID, milliseconds(0));
+    SyntheticUplink shedding_uplink(&frame_shedder);
+    streamOverUplink(shedding_uplink);
+
+    LOG_INFO("Longest video gap (ms): tail drop " << tail_drop_uplink.getMaxGap() << ", shedding " << shedding_uplink.getMaxGap()
+             << ". Delivered video frames: tail drop " << tail_drop_uplink.getDeliveredFrames()
+             << ", shedding " << shedding_uplink.getDeliveredFrames()
+             << ". Shed frames: non-reference " << frame_shedder.getShedFrames(FRAME_SHEDDING_LEVEL_NON_REFERENCE)
+             << ", secondary tracks " << frame_shedder.getShedFrames(FRAME_SHEDDING_LEVEL_SECONDARY_TRACKS)
+             << ", key frame only " << frame_shedder.getShedFrames(FRAME_SHEDDING_LEVEL_KEY_FRAME_ONLY));
+
+    EXPECT_LT(shedding_uplink.getMaxGap(), tail_drop_uplink.getMaxGap());
+    EXPECT_LT(0, frame_shedder.getShedFrames(FRAME_SHEDDING_LEVEL_NON_REFERENCE));
+    EXPECT_LT(0, frame_shedder.getShedFrames(FRAME_SHEDDING_LEVEL_SECONDARY_TRACKS));
+    EXPECT_LT(0, frame_shedder.getShedFrames(FRAME_SHEDDING_LEVEL_KEY_FRAME_ONLY));
+
+    // Back to the full rate once the uplink recovers
+    EXPECT_EQ(FRAME_SHEDDING_LEVEL_NONE, frame_shedder.getLevel());
+}
+
+}  // namespace video
+}  // namespace kinesis
+}  // namespace amazonaws
+}  // namespace com
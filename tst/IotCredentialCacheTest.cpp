@@ -0,0 +1,162 @@
+#include "ProducerTestFixture.h"
+#include "IotCredentialCache.h"
+#include "IotCertCredentialProvider.h"
+
+#include <cstdio>
+#include <thread>
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+using namespace std;
+using namespace std::chrono;
+
+#define TEST_IOT_CREDENTIAL_CACHE_FILE                      "kvs_iot_credential_cache_test"
+#define TEST_IOT_PRODUCER_COUNT                             16
+#define TEST_IOT_HANDSHAKE_DURATION_MILLIS                  200
+#define TEST_IOT_CREDENTIAL_VALIDITY_SECONDS                3600
+
+class IotCredentialCacheTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        IotCredentialCache::getInstance().clear();
+        IotCredentialCache::getInstance().setFetchFunc([this](const IotCredentialParams& params) {
+            return fetch(params);
+        });
+    }
+
+    void TearDown() override {
+        IotCredentialCache::getInstance().setFetchFunc(nullptr);
+        IotCredentialCache::getInstance().setPersistentCachePath("");
+        IotCredentialCache::getInstance().clear();
+        std::remove(TEST_IOT_CREDENTIAL_CACHE_FILE);
+    }
+
+    /**
+     * Stands in for the mTLS handshake with the IoT credential endpoint
+     */
+    Credentials fetch(const IotCredentialParams& params) {
+        this_thread::sleep_for(milliseconds(TEST_IOT_HANDSHAKE_DURATION_MILLIS));
+        auto now_time = duration_cast<seconds>(systemCurrentTime().time_since_epoch());
+        return Credentials("AKID" + to_string(++fetch_count_), "SECRET", "TOKEN",
+                           now_time + seconds(TEST_IOT_CREDENTIAL_VALIDITY_SECONDS));
+    }
+
+    IotCredentialParams getParams(const string& thing_name) {
+        IotCredentialParams params;
+        params.iot_get_credential_endpoint = "xxxxx.credentials.iot.us-west-2.amazonaws.com";
+        params.cert_path = "cert.pem";
+        params.private_key_path = "key.pem";
+        params.role_alias = "KvsCameraIoTRoleAlias";
+        params.ca_cert_path = "ca.pem";
+        params.thing_name = thing_name;
+        return params;
+    }
+
+    /**
+     * Starts the producers of a thing at once and reports the handshakes they've made
+     */
+    uint32_t startProducers(bool shared_credential_cache, milliseconds& duration) {
+        uint32_t start_fetch_count = fetch_count_;
+        auto params = getParams("thing");
+        vector<unique_ptr<IotCertCredentialProvider>> providers;
+        for (uint32_t i = 0; i < TEST_IOT_PRODUCER_COUNT; i++) {
+            providers.emplace_back(new IotCertCredentialProvider(params.iot_get_credential_endpoint, params.cert_path,
+                                                                 params.private_key_path, params.role_alias,
+                                                                 params.ca_cert_path, params.thing_name,
+                                                                 shared_credential_cache));
+        }
+
+        auto start_time = steady_clock::now();
+        vector<thread> threads;
+        for (auto& provider : providers) {
+            threads.emplace_back([this, &provider, &params, shared_credential_cache]() {
+                if (shared_credential_cache) {
+                    provider->getCredentialsSnapshot(true);
+                } else {
+                    // Each producer does its own handshake in the c producer iot auth callbacks
+                    fetch(params);
+                }
+            });
+        }
+
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        duration = duration_cast<milliseconds>(steady_clock::now() - start_time);
+        return fetch_count_ - start_fetch_count;
+    }
+
+    std::atomic<uint32_t> fetch_count_{0};
+};
+
+TEST_F(IotCredentialCacheTest, concurrent_producers_share_one_handshake)
+{
+    milliseconds unshared_duration, shared_duration;
+    uint64_t start_cache_fetch_count = IotCredentialCache::getInstance().getFetchCount();
+    uint32_t unshared_fetch_count = startProducers(false, unshared_duration);
+    uint32_t shared_fetch_count = startProducers(true, shared_duration);
+
+    LOG_INFO("Startup of " << TEST_IOT_PRODUCER_COUNT << " producers. Unshared: " << unshared_fetch_count
+             << " handshakes in " << unshared_duration.count() << "ms. Shared: " << shared_fetch_count
+             << " handshake in " << shared_duration.count() << "ms");
+    EXPECT_EQ((uint32_t) TEST_IOT_PRODUCER_COUNT, unshared_fetch_count);
+    EXPECT_EQ(1u, shared_fetch_count);
+    EXPECT_EQ(1u, IotCredentialCache::getInstance().getFetchCount() - start_cache_fetch_count);
+}
+
+TEST_F(IotCredentialCacheTest, credentials_are_keyed_by_thing)
+{
+    auto& cache = IotCredentialCache::getInstance();
+    auto first = cache.getCredentials(getParams("thing1"), seconds(60));
+    auto second = cache.getCredentials(getParams("thing2"), seconds(60));
+    EXPECT_NE(first.getAccessKey(), second.getAccessKey());
+    EXPECT_EQ(first.getAccessKey(), cache.getCredentials(getParams("thing1"), seconds(60)).getAccessKey());
+    EXPECT_EQ(2u, fetch_count_);
+}
+
+TEST_F(IotCredentialCacheTest, credentials_are_refreshed_ahead_of_expiry)
+{
+    auto& cache = IotCredentialCache::getInstance();
+    auto params = getParams("thing");
+    auto credentials = cache.getCredentials(params, seconds(60));
+    EXPECT_EQ(credentials.getAccessKey(), cache.getCredentials(params, seconds(TEST_IOT_CREDENTIAL_VALIDITY_SECONDS - 60)).getAccessKey());
+
+    // Asking for more validity than the cached credentials have left refreshes them
+    auto refreshed = cache.getCredentials(params, seconds(TEST_IOT_CREDENTIAL_VALIDITY_SECONDS + 60));
+    EXPECT_NE(credentials.getAccessKey(), refreshed.getAccessKey());
+    EXPECT_EQ(2u, fetch_count_);
+}
+
+TEST_F(IotCredentialCacheTest, persisted_credentials_survive_restart)
+{
+    auto& cache = IotCredentialCache::getInstance();
+    auto params = getParams("thing");
+    cache.setPersistentCachePath(TEST_IOT_CREDENTIAL_CACHE_FILE);
+    auto credentials = cache.getCredentials(params, seconds(60));
+
+    // Stands in for a restarted process
+    cache.clear();
+    cache.setPersistentCachePath("");
+    cache.setPersistentCachePath(TEST_IOT_CREDENTIAL_CACHE_FILE);
+    auto reloaded = cache.getCredentials(params, seconds(60));
+    EXPECT_EQ(credentials.getAccessKey(), reloaded.getAccessKey());
+    EXPECT_EQ(credentials.getSessionToken(), reloaded.getSessionToken());
+    EXPECT_EQ(credentials.getExpiration(), reloaded.getExpiration());
+    EXPECT_EQ(1u, fetch_count_);
+}
+
+TEST_F(IotCredentialCacheTest, failed_fetch_is_reported)
+{
+    auto& cache = IotCredentialCache::getInstance();
+    cache.setFetchFunc([](const IotCredentialParams&) -> Credentials {
+        throw runtime_error("handshake failed");
+    });
+
+    EXPECT_THROW(cache.getCredentials(getParams("thing"), seconds(60)), runtime_error);
+}
+
+}  // namespace video
+}  // namespace kinesis
+}  // namespace amazonaws
+}  // namespace com
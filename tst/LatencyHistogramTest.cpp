@@ -0,0 +1,116 @@
+#include "ProducerTestFixture.h"
+#include "LatencyHistogram.h"
+#include "StreamLatencyTracker.h"
+
+#include <thread>
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+using namespace std;
+using namespace std::chrono;
+
+#define TEST_HISTOGRAM_RECORDER_COUNT                       4
+#define TEST_HISTOGRAM_RECORD_ITERATIONS                    1000000
+
+TEST(LatencyHistogramTest, bucket_bounds_within_relative_error)
+{
+    uint32_t previous_index = 0;
+    for (uint64_t value = 0; value < (1ull << 20); value += 1 + value / 128) {
+        uint32_t index = LatencyHistogram::bucketIndex(value);
+        uint64_t upper_bound = LatencyHistogram::bucketUpperBound(index);
+
+        EXPECT_GE(index, previous_index);
+        EXPECT_GE(upper_bound, value);
+        EXPECT_LE(upper_bound - value, value / LATENCY_HISTOGRAM_SUB_BUCKET_COUNT);
+        previous_index = index;
+    }
+
+    // Values past the trackable range are clamped into the last bucket
+    EXPECT_EQ(LATENCY_HISTOGRAM_BUCKET_COUNT - 1, LatencyHistogram::bucketIndex(MAX_UINT64));
+}
+
+TEST(LatencyHistogramTest, uniform_distribution_percentiles)
+{
+    LatencyHistogram histogram;
+
+    EXPECT_EQ(0, histogram.getPercentiles().count);
+
+    for (uint64_t value = 1; value <= 10000; value++) {
+        histogram.record(microseconds(value));
+    }
+
+    LatencyPercentiles percentiles = histogram.getPercentiles();
+    EXPECT_EQ(10000, percentiles.count);
+    EXPECT_NEAR(5000, percentiles.p50.count(), 5000 / LATENCY_HISTOGRAM_SUB_BUCKET_COUNT);
+    EXPECT_NEAR(9000, percentiles.p90.count(), 9000 / LATENCY_HISTOGRAM_SUB_BUCKET_COUNT);
+    EXPECT_NEAR(9900, percentiles.p99.count(), 9900 / LATENCY_HISTOGRAM_SUB_BUCKET_COUNT);
+    EXPECT_NEAR(9990, percentiles.p999.count(), 9990 / LATENCY_HISTOGRAM_SUB_BUCKET_COUNT);
+    EXPECT_EQ(10000, percentiles.max.count());
+
+    histogram.reset();
+    EXPECT_EQ(0, histogram.getPercentiles().count);
+}
+
+TEST(LatencyHistogramTest, concurrent_record_benchmark)
+{
+    LatencyHistogram histogram;
+    vector<thread> threads;
+
+    auto start = steady_clock::now();
+    for (uint32_t i = 0; i < TEST_HISTOGRAM_RECORDER_COUNT; i++) {
+        threads.push_back(thread([&histogram, i]() {
+            for (uint32_t iteration = 0; iteration < TEST_HISTOGRAM_RECORD_ITERATIONS; iteration++) {
+                histogram.record(microseconds((iteration * (i + 1)) % 100000));
+            }
+        }));
+    }
+
+    for (auto& recorder : threads) {
+        recorder.join();
+    }
+
+    auto elapsed = duration_cast<nanoseconds>(steady_clock::now() - start).count();
+    LOG_INFO("Latency histogram record cost with " << TEST_HISTOGRAM_RECORDER_COUNT << " concurrent recorders: "
+             << elapsed * TEST_HISTOGRAM_RECORDER_COUNT / ((uint64_t) TEST_HISTOGRAM_RECORDER_COUNT * TEST_HISTOGRAM_RECORD_ITERATIONS) << " ns");
+
+    EXPECT_EQ((uint64_t) TEST_HISTOGRAM_RECORDER_COUNT * TEST_HISTOGRAM_RECORD_ITERATIONS, histogram.getPercentiles().count);
+}
+
+TEST(LatencyHistogramTest, tracker_matches_fragment_acks)
+{
+    // Millisecond timecode scale
+    StreamLatencyTracker tracker(HUNDREDS_OF_NANOS_IN_A_MILLISECOND);
+
+    Frame frame;
+    MEMSET(&frame, 0x00, SIZEOF(Frame));
+    frame.flags = FRAME_FLAG_KEY_FRAME;
+    frame.presentationTs = 1000 * HUNDREDS_OF_NANOS_IN_A_SECOND;
+
+    auto put_time = steady_clock::now() - milliseconds(100);
+    tracker.recordPutFrame(frame, put_time, microseconds(50));
+
+    // Non-key frames only contribute to the putFrame latency
+    frame.flags = FRAME_FLAG_NONE;
+    frame.presentationTs += HUNDREDS_OF_NANOS_IN_A_SECOND;
+    tracker.recordPutFrame(frame, put_time, microseconds(50));
+
+    FragmentAck fragment_ack;
+    MEMSET(&fragment_ack, 0x00, SIZEOF(FragmentAck));
+    fragment_ack.ackType = FRAGMENT_ACK_TYPE_PERSISTED;
+    fragment_ack.timestamp = 1000 * 1000;
+    tracker.recordFragmentAck(fragment_ack);
+
+    // Untracked fragment
+    fragment_ack.timestamp = 1001 * 1000;
+    tracker.recordFragmentAck(fragment_ack);
+
+    EXPECT_EQ(2, tracker.getPutFrameLatency().count);
+    EXPECT_EQ(0, tracker.getBufferingAckLatency().count);
+    EXPECT_EQ(1, tracker.getPersistedAckLatency().count);
+    EXPECT_LE(100000, tracker.getPersistedAckLatency().max.count());
+}
+
+}  // namespace video
+}  // namespace kinesis
+}  // namespace amazonaws
+}  // namespace com
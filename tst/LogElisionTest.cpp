@@ -0,0 +1,106 @@
+// Compile this translation unit with the DEBUG and TRACE statements compiled out regardless of the build option
+#undef KVS_MIN_LOG_LEVEL
+#define KVS_MIN_LOG_LEVEL KVS_LOG_LEVEL_INFO
+
+#include "gtest/gtest.h"
+#include "Logger.h"
+
+#include <chrono>
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+LOGGER_TAG("com.amazonaws.kinesis.video.TEST");
+
+using namespace std;
+using namespace std::chrono;
+
+#define TEST_LOG_ELISION_ITERATIONS                         2000000
+
+// The statement the LOG_DEBUG macro expands to without the compile time elision
+#define TEST_RUNTIME_CHECKED_DEBUG(msg) _LOG_AT_LEVEL(log4cplus::DEBUG_LOG_LEVEL, LOG4CPLUS_DEBUG, msg)
+
+/**
+ * Mimics the put path logging with the level checked at runtime
+ */
+uint64_t putFrameRuntimeChecked(uint64_t frame_index) {
+    TEST_RUNTIME_CHECKED_DEBUG("putFrame(): frame index " << frame_index);
+    TEST_RUNTIME_CHECKED_DEBUG("putFrame(): decoding ts " << frame_index * 1000 << ", presentation ts " << frame_index * 1000);
+    return frame_index * 31 + 7;
+}
+
+/**
+ * Mimics the put path logging with the statements compiled out
+ */
+uint64_t putFrameCompiledOut(uint64_t frame_index) {
+    LOG_DEBUG("putFrame(): frame index " << frame_index);
+    LOG_TRACE("putFrame(): decoding ts " << frame_index * 1000 << ", presentation ts " << frame_index * 1000);
+    return frame_index * 31 + 7;
+}
+
+/**
+ * Runs the put path function through a volatile pointer so it is not inlined and returns the average nanoseconds per call
+ */
+double runPutPath(uint64_t (* volatile put_frame)(uint64_t)) {
+    volatile uint64_t checksum = 0;
+    auto start = steady_clock::now();
+
+    for (uint64_t i = 0; i < TEST_LOG_ELISION_ITERATIONS; i++) {
+        checksum = checksum + put_frame(i);
+    }
+
+    auto elapsed = duration_cast<nanoseconds>(steady_clock::now() - start).count();
+    return (double) elapsed / TEST_LOG_ELISION_ITERATIONS;
+}
+
+TEST(LogElisionTest, compiled_out_levels_are_disabled)
+{
+    EXPECT_FALSE(LOG_IS_TRACE_ENABLED);
+    EXPECT_FALSE(LOG_IS_DEBUG_ENABLED);
+
+    // The compiled out statements are never evaluated
+    uint32_t evaluations = 0;
+    LOG_DEBUG("evaluated " << ++evaluations);
+    LOG_TRACE("evaluated " << ++evaluations);
+    EXPECT_EQ(0u, evaluations);
+}
+
+TEST(LogElisionTest, compiled_out_statements_ignore_runtime_level)
+{
+    log4cplus::Logger logger = log4cplus::Logger::getInstance("com.amazonaws.kinesis.video.TEST");
+    log4cplus::LogLevel log_level = logger.getLogLevel();
+    logger.setLogLevel(log4cplus::TRACE_LOG_LEVEL);
+
+    // The runtime checked statement formats its arguments once the level is enabled at runtime
+    uint32_t evaluations = 0;
+    TEST_RUNTIME_CHECKED_DEBUG("evaluated " << ++evaluations);
+    EXPECT_EQ(1u, evaluations);
+
+    // The compiled out ones stay out of the put path whatever the runtime level
+    LOG_DEBUG("evaluated " << ++evaluations);
+    LOG_TRACE("evaluated " << ++evaluations);
+    EXPECT_EQ(1u, evaluations);
+
+    logger.setLogLevel(log_level);
+}
+
+TEST(LogElisionTest, put_path_runtime_vs_compiled_out_benchmark)
+{
+    // Runtime disabled DEBUG level which is the common production setting
+    log4cplus::Logger logger = log4cplus::Logger::getInstance("com.amazonaws.kinesis.video.TEST");
+    log4cplus::LogLevel log_level = logger.getLogLevel();
+    logger.setLogLevel(log4cplus::WARN_LOG_LEVEL);
+
+    double runtime_checked = runPutPath(putFrameRuntimeChecked);
+    double compiled_out = runPutPath(putFrameCompiledOut);
+
+    logger.setLogLevel(log_level);
+
+    // Reported only as the timing is too noisy on the shared build hosts to assert on
+    LOG_WARN("Put path ns/call with DEBUG disabled: runtime checked " << runtime_checked
+             << ", compiled out " << compiled_out);
+}
+
+}  // namespace video
+}  // namespace kinesis
+}  // namespace amazonaws
+}  // namespace com
@@ -0,0 +1,209 @@
+#include "ProducerTestFixture.h"
+#include "NalScanner.h"
+
+#include <random>
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+using namespace std;
+using namespace std::chrono;
+
+#define TEST_SCAN_BUFFER_SIZE                               (4 * 1024 * 1024)
+#define TEST_SCAN_NAL_SIZE                                  (64 * 1024)
+#define TEST_SCAN_ITERATIONS                                4
+#define TEST_EQUIVALENCE_BUFFER_SIZE                        200
+
+const uint8_t TEST_H264_SPS[] = {0x67, 0x42, 0x00, 0x1f, 0x95, 0xa8, 0x14, 0x01};
+const uint8_t TEST_H264_PPS[] = {0x68, 0xce, 0x3c, 0x80};
+const uint8_t TEST_H264_IDR[] = {0x65, 0x88, 0x84, 0x00, 0x33, 0xff};
+const uint8_t TEST_H264_NON_IDR[] = {0x41, 0x9a, 0x02, 0x0c};
+
+const uint8_t TEST_H265_VPS[] = {0x40, 0x01, 0x0c, 0x01, 0xff, 0xff};
+const uint8_t TEST_H265_SPS[] = {0x42, 0x01, 0x01, 0x01, 0x60, 0x5d};
+const uint8_t TEST_H265_PPS[] = {0x44, 0x01, 0xc1, 0x72};
+const uint8_t TEST_H265_IDR_W_RADL[] = {0x26, 0x01, 0xaf, 0x09};
+const uint8_t TEST_H265_CRA[] = {0x2a, 0x01, 0xaf, 0x09};
+const uint8_t TEST_H265_TRAIL_R[] = {0x02, 0x01, 0xd0, 0x09};
+
+template <size_t N>
+void appendNal(vector<uint8_t>& access_unit, const uint8_t (&nal)[N], bool long_start_code = true) {
+    if (long_start_code) {
+        access_unit.push_back(0x00);
+    }
+
+    access_unit.push_back(0x00);
+    access_unit.push_back(0x00);
+    access_unit.push_back(0x01);
+    access_unit.insert(access_unit.end(), nal, nal + N);
+}
+
+TEST(NalScannerTest, split_handles_start_code_lengths_and_trailing_zeros)
+{
+    vector<uint8_t> access_unit;
+    appendNal(access_unit, TEST_H264_SPS);
+    appendNal(access_unit, TEST_H264_PPS, false);
+    appendNal(access_unit, TEST_H264_IDR);
+    access_unit.push_back(0x00);
+    access_unit.push_back(0x00);
+
+    vector<NalUnit> nal_units;
+    NalScanner::split(access_unit.data(), access_unit.size(), nal_units);
+    ASSERT_EQ(3u, nal_units.size());
+    EXPECT_EQ(sizeof(TEST_H264_SPS), nal_units[0].size);
+    EXPECT_EQ(0, memcmp(TEST_H264_SPS, nal_units[0].data, sizeof(TEST_H264_SPS)));
+    EXPECT_EQ(sizeof(TEST_H264_PPS), nal_units[1].size);
+    EXPECT_EQ(0, memcmp(TEST_H264_PPS, nal_units[1].data, sizeof(TEST_H264_PPS)));
+    EXPECT_EQ(sizeof(TEST_H264_IDR), nal_units[2].size);
+    EXPECT_EQ(0, memcmp(TEST_H264_IDR, nal_units[2].data, sizeof(TEST_H264_IDR)));
+
+    // No start code
+    NalScanner::split(TEST_H264_IDR, sizeof(TEST_H264_IDR), nal_units);
+    EXPECT_TRUE(nal_units.empty());
+}
+
+TEST(NalScannerTest, h264_slices_and_codec_private_data)
+{
+    vector<uint8_t> access_unit;
+    vector<NalUnit> nal_units;
+    vector<uint8_t> codec_private_data;
+
+    appendNal(access_unit, TEST_H264_NON_IDR);
+    NalScanner::split(access_unit.data(), access_unit.size(), nal_units);
+    EXPECT_EQ(NAL_SLICE_TYPE_NON_IDR, NalScanner::classifySlice(NAL_CODEC_H264, nal_units[0]));
+    EXPECT_FALSE(NalScanner::isKeyFrame(NAL_CODEC_H264, nal_units));
+    EXPECT_FALSE(NalScanner::extractCodecPrivateData(NAL_CODEC_H264, nal_units, codec_private_data));
+    EXPECT_TRUE(codec_private_data.empty());
+
+    access_unit.clear();
+    appendNal(access_unit, TEST_H264_SPS);
+    appendNal(access_unit, TEST_H264_PPS);
+    appendNal(access_unit, TEST_H264_IDR);
+    NalScanner::split(access_unit.data(), access_unit.size(), nal_units);
+    EXPECT_EQ(NAL_SLICE_TYPE_NONE, NalScanner::classifySlice(NAL_CODEC_H264, nal_units[0]));
+    EXPECT_EQ(NAL_SLICE_TYPE_IDR, NalScanner::classifySlice(NAL_CODEC_H264, nal_units[2]));
+    EXPECT_TRUE(NalScanner::isKeyFrame(NAL_CODEC_H264, nal_units));
+
+    // The parameter sets with the four byte start codes
+    vector<uint8_t> expected;
+    appendNal(expected, TEST_H264_SPS);
+    appendNal(expected, TEST_H264_PPS);
+    EXPECT_TRUE(NalScanner::extractCodecPrivateData(NAL_CODEC_H264, nal_units, codec_private_data));
+    EXPECT_EQ(expected, codec_private_data);
+}
+
+TEST(NalScannerTest, h265_slices_and_codec_private_data)
+{
+    vector<uint8_t> access_unit;
+    vector<NalUnit> nal_units;
+    vector<uint8_t> codec_private_data;
+
+    appendNal(access_unit, TEST_H265_TRAIL_R);
+    appendNal(access_unit, TEST_H265_CRA);
+    NalScanner::split(access_unit.data(), access_unit.size(), nal_units);
+    EXPECT_EQ(NAL_SLICE_TYPE_NON_IDR, NalScanner::classifySlice(NAL_CODEC_H265, nal_units[0]));
+    EXPECT_EQ(NAL_SLICE_TYPE_IDR, NalScanner::classifySlice(NAL_CODEC_H265, nal_units[1]));
+
+    // The parameter sets are emitted in the VPS, SPS, PPS order regardless of the order in the access unit
+    access_unit.clear();
+    appendNal(access_unit, TEST_H265_SPS);
+    appendNal(access_unit, TEST_H265_PPS);
+    appendNal(access_unit, TEST_H265_IDR_W_RADL);
+    NalScanner::split(access_unit.data(), access_unit.size(), nal_units);
+    EXPECT_TRUE(NalScanner::isKeyFrame(NAL_CODEC_H265, nal_units));
+    EXPECT_FALSE(NalScanner::extractCodecPrivateData(NAL_CODEC_H265, nal_units, codec_private_data));
+
+    appendNal(access_unit, TEST_H265_VPS, false);
+    NalScanner::split(access_unit.data(), access_unit.size(), nal_units);
+    EXPECT_EQ(32, NalScanner::getNalUnitType(NAL_CODEC_H265, nal_units[3]));
+
+    vector<uint8_t> expected;
+    appendNal(expected, TEST_H265_VPS);
+    appendNal(expected, TEST_H265_SPS);
+    appendNal(expected, TEST_H265_PPS);
+    EXPECT_TRUE(NalScanner::extractCodecPrivateData(NAL_CODEC_H265, nal_units, codec_private_data));
+    EXPECT_EQ(expected, codec_private_data);
+}
+
+TEST(NalScannerTest, vectorized_search_matches_scalar)
+{
+    auto start_code_searches = NalScanner::getSupportedStartCodeSearches();
+    ASSERT_STREQ("scalar", start_code_searches.back().name);
+    EXPECT_STREQ(start_code_searches.front().name, NalScanner::getImplementationName());
+
+    // Every implementation the CPU supports rather than only the dispatched one
+    for (const auto& start_code_search : start_code_searches) {
+        SCOPED_TRACE(start_code_search.name);
+
+        // Start codes at every offset across the vector boundaries and the scalar tail
+        for (size_t size = 0; size <= TEST_EQUIVALENCE_BUFFER_SIZE; size += 7) {
+            for (size_t position = 0; position + 3 <= size; position++) {
+                vector<uint8_t> buffer(size, 0xff);
+                buffer[position] = 0x00;
+                buffer[position + 1] = 0x00;
+                buffer[position + 2] = 0x01;
+                for (size_t offset = 0; offset <= size; offset += 5) {
+                    ASSERT_EQ(NalScanner::findStartCodeScalar(buffer.data(), size, offset),
+                              start_code_search.find(buffer.data(), size, offset))
+                            << "size " << size << ", position " << position << ", offset " << offset;
+                }
+            }
+        }
+
+        // Zero runs and near misses
+        mt19937 generator(42);
+        uniform_int_distribution<int> distribution(0, 3);
+        vector<uint8_t> buffer(TEST_EQUIVALENCE_BUFFER_SIZE * 16);
+        for (auto& byte : buffer) {
+            byte = (uint8_t) (distribution(generator) < 3 ? 0x00 : distribution(generator));
+        }
+
+        for (size_t offset = 0; offset < buffer.size();) {
+            size_t expected = NalScanner::findStartCodeScalar(buffer.data(), buffer.size(), offset);
+            ASSERT_EQ(expected, start_code_search.find(buffer.data(), buffer.size(), offset));
+            offset = expected + 1;
+        }
+    }
+}
+
+TEST(NalScannerTest, start_code_search_throughput)
+{
+    // Slice payload with emulation prevention so that the start codes only separate the NAL units
+    vector<uint8_t> buffer(TEST_SCAN_BUFFER_SIZE);
+    mt19937 generator(42);
+    for (auto& byte : buffer) {
+        byte = (uint8_t) (generator() | 0x04);
+    }
+
+    size_t nal_count = 0;
+    for (size_t i = 0; i + 4 <= buffer.size(); i += TEST_SCAN_NAL_SIZE) {
+        buffer[i] = 0x00;
+        buffer[i + 1] = 0x00;
+        buffer[i + 2] = 0x01;
+        buffer[i + 3] = 0x41;
+        nal_count++;
+    }
+
+    vector<NalUnit> nal_units;
+    NalScanner::split(buffer.data(), buffer.size(), nal_units);
+    EXPECT_EQ(nal_count, nal_units.size());
+
+    double scanned_gb = (double) TEST_SCAN_BUFFER_SIZE * TEST_SCAN_ITERATIONS / 1e9;
+    for (const auto& start_code_search : NalScanner::getSupportedStartCodeSearches()) {
+        size_t found = 0;
+        auto start = steady_clock::now();
+        for (uint32_t i = 0; i < TEST_SCAN_ITERATIONS; i++) {
+            for (size_t offset = 0; offset < buffer.size(); found++) {
+                offset = start_code_search.find(buffer.data(), buffer.size(), offset) + 1;
+            }
+        }
+
+        double seconds = duration_cast<duration<double>>(steady_clock::now() - start).count();
+        EXPECT_EQ((nal_count + 1) * TEST_SCAN_ITERATIONS, found) << start_code_search.name;
+        LOG_INFO("Start code search GB/s: " << start_code_search.name << " " << scanned_gb / seconds);
+    }
+}
+
+}  // namespace video
+}  // namespace kinesis
+}  // namespace amazonaws
+}  // namespace com
@@ -0,0 +1,162 @@
+#include "ProducerTestFixture.h"
+#include "PersistentCache.h"
+#include "CachingCredentialProvider.h"
+
+#include <cstdio>
+#include <fstream>
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+using namespace std;
+using namespace std::chrono;
+
+#define TEST_PERSISTENT_CACHE_FILE                          "kvs_persistent_cache_test.cache"
+
+/**
+ * Counts the credential fetches and fails them on demand
+ */
+class CountingCredentialProvider : public CredentialProvider {
+public:
+    CountingCredentialProvider(uint32_t& fetch_count, bool& fail, duration<uint64_t> validity)
+            : fetch_count_(fetch_count), fail_(fail), validity_(validity) {}
+
+private:
+    void updateCredentials(Credentials& credentials) override {
+        fetch_count_++;
+        if (fail_) {
+            throw runtime_error("Credential fetch failed");
+        }
+
+        auto now_time = duration_cast<seconds>(systemCurrentTime().time_since_epoch());
+        credentials = Credentials("access" + to_string(fetch_count_), "secret", "token", now_time + validity_);
+    }
+
+    uint32_t& fetch_count_;
+    bool& fail_;
+    const duration<uint64_t> validity_;
+};
+
+duration<uint64_t> expiresIn(seconds validity) {
+    return duration_cast<seconds>(systemCurrentTime().time_since_epoch()) + validity;
+}
+
+TEST(PersistentCacheTest, entries_survive_reload)
+{
+    std::remove(TEST_PERSISTENT_CACHE_FILE);
+    {
+        PersistentCache cache(TEST_PERSISTENT_CACHE_FILE);
+        EXPECT_FALSE(cache.load());
+        EXPECT_TRUE(cache.put("key", string("value\0with\nbytes", 16), expiresIn(hours(1))));
+        EXPECT_TRUE(cache.put("other", "other value", expiresIn(hours(1))));
+        EXPECT_TRUE(cache.put("expired", "expired value", expiresIn(seconds(-1))));
+        EXPECT_TRUE(cache.remove("other"));
+    }
+
+    PersistentCache cache(TEST_PERSISTENT_CACHE_FILE);
+    ASSERT_TRUE(cache.load());
+
+    PersistentCacheEntry entry;
+    ASSERT_TRUE(cache.get("key", entry));
+    EXPECT_EQ(string("value\0with\nbytes", 16), entry.value);
+    EXPECT_FALSE(cache.get("other", entry));
+    EXPECT_FALSE(cache.get("expired", entry));
+
+    std::remove(TEST_PERSISTENT_CACHE_FILE);
+}
+
+TEST(PersistentCacheTest, corrupt_file_is_ignored)
+{
+    {
+        PersistentCache cache(TEST_PERSISTENT_CACHE_FILE);
+        ASSERT_TRUE(cache.put("key", "value", expiresIn(hours(1))));
+    }
+
+    // Flip a byte of the value
+    {
+        fstream file(TEST_PERSISTENT_CACHE_FILE, ios::in | ios::out | ios::binary);
+        file.seekp(-(streamoff) (sizeof(uint64_t) * 2 + 1), ios::end);
+        file.put('X');
+    }
+
+    PersistentCache cache(TEST_PERSISTENT_CACHE_FILE);
+    EXPECT_FALSE(cache.load());
+
+    PersistentCacheEntry entry;
+    EXPECT_FALSE(cache.get("key", entry));
+
+    // Truncated file
+    {
+        ofstream file(TEST_PERSISTENT_CACHE_FILE, ios::out | ios::trunc | ios::binary);
+        file.write(PERSISTENT_CACHE_FILE_MAGIC, PERSISTENT_CACHE_FILE_MAGIC_SIZE);
+    }
+
+    EXPECT_FALSE(cache.load());
+    std::remove(TEST_PERSISTENT_CACHE_FILE);
+}
+
+TEST(PersistentCacheTest, credentials_are_reused_across_restarts)
+{
+    uint32_t fetch_count = 0;
+    bool fail = false;
+    Credentials credentials;
+    std::remove(TEST_PERSISTENT_CACHE_FILE);
+
+    {
+        CachingCredentialProvider credential_provider(
+                unique_ptr<CredentialProvider>(new CountingCredentialProvider(fetch_count, fail, hours(1))),
+                TEST_PERSISTENT_CACHE_FILE);
+        credential_provider.getUpdatedCredentials(credentials);
+        credential_provider.getUpdatedCredentials(credentials);
+        EXPECT_EQ(1u, fetch_count);
+        EXPECT_EQ("access1", credentials.getAccessKey());
+    }
+
+    // The restarted process uses the persisted credentials
+    CachingCredentialProvider credential_provider(
+            unique_ptr<CredentialProvider>(new CountingCredentialProvider(fetch_count, fail, hours(1))),
+            TEST_PERSISTENT_CACHE_FILE);
+    credential_provider.getUpdatedCredentials(credentials);
+    EXPECT_EQ(1u, fetch_count);
+    EXPECT_EQ("access1", credentials.getAccessKey());
+    EXPECT_EQ("secret", credentials.getSecretKey());
+    EXPECT_EQ("token", credentials.getSessionToken());
+
+    std::remove(TEST_PERSISTENT_CACHE_FILE);
+}
+
+TEST(PersistentCacheTest, stale_credentials_are_used_on_refresh_failure)
+{
+    uint32_t fetch_count = 0;
+    bool fail = false;
+    Credentials credentials;
+    std::remove(TEST_PERSISTENT_CACHE_FILE);
+
+    // Credentials within the grace period are refreshed on every use
+    CachingCredentialProvider credential_provider(
+            unique_ptr<CredentialProvider>(new CountingCredentialProvider(fetch_count, fail, seconds(60))),
+            TEST_PERSISTENT_CACHE_FILE);
+    credential_provider.getUpdatedCredentials(credentials);
+    credential_provider.getUpdatedCredentials(credentials);
+    EXPECT_EQ(2u, fetch_count);
+    EXPECT_EQ("access2", credentials.getAccessKey());
+
+    fail = true;
+    credential_provider.getUpdatedCredentials(credentials);
+    EXPECT_EQ(3u, fetch_count);
+    EXPECT_EQ("access2", credentials.getAccessKey());
+
+    // The expired credentials are dropped so there is nothing to fall back onto
+    shared_ptr<PersistentCache> cache = make_shared<PersistentCache>(TEST_PERSISTENT_CACHE_FILE);
+    ASSERT_TRUE(cache->put("expired", "access\nsecret\ntoken", expiresIn(seconds(-1))));
+    CachingCredentialProvider expired_credential_provider(
+            unique_ptr<CredentialProvider>(new CountingCredentialProvider(fetch_count, fail, seconds(60))),
+            cache, "expired");
+    EXPECT_THROW(expired_credential_provider.getUpdatedCredentials(credentials), runtime_error);
+
+    std::remove(TEST_PERSISTENT_CACHE_FILE);
+}
+
+}  // namespace video
+}  // namespace kinesis
+}  // namespace amazonaws
+}  // namespace com
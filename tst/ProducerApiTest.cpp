@@ -1,4 +1,9 @@
 #include "ProducerTestFixture.h"
+#include "OpenMetricsExporter.h"
+#include "StreamPool.h"
+#include "ProducerPool.h"
+
+#include <fstream>
 
 namespace com { namespace amazonaws { namespace kinesis { namespace video {
 
@@ -6,6 +11,18 @@ using namespace std;
 using namespace std::chrono;
 
 class ProducerApiTest : public ProducerTestBase {
+protected:
+    /**
+     * Creates a stream definition which exceeds the track count and fails to be created before reaching the backend
+     */
+    unique_ptr<StreamDefinition> CreateInvalidTestStreamDefinition(int index) {
+        unique_ptr<StreamDefinition> stream_definition = CreateTestStreamDefinition(index);
+        for (uint64_t track_id = DEFAULT_TRACK_ID + 1; track_id <= DEFAULT_TRACK_ID + MAX_SUPPORTED_TRACK_COUNT_PER_STREAM; track_id++) {
+            stream_definition->addTrack(track_id, "audio", "A_AAC", MKV_TRACK_INFO_TYPE_AUDIO);
+        }
+
+        return stream_definition;
+    }
 };
 
 ProducerTestBase* gProducerApiTest;
@@ -838,6 +855,551 @@ TEST_F(ProducerApiTest, segment_uuid_variations)
             DEFAULT_TRACK_ID)));
 }
 
+TEST_F(ProducerApiTest, put_frames_batch_throughput)
+{
+    // Check if it's run with the env vars set if not bail out
+    if (!access_key_set_) {
+        return;
+    }
+
+    const uint32_t batch_sizes[] = {1, 4, 16, 64, 256};
+    const uint32_t frames_per_batch_size = 1024;
+
+    CreateProducer();
+    streams_[0] = CreateTestStream(0, STREAMING_TYPE_OFFLINE);
+    shared_ptr<KinesisVideoStream> kinesis_video_stream = streams_[0];
+
+    EXPECT_TRUE(StartTestStream(*kinesis_video_stream));
+
+    MEMSET(frameBuffer_, 0x55, SIZEOF(frameBuffer_));
+
+    uint32_t index = 0;
+    for (auto batch_size : batch_sizes) {
+        vector<Frame> batch(batch_size);
+        uint64_t elapsed_nanos = 0;
+
+        for (uint32_t submitted = 0; submitted < frames_per_batch_size; submitted += batch_size) {
+            for (auto& frame : batch) {
+                frame = CreateTestFrame(index++);
+            }
+
+            auto start = high_resolution_clock::now();
+            vector<STATUS> statuses = kinesis_video_stream->putFrames(batch);
+            elapsed_nanos += duration_cast<nanoseconds>(high_resolution_clock::now() - start).count();
+
+            ASSERT_EQ(batch_size, statuses.size());
+            for (auto status : statuses) {
+                EXPECT_EQ(STATUS_SUCCESS, status);
+            }
+        }
+
+        LOG_INFO("putFrames batch size " << batch_size << ": "
+                 << (frames_per_batch_size * 1000000000ull) / MAX(elapsed_nanos, 1) << " frames/sec");
+    }
+
+    EXPECT_TRUE(kinesis_video_stream->stopSync());
+    kinesis_video_stream.reset();
+    freeStreams();
+}
+
+TEST_F(ProducerApiTest, create_produce_async_ingest_stream)
+{
+    // Check if it's run with the env vars set if not bail out
+    if (!access_key_set_) {
+        return;
+    }
+
+    const uint32_t ingest_queue_capacity = 64;
+    const uint32_t frame_count = 1000;
+
+    CreateProducer();
+    streams_[0] = CreateTestStream(0, STREAMING_TYPE_OFFLINE, TEST_MAX_STREAM_LATENCY_IN_MILLIS, 120, ingest_queue_capacity);
+    shared_ptr<KinesisVideoStream> kinesis_video_stream = streams_[0];
+
+    EXPECT_TRUE(StartTestStream(*kinesis_video_stream));
+
+    uint32_t accepted = 0;
+    for (uint32_t index = 0; index < frame_count; index++) {
+        // The queue owns a copy so the caller buffer can be reused right away
+        MEMSET(frameBuffer_, (BYTE) index, SIZEOF(frameBuffer_));
+        if (kinesis_video_stream->putFrame(CreateTestFrame(index))) {
+            accepted++;
+        }
+    }
+
+    kinesis_video_stream->flushIngestQueue();
+
+    auto stream_metrics = kinesis_video_stream->getMetrics();
+    EXPECT_EQ(0, stream_metrics.getIngestQueueDepth());
+    EXPECT_LE(stream_metrics.getIngestQueueHighWaterMark(), ingest_queue_capacity);
+    EXPECT_EQ(frame_count, accepted + stream_metrics.getIngestQueueDroppedFrames());
+
+    EXPECT_TRUE(kinesis_video_stream->stopSync());
+    kinesis_video_stream.reset();
+    freeStreams();
+}
+
+TEST_F(ProducerApiTest, create_produce_owned_frame_buffers)
+{
+    // Check if it's run with the env vars set if not bail out
+    if (!access_key_set_) {
+        return;
+    }
+
+    const uint32_t frame_count = 200;
+    std::atomic<uint32_t> released(0);
+
+    CreateProducer();
+    streams_[0] = CreateTestStream(0, STREAMING_TYPE_OFFLINE, TEST_MAX_STREAM_LATENCY_IN_MILLIS, 120, frame_count);
+    shared_ptr<KinesisVideoStream> kinesis_video_stream = streams_[0];
+
+    EXPECT_TRUE(StartTestStream(*kinesis_video_stream));
+
+    for (uint32_t index = 0; index < frame_count; index++) {
+        // The payload and its size are taken from the frame buffer
+        Frame frame = CreateTestFrame(index);
+
+        // Alternate between an adopted vector and an external buffer with a release callback
+        if (index % 2 == 0) {
+            EXPECT_TRUE(kinesis_video_stream->putFrame(frame, FrameBuffer(vector<uint8_t>(TEST_FRAME_SIZE, 0x55))));
+            released++;
+        } else {
+            uint8_t* payload = new uint8_t[TEST_FRAME_SIZE];
+            MEMSET(payload, 0x55, TEST_FRAME_SIZE);
+            EXPECT_TRUE(kinesis_video_stream->putFrame(frame, FrameBuffer(payload, TEST_FRAME_SIZE, [&released](uint8_t* data, size_t) {
+                delete [] data;
+                released++;
+            })));
+        }
+    }
+
+    kinesis_video_stream->flushIngestQueue();
+    EXPECT_EQ(frame_count, released.load());
+
+    EXPECT_TRUE(kinesis_video_stream->stopSync());
+    kinesis_video_stream.reset();
+    freeStreams();
+}
+
+TEST_F(ProducerApiTest, create_produce_owned_frame_buffers_released_on_queue_drop)
+{
+    // Check if it's run with the env vars set if not bail out
+    if (!access_key_set_) {
+        return;
+    }
+
+    const uint32_t ingest_queue_capacity = 4;
+    const uint32_t frame_count = 200;
+    std::atomic<uint32_t> released(0);
+
+    CreateProducer();
+    streams_[0] = CreateTestStream(0, STREAMING_TYPE_OFFLINE, TEST_MAX_STREAM_LATENCY_IN_MILLIS, 120, ingest_queue_capacity);
+    shared_ptr<KinesisVideoStream> kinesis_video_stream = streams_[0];
+    EXPECT_TRUE(StartTestStream(*kinesis_video_stream));
+
+    uint32_t dropped = 0;
+    for (uint32_t index = 0; index < frame_count; index++) {
+        uint8_t* payload = new uint8_t[TEST_FRAME_SIZE];
+        MEMSET(payload, 0x55, TEST_FRAME_SIZE);
+        uint32_t released_before = released;
+        if (!kinesis_video_stream->putFrame(CreateTestFrame(index), FrameBuffer(payload, TEST_FRAME_SIZE, [&released](uint8_t* data, size_t) {
+            delete [] data;
+            released++;
+        }))) {
+            // The buffer of a frame which doesn't fit the queue is released on return
+            EXPECT_LT(released_before, released.load());
+            dropped++;
+        }
+    }
+
+    kinesis_video_stream->flushIngestQueue();
+    EXPECT_EQ(frame_count, released.load());
+    EXPECT_EQ(dropped, kinesis_video_stream->getMetrics().getIngestQueueDroppedFrames());
+
+    EXPECT_TRUE(kinesis_video_stream->stopSync());
+    kinesis_video_stream.reset();
+    freeStreams();
+}
+
+TEST_F(ProducerApiTest, metrics_snapshots_sampled_in_background)
+{
+    // Check if it's run with the env vars set if not bail out
+    if (!access_key_set_) {
+        return;
+    }
+
+    CreateProducer();
+    kinesis_video_producer_->setMetricsSamplingPeriod(std::chrono::milliseconds(50));
+    streams_[0] = CreateTestStream(0);
+    shared_ptr<KinesisVideoStream> kinesis_video_stream = streams_[0];
+
+    // Allow a few sampling periods to lapse
+    THREAD_SLEEP(500 * HUNDREDS_OF_NANOS_IN_A_MILLISECOND);
+
+    EXPECT_NE(0, kinesis_video_producer_->getMetricsSnapshot().getContentStoreSizeSize());
+    EXPECT_EQ(kinesis_video_producer_->getMetrics().getContentStoreSizeSize(),
+              kinesis_video_producer_->getMetricsSnapshot().getContentStoreSizeSize());
+    EXPECT_EQ(0, kinesis_video_stream->getMetricsSnapshot().getIngestQueueDroppedFrames());
+
+    // Stopping the sampler keeps the last snapshot
+    kinesis_video_producer_->setMetricsSamplingPeriod(std::chrono::milliseconds(0));
+    EXPECT_NE(0, kinesis_video_producer_->getMetricsSnapshot().getContentStoreSizeSize());
+
+    kinesis_video_stream.reset();
+    freeStreams();
+}
+
+TEST_F(ProducerApiTest, open_metrics_exporter_renders_snapshots)
+{
+    // Check if it's run with the env vars set if not bail out
+    if (!access_key_set_) {
+        return;
+    }
+
+    CreateProducer();
+    kinesis_video_producer_->setMetricsSamplingPeriod(std::chrono::milliseconds(50));
+    streams_[0] = CreateTestStream(0);
+
+    // Allow the sampler to publish the snapshots
+    THREAD_SLEEP(500 * HUNDREDS_OF_NANOS_IN_A_MILLISECOND);
+
+    OpenMetricsExporter exporter(*kinesis_video_producer_);
+    std::string text = exporter.render();
+    EXPECT_NE(std::string::npos, text.find("kvs_producer_content_store_size_bytes "));
+    EXPECT_NE(std::string::npos, text.find("kvs_stream_current_view_bytes{stream=\"ScaryTestStream_0\"}"));
+    EXPECT_NE(std::string::npos, text.find("kvs_stream_put_frame_latency_seconds{stream=\"ScaryTestStream_0\",quantile=\"0.99\"}"));
+    EXPECT_EQ(text.size() - 6, text.rfind("# EOF\n"));
+
+    // Text file mode replaces the file on every period
+    std::string file_path = "kvs_producer_test_metrics.prom";
+    EXPECT_TRUE(exporter.startTextFile(file_path, std::chrono::milliseconds(50)));
+    EXPECT_FALSE(exporter.startTextFile(file_path, std::chrono::milliseconds(50)));
+    THREAD_SLEEP(200 * HUNDREDS_OF_NANOS_IN_A_MILLISECOND);
+    exporter.stop();
+
+    std::ifstream file(file_path);
+    std::string file_text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    EXPECT_NE(std::string::npos, file_text.find("kvs_stream_current_view_bytes{stream=\"ScaryTestStream_0\"}"));
+    std::remove(file_path.c_str());
+
+    freeStreams();
+}
+
+TEST_F(ProducerApiTest, create_streams_concurrently_benchmark)
+{
+    // Check if it's run with the env vars set if not bail out
+    if (!access_key_set_) {
+        return;
+    }
+
+    const uint32_t stream_count = 8;
+    CreateProducer();
+
+    // Baseline with the streams created one after another
+    auto start = steady_clock::now();
+    for (uint32_t i = 0; i < stream_count; i++) {
+        EXPECT_NE(nullptr, CreateTestStream(i));
+    }
+
+    auto sequential_elapsed = duration_cast<milliseconds>(steady_clock::now() - start).count();
+    kinesis_video_producer_->freeStreams();
+
+    vector<unique_ptr<StreamDefinition>> stream_definitions;
+    for (uint32_t i = 0; i < stream_count; i++) {
+        stream_definitions.push_back(CreateTestStreamDefinition(i));
+    }
+
+    // Exceeds the track count and fails to be created
+    stream_definitions.push_back(CreateInvalidTestStreamDefinition(stream_count));
+
+    start = steady_clock::now();
+    auto kinesis_video_streams = kinesis_video_producer_->createStreams(move(stream_definitions), stream_count);
+    ASSERT_EQ(stream_count + 1, kinesis_video_streams.size());
+    for (uint32_t i = 0; i < stream_count; i++) {
+        auto kinesis_video_stream = kinesis_video_streams[i].get();
+        ASSERT_NE(nullptr, kinesis_video_stream);
+        EXPECT_EQ("ScaryTestStream_" + to_string(i), kinesis_video_stream->getStreamName());
+    }
+
+    auto concurrent_elapsed = duration_cast<milliseconds>(steady_clock::now() - start).count();
+    EXPECT_THROW(kinesis_video_streams[stream_count].get(), runtime_error);
+    EXPECT_EQ(stream_count, kinesis_video_producer_->getActiveStreams().size());
+
+    LOG_WARN("Time to all " << stream_count << " streams ready: sequential " << sequential_elapsed
+             << "ms, concurrent " << concurrent_elapsed << "ms");
+
+    kinesis_video_producer_->freeStreams();
+}
+
+TEST_F(ProducerApiTest, stream_pool_hands_over_ready_streams)
+{
+    // Check if it's run with the env vars set if not bail out
+    if (!access_key_set_) {
+        return;
+    }
+
+    CreateProducer();
+    {
+        StreamPool stream_pool(*kinesis_video_producer_, CreateTestStreamDefinition(0),
+                               {"ScaryTestStream_0", "ScaryTestStream_1", "ScaryTestStream_2"}, 2);
+
+        // Allow the pool to fill up
+        for (uint32_t i = 0; i < 100 && stream_pool.getStats().ready < 2; i++) {
+            THREAD_SLEEP(100 * HUNDREDS_OF_NANOS_IN_A_MILLISECOND);
+        }
+
+        ASSERT_EQ(2u, stream_pool.getStats().ready);
+
+        auto start = steady_clock::now();
+        auto first_stream = stream_pool.acquire();
+        auto second_stream = stream_pool.acquire();
+        LOG_WARN("Stream pool hand over time: " << duration_cast<microseconds>(steady_clock::now() - start).count() << "us");
+
+        EXPECT_NE(nullptr, first_stream);
+        EXPECT_NE(nullptr, second_stream);
+        EXPECT_EQ(2u, stream_pool.getStats().hits);
+
+        // The remaining name is refilled in the background
+        for (uint32_t i = 0; i < 100 && stream_pool.getStats().ready < 1; i++) {
+            THREAD_SLEEP(100 * HUNDREDS_OF_NANOS_IN_A_MILLISECOND);
+        }
+
+        auto third_stream = stream_pool.acquire();
+        EXPECT_NE(nullptr, third_stream);
+
+        // All of the names are in use
+        EXPECT_THROW(stream_pool.acquire(), runtime_error);
+        EXPECT_EQ(1u, stream_pool.getStats().misses);
+
+        // The released name is available on a miss
+        stream_pool.release(first_stream);
+        first_stream = stream_pool.acquire();
+        EXPECT_NE(nullptr, first_stream);
+
+        stream_pool.release(first_stream);
+        stream_pool.release(second_stream);
+        stream_pool.release(third_stream);
+    }
+
+    EXPECT_EQ(0u, kinesis_video_producer_->getActiveStreams().size());
+}
+
+TEST_F(ProducerApiTest, stream_pool_recreates_idle_streams)
+{
+    // Check if it's run with the env vars set if not bail out
+    if (!access_key_set_) {
+        return;
+    }
+
+    CreateProducer();
+    StreamPool stream_pool(*kinesis_video_producer_, CreateTestStreamDefinition(0),
+                           {"ScaryTestStream_0", "ScaryTestStream_1"}, 1, std::chrono::seconds(1));
+
+    for (uint32_t i = 0; i < 100 && stream_pool.getStats().expired < 1; i++) {
+        THREAD_SLEEP(100 * HUNDREDS_OF_NANOS_IN_A_MILLISECOND);
+    }
+
+    EXPECT_LE(1u, stream_pool.getStats().expired);
+    EXPECT_EQ(0u, stream_pool.getStats().refill_failures);
+}
+
+TEST_F(ProducerApiTest, producer_pool_places_streams_by_load)
+{
+    // Check if it's run with the env vars set if not bail out
+    if (!access_key_set_) {
+        return;
+    }
+
+    auto producer_pool = ProducerPool::create(2, [this](size_t) {
+        CreateProducer();
+        return move(kinesis_video_producer_);
+    });
+
+    vector<shared_ptr<KinesisVideoStream>> kinesis_video_streams;
+    for (uint32_t i = 0; i < 4; i++) {
+        kinesis_video_streams.push_back(producer_pool->createStreamSync(CreateTestStreamDefinition(i)));
+    }
+
+    EXPECT_EQ(vector<size_t>({2, 2}), producer_pool->getStreamCounts());
+
+    // The freed capacity takes on the new streams
+    for (auto& kinesis_video_stream : kinesis_video_streams) {
+        if (&kinesis_video_stream->getProducer() == &producer_pool->getProducer(0)) {
+            producer_pool->freeStream(kinesis_video_stream);
+            kinesis_video_stream = producer_pool->createStreamSync(CreateTestStreamDefinition(4));
+            EXPECT_EQ(&producer_pool->getProducer(0), &kinesis_video_stream->getProducer());
+            break;
+        }
+    }
+
+    EXPECT_EQ(vector<size_t>({2, 2}), producer_pool->getStreamCounts());
+    EXPECT_EQ(4u, producer_pool->getActiveStreams().size());
+    EXPECT_EQ(producer_pool->getProducer(0).getMetrics().getContentStoreSizeSize() +
+              producer_pool->getProducer(1).getMetrics().getContentStoreSizeSize(),
+              producer_pool->getMetrics().getContentStoreSizeSize());
+
+    producer_pool->freeStreams();
+    EXPECT_EQ(0u, producer_pool->getActiveStreams().size());
+}
+
+TEST_F(ProducerApiTest, producer_pool_scaling_benchmark)
+{
+    // Check if it's run with the env vars set if not bail out
+    if (!access_key_set_) {
+        return;
+    }
+
+    const size_t producer_counts[] = {1, 2, 4, 8};
+    const uint32_t stream_count = 8;
+    const uint32_t frames_per_stream = 1024;
+
+    MEMSET(frameBuffer_, 0x55, SIZEOF(frameBuffer_));
+
+    for (auto producer_count : producer_counts) {
+        auto producer_pool = ProducerPool::create(producer_count, [this](size_t) {
+            CreateProducer();
+            return move(kinesis_video_producer_);
+        });
+
+        vector<shared_ptr<KinesisVideoStream>> kinesis_video_streams;
+        for (uint32_t i = 0; i < stream_count; i++) {
+            kinesis_video_streams.push_back(producer_pool->createStreamSync(CreateTestStreamDefinition(i)));
+            EXPECT_TRUE(StartTestStream(*kinesis_video_streams.back()));
+        }
+
+        for (auto stream_count_per_producer : producer_pool->getStreamCounts()) {
+            EXPECT_EQ(stream_count / producer_count, stream_count_per_producer);
+        }
+
+        std::atomic<uint32_t> failed_frames(0);
+        vector<thread> producer_threads;
+        auto start = steady_clock::now();
+        for (auto& kinesis_video_stream : kinesis_video_streams) {
+            producer_threads.emplace_back([this, &kinesis_video_stream, &failed_frames, frames_per_stream]() {
+                for (uint32_t index = 0; index < frames_per_stream; index++) {
+                    if (!kinesis_video_stream->putFrame(CreateTestFrame(index))) {
+                        failed_frames++;
+                    }
+                }
+            });
+        }
+
+        for (auto& producer_thread : producer_threads) {
+            producer_thread.join();
+        }
+
+        auto elapsed_nanos = duration_cast<nanoseconds>(steady_clock::now() - start).count();
+        LOG_WARN("Producer pool of " << producer_count << " producers, " << stream_count << " streams: "
+                 << (stream_count * frames_per_stream * 1000000000ull) / MAX(elapsed_nanos, 1) << " frames/sec");
+        EXPECT_EQ(0u, failed_frames.load());
+
+        for (auto& kinesis_video_stream : kinesis_video_streams) {
+            kinesis_video_stream->stop();
+        }
+
+        kinesis_video_streams.clear();
+        producer_pool->freeStreams();
+    }
+}
+
+TEST_F(ProducerApiTest, create_streams_reports_failures_per_stream)
+{
+    CreateProducer();
+
+    EXPECT_TRUE(kinesis_video_producer_->createStreams(vector<unique_ptr<StreamDefinition>>(), 4).empty());
+
+    vector<unique_ptr<StreamDefinition>> stream_definitions;
+    for (uint32_t i = 0; i < 3; i++) {
+        stream_definitions.push_back(CreateInvalidTestStreamDefinition(i));
+    }
+
+    auto kinesis_video_streams = kinesis_video_producer_->createStreams(move(stream_definitions), 2);
+    ASSERT_EQ(3u, kinesis_video_streams.size());
+    for (auto& kinesis_video_stream : kinesis_video_streams) {
+        EXPECT_THROW(kinesis_video_stream.get(), runtime_error);
+    }
+
+    EXPECT_EQ(0u, kinesis_video_producer_->getActiveStreams().size());
+}
+
+TEST_F(ProducerApiTest, stream_pool_keeps_names_of_failed_creations)
+{
+    CreateProducer();
+    EXPECT_THROW(StreamPool(*kinesis_video_producer_, nullptr, {"ScaryTestStream_0"}, 1), runtime_error);
+
+    StreamPool stream_pool(*kinesis_video_producer_, CreateInvalidTestStreamDefinition(0), {"ScaryTestStream_0"}, 1);
+    for (uint32_t i = 0; i < 100 && stream_pool.getStats().refill_failures < 1; i++) {
+        THREAD_SLEEP(50 * HUNDREDS_OF_NANOS_IN_A_MILLISECOND);
+    }
+
+    EXPECT_LE(1u, stream_pool.getStats().refill_failures);
+    EXPECT_EQ(0u, stream_pool.getStats().ready);
+
+    // The name is still free so every miss retries the creation
+    for (uint32_t i = 0; i < 3; i++) {
+        EXPECT_THROW(stream_pool.acquire(), runtime_error);
+    }
+
+    EXPECT_EQ(3u, stream_pool.getStats().misses);
+    EXPECT_EQ(0u, stream_pool.getStats().hits);
+}
+
+TEST_F(ProducerApiTest, producer_pool_rolls_back_failed_placement)
+{
+    EXPECT_THROW(ProducerPool::create(0, [this](size_t) {
+        CreateProducer();
+        return move(kinesis_video_producer_);
+    }), runtime_error);
+    EXPECT_THROW(ProducerPool::create(1, [](size_t) {
+        return unique_ptr<KinesisVideoProducer>();
+    }), runtime_error);
+
+    auto producer_pool = ProducerPool::create(2, [this](size_t) {
+        CreateProducer();
+        return move(kinesis_video_producer_);
+    });
+
+    for (uint32_t i = 0; i < 4; i++) {
+        EXPECT_THROW(producer_pool->createStream(CreateInvalidTestStreamDefinition(i)), runtime_error);
+    }
+
+    EXPECT_EQ(vector<size_t>({0, 0}), producer_pool->getStreamCounts());
+    EXPECT_EQ(0u, producer_pool->getActiveStreams().size());
+}
+
+TEST_F(ProducerApiTest, metrics_sampler_publishes_producer_snapshots)
+{
+    CreateProducer();
+    kinesis_video_producer_->setMetricsSamplingPeriod(std::chrono::milliseconds(50));
+
+    for (uint32_t i = 0; i < 100 && 0 == kinesis_video_producer_->getMetricsSnapshot().getContentStoreSizeSize(); i++) {
+        THREAD_SLEEP(10 * HUNDREDS_OF_NANOS_IN_A_MILLISECOND);
+    }
+
+    EXPECT_EQ(kinesis_video_producer_->getMetrics().getContentStoreSizeSize(),
+              kinesis_video_producer_->getMetricsSnapshot().getContentStoreSizeSize());
+
+    // Stopping the sampler keeps the last snapshot
+    kinesis_video_producer_->setMetricsSamplingPeriod(std::chrono::milliseconds(0));
+    EXPECT_NE(0, kinesis_video_producer_->getMetricsSnapshot().getContentStoreSizeSize());
+}
+
+TEST_F(ProducerApiTest, open_metrics_exporter_renders_producer_without_streams)
+{
+    CreateProducer();
+    kinesis_video_producer_->setMetricsSamplingPeriod(std::chrono::milliseconds(50));
+
+    OpenMetricsExporter exporter(*kinesis_video_producer_);
+    std::string text = exporter.render();
+    EXPECT_NE(std::string::npos, text.find("# TYPE kvs_producer_content_store_size_bytes gauge\n"));
+    EXPECT_NE(std::string::npos, text.find("kvs_producer_content_store_size_bytes "));
+    EXPECT_EQ(std::string::npos, text.find("{stream="));
+    EXPECT_EQ(text.size() - 6, text.rfind("# EOF\n"));
+
+    EXPECT_FALSE(exporter.startTextFile("", std::chrono::milliseconds(50)));
+    EXPECT_FALSE(exporter.startTextFile("kvs_producer_test_metrics.prom", std::chrono::milliseconds(0)));
+}
+
 }  // namespace video
 }  // namespace kinesis
 }  // namespace amazonaws
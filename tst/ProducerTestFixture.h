@@ -342,10 +342,11 @@ protected:
         }
     };
 
-    std::shared_ptr<KinesisVideoStream> CreateTestStream(int index,
-                                                    STREAMING_TYPE streaming_type = STREAMING_TYPE_REALTIME,
-                                                    uint32_t max_stream_latency_ms = TEST_MAX_STREAM_LATENCY_IN_MILLIS,
-                                                    int buffer_duration_seconds = 120) {
+    std::unique_ptr<StreamDefinition> CreateTestStreamDefinition(int index,
+                                                                 STREAMING_TYPE streaming_type = STREAMING_TYPE_REALTIME,
+                                                                 uint32_t max_stream_latency_ms = TEST_MAX_STREAM_LATENCY_IN_MILLIS,
+                                                                 int buffer_duration_seconds = 120,
+                                                                 uint32_t ingest_queue_capacity = 0) {
         char stream_name[MAX_STREAM_NAME_LEN];
         sprintf(stream_name, "ScaryTestStream_%d", index);
         std::map<std::string, std::string> tags;
@@ -379,9 +380,52 @@ protected:
                 std::chrono::seconds(buffer_duration_seconds),
                 std::chrono::seconds(buffer_duration_seconds),
                 std::chrono::seconds(50)));
-        return kinesis_video_producer_->createStreamSync(move(stream_definition));
+        stream_definition->setAsyncIngestQueueCapacity(ingest_queue_capacity);
+        return stream_definition;
+    };
+
+    std::shared_ptr<KinesisVideoStream> CreateTestStream(int index,
+                                                    STREAMING_TYPE streaming_type = STREAMING_TYPE_REALTIME,
+                                                    uint32_t max_stream_latency_ms = TEST_MAX_STREAM_LATENCY_IN_MILLIS,
+                                                    int buffer_duration_seconds = 120,
+                                                    uint32_t ingest_queue_capacity = 0) {
+        return kinesis_video_producer_->createStreamSync(CreateTestStreamDefinition(index,
+                                                                                    streaming_type,
+                                                                                    max_stream_latency_ms,
+                                                                                    buffer_duration_seconds,
+                                                                                    ingest_queue_capacity));
     };
 
+    /**
+     * Starts the stream with the H264 codec private data matching the test frames
+     */
+    bool StartTestStream(KinesisVideoStream& kinesis_video_stream) {
+        BYTE cpd[] = {0x00, 0x00, 0x00, 0x01, 0x67, 0x64, 0x00, 0x34,
+                      0xAC, 0x2B, 0x40, 0x1E, 0x00, 0x78, 0xD8, 0x08,
+                      0x80, 0x00, 0x01, 0xF4, 0x00, 0x00, 0xEA, 0x60,
+                      0x47, 0xA5, 0x50, 0x00, 0x00, 0x00, 0x01, 0x68,
+                      0xEE, 0x3C, 0xB0};
+        return kinesis_video_stream.start(cpd, SIZEOF(cpd), DEFAULT_TRACK_ID);
+    }
+
+    /**
+     * Creates the offline streaming frame with the index pointing to the test frame buffer.
+     * Every key_frame_interval_ frame is a key frame.
+     */
+    Frame CreateTestFrame(uint32_t index) {
+        Frame frame;
+        frame.version = FRAME_CURRENT_VERSION;
+        frame.index = index;
+        frame.flags = (index % key_frame_interval_ == 0) ? FRAME_FLAG_KEY_FRAME : FRAME_FLAG_NONE;
+        frame.decodingTs = index * TEST_FRAME_DURATION;
+        frame.presentationTs = frame.decodingTs;
+        frame.duration = TEST_FRAME_DURATION;
+        frame.size = SIZEOF(frameBuffer_);
+        frame.frameData = frameBuffer_;
+        frame.trackId = DEFAULT_TRACK_ID;
+        return frame;
+    }
+
     virtual void SetUp() {
         LOG_INFO("Setting up test: " << GetTestName());
     };
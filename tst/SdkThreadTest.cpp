@@ -0,0 +1,137 @@
+#include "ProducerTestFixture.h"
+#include "SdkThread.h"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+using namespace std;
+using namespace std::chrono;
+
+#define TEST_THREAD_NAME_PREFIX                             "kvstest"
+#define TEST_THREAD_STACK_SIZE                              (256 * 1024)
+#define TEST_THREAD_BUSY_MILLIS                             50
+
+#if defined(__linux__)
+
+class SdkThreadTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ThreadPolicy thread_policy;
+        thread_policy.cpu_affinity.push_back(0);
+        thread_policy.stack_size = TEST_THREAD_STACK_SIZE;
+        thread_policy.name_prefix = TEST_THREAD_NAME_PREFIX;
+        SdkThread::setPolicy(thread_policy);
+    }
+
+    void TearDown() override {
+        SdkThread::setPolicy(ThreadPolicy());
+    }
+};
+
+struct ThreadPlacement {
+    string name;
+    size_t stack_size;
+    int cpu_count;
+    bool on_cpu_0;
+};
+
+void getThreadPlacement(ThreadPlacement& placement) {
+    char name[MAX_THREAD_NAME_LEN + 1] = {0};
+    pthread_getname_np(pthread_self(), name, sizeof(name));
+    placement.name = name;
+
+    pthread_attr_t attr;
+    pthread_getattr_np(pthread_self(), &attr);
+    pthread_attr_getstacksize(&attr, &placement.stack_size);
+    pthread_attr_destroy(&attr);
+
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    pthread_getaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+    placement.cpu_count = CPU_COUNT(&cpu_set);
+    placement.on_cpu_0 = CPU_ISSET(0, &cpu_set);
+}
+
+PVOID clientRoutine(PVOID args) {
+    getThreadPlacement(*reinterpret_cast<ThreadPlacement*>(args));
+    return NULL;
+}
+
+bool findCpuTime(const string& name, bool running, nanoseconds& cpu_time) {
+    for (auto& thread_cpu_time : SdkThread::getCpuTimes()) {
+        if (name == thread_cpu_time.name && running == (0 != thread_cpu_time.thread_id)) {
+            cpu_time = thread_cpu_time.cpu_time;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+TEST_F(SdkThreadTest, worker_threads_follow_policy)
+{
+    ThreadPlacement placement;
+    nanoseconds running_cpu_time(0);
+    std::atomic<bool> busy(true);
+    auto worker_thread = SdkThread::start("worker", [&placement, &busy]() {
+        getThreadPlacement(placement);
+        while (busy) {
+        }
+    });
+
+    this_thread::sleep_for(milliseconds(TEST_THREAD_BUSY_MILLIS));
+    EXPECT_TRUE(findCpuTime(TEST_THREAD_NAME_PREFIX "-worker", true, running_cpu_time));
+    busy = false;
+    worker_thread.join();
+
+    EXPECT_EQ(TEST_THREAD_NAME_PREFIX "-worker", placement.name);
+    EXPECT_EQ(1, placement.cpu_count);
+    EXPECT_TRUE(placement.on_cpu_0);
+
+    // The CPU time of the exited thread is kept in the total of its name
+    nanoseconds exited_cpu_time(0);
+    EXPECT_FALSE(findCpuTime(TEST_THREAD_NAME_PREFIX "-worker", true, running_cpu_time));
+    ASSERT_TRUE(findCpuTime(TEST_THREAD_NAME_PREFIX "-worker", false, exited_cpu_time));
+    EXPECT_LT(0, exited_cpu_time.count());
+}
+
+TEST_F(SdkThreadTest, client_threads_follow_policy)
+{
+    ThreadPlacement placement;
+    TID thread_id = INVALID_TID_VALUE;
+    ASSERT_EQ(STATUS_SUCCESS, SdkThread::createClientThread(&thread_id, clientRoutine, &placement));
+    EXPECT_EQ(0, pthread_join((pthread_t) thread_id, NULL));
+
+    EXPECT_EQ(TEST_THREAD_NAME_PREFIX "-client", placement.name);
+    EXPECT_LE((size_t) TEST_THREAD_STACK_SIZE, placement.stack_size);
+
+    // The stack size of the threads created without the policy
+    ThreadPlacement default_placement;
+    thread([&default_placement]() { getThreadPlacement(default_placement); }).join();
+    EXPECT_GT(default_placement.stack_size, placement.stack_size);
+    EXPECT_EQ(1, placement.cpu_count);
+
+    EXPECT_EQ(STATUS_NULL_ARG, SdkThread::createClientThread(NULL, clientRoutine, &placement));
+}
+
+TEST_F(SdkThreadTest, long_thread_names_are_truncated)
+{
+    ThreadPolicy thread_policy;
+    thread_policy.name_prefix = "kvs-long-prefix";
+    SdkThread::setPolicy(thread_policy);
+
+    ThreadPlacement placement;
+    SdkThread::start("worker", [&placement]() { getThreadPlacement(placement); }).join();
+    EXPECT_EQ(string("kvs-long-prefix-worker").substr(0, MAX_THREAD_NAME_LEN), placement.name);
+}
+
+#endif
+
+}  // namespace video
+}  // namespace kinesis
+}  // namespace amazonaws
+}  // namespace com
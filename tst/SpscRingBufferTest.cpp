@@ -0,0 +1,149 @@
+#include "ProducerTestFixture.h"
+#include "SpscRingBuffer.h"
+
+#include <thread>
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+using namespace std;
+
+#define TEST_RING_CAPACITY                                  5
+#define TEST_RING_ROUNDED_CAPACITY                          8
+#define TEST_RING_ITEM_COUNT                                100000
+
+TEST(SpscRingBufferTest, capacity_is_rounded_up_to_power_of_two)
+{
+    EXPECT_EQ(1, SpscRingBuffer<uint32_t>(0).capacity());
+    EXPECT_EQ(1, SpscRingBuffer<uint32_t>(1).capacity());
+    EXPECT_EQ(TEST_RING_ROUNDED_CAPACITY, SpscRingBuffer<uint32_t>(TEST_RING_CAPACITY).capacity());
+    EXPECT_EQ(TEST_RING_ROUNDED_CAPACITY, SpscRingBuffer<uint32_t>(TEST_RING_ROUNDED_CAPACITY).capacity());
+}
+
+TEST(SpscRingBufferTest, claim_fails_when_full_and_front_fails_when_empty)
+{
+    SpscRingBuffer<uint32_t> ring(TEST_RING_CAPACITY);
+    EXPECT_TRUE(ring.empty());
+    EXPECT_EQ(nullptr, ring.front());
+
+    for (uint32_t i = 0; i < TEST_RING_ROUNDED_CAPACITY; i++) {
+        uint32_t* slot = ring.claim();
+        ASSERT_NE(nullptr, slot);
+        *slot = i;
+        ring.publish();
+    }
+
+    EXPECT_EQ(TEST_RING_ROUNDED_CAPACITY, ring.size());
+    EXPECT_EQ(nullptr, ring.claim());
+
+    // Popping one slot frees up exactly one slot
+    ring.pop();
+    EXPECT_NE(nullptr, ring.claim());
+}
+
+TEST(SpscRingBufferTest, claimed_slot_is_invisible_until_published)
+{
+    SpscRingBuffer<uint32_t> ring(TEST_RING_CAPACITY);
+
+    uint32_t* slot = ring.claim();
+    ASSERT_NE(nullptr, slot);
+    *slot = 1;
+    EXPECT_EQ(nullptr, ring.front());
+    EXPECT_TRUE(ring.empty());
+
+    ring.publish();
+    ASSERT_NE(nullptr, ring.front());
+    EXPECT_EQ(1, *ring.front());
+}
+
+TEST(SpscRingBufferTest, batch_is_claimed_and_published_at_once)
+{
+    SpscRingBuffer<uint32_t> ring(TEST_RING_CAPACITY);
+    EXPECT_EQ(TEST_RING_ROUNDED_CAPACITY, ring.available());
+
+    // Offsets past the free slots can't be claimed
+    EXPECT_EQ(nullptr, ring.claim(TEST_RING_ROUNDED_CAPACITY));
+    for (uint32_t i = 0; i < TEST_RING_CAPACITY; i++) {
+        uint32_t* slot = ring.claim(i);
+        ASSERT_NE(nullptr, slot);
+        *slot = i;
+    }
+
+    EXPECT_TRUE(ring.empty());
+    ring.publish(TEST_RING_CAPACITY);
+    EXPECT_EQ(TEST_RING_CAPACITY, ring.size());
+    EXPECT_EQ(TEST_RING_ROUNDED_CAPACITY - TEST_RING_CAPACITY, ring.available());
+    EXPECT_EQ(nullptr, ring.claim(TEST_RING_ROUNDED_CAPACITY - TEST_RING_CAPACITY));
+
+    for (uint32_t i = 0; i < TEST_RING_CAPACITY; i++) {
+        ASSERT_NE(nullptr, ring.front());
+        EXPECT_EQ(i, *ring.front());
+        ring.pop();
+    }
+
+    EXPECT_EQ(TEST_RING_ROUNDED_CAPACITY, ring.available());
+}
+
+TEST(SpscRingBufferTest, slots_are_reused_in_fifo_order_across_laps)
+{
+    SpscRingBuffer<vector<uint8_t>> ring(TEST_RING_CAPACITY);
+
+    for (uint32_t i = 0; i < 3 * TEST_RING_ROUNDED_CAPACITY; i++) {
+        vector<uint8_t>* slot = ring.claim();
+        ASSERT_NE(nullptr, slot);
+
+        // The slot keeps the allocation of the previous lap
+        if (i >= TEST_RING_ROUNDED_CAPACITY) {
+            EXPECT_LE(i - TEST_RING_ROUNDED_CAPACITY + 1, slot->capacity());
+        }
+
+        slot->assign(i + 1, (uint8_t) i);
+        ring.publish();
+
+        vector<uint8_t>* item = ring.front();
+        ASSERT_EQ(slot, item);
+        EXPECT_EQ(i + 1, item->size());
+        EXPECT_EQ((uint8_t) i, item->back());
+        ring.pop();
+    }
+
+    EXPECT_TRUE(ring.empty());
+}
+
+TEST(SpscRingBufferTest, concurrent_producer_and_consumer_keep_order)
+{
+    SpscRingBuffer<uint32_t> ring(TEST_RING_CAPACITY);
+
+    thread producer([&ring]() {
+        for (uint32_t i = 0; i < TEST_RING_ITEM_COUNT;) {
+            uint32_t* slot = ring.claim();
+            if (nullptr == slot) {
+                this_thread::yield();
+                continue;
+            }
+
+            *slot = i++;
+            ring.publish();
+        }
+    });
+
+    uint32_t expected = 0;
+    while (expected < TEST_RING_ITEM_COUNT) {
+        uint32_t* item = ring.front();
+        if (nullptr == item) {
+            this_thread::yield();
+            continue;
+        }
+
+        ASSERT_EQ(expected, *item);
+        expected++;
+        ring.pop();
+    }
+
+    producer.join();
+    EXPECT_TRUE(ring.empty());
+}
+
+}  // namespace video
+}  // namespace kinesis
+}  // namespace amazonaws
+}  // namespace com
@@ -0,0 +1,109 @@
+#include "ProducerTestFixture.h"
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+using namespace std;
+using namespace std::chrono;
+
+#define TEST_TEMPLATE_TAG_COUNT                             5
+
+static const uint8_t TEST_CPD[] = {0x01, 0x42, 0x00, 0x1e, 0xff, 0xe1};
+static const uint8_t TEST_OTHER_CPD[] = {0x01, 0x64, 0x00, 0x28};
+
+map<string, string> makeTags(const string& value) {
+    map<string, string> tags;
+    for (uint32_t i = 0; i < TEST_TEMPLATE_TAG_COUNT; i++) {
+        tags["tag" + to_string(i)] = value + to_string(i);
+    }
+
+    return tags;
+}
+
+unique_ptr<StreamDefinition> makeDefinition(const string& stream_name, const map<string, string>& tags) {
+    return unique_ptr<StreamDefinition>(new StreamDefinition(stream_name,
+                                                             hours(2),
+                                                             &tags,
+                                                             "",
+                                                             STREAMING_TYPE_REALTIME,
+                                                             "video/h264",
+                                                             milliseconds::zero(),
+                                                             seconds(2),
+                                                             milliseconds(1),
+                                                             true,
+                                                             true,
+                                                             true,
+                                                             true,
+                                                             true,
+                                                             true,
+                                                             NAL_ADAPTATION_ANNEXB_NALS | NAL_ADAPTATION_ANNEXB_CPD_NALS,
+                                                             30,
+                                                             4 * 1024 * 1024,
+                                                             seconds(120),
+                                                             seconds(40),
+                                                             seconds(30),
+                                                             "V_MPEG4/ISO/AVC",
+                                                             "kinesis_video",
+                                                             TEST_CPD,
+                                                             SIZEOF(TEST_CPD)));
+}
+
+TEST(StreamDefinitionTest, stream_info_is_materialized_once)
+{
+    auto tags = makeTags("value");
+    auto stream_definition = makeDefinition("stream", tags);
+
+    const StreamInfo& stream_info = stream_definition->getStreamInfo();
+    PTrackInfo track_info_list = stream_info.streamCaps.trackInfoList;
+    PTag stream_tags = stream_info.tags;
+    EXPECT_EQ(track_info_list, stream_definition->getStreamInfo().streamCaps.trackInfoList);
+    EXPECT_EQ(stream_tags, stream_definition->getStreamInfo().tags);
+
+    ASSERT_EQ(1u, stream_info.streamCaps.trackInfoCount);
+    EXPECT_EQ(TEST_CPD, stream_info.streamCaps.trackInfoList[0].codecPrivateData);
+    EXPECT_STREQ("V_MPEG4/ISO/AVC", stream_info.streamCaps.trackInfoList[0].codecId);
+
+    ASSERT_EQ(TEST_TEMPLATE_TAG_COUNT, stream_info.tagCount);
+    EXPECT_STREQ("tag0", stream_info.tags[0].name);
+    EXPECT_STREQ("value0", stream_info.tags[0].value);
+
+    // The definition owns the copy of the tags
+    tags.clear();
+    EXPECT_STREQ("value4", stream_definition->getStreamInfo().tags[4].value);
+
+    stream_definition->addTrack(2, "audio", "A_AAC", MKV_TRACK_INFO_TYPE_AUDIO);
+    EXPECT_EQ(2u, stream_definition->getStreamInfo().streamCaps.trackInfoCount);
+    EXPECT_EQ(2u, stream_definition->getStreamInfo().streamCaps.trackInfoList[1].trackId);
+}
+
+TEST(StreamDefinitionTest, clone_applies_overrides)
+{
+    auto tags = makeTags("base");
+    auto base_definition = makeDefinition("base", tags);
+    base_definition->setAsyncIngestQueueCapacity(64);
+
+    auto stream_definition = base_definition->clone("camera_1");
+    stream_definition->setTags(makeTags("camera_1"));
+    stream_definition->setCodecPrivateData(DEFAULT_TRACK_ID, TEST_OTHER_CPD, SIZEOF(TEST_OTHER_CPD));
+    EXPECT_THROW(stream_definition->setCodecPrivateData(DEFAULT_TRACK_ID + 1, TEST_OTHER_CPD, SIZEOF(TEST_OTHER_CPD)), runtime_error);
+
+    const StreamInfo& stream_info = stream_definition->getStreamInfo();
+    EXPECT_EQ("camera_1", stream_definition->getStreamName());
+    EXPECT_STREQ("camera_1", stream_info.name);
+    EXPECT_EQ(64u, stream_definition->getAsyncIngestQueueCapacity());
+    EXPECT_EQ(30u, stream_info.streamCaps.frameRate);
+    EXPECT_EQ(TEST_OTHER_CPD, stream_info.streamCaps.trackInfoList[0].codecPrivateData);
+    EXPECT_EQ(SIZEOF(TEST_OTHER_CPD), stream_info.streamCaps.trackInfoList[0].codecPrivateDataSize);
+    EXPECT_STREQ("camera_10", stream_info.tags[0].value);
+
+    // The template is unaffected
+    const StreamInfo& base_stream_info = base_definition->getStreamInfo();
+    EXPECT_STREQ("base", base_stream_info.name);
+    EXPECT_EQ(TEST_CPD, base_stream_info.streamCaps.trackInfoList[0].codecPrivateData);
+    EXPECT_STREQ("base0", base_stream_info.tags[0].value);
+    EXPECT_NE(base_stream_info.streamCaps.trackInfoList, stream_info.streamCaps.trackInfoList);
+}
+
+}  // namespace video
+}  // namespace kinesis
+}  // namespace amazonaws
+}  // namespace com
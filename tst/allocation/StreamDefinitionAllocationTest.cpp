@@ -0,0 +1,165 @@
+/**
+ * Heap allocation tests. Built as an executable of their own as they replace the global operator new.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <map>
+#include <new>
+
+#include "StreamDefinition.h"
+
+/**
+ * Allocations are counted on the thread which enables the counting only so that the SDK threads and
+ * the gtest internals don't skew the counts
+ */
+static thread_local bool t_count_allocations = false;
+static thread_local uint64_t t_allocation_count = 0;
+
+void* operator new(size_t size) {
+    if (t_count_allocations) {
+        t_allocation_count++;
+    }
+
+    void* ptr = malloc(0 == size ? 1 : size);
+    if (nullptr == ptr) {
+        throw std::bad_alloc();
+    }
+
+    return ptr;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    free(ptr);
+}
+
+namespace com { namespace amazonaws { namespace kinesis { namespace video {
+
+using namespace std;
+using namespace std::chrono;
+
+#define TEST_STREAM_DEFINITION_COUNT                        500
+#define TEST_TEMPLATE_TAG_COUNT                             5
+
+static const uint8_t TEST_CPD[] = {0x01, 0x42, 0x00, 0x1e, 0xff, 0xe1};
+
+/**
+ * Counts the allocations of the calling thread in the scope
+ */
+class AllocationCounter {
+public:
+    AllocationCounter() : start_count_(t_allocation_count) {
+        t_count_allocations = true;
+    }
+
+    ~AllocationCounter() {
+        t_count_allocations = false;
+    }
+
+    uint64_t getCount() const {
+        return t_allocation_count - start_count_;
+    }
+
+private:
+    const uint64_t start_count_;
+};
+
+static map<string, string> makeTags(const string& value) {
+    map<string, string> tags;
+    for (uint32_t i = 0; i < TEST_TEMPLATE_TAG_COUNT; i++) {
+        tags["tag" + to_string(i)] = value + to_string(i);
+    }
+
+    return tags;
+}
+
+static unique_ptr<StreamDefinition> makeDefinition(const string& stream_name, const map<string, string>& tags) {
+    return unique_ptr<StreamDefinition>(new StreamDefinition(stream_name,
+                                                             hours(2),
+                                                             &tags,
+                                                             "",
+                                                             STREAMING_TYPE_REALTIME,
+                                                             "video/h264",
+                                                             milliseconds::zero(),
+                                                             seconds(2),
+                                                             milliseconds(1),
+                                                             true,
+                                                             true,
+                                                             true,
+                                                             true,
+                                                             true,
+                                                             true,
+                                                             NAL_ADAPTATION_ANNEXB_NALS | NAL_ADAPTATION_ANNEXB_CPD_NALS,
+                                                             30,
+                                                             4 * 1024 * 1024,
+                                                             seconds(120),
+                                                             seconds(40),
+                                                             seconds(30),
+                                                             "V_MPEG4/ISO/AVC",
+                                                             "kinesis_video",
+                                                             TEST_CPD,
+                                                             sizeof(TEST_CPD)));
+}
+
+TEST(StreamDefinitionAllocationTest, cloned_definition_allocates_less)
+{
+    auto tags = makeTags("value");
+    vector<unique_ptr<StreamDefinition>> stream_definitions;
+    stream_definitions.reserve(TEST_STREAM_DEFINITION_COUNT);
+
+    uint64_t full_allocations;
+    {
+        AllocationCounter allocation_counter;
+        for (uint32_t i = 0; i < TEST_STREAM_DEFINITION_COUNT; i++) {
+            stream_definitions.push_back(makeDefinition("camera_" + to_string(i), tags));
+            stream_definitions.back()->getStreamInfo();
+        }
+
+        full_allocations = allocation_counter.getCount();
+    }
+
+    stream_definitions.clear();
+    auto base_definition = makeDefinition("template", tags);
+
+    uint64_t clone_allocations;
+    {
+        AllocationCounter allocation_counter;
+        for (uint32_t i = 0; i < TEST_STREAM_DEFINITION_COUNT; i++) {
+            stream_definitions.push_back(base_definition->clone("camera_" + to_string(i)));
+            stream_definitions.back()->getStreamInfo();
+        }
+
+        clone_allocations = allocation_counter.getCount();
+    }
+
+    RecordProperty("full_allocations_per_stream", (int) (full_allocations / TEST_STREAM_DEFINITION_COUNT));
+    RecordProperty("cloned_allocations_per_stream", (int) (clone_allocations / TEST_STREAM_DEFINITION_COUNT));
+    EXPECT_LT(clone_allocations, full_allocations);
+}
+
+}  // namespace video
+}  // namespace kinesis
+}  // namespace amazonaws
+}  // namespace com
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}